@@ -318,7 +318,99 @@
                     A.pid = NEW.id AND B.id = NEW.pid;
                 END;</statement>
             </dbaction>
-            
+
+            <!-- Full text index for text searches. Optional: requires SQLite with FTS4.
+                 The index tables store their own copy of the text, so that stale entries
+                 left by REPLACE statements (which do not fire delete triggers) can be removed -->
+            <dbaction name="CreateTextIndex" mode="transaction">
+                <statement mode="plain">CREATE VIRTUAL TABLE ImagesFts USING fts4(name);</statement>
+                <statement mode="plain">CREATE VIRTUAL TABLE ImageCommentsFts USING fts4(comment);</statement>
+                <statement mode="plain">CREATE VIRTUAL TABLE TagsFts USING fts4(name);</statement>
+                <statement mode="plain">INSERT INTO ImagesFts (docid, name) SELECT id, name FROM Images;</statement>
+                <statement mode="plain">INSERT INTO ImageCommentsFts (docid, comment) SELECT id, comment FROM ImageComments;</statement>
+                <statement mode="plain">INSERT INTO TagsFts (docid, name) SELECT id, name FROM Tags;</statement>
+                <statement mode="plain">CREATE TRIGGER fts_insert_image AFTER INSERT ON Images
+                    BEGIN
+                        DELETE FROM ImagesFts WHERE docid=NEW.id;
+                        INSERT INTO ImagesFts (docid, name) VALUES (NEW.id, NEW.name);
+                    END;
+                </statement>
+                <statement mode="plain">CREATE TRIGGER fts_update_image AFTER UPDATE OF name ON Images
+                    BEGIN
+                        DELETE FROM ImagesFts WHERE docid=OLD.id;
+                        INSERT INTO ImagesFts (docid, name) VALUES (NEW.id, NEW.name);
+                    END;
+                </statement>
+                <statement mode="plain">CREATE TRIGGER fts_delete_image AFTER DELETE ON Images
+                    BEGIN
+                        DELETE FROM ImagesFts WHERE docid=OLD.id;
+                    END;
+                </statement>
+                <statement mode="plain">CREATE TRIGGER fts_insert_comment AFTER INSERT ON ImageComments
+                    BEGIN
+                        DELETE FROM ImageCommentsFts WHERE docid=NEW.id;
+                        INSERT INTO ImageCommentsFts (docid, comment) VALUES (NEW.id, NEW.comment);
+                    END;
+                </statement>
+                <statement mode="plain">CREATE TRIGGER fts_update_comment AFTER UPDATE OF comment ON ImageComments
+                    BEGIN
+                        DELETE FROM ImageCommentsFts WHERE docid=OLD.id;
+                        INSERT INTO ImageCommentsFts (docid, comment) VALUES (NEW.id, NEW.comment);
+                    END;
+                </statement>
+                <statement mode="plain">CREATE TRIGGER fts_delete_comment AFTER DELETE ON ImageComments
+                    BEGIN
+                        DELETE FROM ImageCommentsFts WHERE docid=OLD.id;
+                    END;
+                </statement>
+                <statement mode="plain">CREATE TRIGGER fts_insert_tag AFTER INSERT ON Tags
+                    BEGIN
+                        DELETE FROM TagsFts WHERE docid=NEW.id;
+                        INSERT INTO TagsFts (docid, name) VALUES (NEW.id, NEW.name);
+                    END;
+                </statement>
+                <statement mode="plain">CREATE TRIGGER fts_update_tag AFTER UPDATE OF name ON Tags
+                    BEGIN
+                        DELETE FROM TagsFts WHERE docid=OLD.id;
+                        INSERT INTO TagsFts (docid, name) VALUES (NEW.id, NEW.name);
+                    END;
+                </statement>
+                <statement mode="plain">CREATE TRIGGER fts_delete_tag AFTER DELETE ON Tags
+                    BEGIN
+                        DELETE FROM TagsFts WHERE docid=OLD.id;
+                    END;
+                </statement>
+            </dbaction>
+
+            <!-- Spatial index on image positions. Optional: requires SQLite with the R*Tree module -->
+            <dbaction name="CreateSpatialIndex" mode="transaction">
+                <statement mode="plain">CREATE VIRTUAL TABLE ImagePositionsRTree USING rtree(id, minLat, maxLat, minLng, maxLng);</statement>
+                <statement mode="plain">INSERT INTO ImagePositionsRTree (id, minLat, maxLat, minLng, maxLng)
+                    SELECT imageid, latitudeNumber, latitudeNumber, longitudeNumber, longitudeNumber FROM ImagePositions
+                    WHERE latitudeNumber IS NOT NULL AND longitudeNumber IS NOT NULL;</statement>
+                <statement mode="plain">CREATE TRIGGER rtree_insert_position AFTER INSERT ON ImagePositions
+                    BEGIN
+                        DELETE FROM ImagePositionsRTree WHERE id=NEW.imageid;
+                        INSERT INTO ImagePositionsRTree (id, minLat, maxLat, minLng, maxLng)
+                            SELECT NEW.imageid, NEW.latitudeNumber, NEW.latitudeNumber, NEW.longitudeNumber, NEW.longitudeNumber
+                            WHERE NEW.latitudeNumber IS NOT NULL AND NEW.longitudeNumber IS NOT NULL;
+                    END;
+                </statement>
+                <statement mode="plain">CREATE TRIGGER rtree_update_position AFTER UPDATE OF latitudeNumber, longitudeNumber ON ImagePositions
+                    BEGIN
+                        DELETE FROM ImagePositionsRTree WHERE id=OLD.imageid;
+                        INSERT INTO ImagePositionsRTree (id, minLat, maxLat, minLng, maxLng)
+                            SELECT NEW.imageid, NEW.latitudeNumber, NEW.latitudeNumber, NEW.longitudeNumber, NEW.longitudeNumber
+                            WHERE NEW.latitudeNumber IS NOT NULL AND NEW.longitudeNumber IS NOT NULL;
+                    END;
+                </statement>
+                <statement mode="plain">CREATE TRIGGER rtree_delete_position AFTER DELETE ON ImagePositions
+                    BEGIN
+                        DELETE FROM ImagePositionsRTree WHERE id=OLD.imageid;
+                    END;
+                </statement>
+            </dbaction>
+
             <dbaction name="getItemURLsInAlbumByItemName">
                 <statement mode="query">SELECT Albums.relativePath, Images.name FROM Images INNER JOIN Albums ON Albums.id=Images.album WHERE Albums.id=:albumID ORDER BY Images.name COLLATE NOCASE;</statement>
             </dbaction>
@@ -950,7 +1042,21 @@
             ORDER BY parent.lft;
             END;</statement>
             </dbaction>
-                       
+
+            <!-- Full text index for text searches. Optional: requires a storage engine
+                 supporting FULLTEXT indexes (MyISAM, or InnoDB since MySQL 5.6) -->
+            <dbaction name="CreateTextIndex">
+                <statement mode="plain">ALTER TABLE Images ADD FULLTEXT images_name_fulltext (name);</statement>
+                <statement mode="plain">ALTER TABLE ImageComments ADD FULLTEXT comments_fulltext (comment);</statement>
+                <statement mode="plain">ALTER TABLE Tags ADD FULLTEXT tags_name_fulltext (name);</statement>
+            </dbaction>
+
+            <!-- Index on image positions. A SPATIAL index would require a geometry column and MyISAM,
+                 the rectangle queries can use an index on the coordinate columns as well -->
+            <dbaction name="CreateSpatialIndex">
+                <statement mode="plain">CREATE INDEX positions_coordinates_index ON ImagePositions (latitudeNumber, longitudeNumber);</statement>
+            </dbaction>
+
             <dbaction name="checkIfDatabaseExists">
                 <statement mode="query">SELECT Albums.relativePath, Images.name FROM Images INNER JOIN Albums ON Albums.id=Images.album WHERE Albums.id=:albumID ORDER BY Images.name;</statement>
             </dbaction>
@@ -92,6 +92,7 @@ extern "C"
 #include "databasewatch.h"
 #include "dio.h"
 #include "imagelister.h"
+#include "previewdiskcache.h"
 #include "scancontroller.h"
 #include "setupcollections.h"
 #include "setup.h"
@@ -980,6 +981,9 @@ bool AlbumManager::setDatabase(const DatabaseParameters& params, bool priority,
     QApplication::restoreOverrideCursor();
 #endif
 
+    // identify previews on disk by the unique hash of the file
+    PreviewDiskCache::instance()->setInfoProvider(new DatabaseThumbnailInfoProvider());
+
     // -- ---------------------------------------------------------
 
     // measures to filter out KDirWatch signals caused by database operations
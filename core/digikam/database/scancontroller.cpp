@@ -97,6 +97,7 @@ public:
         needsInitialization(false),
         needsCompleteScan(false),
         needsUpdateUniqueHash(false),
+        needsBackgroundHashUpdate(false),
         idle(false),
         scanSuspended(0),
         continueInitialization(false),
@@ -117,6 +118,7 @@ public:
     bool                      needsInitialization;
     bool                      needsCompleteScan;
     bool                      needsUpdateUniqueHash;
+    bool                      needsBackgroundHashUpdate;
     bool                      idle;
 
     int                       scanSuspended;
@@ -226,6 +228,26 @@ public:
     }
 };
 
+/** Interrupts the background update of unique hashes as soon as there is any other task
+ */
+class BackgroundHashUpdateObserver : public CollectionScannerObserver
+{
+public:
+
+    BackgroundHashUpdateObserver(ScanControllerPriv* d) : d(d)
+    {
+    }
+
+    bool continueQuery()
+    {
+        QMutexLocker lock(&d->mutex);
+        return d->running && !d->scanSuspended && !d->needsCompleteScan && !d->needsUpdateUniqueHash
+               && d->scanTasks.isEmpty();
+    }
+
+    ScanControllerPriv* const d;
+};
+
 class ScanControllerLoadingCacheFileWatch : public ClassicLoadingCacheFileWatch
 {
     Q_OBJECT
@@ -394,7 +416,6 @@ ScanController::Advice ScanController::databaseInitialization()
     {
         d->fileWatchInstalled = true; // once per application lifetime only
         LoadingCache* cache = LoadingCache::cache();
-        LoadingCache::CacheLock lock(cache);
         cache->setFileWatch(new ScanControllerLoadingCacheFileWatch);
     }
 
@@ -572,6 +593,7 @@ void ScanController::run()
     while (d->running)
     {
         bool doInit = false, doScan = false, doPartialScan = false, doUpdateUniqueHash = false;
+        bool doBackgroundHashUpdate = false;
         QString task;
         {
             QMutexLocker lock(&d->mutex);
@@ -596,6 +618,11 @@ void ScanController::run()
                 doPartialScan = true;
                 task          = d->scanTasks.takeFirst();
             }
+            else if (d->needsBackgroundHashUpdate && !d->scanSuspended)
+            {
+                d->needsBackgroundHashUpdate = false;
+                doBackgroundHashUpdate       = true;
+            }
             else
             {
                 d->idle = true;
@@ -616,6 +643,13 @@ void ScanController::run()
                 d->advice = ContinueWithoutDatabase;
             }
 
+            // Update hashes of an older version file by file, while digiKam is in use
+            if (success && SchemaUpdater::prepareUniqueHashUpdateInBackground())
+            {
+                QMutexLocker lock(&d->mutex);
+                d->needsBackgroundHashUpdate = true;
+            }
+
             emit databaseInitialized(success);
         }
         else if (doScan)
@@ -623,6 +657,7 @@ void ScanController::run()
             CollectionScanner scanner;
             connectCollectionScanner(&scanner);
             scanner.setNeedFileCount(d->needTotalFiles);
+            scanner.setParallelScan(true);
             scanner.recordHints(d->albumHints);
             scanner.recordHints(d->itemHints);
             scanner.recordHints(d->itemChangeHints);
@@ -651,6 +686,19 @@ void ScanController::run()
             updater.updateUniqueHash();
             emit completeScanDone();
         }
+        else if (doBackgroundHashUpdate)
+        {
+            CollectionScanner scanner;
+            BackgroundHashUpdateObserver observer(d);
+            scanner.setObserver(&observer);
+
+            if (!scanner.updateUniqueHashes())
+            {
+                // interrupted by another task, continue afterwards
+                QMutexLocker lock(&d->mutex);
+                d->needsBackgroundHashUpdate = d->running;
+            }
+        }
     }
 }
 
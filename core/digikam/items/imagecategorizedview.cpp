@@ -93,6 +93,7 @@ public:
         delegate(0),
         showToolTip(false),
         scrollToItemId(0),
+        lastScrollValue(0),
         delayedEnterTimer(0),
         currentMouseEvent(0)
     {
@@ -105,6 +106,7 @@ public:
     bool                  showToolTip;
 
     qlonglong             scrollToItemId;
+    int                   lastScrollValue;
 
     QTimer*               delayedEnterTimer;
 
@@ -639,6 +641,19 @@ void ImageCategorizedView::paintEvent(QPaintEvent* e)
     {
         QModelIndexList indexesToThumbnail = imageFilterModel()->mapListToSource(categorizedIndexesIn(viewport()->rect()));
         d->delegate->prepareThumbnails(thumbModel, indexesToThumbnail);
+
+        // Read ahead the next screen in the direction of scrolling
+        const int scrollValue = verticalScrollBar()->value();
+
+        if (scrollValue != d->lastScrollValue)
+        {
+            QRect nextRect = viewport()->rect();
+            nextRect.translate(0, scrollValue > d->lastScrollValue ? nextRect.height() : -nextRect.height());
+            d->lastScrollValue = scrollValue;
+
+            QModelIndexList indexesToPrefetch = imageFilterModel()->mapListToSource(categorizedIndexesIn(nextRect));
+            d->delegate->prefetchThumbnails(thumbModel, indexesToPrefetch);
+        }
     }
 
     DCategorizedView::paintEvent(e);
@@ -203,6 +203,11 @@ void ImageDelegate::prepareThumbnails(ImageThumbnailModel* thumbModel, const QLi
     thumbModel->prepareThumbnails(indexes, thumbnailSize());
 }
 
+void ImageDelegate::prefetchThumbnails(ImageThumbnailModel* thumbModel, const QList<QModelIndex>& indexes)
+{
+    thumbModel->prefetchThumbnails(indexes, thumbnailSize());
+}
+
 QPixmap ImageDelegate::retrieveThumbnailPixmap(const QModelIndex& index, int thumbnailSize)
 {
     // work around constness
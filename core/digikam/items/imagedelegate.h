@@ -73,6 +73,10 @@ public:
      *  so that thumbnails become available in order. */
     virtual void prepareThumbnails(ImageThumbnailModel* thumbModel, const QList<QModelIndex>& indexes);
 
+    /** Call this from a paint event, with the indexes expected to be painted next,
+     *  so that their thumbnails are loaded after those given to prepareThumbnails. */
+    virtual void prefetchThumbnails(ImageThumbnailModel* thumbModel, const QList<QModelIndex>& indexes);
+
     /**
      * Retrieve the thumbnail pixmap in given size for the ImageModel::ThumbnailRole for
      * the given index from the given index, which must adhere to ImageThumbnailModel semantics.
@@ -125,6 +125,7 @@
 #include "queuemgrwindow.h"
 #include "loadingcache.h"
 #include "loadingcacheinterface.h"
+#include "previewdiskcache.h"
 #include "scancontroller.h"
 #include "setup.h"
 #include "setupeditor.h"
@@ -212,6 +213,8 @@ DigikamApp::DigikamApp()
     AlbumSettings::instance();
     AlbumManager::instance();
     LoadingCacheInterface::initialize();
+    LoadingCacheInterface::setAdaptiveCacheSizing(d->config->group("General Settings").readEntry("Adaptive Cache Size", true));
+    PreviewDiskCache::instance()->setMaximumSize(d->config->group("General Settings").readEntry("Preview Disk Cache Size", 512));
     IccSettings::instance()->loadAllProfilesProperties();
     ThumbnailLoadThread::setDisplayingWidget(this);
 
@@ -51,6 +51,12 @@
 /* Define to 1 if you have Nepomuk shared libraries installed */
 #cmakedefine HAVE_NEPOMUK 1
 
+/* Define to 1 if the compiler can build SSE2 code paths */
+#cmakedefine HAVE_SSE2 1
+
+/* Define to 1 if the compiler can build AVX2 code paths */
+#cmakedefine HAVE_AVX2 1
+
 #define LIBEXEC_INSTALL_DIR "${LIBEXEC_INSTALL_DIR}"
 
 /*
@@ -0,0 +1,145 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-05
+ * Description : runtime detection of processor features
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "cpufeatures.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define DIGIKAM_CPU_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace Digikam
+{
+
+#ifdef DIGIKAM_CPU_X86
+
+static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, leaf, subleaf);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        regs[i] = info[i];
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned int maxLeaf()
+{
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    return regs[0];
+}
+
+/// Returns the lower 32 bit of the extended control register 0
+static unsigned int xgetbv0()
+{
+#if defined(_MSC_VER)
+    return (unsigned int)_xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return eax;
+#endif
+}
+
+class CpuFeaturesPriv
+{
+public:
+
+    CpuFeaturesPriv()
+    {
+        sse2 = false;
+        avx2 = false;
+
+        unsigned int regs[4];
+        const unsigned int leafs = maxLeaf();
+
+        if (leafs < 1)
+        {
+            return;
+        }
+
+        cpuid(1, 0, regs);
+        sse2                 = regs[3] & (1 << 26);
+        const bool osxsave   = regs[2] & (1 << 27);
+        const bool avx       = regs[2] & (1 << 28);
+
+        // The OS must save the XMM and YMM state on context switches
+        const bool ymmSaved  = osxsave && ((xgetbv0() & 0x6) == 0x6);
+
+        if (leafs >= 7 && avx && ymmSaved)
+        {
+            cpuid(7, 0, regs);
+            avx2 = regs[1] & (1 << 5);
+        }
+    }
+
+    bool sse2;
+    bool avx2;
+};
+
+#else // DIGIKAM_CPU_X86
+
+class CpuFeaturesPriv
+{
+public:
+
+    CpuFeaturesPriv()
+    {
+        sse2 = false;
+        avx2 = false;
+    }
+
+    bool sse2;
+    bool avx2;
+};
+
+#endif // DIGIKAM_CPU_X86
+
+// The detection is cheap and its result constant: no locking needed.
+static const CpuFeaturesPriv& features()
+{
+    static const CpuFeaturesPriv detected;
+    return detected;
+}
+
+bool CpuFeatures::hasSSE2()
+{
+    return features().sse2;
+}
+
+bool CpuFeatures::hasAVX2()
+{
+    return features().avx2;
+}
+
+}  // namespace Digikam
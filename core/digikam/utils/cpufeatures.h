@@ -0,0 +1,50 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-05
+ * Description : runtime detection of processor features
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+// Local includes
+
+#include "digikam_export.h"
+
+namespace Digikam
+{
+
+/**
+ * Tells which vectorized code paths can be used on the running processor.
+ * Code paths for an instruction set are only compiled if the compiler supports it,
+ * see HAVE_SSE2 and HAVE_AVX2 in config-digikam.h. Both conditions must be checked.
+ */
+class DIGIKAM_EXPORT CpuFeatures
+{
+public:
+
+    static bool hasSSE2();
+    /// Also checks that the operating system saves the AVX registers
+    static bool hasAVX2();
+};
+
+}  // namespace Digikam
+
+#endif // CPUFEATURES_H
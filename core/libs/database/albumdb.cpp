@@ -52,6 +52,7 @@ extern "C"
 
 // Local includes
 
+#include "databaseaccess.h"
 #include "databasebackend.h"
 #include "collectionmanager.h"
 #include "collectionlocation.h"
@@ -67,7 +68,10 @@ public:
 
     AlbumDBPriv() :
         db(0),
-        uniqueHashVersion(-1)
+        uniqueHashVersion(-1),
+        uniqueHashUpdateVersion(-1),
+        textIndexVersion(-1),
+        spatialIndexVersion(-1)
     {
     }
 
@@ -75,6 +79,9 @@ public:
     QList<int>       recentlyAssignedTags;
 
     int              uniqueHashVersion;
+    int              uniqueHashUpdateVersion;
+    int              textIndexVersion;
+    int              spatialIndexVersion;
 };
 
 AlbumDB::AlbumDB(DatabaseBackend* backend)
@@ -1079,12 +1086,69 @@ bool AlbumDB::isUniqueHashV2()
     return getUniqueHashVersion() == 2;
 }
 
+bool AlbumDB::isUniqueHashV3()
+{
+    return getUniqueHashVersion() == 3;
+}
+
 void AlbumDB::setUniqueHashVersion(int version)
 {
     d->uniqueHashVersion = version;
     setSetting("uniqueHashVersion", QString::number(d->uniqueHashVersion));
 }
 
+int AlbumDB::getUniqueHashUpdateVersion()
+{
+    if (d->uniqueHashUpdateVersion == -1)
+    {
+        // toInt() returns 0 if not set
+        d->uniqueHashUpdateVersion = getSetting("uniqueHashUpdateVersion").toInt();
+    }
+    return d->uniqueHashUpdateVersion;
+}
+
+void AlbumDB::setUniqueHashUpdateVersion(int version)
+{
+    d->uniqueHashUpdateVersion = version;
+    setSetting("uniqueHashUpdateVersion", QString::number(d->uniqueHashUpdateVersion));
+}
+
+int AlbumDB::getScanUniqueHashVersion()
+{
+    return qMax(getUniqueHashVersion(), getUniqueHashUpdateVersion());
+}
+
+int AlbumDB::getTextIndexVersion()
+{
+    if (d->textIndexVersion == -1)
+    {
+        // toInt() returns 0 if not set
+        d->textIndexVersion = getSetting("textIndexVersion").toInt();
+    }
+    return d->textIndexVersion;
+}
+
+void AlbumDB::setTextIndexVersion(int version)
+{
+    d->textIndexVersion = version;
+    setSetting("textIndexVersion", QString::number(d->textIndexVersion));
+}
+
+int AlbumDB::getSpatialIndexVersion()
+{
+    if (d->spatialIndexVersion == -1)
+    {
+        d->spatialIndexVersion = getSetting("spatialIndexVersion").toInt();
+    }
+    return d->spatialIndexVersion;
+}
+
+void AlbumDB::setSpatialIndexVersion(int version)
+{
+    d->spatialIndexVersion = version;
+    setSetting("spatialIndexVersion", QString::number(d->spatialIndexVersion));
+}
+
 /*
 QString AlbumDB::getItemCaption(qlonglong imageID)
 {
@@ -1214,6 +1278,36 @@ QList<int> AlbumDB::getItemTagIDs(qlonglong imageID)
     return ids;
 }
 
+QHash<qlonglong, QList<int> > AlbumDB::getItemTagIDs(const QList<qlonglong>& imageIDs)
+{
+    QHash<qlonglong, QList<int> > hash;
+
+    foreach (const QList<qlonglong>& chunk, splitForBoundValues(imageIDs))
+    {
+        QList<QVariant> values, boundValues;
+        QString query("SELECT imageid, tagid FROM ImageTags WHERE imageid IN (");
+        addBoundValuePlaceholders(query, chunk.size());
+        query += ");";
+
+        foreach (const qlonglong& id, chunk)
+        {
+            boundValues << id;
+        }
+
+        d->db->execSql(query, boundValues, &values);
+
+        for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+        {
+            qlonglong imageId = (*it).toLongLong();
+            ++it;
+            hash[imageId] << (*it).toInt();
+            ++it;
+        }
+    }
+
+    return hash;
+}
+
 QList<ImageTagProperty> AlbumDB::getImageTagProperties(qlonglong imageId, int tagId)
 {
     QList<QVariant> values;
@@ -1367,6 +1461,46 @@ ItemShortInfo AlbumDB::getItemShortInfo(int albumRootId, const QString& relative
     return info;
 }
 
+QHash<QString, qlonglong> AlbumDB::getItemIDs(int albumRootId, const QString& relativePath, const QStringList& names)
+{
+    QHash<QString, qlonglong> ids;
+
+    // SQLite allows at most 999 bound values per statement
+    const int chunkSize = 500;
+
+    for (int i = 0; i < names.size(); i += chunkSize)
+    {
+        QStringList     chunk = names.mid(i, chunkSize);
+        QList<QVariant> values, boundValues;
+
+        QString query("SELECT Images.name, Images.id "
+                      " FROM Images INNER JOIN Albums "
+                      "  ON Images.album=Albums.id "
+                      " WHERE albumRoot=? AND relativePath=? AND name IN (");
+        addBoundValuePlaceholders(query, chunk.size());
+        query += ");";
+
+        boundValues << albumRootId << relativePath;
+
+        foreach (const QString& name, chunk)
+        {
+            boundValues << name;
+        }
+
+        d->db->execSql(query, boundValues, &values);
+
+        for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+        {
+            QString name = (*it).toString();
+            ++it;
+            ids[name] = (*it).toLongLong();
+            ++it;
+        }
+    }
+
+    return ids;
+}
+
 bool AlbumDB::hasTags(const QList<qlonglong>& imageIDList)
 {
     QList<int> ids;
@@ -1473,6 +1607,51 @@ QVariantList AlbumDB::getImagesFields(qlonglong imageID, DatabaseFields::Images
     return values;
 }
 
+QVariantList AlbumDB::getImagesFields(const QList<qlonglong>& imageIDs, DatabaseFields::Images fields)
+{
+    QVariantList list;
+
+    if (fields == DatabaseFields::ImagesNone || imageIDs.isEmpty())
+    {
+        return list;
+    }
+
+    QStringList fieldNames = imagesFieldList(fields);
+    int dateIndex          = (fields & DatabaseFields::ModificationDate) ? fieldNames.indexOf("modificationDate") : -1;
+    int rowSize            = fieldNames.size() + 1;
+
+    foreach (const QList<qlonglong>& chunk, splitForBoundValues(imageIDs))
+    {
+        QVariantList values, boundValues;
+        QString query("SELECT id, ");
+        query += fieldNames.join(", ");
+        query += " FROM Images WHERE id IN (";
+        addBoundValuePlaceholders(query, chunk.size());
+        query += ");";
+
+        foreach (const qlonglong& id, chunk)
+        {
+            boundValues << id;
+        }
+
+        d->db->execSql(query, boundValues, &values);
+
+        // Convert date times to QDateTime, they come as QString
+        if (dateIndex != -1)
+        {
+            for (int i = dateIndex + 1; i < values.size(); i += rowSize)
+            {
+                values[i] = (values[i].isNull() ? QDateTime()
+                             : QDateTime::fromString(values[i].toString(), Qt::ISODate));
+            }
+        }
+
+        list += values;
+    }
+
+    return list;
+}
+
 QVariantList AlbumDB::getImageInformation(qlonglong imageID, DatabaseFields::ImageInformation fields)
 {
     QVariantList values;
@@ -1505,6 +1684,61 @@ QVariantList AlbumDB::getImageInformation(qlonglong imageID, DatabaseFields::Ima
     return values;
 }
 
+QVariantList AlbumDB::getImageInformation(const QList<qlonglong>& imageIDs, DatabaseFields::ImageInformation fields)
+{
+    QVariantList list;
+
+    if (fields == DatabaseFields::ImageInformationNone || imageIDs.isEmpty())
+    {
+        return list;
+    }
+
+    QStringList fieldNames = imageInformationFieldList(fields);
+    int rowSize            = fieldNames.size() + 1;
+    QList<int> dateIndexes;
+
+    if (fields & DatabaseFields::CreationDate)
+    {
+        dateIndexes << fieldNames.indexOf("creationDate") + 1;
+    }
+
+    if (fields & DatabaseFields::DigitizationDate)
+    {
+        dateIndexes << fieldNames.indexOf("digitizationDate") + 1;
+    }
+
+    foreach (const QList<qlonglong>& chunk, splitForBoundValues(imageIDs))
+    {
+        QVariantList values, boundValues;
+        QString query("SELECT imageid, ");
+        query += fieldNames.join(", ");
+        query += " FROM ImageInformation WHERE imageid IN (";
+        addBoundValuePlaceholders(query, chunk.size());
+        query += ");";
+
+        foreach (const qlonglong& id, chunk)
+        {
+            boundValues << id;
+        }
+
+        d->db->execSql(query, boundValues, &values);
+
+        // Convert date times to QDateTime, they come as QString
+        foreach (int index, dateIndexes)
+        {
+            for (int i = index; i < values.size(); i += rowSize)
+            {
+                values[i] = (values[i].isNull() ? QDateTime()
+                             : QDateTime::fromString(values[i].toString(), Qt::ISODate));
+            }
+        }
+
+        list += values;
+    }
+
+    return list;
+}
+
 QVariantList AlbumDB::getImageMetadata(qlonglong imageID, DatabaseFields::ImageMetadata fields)
 {
     QVariantList values;
@@ -1851,6 +2085,50 @@ QList<CommentInfo> AlbumDB::getImageComments(qlonglong imageID)
     return list;
 }
 
+QHash<qlonglong, QList<CommentInfo> > AlbumDB::getImageComments(const QList<qlonglong>& imageIDs)
+{
+    QHash<qlonglong, QList<CommentInfo> > hash;
+
+    foreach (const QList<qlonglong>& chunk, splitForBoundValues(imageIDs))
+    {
+        QList<QVariant> values, boundValues;
+        QString query("SELECT imageid, id, type, language, author, date, comment "
+                      "FROM ImageComments WHERE imageid IN (");
+        addBoundValuePlaceholders(query, chunk.size());
+        query += ");";
+
+        foreach (const qlonglong& id, chunk)
+        {
+            boundValues << id;
+        }
+
+        d->db->execSql(query, boundValues, &values);
+
+        for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+        {
+            CommentInfo info;
+            info.imageId  = (*it).toLongLong();
+            ++it;
+            info.id       = (*it).toInt();
+            ++it;
+            info.type     = (DatabaseComment::Type)(*it).toInt();
+            ++it;
+            info.language = (*it).toString();
+            ++it;
+            info.author   = (*it).toString();
+            ++it;
+            info.date     = ((*it).isNull() ? QDateTime() : QDateTime::fromString((*it).toString(), Qt::ISODate));
+            ++it;
+            info.comment  = (*it).toString();
+            ++it;
+
+            hash[info.imageId] << info;
+        }
+    }
+
+    return hash;
+}
+
 int AlbumDB::setImageComment(qlonglong imageID, const QString& comment, DatabaseComment::Type type,
                              const QString& language, const QString& author, const QDateTime& date)
 {
@@ -2228,6 +2506,47 @@ bool AlbumDB::hasImagesRelatedFrom(qlonglong subjectId, DatabaseRelation::Type t
     return !getRelatedImages(subjectId, true, type, true).isEmpty();
 }
 
+QHash<qlonglong, QList<qlonglong> > AlbumDB::getImagesRelatedFrom(const QList<qlonglong>& subjectIds,
+                                                                  DatabaseRelation::Type type)
+{
+    QHash<qlonglong, QList<qlonglong> > hash;
+
+    foreach (const QList<qlonglong>& chunk, splitForBoundValues(subjectIds))
+    {
+        QList<QVariant> values, boundValues;
+        QString query("SELECT subject, object FROM ImageRelations "
+                      "INNER JOIN Images ON ImageRelations.object=Images.id "
+                      "WHERE status!=3 AND subject IN (");
+        addBoundValuePlaceholders(query, chunk.size());
+        query += ")";
+
+        foreach (const qlonglong& id, chunk)
+        {
+            boundValues << id;
+        }
+
+        if (type != DatabaseRelation::UndefinedType)
+        {
+            query += " AND type=?";
+            boundValues << type;
+        }
+
+        query += ';';
+
+        d->db->execSql(query, boundValues, &values);
+
+        for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+        {
+            qlonglong subject = (*it).toLongLong();
+            ++it;
+            hash[subject] << (*it).toLongLong();
+            ++it;
+        }
+    }
+
+    return hash;
+}
+
 QList<qlonglong> AlbumDB::getImagesRelatingTo(qlonglong objectId, DatabaseRelation::Type type)
 {
     return getRelatedImages(objectId, false, type, false);
@@ -2602,6 +2921,50 @@ QList<ItemScanInfo> AlbumDB::getIdenticalFiles(const QString& uniqueHash, int fi
     return list;
 }
 
+QList<ItemScanInfo> AlbumDB::getFilesWithOtherHashVersion(const QString& uniqueHash, int fileSize)
+{
+    if (uniqueHash.isEmpty() || fileSize <= 0)
+    {
+        return QList<ItemScanInfo>();
+    }
+
+    QList<QVariant> values;
+
+    d->db->execSql( QString("SELECT id, album, name, status, category, modificationDate, fileSize, uniqueHash "
+                            " FROM Images WHERE fileSize=? AND length(uniqueHash)<>?; "),
+                    fileSize, uniqueHash.length(),
+                    &values );
+
+    QList<ItemScanInfo> list;
+
+    for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+    {
+        ItemScanInfo info;
+
+        info.id               = (*it).toLongLong();
+        ++it;
+        info.albumID          = (*it).toInt();
+        ++it;
+        info.itemName         = (*it).toString();
+        ++it;
+        info.status           = (DatabaseItem::Status)(*it).toInt();
+        ++it;
+        info.category         = (DatabaseItem::Category)(*it).toInt();
+        ++it;
+        info.modificationDate = ((*it).isNull() ? QDateTime()
+                                 : QDateTime::fromString( (*it).toString(), Qt::ISODate ));
+        ++it;
+        info.fileSize         = (*it).toInt();
+        ++it;
+        info.uniqueHash       = (*it).toString();
+        ++it;
+
+        list << info;
+    }
+
+    return list;
+}
+
 QStringList AlbumDB::imagesFieldList(DatabaseFields::Images fields)
 {
     // adds no spaces at beginning or end
@@ -2880,20 +3243,21 @@ QStringList AlbumDB::imageCommentsFieldList(DatabaseFields::ImageComments fields
 
 void AlbumDB::addBoundValuePlaceholders(QString& query, int count)
 {
-    // adds no spaces at beginning or end
-    QString questionMarks;
-    questionMarks.reserve(count * 2);
-    QString questionMark("?,");
+    DatabaseCoreBackend::addBoundValuePlaceholders(query, count);
+}
+
+QList<QList<qlonglong> > AlbumDB::splitForBoundValues(const QList<qlonglong>& ids)
+{
+    // SQLite allows at most 999 bound values per statement
+    const int chunkSize = 500;
+    QList<QList<qlonglong> > chunks;
 
-    for (int i=0; i<count; ++i)
+    for (int i = 0; i < ids.size(); i += chunkSize)
     {
-        questionMarks += questionMark;
+        chunks << ids.mid(i, chunkSize);
     }
 
-    // remove last ','
-    questionMarks.chop(1);
-
-    query += questionMarks;
+    return chunks;
 }
 
 int AlbumDB::findInDownloadHistory(const QString& identifier, const QString& name, int fileSize, const QDateTime& date)
@@ -3424,6 +3788,20 @@ void AlbumDB::updateItem(qlonglong imageID, DatabaseItem::Category category,
                                           | DatabaseFields::UniqueHash ));
 }
 
+bool AlbumDB::replaceUniqueHash(qlonglong imageID, const QString& oldHash, const QString& newHash)
+{
+    SqlQuery query = d->db->execQuery( QString("UPDATE Images SET uniqueHash=? WHERE id=? AND uniqueHash=?;"),
+                                       newHash, imageID, oldHash );
+
+    if (query.numRowsAffected() <= 0)
+    {
+        return false;
+    }
+
+    d->db->recordChangeset(ImageChangeset(imageID, DatabaseFields::UniqueHash));
+    return true;
+}
+
 void AlbumDB::setItemStatus(qlonglong imageID, DatabaseItem::Status status)
 {
     QVariantList boundValues;
@@ -3876,6 +4254,25 @@ QList<ItemScanInfo> AlbumDB::getItemScanInfos(int albumID)
     return list;
 }
 
+QList<int> AlbumDB::getAlbumsWithMD5UniqueHash()
+{
+    QList<QVariant> values;
+
+    d->db->execSql( QString("SELECT DISTINCT album FROM Images "
+                            "WHERE status<>? AND album IS NOT NULL AND length(uniqueHash)=32;"),
+                    DatabaseItem::Removed,
+                    &values );
+
+    QList<int> albumIds;
+
+    foreach (const QVariant& value, values)
+    {
+        albumIds << value.toInt();
+    }
+
+    return albumIds;
+}
+
 ItemScanInfo AlbumDB::getItemScanInfo(qlonglong imageID)
 {
     QList<QVariant> values;
@@ -4422,18 +4819,37 @@ QList<QVariant> AlbumDB::getImageIdsFromArea(qreal lat1, qreal lat2, qreal lng1,
 {
     QList<QVariant> values;
     QList<QVariant> boundValues;
-    boundValues<<lat1<<lat2<<lng1<<lng2;
-
-    //DatabaseAccess access;
 
     d->db->execSql( QString("Select ImageInformation.imageid, ImageInformation.rating, ImagePositions.latitudeNumber, ImagePositions.longitudeNumber"
                             " FROM ImageInformation INNER JOIN ImagePositions"
                             " ON ImageInformation.imageid = ImagePositions.imageid"
-                            " WHERE (ImagePositions.latitudeNumber>? AND ImagePositions.latitudeNumber<?)"
-                            " AND (ImagePositions.longitudeNumber>? AND ImagePositions.longitudeNumber<?);"),
-                    boundValues,&values);
+                            " WHERE ") +
+                    imagePositionsAreaCondition(lat1, lat2, lng1, lng2, &boundValues) + ';',
+                    boundValues, &values);
 
     return values;
 }
 
+QString AlbumDB::imagePositionsAreaCondition(qreal lat1, qreal lat2, qreal lng1, qreal lng2, QList<QVariant>* boundValues)
+{
+    QString sql;
+
+    // With SQLite, an R*Tree holds the positions. Its coordinates are rounded outwards to float,
+    // so it only preselects the candidates, and the exact comparison follows.
+    // With MySQL, the index on the coordinate columns is used for the comparison itself.
+    if (getSpatialIndexVersion() >= 1 && d->db->isSQLite())
+    {
+        sql += "ImagePositions.imageid IN "
+               " (SELECT id FROM ImagePositionsRTree "
+               "  WHERE maxLat>=? AND minLat<=? AND maxLng>=? AND minLng<=?) AND ";
+        *boundValues << lat1 << lat2 << lng1 << lng2;
+    }
+
+    sql += "(ImagePositions.latitudeNumber>? AND ImagePositions.latitudeNumber<?)"
+           " AND (ImagePositions.longitudeNumber>? AND ImagePositions.longitudeNumber<?)";
+    *boundValues << lat1 << lat2 << lng1 << lng2;
+
+    return sql;
+}
+
 }  // namespace Digikam
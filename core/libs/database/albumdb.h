@@ -32,6 +32,7 @@
 #include <QtCore/QList>
 #include <QtCore/QStringList>
 #include <QtCore/QDateTime>
+#include <QtCore/QHash>
 #include <QtCore/QPair>
 #include <QtCore/QMap>
 #include <QtCore/QUuid>
@@ -126,7 +127,39 @@ public:
 
     void setUniqueHashVersion(int version);
 
+    /**
+     * While the unique hashes are replaced in the background, returns the version of the
+     * new hashes, otherwise 0. getUniqueHashVersion() returns the old version until all
+     * hashes are replaced. The value is cached.
+     */
+    int getUniqueHashUpdateVersion();
+
+    void setUniqueHashUpdateVersion(int version);
+
+    /**
+     * Returns the version in which the unique hash of a scanned file is calculated:
+     * the version of a running update, or else getUniqueHashVersion().
+     */
+    int getScanUniqueHashVersion();
+
     bool isUniqueHashV2();
+    bool isUniqueHashV3();
+
+    /**
+     * Returns the version of the full text index used for text searches,
+     * or 0 if the database has no such index. The value is cached.
+     */
+    int getTextIndexVersion();
+
+    void setTextIndexVersion(int version);
+
+    /**
+     * Returns the version of the spatial index on image positions,
+     * or 0 if the database has no such index. The value is cached.
+     */
+    int getSpatialIndexVersion();
+
+    void setSpatialIndexVersion(int version);
 
     // ----------- AlbumRoot operations -----------
 
@@ -594,6 +627,12 @@ public:
      */
     QList<ItemScanInfo> getItemScanInfos(int albumID);
 
+    /**
+     * Returns the ids of the albums containing items with a unique hash of version 1 or 2,
+     * which is a 32 character MD5 hex digest.
+     */
+    QList<int> getAlbumsWithMD5UniqueHash();
+
     /**
      * Given a albumID, get a list of the url of all items in the album
      * NOTE: Uses the CollectionManager
@@ -675,6 +714,12 @@ public:
      */
     ItemShortInfo getItemShortInfo(int albumRootId, const QString& relativePath, const QString& name);
 
+    /**
+     * Get the ids of the items with the given file names in the album given by albumRootId and album path,
+     * with one query per a few hundred names. Names not found are not contained in the returned hash.
+     */
+    QHash<QString, qlonglong> getItemIDs(int albumRootId, const QString& relativePath, const QStringList& names);
+
     /**
      * Get scan info from the image ID
      */
@@ -691,6 +736,12 @@ public:
                     int fileSize,
                     const QString& uniqueHash);
 
+    /**
+     * Sets the unique hash of the given image to newHash, if it is still oldHash.
+     * Returns false if the hash was changed meanwhile, e.g. by a rescan of the file.
+     */
+    bool replaceUniqueHash(qlonglong imageID, const QString& oldHash, const QString& newHash);
+
     /**
      * Updates the status field for the item.
      * Note: Do not use this to set to the Removed status, see removeItems().
@@ -711,6 +762,14 @@ public:
      */
     QVariantList getImagesFields(qlonglong imageID, DatabaseFields::Images imagesFields);
 
+    /**
+     * Returns the requested fields from the Images table for all given images,
+     * with one query per a few hundred images.
+     * For each image found, the image id is followed by the fields,
+     * in the order and with the types as described above. The order of the images is undefined.
+     */
+    QVariantList getImagesFields(const QList<qlonglong>& imageIDs, DatabaseFields::Images imagesFields);
+
     /**
      * Add (or replace) the ImageInformation of the specified item.
      * If there is already an entry, it will be discarded.
@@ -746,6 +805,14 @@ public:
     QVariantList getImageInformation(qlonglong imageID,
                                      DatabaseFields::ImageInformation infoFields = DatabaseFields::ImageInformationAll);
 
+    /**
+     * Read image information for all given images, with one query per a few hundred images.
+     * For each image found, the image id is followed by the fields, as above.
+     * The order of the images is undefined.
+     */
+    QVariantList getImageInformation(const QList<qlonglong>& imageIDs,
+                                     DatabaseFields::ImageInformation infoFields);
+
     /**
      * Add (or replace) the ImageMetadata of the specified item.
      * If there is already an entry, it will be discarded.
@@ -833,6 +900,12 @@ public:
      */
     QList<CommentInfo> getImageComments(qlonglong imageID);
 
+    /**
+     * Retrieves all available comments for the given items, with one query per a few hundred items.
+     * Items without comments are not contained in the returned hash.
+     */
+    QHash<qlonglong, QList<CommentInfo> > getImageComments(const QList<qlonglong>& imageIDs);
+
     /**
      * Sets the comments for the image. A comment for the image with the same
      * source, language and author will be overwritten.
@@ -966,6 +1039,12 @@ public:
      */
     QList<qlonglong> getImagesRelatedFrom(qlonglong subjectId, DatabaseRelation::Type type = DatabaseRelation::UndefinedType);
     bool hasImagesRelatedFrom(qlonglong subjectId, DatabaseRelation::Type type = DatabaseRelation::UndefinedType);
+    /**
+     * As above, for all given images, with one query per a few hundred images.
+     * Images without relations are not contained in the returned hash.
+     */
+    QHash<qlonglong, QList<qlonglong> > getImagesRelatedFrom(const QList<qlonglong>& subjectIds,
+                                                             DatabaseRelation::Type type = DatabaseRelation::UndefinedType);
     /**
      * Retrieves all images that relate to the given image (retrieves subject, given image is object)
      * If type is given, filters by type, otherwise returns all types.
@@ -1024,6 +1103,13 @@ public:
     QList<ItemScanInfo> getIdenticalFiles(qlonglong id);
     QList<ItemScanInfo> getIdenticalFiles(const QString& uniqueHash, int fileSize, qlonglong sourceId = -1);
 
+    /**
+     * Returns the items of the given file size whose unique hash is of another version
+     * than the given hash. Versions are told apart by the length of the hash.
+     * Whether these files are identical can only be checked by hashing the files.
+     */
+    QList<ItemScanInfo> getFilesWithOtherHashVersion(const QString& uniqueHash, int fileSize);
+
     // ----------- Items and their tags -----------
 
     /**
@@ -1081,6 +1167,12 @@ public:
      */
     QList<int> getItemTagIDs(qlonglong imageID);
 
+    /**
+     * Get the IDs of the tags for all given items, with one query per a few hundred items.
+     * Items without tags are not contained in the returned hash.
+     */
+    QHash<qlonglong, QList<int> > getItemTagIDs(const QList<qlonglong>& imageIDs);
+
     /**
      * Get the properties for the given image/tag pair.
      * If the tagID is -1, returns the ImageTagProperties for all tagIds of the given image.
@@ -1188,7 +1280,14 @@ public:
      */
     int addToDownloadHistory(const QString& identifier, const QString& name, int fileSize, const QDateTime& date);
 
-    QList<QVariant> getImageIdsFromArea(qreal lat1, qreal lng1, qreal lat2, qreal lng2, int sortMode, const QString& sortBy);
+    QList<QVariant> getImageIdsFromArea(qreal lat1, qreal lat2, qreal lng1, qreal lng2, int sortMode, const QString& sortBy);
+
+    /**
+     * Returns an SQL condition on the ImagePositions table selecting the positions with
+     * lat1 < latitude < lat2 and lng1 < longitude < lng2, and adds the values to bind.
+     * The spatial index is used if the database has one.
+     */
+    QString imagePositionsAreaCondition(qreal lat1, qreal lat2, qreal lng1, qreal lng2, QList<QVariant>* boundValues);
 
     // ----------- Static helper methods for constructing SQL queries -----------
 
@@ -1198,6 +1297,7 @@ public:
     static QStringList imagePositionsFieldList(DatabaseFields::ImagePositions fields);
     static QStringList imageCommentsFieldList(DatabaseFields::ImageComments fields);
     static void addBoundValuePlaceholders(QString& query, int count);
+    static QList<QList<qlonglong> > splitForBoundValues(const QList<qlonglong>& ids);
 
 public:
 
@@ -35,9 +35,14 @@
 
 #include <QDir>
 #include <QFileInfo>
+#include <QMutex>
+#include <QRunnable>
 #include <QStringList>
 #include <QSet>
+#include <QThread>
+#include <QThreadPool>
 #include <QTime>
+#include <QWaitCondition>
 
 // KDE includes
 
@@ -58,6 +63,7 @@
 #include "databasebackend.h"
 #include "databasetransaction.h"
 #include "databaseoperationgroup.h"
+#include "dimg.h"
 #include "imageinfo.h"
 #include "imagescanner.h"
 #include "tagscache.h"
@@ -90,6 +96,201 @@ inline uint qHash(const NewlyAppearedFile& file)
     return ::qHash(file.albumId) ^ ::qHash(file.fileName);
 }
 
+// ---------------------------------------------------------------------------------------------------
+
+/** A file of a parallel scan, see CollectionScanner::setParallelScan().
+ *  The scanner is created by the scanning thread, loaded from disk by the reader,
+ *  and then applied to the database by the scanning thread.
+ */
+class CollectionScannerJob
+{
+public:
+
+    enum Type
+    {
+        NoScan,
+        NewFile,
+        ModifiedFile,
+        RescanFile,
+        UpdateHash
+    };
+
+    enum State
+    {
+        Queued,
+        Loading,
+        Loaded
+    };
+
+    CollectionScannerJob(Type type, const QFileInfo& info, const ItemScanInfo& scanInfo, int albumId)
+        : type(type),
+          state(Queued),
+          albumId(albumId),
+          info(info),
+          scanInfo(scanInfo),
+          scanner(info, scanInfo)
+    {
+    }
+
+    const Type         type;
+    State              state;
+    const int          albumId;
+    const QFileInfo    info;
+    const ItemScanInfo scanInfo;
+    ImageScanner       scanner;
+};
+
+/** Loads the files of a parallel scan from disk, in the threads of the pool,
+ *  or in the scanning thread if a file is needed whose loading has not yet started.
+ *  Jobs are added and taken only by the scanning thread, in the same order.
+ */
+class CollectionScannerReader
+{
+public:
+
+    explicit CollectionScannerReader(int uniqueHashVersion)
+        : uniqueHashVersion(uniqueHashVersion), workers(0)
+    {
+        pool.setMaxThreadCount(QThread::idealThreadCount());
+    }
+
+    ~CollectionScannerReader()
+    {
+        clear();
+    }
+
+    /// The number of jobs added and not yet taken
+    int count() const
+    {
+        return jobs.size();
+    }
+
+    void add(CollectionScannerJob* job);
+    CollectionScannerJob* takeFirst();
+    void clear();
+
+    bool loadNext();
+
+public:
+
+    const int                    uniqueHashVersion;
+
+    QMutex                       mutex;
+    QWaitCondition               condVar;
+    /// All jobs not yet taken, in order of adding. Owned. Accessed only by the scanning thread.
+    QList<CollectionScannerJob*> jobs;
+    /// The jobs waiting to be loaded
+    QList<CollectionScannerJob*> queue;
+    int                          workers;
+    QThreadPool                  pool;
+};
+
+class CollectionScannerReaderWorker : public QRunnable
+{
+public:
+
+    CollectionScannerReaderWorker(CollectionScannerReader* reader)
+        : reader(reader)
+    {
+    }
+
+    virtual void run()
+    {
+        while (reader->loadNext())
+        {
+        }
+    }
+
+private:
+
+    CollectionScannerReader* const reader;
+};
+
+void CollectionScannerReader::add(CollectionScannerJob* job)
+{
+    jobs << job;
+
+    QMutexLocker lock(&mutex);
+    queue << job;
+
+    if (workers < pool.maxThreadCount())
+    {
+        ++workers;
+        pool.start(new CollectionScannerReaderWorker(this));
+    }
+}
+
+bool CollectionScannerReader::loadNext()
+{
+    CollectionScannerJob* job = 0;
+
+    {
+        QMutexLocker lock(&mutex);
+
+        if (queue.isEmpty())
+        {
+            --workers;
+            return false;
+        }
+
+        job        = queue.takeFirst();
+        job->state = CollectionScannerJob::Loading;
+    }
+
+    // does not touch the database
+    job->scanner.loadFile(uniqueHashVersion);
+
+    QMutexLocker lock(&mutex);
+    job->state = CollectionScannerJob::Loaded;
+    condVar.wakeAll();
+    return true;
+}
+
+CollectionScannerJob* CollectionScannerReader::takeFirst()
+{
+    if (jobs.isEmpty())
+    {
+        return 0;
+    }
+
+    CollectionScannerJob* job = jobs.takeFirst();
+
+    QMutexLocker lock(&mutex);
+
+    if (job->state == CollectionScannerJob::Queued)
+    {
+        // Loading has not yet started: Do it here instead of waiting
+        queue.removeOne(job);
+        job->state = CollectionScannerJob::Loading;
+        lock.unlock();
+
+        job->scanner.loadFile(uniqueHashVersion);
+        job->state = CollectionScannerJob::Loaded;
+        return job;
+    }
+
+    while (job->state != CollectionScannerJob::Loaded)
+    {
+        condVar.wait(&mutex);
+    }
+
+    return job;
+}
+
+void CollectionScannerReader::clear()
+{
+    {
+        QMutexLocker lock(&mutex);
+        queue.clear();
+    }
+
+    pool.waitForDone();
+    qDeleteAll(jobs);
+    jobs.clear();
+}
+
+// ---------------------------------------------------------------------------------------------------
+
 class CollectionScannerPriv
 {
 
@@ -100,10 +301,17 @@ public:
         needTotalFiles(false),
         updatingHashHint(false),
         recordHistoryIds(false),
+        parallelScan(false),
+        reader(0),
         observer(0)
     {
     }
 
+    ~CollectionScannerPriv()
+    {
+        delete reader;
+    }
+
     QSet<QString>     nameFilters;
     QSet<QString>     imageFilterSet;
     QSet<QString>     videoFilterSet;
@@ -127,6 +335,10 @@ public:
     QSet<qlonglong>   needResolveHistorySet;
     QSet<qlonglong>   needTaggingHistorySet;
 
+    bool              parallelScan;
+    CollectionScannerReader*
+                      reader;
+
     CollectionScannerObserver* observer;
 
     void resetRemovedItemsTime()
@@ -149,6 +361,7 @@ public:
     }
 
     void finishScanner(const ImageScanner& scanner);
+    CollectionScannerJob::Type scanTypeForExistingFile(const QFileInfo& fi, const ItemScanInfo& scanInfo);
 };
 
 CollectionScanner::CollectionScanner()
@@ -171,6 +384,11 @@ void CollectionScanner::setNeedFileCount(bool on)
     d->needTotalFiles = on;
 }
 
+void CollectionScanner::setParallelScan(bool on)
+{
+    d->parallelScan = on;
+}
+
 void CollectionScanner::recordHints(const QList<AlbumCopyMoveHint>& hints)
 {
     foreach(const AlbumCopyMoveHint& hint, hints)
@@ -746,10 +964,20 @@ void CollectionScanner::scanAlbum(const CollectionLocation& location, const QStr
 
     int counter = -1;
 
+    if (d->parallelScan && !d->reader)
+    {
+        d->reader = new CollectionScannerReader(DatabaseAccess().db()->getScanUniqueHashVersion());
+    }
+
     for (fi = list.constBegin(); fi != list.constEnd(); ++fi)
     {
         if (!d->checkObserver())
         {
+            if (d->reader)
+            {
+                d->reader->clear();
+            }
+
             return; // return directly, do not go to cleanup code after loop!
         }
 
@@ -778,7 +1006,19 @@ void CollectionScanner::scanAlbum(const CollectionLocation& location, const QStr
                 // mark item as "seen"
                 itemIdSet.remove(scanInfos[index].id);
 
-                scanFileNormal(*fi, scanInfos[index]);
+                if (d->reader)
+                {
+                    CollectionScannerJob::Type type = d->scanTypeForExistingFile(*fi, scanInfos[index]);
+
+                    if (type != CollectionScannerJob::NoScan)
+                    {
+                        addScanJob(new CollectionScannerJob(type, *fi, scanInfos[index], albumID));
+                    }
+                }
+                else
+                {
+                    scanFileNormal(*fi, scanInfos[index]);
+                }
             }
             // ignore temp files we created ourselves
             else if (fi->completeSuffix() == "digikamtempfile.tmp")
@@ -789,7 +1029,14 @@ void CollectionScanner::scanAlbum(const CollectionLocation& location, const QStr
             {
                 //kDebug() << "Adding item " << fi->fileName();
 
-                scanNewFile(*fi, albumID);
+                if (d->reader)
+                {
+                    addScanJob(new CollectionScannerJob(CollectionScannerJob::NewFile, *fi, ItemScanInfo(), albumID));
+                }
+                else
+                {
+                    scanNewFile(*fi, albumID);
+                }
 
                 // emit signals for scanned files with much higher granularity
                 if (d->wantSignals && counter && (counter % 2 == 0))
@@ -816,6 +1063,12 @@ void CollectionScanner::scanAlbum(const CollectionLocation& location, const QStr
         }
     }
 
+    // write all files of this album before marking it as scanned
+    if (d->reader)
+    {
+        applyScanJobs(0);
+    }
+
     if (d->wantSignals && counter)
     {
         emit scannedFiles(counter);
@@ -855,42 +1108,57 @@ static bool modificationDateEquals(const QDateTime& a, const QDateTime& b)
     return true;
 }
 
-void CollectionScanner::scanFileNormal(const QFileInfo& fi, const ItemScanInfo& scanInfo)
+CollectionScannerJob::Type CollectionScannerPriv::scanTypeForExistingFile(const QFileInfo& fi, const ItemScanInfo& scanInfo)
 {
     // if the date is null, this signals a full rescan
-    if (scanInfo.modificationDate.isNull() || d->rescanItemHints.contains(scanInfo.id))
+    if (scanInfo.modificationDate.isNull() || rescanItemHints.contains(scanInfo.id))
     {
-        d->rescanItemHints.remove(scanInfo.id);
-        rescanFile(fi, scanInfo);
-        return;
+        rescanItemHints.remove(scanInfo.id);
+        return CollectionScannerJob::RescanFile;
     }
-    else if (d->modifiedItemHints.contains(scanInfo.id))
+    else if (modifiedItemHints.contains(scanInfo.id))
     {
-        d->modifiedItemHints.remove(scanInfo.id);
-        scanModifiedFile(fi, scanInfo);
-        return;
+        modifiedItemHints.remove(scanInfo.id);
+        return CollectionScannerJob::ModifiedFile;
     }
-    else if (d->updatingHashHint)
+    else if (updatingHashHint)
     {
         // if the file need not be scanned because of modification, update the hash
         if (modificationDateEquals(fi.lastModified(), scanInfo.modificationDate)
             && (int)fi.size() == scanInfo.fileSize)
         {
-            QString oldHash = scanInfo.uniqueHash;
-            QString newHash = scanFileUpdateHash(fi, scanInfo);
-            if (ThumbnailDatabaseAccess::isInitialized())
-            {
-                ThumbnailDatabaseAccess().db()->replaceUniqueHash(oldHash, scanInfo.fileSize,
-                                                                  newHash, scanInfo.fileSize);
-            }
-            return;
+            return CollectionScannerJob::UpdateHash;
         }
     }
 
     if (!modificationDateEquals(fi.lastModified(), scanInfo.modificationDate)
         || (int)fi.size() != scanInfo.fileSize)
     {
-        scanModifiedFile(fi, scanInfo);
+        return CollectionScannerJob::ModifiedFile;
+    }
+
+    return CollectionScannerJob::NoScan;
+}
+
+void CollectionScanner::scanFileNormal(const QFileInfo& fi, const ItemScanInfo& scanInfo)
+{
+    switch (d->scanTypeForExistingFile(fi, scanInfo))
+    {
+        case CollectionScannerJob::RescanFile:
+            rescanFile(fi, scanInfo);
+            break;
+        case CollectionScannerJob::ModifiedFile:
+            scanModifiedFile(fi, scanInfo);
+            break;
+        case CollectionScannerJob::UpdateHash:
+        {
+            ImageScanner scanner(fi, scanInfo);
+            scanner.setCategory(category(fi));
+            scanFileUpdateHashAndThumbnail(scanner, scanInfo);
+            break;
+        }
+        default:
+            break;
     }
 }
 
@@ -904,9 +1172,14 @@ void CollectionScannerPriv::finishScanner(const ImageScanner& scanner)
 
 qlonglong CollectionScanner::scanNewFile(const QFileInfo& info, int albumId)
 {
-    DatabaseOperationGroup group;
     ImageScanner scanner(info);
     scanner.setCategory(category(info));
+    return scanNewFile(scanner, info, albumId);
+}
+
+qlonglong CollectionScanner::scanNewFile(ImageScanner& scanner, const QFileInfo& info, int albumId)
+{
+    DatabaseOperationGroup group;
 
     // Check copy/move hints for single items
     qlonglong srcId = d->itemHints.value(NewlyAppearedFile(albumId, info.fileName()));
@@ -953,29 +1226,220 @@ qlonglong CollectionScanner::scanNewFileFullScan(const QFileInfo& info, int albu
 
 void CollectionScanner::scanModifiedFile(const QFileInfo& info, const ItemScanInfo& scanInfo)
 {
-    DatabaseOperationGroup group;
     ImageScanner scanner(info, scanInfo);
     scanner.setCategory(category(info));
+    scanModifiedFile(scanner);
+}
+
+void CollectionScanner::scanModifiedFile(ImageScanner& scanner)
+{
+    DatabaseOperationGroup group;
     scanner.fileModified();
     d->finishScanner(scanner);
 }
 
 QString CollectionScanner::scanFileUpdateHash(const QFileInfo& info, const ItemScanInfo& scanInfo)
 {
-    // same code as scanModifiedFile
-    DatabaseOperationGroup group;
     ImageScanner scanner(info, scanInfo);
     scanner.setCategory(category(info));
-    scanner.fileModified();
-    d->finishScanner(scanner);
+    return scanFileUpdateHash(scanner);
+}
+
+QString CollectionScanner::scanFileUpdateHash(ImageScanner& scanner)
+{
+    // same code as scanModifiedFile
+    scanModifiedFile(scanner);
     return scanner.itemScanInfo().uniqueHash;
 }
 
+void CollectionScanner::scanFileUpdateHashAndThumbnail(ImageScanner& scanner, const ItemScanInfo& scanInfo)
+{
+    QString oldHash = scanInfo.uniqueHash;
+    QString newHash = scanFileUpdateHash(scanner);
+
+    if (ThumbnailDatabaseAccess::isInitialized())
+    {
+        ThumbnailDatabaseAccess().db()->replaceUniqueHash(oldHash, scanInfo.fileSize,
+                                                          newHash, scanInfo.fileSize);
+    }
+}
+
+void CollectionScanner::addScanJob(CollectionScannerJob* job)
+{
+    // Keep enough jobs queued to keep the reader busy while writing a batch
+    const int maxJobs = qMax(100, 20 * d->reader->pool.maxThreadCount());
+
+    job->scanner.setCategory(category(job->info));
+    d->reader->add(job);
+
+    if (d->reader->count() >= maxJobs)
+    {
+        applyScanJobs(maxJobs / 2);
+    }
+}
+
+void CollectionScanner::applyScanJobs(int remaining)
+{
+    if (d->reader->count() <= remaining)
+    {
+        return;
+    }
+
+    // one transaction for the whole batch
+    DatabaseTransaction transaction;
+
+    while (d->reader->count() > remaining)
+    {
+        CollectionScannerJob* job = d->reader->takeFirst();
+        applyScanJob(job);
+        delete job;
+    }
+}
+
+void CollectionScanner::applyScanJob(CollectionScannerJob* job)
+{
+    switch (job->type)
+    {
+        case CollectionScannerJob::NewFile:
+            scanNewFile(job->scanner, job->info, job->albumId);
+            break;
+        case CollectionScannerJob::ModifiedFile:
+            scanModifiedFile(job->scanner);
+            break;
+        case CollectionScannerJob::RescanFile:
+            rescanFile(job->scanner);
+            break;
+        case CollectionScannerJob::UpdateHash:
+            scanFileUpdateHashAndThumbnail(job->scanner, job->scanInfo);
+            break;
+        default:
+            break;
+    }
+}
+
+bool CollectionScanner::updateUniqueHashes()
+{
+    QList<int> albumIds = DatabaseAccess().db()->getAlbumsWithMD5UniqueHash();
+
+    foreach (int albumId, albumIds)
+    {
+        if (!d->checkObserver())
+        {
+            return false;
+        }
+
+        QString albumRoot, album;
+        {
+            DatabaseAccess access;
+            albumRoot = CollectionManager::instance()->albumRootPath(access.db()->getAlbumRootId(albumId));
+            album     = access.db()->getAlbumRelativePath(albumId);
+        }
+
+        // location not available
+        if (albumRoot.isNull())
+        {
+            continue;
+        }
+
+        QDir                dir(albumRoot + album);
+        QList<ItemScanInfo> scanInfos = DatabaseAccess().db()->getItemScanInfos(albumId);
+        QList<ItemScanInfo> updated;
+        QStringList         oldHashes;
+
+        // read the files without holding the database lock
+        for (int i=0; i<scanInfos.size(); ++i)
+        {
+            ItemScanInfo& scanInfo = scanInfos[i];
+
+            if (scanInfo.status == DatabaseItem::Removed || scanInfo.uniqueHash.length() != 32)
+            {
+                continue;
+            }
+
+            QFileInfo fi(dir.filePath(scanInfo.itemName));
+
+            // modified files get the new hash with their next scan
+            if (!fi.exists() || !modificationDateEquals(fi.lastModified(), scanInfo.modificationDate)
+                || (int)fi.size() != scanInfo.fileSize)
+            {
+                continue;
+            }
+
+            QString newHash = QString(DImg::getUniqueHashV3(fi.filePath()));
+
+            if (!newHash.isEmpty())
+            {
+                oldHashes << scanInfo.uniqueHash;
+                scanInfo.uniqueHash = newHash;
+                updated << scanInfo;
+            }
+        }
+
+        if (updated.isEmpty())
+        {
+            continue;
+        }
+
+        {
+            DatabaseAccess      access;
+            DatabaseTransaction transaction(&access);
+
+            // Only replace the hash: the file may have been rescanned while it was read
+            for (int i=0; i<updated.size(); )
+            {
+                if (access.db()->replaceUniqueHash(updated.at(i).id, oldHashes.at(i), updated.at(i).uniqueHash))
+                {
+                    ++i;
+                }
+                else
+                {
+                    updated.removeAt(i);
+                    oldHashes.removeAt(i);
+                }
+            }
+        }
+
+        if (ThumbnailDatabaseAccess::isInitialized() && !updated.isEmpty())
+        {
+            ThumbnailDatabaseAccess access;
+            DatabaseCoreBackend::QueryState state = access.backend()->beginTransaction();
+
+            for (int i=0; i<updated.size(); ++i)
+            {
+                access.db()->replaceUniqueHash(oldHashes.at(i), updated.at(i).fileSize,
+                                               updated.at(i).uniqueHash, updated.at(i).fileSize);
+            }
+
+            if (state == DatabaseCoreBackend::NoErrors)
+            {
+                access.backend()->commitTransaction();
+            }
+        }
+    }
+
+    // Only now the database switches to the new version. If files were left out,
+    // for example in unavailable locations, the update continues at the next start.
+    DatabaseAccess access;
+
+    if (access.db()->getUniqueHashUpdateVersion() && access.db()->getAlbumsWithMD5UniqueHash().isEmpty())
+    {
+        access.db()->setUniqueHashVersion(access.db()->getUniqueHashUpdateVersion());
+        access.db()->setUniqueHashUpdateVersion(0);
+    }
+
+    return true;
+}
+
 void CollectionScanner::rescanFile(const QFileInfo& info, const ItemScanInfo& scanInfo)
 {
-    DatabaseOperationGroup group;
     ImageScanner scanner(info, scanInfo);
     scanner.setCategory(category(info));
+    rescanFile(scanner);
+}
+
+void CollectionScanner::rescanFile(ImageScanner& scanner)
+{
+    DatabaseOperationGroup group;
     scanner.rescan();
     d->finishScanner(scanner);
 }
@@ -45,9 +45,11 @@ namespace Digikam
 
 class AlbumCopyMoveHint;
 class CollectionLocation;
+class CollectionScannerJob;
 class CollectionScannerObserver;
 class CollectionScannerPriv;
 class ImageInfo;
+class ImageScanner;
 class ItemCopyMoveHint;
 class ItemChangeHint;
 
@@ -135,6 +137,15 @@ public:
      */
     void setNeedFileCount(bool on);
 
+    /**
+     * Call this to read new and modified files from disk in a pool of threads.
+     * Metadata, image information and unique hash of the files are read in parallel,
+     * while the information is written to the database by the scanning thread only,
+     * in transactions of many files. Recommended for large scans, like the complete scan.
+     * Default is off.
+     */
+    void setParallelScan(bool on);
+
     /**
      * Record hints for the collection scanner.
      */
@@ -143,6 +154,16 @@ public:
     void recordHints(const QList<ItemChangeHint>& hint);
     void setUpdateHashHint(bool hint = true);
 
+    /**
+     * Replaces the unique hash of version 1 or 2 of all unmodified files in available locations
+     * by the hash of the current version, and updates the thumbnail database accordingly.
+     * Only the hash is read from the files. Works album per album, without locking the database
+     * for a long time, so it can run in the background. New and modified files are scanned
+     * as usual. The observer can interrupt this method; it returns true when all files were processed.
+     * When no old hash is left, the database is switched to the version of the update.
+     */
+    bool updateUniqueHashes();
+
     /**
      * Utility method:
      * Prepare the given albums to be removed,
@@ -179,6 +200,14 @@ protected:
     void scanModifiedFile(const QFileInfo& info, const ItemScanInfo& scanInfo);
     QString scanFileUpdateHash(const QFileInfo& info, const ItemScanInfo& scanInfo);
     void rescanFile(const QFileInfo& info, const ItemScanInfo& scanInfo);
+    qlonglong scanNewFile(ImageScanner& scanner, const QFileInfo& info, int albumId);
+    void scanModifiedFile(ImageScanner& scanner);
+    QString scanFileUpdateHash(ImageScanner& scanner);
+    void scanFileUpdateHashAndThumbnail(ImageScanner& scanner, const ItemScanInfo& scanInfo);
+    void rescanFile(ImageScanner& scanner);
+    void addScanJob(CollectionScannerJob* job);
+    void applyScanJobs(int remaining);
+    void applyScanJob(CollectionScannerJob* job);
     void itemsWereRemoved(const QList<qlonglong> &removedIds);
     void completeHistoryScanning();
     void finishHistoryScanning();
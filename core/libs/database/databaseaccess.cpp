@@ -27,6 +27,7 @@
 
 #include <QEventLoop>
 #include <QMutex>
+#include <QReadWriteLock>
 #include <QSqlDatabase>
 #include <QUuid>
 
@@ -68,6 +69,9 @@ public:
     DatabaseWatch*      databaseWatch;
     DatabaseParameters  parameters;
     DatabaseLocking     lock;
+    /// Held for reading by readers, which do not hold the lock's mutex,
+    /// and for writing when the backend is replaced or closed.
+    QReadWriteLock      readersLock;
     QString             lastError;
     QUuid               applicationIdentifier;
 
@@ -95,8 +99,34 @@ public:
 DatabaseAccessStaticPriv* DatabaseAccess::d = 0;
 
 DatabaseAccess::DatabaseAccess()
+    : m_sharedRead(false)
 {
     Q_ASSERT(d/*You will want to call setParameters before constructing DatabaseAccess*/);
+    lockExclusively();
+}
+
+DatabaseAccess::DatabaseAccess(AccessMode mode)
+    : m_sharedRead(false)
+{
+    Q_ASSERT(d/*You will want to call setParameters before constructing DatabaseAccess*/);
+
+    // Never wait here for the readers lock: If the backend is about to be replaced, we fall back to the mutex.
+    if (mode == ReadAccess && d->readersLock.tryLockForRead())
+    {
+        if (d->backend->isReady() && d->backend->supportsConcurrentReading())
+        {
+            m_sharedRead = true;
+            return;
+        }
+
+        d->readersLock.unlock();
+    }
+
+    lockExclusively();
+}
+
+void DatabaseAccess::lockExclusively()
+{
     d->lock.mutex.lock();
     d->lock.lockCount++;
 
@@ -115,11 +145,18 @@ DatabaseAccess::DatabaseAccess()
 
 DatabaseAccess::~DatabaseAccess()
 {
+    if (m_sharedRead)
+    {
+        d->readersLock.unlock();
+        return;
+    }
+
     d->lock.lockCount--;
     d->lock.mutex.unlock();
 }
 
 DatabaseAccess::DatabaseAccess(bool)
+    : m_sharedRead(false)
 {
     // private constructor, when mutex is locked and
     // backend should not be checked
@@ -191,6 +228,8 @@ void DatabaseAccess::setParameters(const DatabaseParameters& parameters, Applica
         d = new DatabaseAccessStaticPriv();
     }
 
+    // wait for all readers, before the mutex, which readers may try to acquire
+    QWriteLocker readersLock(&d->readersLock);
     DatabaseAccessMutexLocker lock(d);
 
     if (d->parameters == parameters)
@@ -333,6 +372,7 @@ void DatabaseAccess::cleanUpDatabase()
 {
     if (d)
     {
+        QWriteLocker readersLock(&d->readersLock);
         DatabaseAccessMutexLocker locker(d);
         d->backend->close();
         delete d->db;
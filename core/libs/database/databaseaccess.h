@@ -67,6 +67,30 @@ public:
       * for a full opening process including schema update and error messages.
       */
     DatabaseAccess();
+
+    enum AccessMode
+    {
+        /**
+          * Exclusive access, as provided by the default constructor.
+          * Required for writing to the database, and for all objects protected by the lock,
+          * like the ImageInfoCache.
+          */
+        WriteAccess,
+        /**
+          * Shared access for read-only queries of the AlbumDB.
+          * If the backend supports concurrent reading (SQLite in WAL mode, MySQL),
+          * any number of readers run in parallel to each other and to the single writer,
+          * each thread using its own connection. Otherwise, this is the same as WriteAccess.
+          * Do not write to the database with such an object, do not emit changesets,
+          * and do not access ImageInfo or other objects relying on the DatabaseAccess lock.
+          */
+        ReadAccess
+    };
+
+    /**
+      * Create a DatabaseAccess object for the default database with the given mode.
+      */
+    explicit DatabaseAccess(AccessMode mode);
     ~DatabaseAccess();
 
     /**
@@ -144,6 +168,11 @@ private:
 
     DatabaseAccess(bool);
 
+    void lockExclusively();
+
+    /// true if this object holds shared read access instead of the mutex
+    bool m_sharedRead;
+
     friend class DatabaseAccessUnlock;
     static DatabaseAccessStaticPriv* d;
 };
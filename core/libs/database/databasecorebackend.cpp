@@ -51,6 +51,7 @@
 
 #include <kdebug.h>
 #include <kglobal.h>
+#include <kmountpoint.h>
 
 // Local includes
 
@@ -88,8 +89,9 @@ DatabaseCoreBackendPrivate::DatabaseCoreBackendPrivate(DatabaseCoreBackend* back
     : q(backend)
 {
 
-    status          = DatabaseCoreBackend::Unavailable;
-    isInTransaction = false;
+    status            = DatabaseCoreBackend::Unavailable;
+    isInTransaction   = false;
+    concurrentReading = false;
     operationStatus = DatabaseCoreBackend::ExecuteNormal;
     errorHandler    = 0;
 }
@@ -115,8 +117,14 @@ void DatabaseCoreBackendPrivate::init(const QString& name, DatabaseLocking* l)
 QSqlDatabase DatabaseCoreBackendPrivate::databaseForThread()
 {
     QThread* thread = QThread::currentThread();
-    QSqlDatabase db = threadDatabases[thread];
-    int isValid = databasesValid[thread];
+    QSqlDatabase db;
+    int isValid;
+
+    {
+        QMutexLocker threadLock(&threadDataMutex);
+        db      = threadDatabases.value(thread);
+        isValid = databasesValid.value(thread);
+    }
 
     if (!isValid || !db.isOpen())
     {
@@ -148,29 +156,35 @@ void DatabaseCoreBackendPrivate::closeDatabaseForThread()
     QThread* thread = QThread::currentThread();
     // scope, so that db is destructed when calling removeDatabase
     {
-        QSqlDatabase db = threadDatabases[thread];
+        QSqlDatabase db;
+
+        {
+            QMutexLocker threadLock(&threadDataMutex);
+            db = threadDatabases.take(thread);
+            databaseErrors.remove(thread);
+            databasesValid[thread] = 0;
+            transactionCount.remove(thread);
+        }
 
         if (db.isValid())
         {
             db.close();
         }
     }
-    threadDatabases.remove(thread);
-    databaseErrors.remove(thread);
-    databasesValid[thread] = 0;
-    transactionCount.remove(thread);
     QSqlDatabase::removeDatabase(connectionName(thread));
 }
 
 QSqlError DatabaseCoreBackendPrivate::databaseErrorForThread()
 {
     QThread* thread = QThread::currentThread();
-    return databaseErrors[thread];
+    QMutexLocker threadLock(&threadDataMutex);
+    return databaseErrors.value(thread);
 }
 
 void DatabaseCoreBackendPrivate::setDatabaseErrorForThread(QSqlError lastError)
 {
     QThread* thread = QThread::currentThread();
+    QMutexLocker threadLock(&threadDataMutex);
     databaseErrors.insert(thread, lastError);
 }
 
@@ -195,8 +209,8 @@ bool DatabaseCoreBackendPrivate::open(QSqlDatabase& db)
     if (parameters.isSQLite())
     {
         QStringList toAdd;
-        // enable shared cache, especially useful with SQLite >= 3.5.0
-        toAdd << "QSQLITE_ENABLE_SHARED_CACHE";
+        // No shared cache: Connections sharing the cache use table-level locking
+        // and would block each other, while in WAL mode, readers and the writer can proceed concurrently.
         // We do our own waiting.
         toAdd << "QSQLITE_BUSY_TIMEOUT=0";
 
@@ -222,6 +236,7 @@ bool DatabaseCoreBackendPrivate::open(QSqlDatabase& db)
         kDebug() << "Error while opening the database. Error was <" << db.lastError() << ">";
     }
 
+    QMutexLocker threadLock(&threadDataMutex);
     threadDatabases[thread]  = db;
     databasesValid[thread]   = 1;
     transactionCount[thread] = 0;
@@ -229,21 +244,79 @@ bool DatabaseCoreBackendPrivate::open(QSqlDatabase& db)
     return success;
 }
 
+bool DatabaseCoreBackendPrivate::enableWriteAheadLog()
+{
+    if (!parameters.isSQLite())
+    {
+        // the server takes care of concurrent connections
+        return true;
+    }
+
+    // WAL needs shared memory between all connections to the file, which network file systems do not provide
+    bool useWal = parameters.writeAheadLog;
+
+    if (useWal)
+    {
+        KMountPoint::Ptr mountPoint = KMountPoint::currentMountPoints().findByPath(parameters.databaseName);
+
+        if (mountPoint && mountPoint->probablySlow())
+        {
+            kDebug() << "Database" << parameters.databaseName << "is on the network file system"
+                     << mountPoint->mountType() << ", not using the write-ahead log";
+            useWal = false;
+        }
+    }
+
+    // The journal mode is persistent in the database file, a file switched to WAL before is switched back.
+    // Requires SQLite >= 3.7.0, older versions keep their mode.
+    QSqlQuery query(databaseForThread());
+
+    if (!query.exec("PRAGMA journal_mode;") || !query.next())
+    {
+        kDebug() << "Failed to query the journal mode of the database:" << query.lastError();
+        return false;
+    }
+
+    QString mode = query.value(0).toString();
+
+    if (useWal || mode.compare("wal", Qt::CaseInsensitive) == 0)
+    {
+        if (!query.exec(useWal ? "PRAGMA journal_mode=WAL;" : "PRAGMA journal_mode=DELETE;") || !query.next())
+        {
+            kDebug() << "Failed to set the journal mode of the database:" << query.lastError();
+            return false;
+        }
+
+        mode = query.value(0).toString();
+    }
+
+    if (!useWal || mode.compare("wal", Qt::CaseInsensitive) != 0)
+    {
+        kDebug() << "Database" << parameters.databaseName << "uses journal mode" << mode << ", readers will be serialized";
+        return false;
+    }
+
+    return true;
+}
+
 bool DatabaseCoreBackendPrivate::incrementTransactionCount()
 {
     QThread* thread = QThread::currentThread();
+    QMutexLocker threadLock(&threadDataMutex);
     return !transactionCount[thread]++;
 }
 
 bool DatabaseCoreBackendPrivate::decrementTransactionCount()
 {
     QThread* thread = QThread::currentThread();
+    QMutexLocker threadLock(&threadDataMutex);
     return !--transactionCount[thread];
 }
 
 bool DatabaseCoreBackendPrivate::isInTransactionInOtherThread() const
 {
     QThread* thread = QThread::currentThread();
+    QMutexLocker threadLock(&threadDataMutex);
     QHash<QThread*, int>::const_iterator it;
 
     for (it=transactionCount.constBegin(); it != transactionCount.constEnd(); ++it)
@@ -742,6 +815,24 @@ void DatabaseCoreBackend::slotMainThreadFinished()
     d->closeDatabaseForThread();
 }
 
+void DatabaseCoreBackend::addBoundValuePlaceholders(QString& query, int count)
+{
+    // adds no spaces at beginning or end
+    QString questionMarks;
+    questionMarks.reserve(count * 2);
+    QString questionMark("?,");
+
+    for (int i=0; i<count; ++i)
+    {
+        questionMarks += questionMark;
+    }
+
+    // remove last ','
+    questionMarks.chop(1);
+
+    query += questionMarks;
+}
+
 bool DatabaseCoreBackend::isCompatible(const DatabaseParameters& parameters)
 {
     return QSqlDatabase::drivers().contains(parameters.databaseType);
@@ -754,7 +845,10 @@ bool DatabaseCoreBackend::open(const DatabaseParameters& parameters)
 
     // Force possibly opened thread dbs to re-open with new parameters.
     // They are not accessible from this thread!
-    d->databasesValid.clear();
+    {
+        QMutexLocker threadLock(&d->threadDataMutex);
+        d->databasesValid.clear();
+    }
 
     int retries = 0;
 
@@ -778,7 +872,9 @@ bool DatabaseCoreBackend::open(const DatabaseParameters& parameters)
         else
             { break; }
     }
-    d->status = Open;
+
+    d->concurrentReading = d->enableWriteAheadLog();
+    d->status            = Open;
     return true;
 }
 
@@ -818,6 +914,18 @@ DatabaseCoreBackend::Status DatabaseCoreBackend::status() const
     return d->status;
 }
 
+bool DatabaseCoreBackend::supportsConcurrentReading() const
+{
+    Q_D(const DatabaseCoreBackend);
+    return d->concurrentReading;
+}
+
+bool DatabaseCoreBackend::isSQLite() const
+{
+    Q_D(const DatabaseCoreBackend);
+    return d->parameters.isSQLite();
+}
+
 /*
 bool DatabaseCoreBackend::execSql(const QString& sql, QStringList* values)
 {
@@ -172,6 +172,18 @@ public:
         return status() == OpenSchemaChecked;
     }
 
+    /**
+     * Returns if a thread can read from the database with its own connection
+     * while other threads are reading or writing. This is the case for
+     * SQLite databases in write-ahead log (WAL) journal mode, and for MySQL.
+     */
+    bool supportsConcurrentReading() const;
+
+    /**
+     * Returns if the database is an SQLite database.
+     */
+    bool isSQLite() const;
+
     /**
      * Add a DatabaseErrorHandler. This object must be created in the main thread.
      * If a database error occurs, this object can handle problem solving and user interaction.
@@ -422,6 +434,12 @@ public:
      */
     QSqlError lastSQLError();
 
+    /**
+     * Appends count comma-separated placeholders for bound values to query,
+     * for use in an "IN (...)" clause.
+     */
+    static void addBoundValuePlaceholders(QString& query, int count);
+
     /*
         Qt SQL driver supported features
         SQLITE3:
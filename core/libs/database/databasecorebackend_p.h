@@ -27,6 +27,7 @@
 // Qt includes
 
 #include <QHash>
+#include <QMutex>
 #include <QSqlDatabase>
 #include <QThread>
 #include <QWaitCondition>
@@ -55,6 +56,7 @@ public:
 
     void closeDatabaseForThread();
     bool open(QSqlDatabase& db);
+    bool enableWriteAheadLog();
     bool incrementTransactionCount();
     bool decrementTransactionCount();
     bool isInTransactionInOtherThread() const;
@@ -84,7 +86,9 @@ public:
 
 public:
 
-    // this is always accessed in mutex context, no need for QThreadStorage
+    // The per-thread data is accessed under lock of the threadDataMutex only,
+    // as readers with DatabaseAccess::ReadAccess do not hold the main mutex.
+    mutable QMutex                            threadDataMutex;
     QHash<QThread*, QSqlDatabase>             threadDatabases;
     // this is not only db.isValid(), but also "parameters changed, need to reopen"
     QHash<QThread*, int>                      databasesValid;
@@ -94,6 +98,8 @@ public:
     QHash<QThread*, QSqlError>                databaseErrors;
 
     bool                                      isInTransaction;
+    // the database allows reading in parallel to other connections
+    bool                                      concurrentReading;
 
     QString                                   backendName;
 
@@ -54,6 +54,7 @@ static const char* configDatabasePort = "Database Port";
 static const char* configDatabaseUsername = "Database Username";
 static const char* configDatabasePassword = "Database Password";
 static const char* configDatabaseConnectOptions = "Database Connectoptions";
+static const char* configDatabaseWriteAheadLog = "Database Write Ahead Log";
 // legacy
 static const char* configDatabaseFilePathEntry = "Database File Path";
 static const char* configAlbumPathEntry = "Album Path";
@@ -62,7 +63,7 @@ static const char* digikam4db = "digikam4.db";
 static const char* thumbnails_digikamdb = "thumbnails-digikam.db";
 
 DatabaseParameters::DatabaseParameters()
-    : port(-1)
+    : port(-1), internalServer(false), writeAheadLog(true)
 {
 }
 
@@ -77,13 +78,13 @@ DatabaseParameters::DatabaseParameters(const QString& type,
                                        const QString& databaseNameThumbnails)
     : databaseType(type), databaseName(databaseName),
       connectOptions(connectOptions), hostName(hostName),
-      port(port), internalServer(internalServer), userName(userName),
+      port(port), internalServer(internalServer), writeAheadLog(true), userName(userName),
       password(password), databaseNameThumbnails(databaseNameThumbnails)
 {
 }
 
 DatabaseParameters::DatabaseParameters(const KUrl& url)
-    : port(-1), internalServer(false)
+    : port(-1), internalServer(false), writeAheadLog(true)
 {
     databaseType   = url.queryItem("databaseType");
     databaseName   = url.queryItem("databaseName");
@@ -104,6 +105,13 @@ DatabaseParameters::DatabaseParameters(const KUrl& url)
         internalServer = (queryServer == "true");
     }
 
+    QString queryWriteAheadLog = url.queryItem("writeAheadLog");
+
+    if (!queryWriteAheadLog.isNull())
+    {
+        writeAheadLog = (queryWriteAheadLog == "true");
+    }
+
     userName       = url.queryItem("userName");
     password       = url.queryItem("password");
 }
@@ -117,6 +125,7 @@ bool DatabaseParameters::operator==(const DatabaseParameters& other) const
            hostName       == other.hostName &&
            port           == other.port &&
            internalServer == other.internalServer &&
+           writeAheadLog  == other.writeAheadLog &&
            userName       == other.userName &&
            password       == other.password;
 }
@@ -208,6 +217,7 @@ void DatabaseParameters::readFromConfig(KSharedConfig::Ptr config, const QString
     password                 = group.readEntry(configDatabasePassword, QString());
     connectOptions           = group.readEntry(configDatabaseConnectOptions, QString());
     internalServer           = group.readEntry(configInternalDatabaseServer, false);
+    writeAheadLog            = group.readEntry(configDatabaseWriteAheadLog, true);
 
     if (isSQLite() && !databaseName.isNull())
     {
@@ -355,6 +365,7 @@ void DatabaseParameters::writeToConfig(KSharedConfig::Ptr config, const QString&
     group.writeEntry(configDatabasePassword, password);
     group.writeEntry(configDatabaseConnectOptions, connectOptions);
     group.writeEntry(configInternalDatabaseServer, internalServer);
+    group.writeEntry(configDatabaseWriteAheadLog, writeAheadLog);
 }
 
 QString DatabaseParameters::getDatabaseNameOrDir() const
@@ -429,6 +440,8 @@ DatabaseParameters DatabaseParameters::thumbnailParameters() const
 {
     DatabaseParameters params = *this;
     params.databaseName = databaseNameThumbnails;
+    // the thumbnail database is mostly written to, readers gain nothing from the write-ahead log
+    params.writeAheadLog = false;
     return params;
 }
 
@@ -473,6 +486,11 @@ void DatabaseParameters::insertInUrl(KUrl& url) const
         url.addQueryItem("internalServer", "true");
     }
 
+    if (!writeAheadLog)
+    {
+        url.addQueryItem("writeAheadLog", "false");
+    }
+
     if (!userName.isNull())
     {
         url.addQueryItem("userName", userName);
@@ -492,6 +510,7 @@ void DatabaseParameters::removeFromUrl(KUrl& url)
     url.removeQueryItem("hostName");
     url.removeQueryItem("port");
     url.removeQueryItem("internalServer");
+    url.removeQueryItem("writeAheadLog");
     url.removeQueryItem("userName");
     url.removeQueryItem("password");
 }
@@ -518,6 +537,11 @@ QDebug operator<<(QDebug dbg, const DatabaseParameters& p)
         dbg.nospace() << "Using an Internal Server; ";
     }
 
+    if (p.isSQLite() && !p.writeAheadLog)
+    {
+        dbg.nospace() << "No Write-Ahead Log; ";
+    }
+
     if (!p.userName.isEmpty())
         dbg.nospace() << "Username and Password: "
                       << p.userName << ", " << p.password;
@@ -74,6 +74,9 @@ public:
     QString hostName;
     int     port;
     bool    internalServer;
+    /** SQLite only: allow the write-ahead log journal mode, so that readers are not blocked by the writer.
+     *  It is never used for the thumbnail database and for files on network file systems. */
+    bool    writeAheadLog;
     QString userName;
     QString password;
 
@@ -24,6 +24,12 @@
 
 #include "databasethumbnailinfoprovider.h"
 
+// Qt includes
+
+#include <QHash>
+#include <QMap>
+#include <QPair>
+
 // KDE includes
 
 #include <kurl.h>
@@ -55,7 +61,8 @@ ThumbnailInfo DatabaseThumbnailInfoProvider::thumbnailInfo(const QString& path)
     thumbinfo.filePath = path;
     thumbinfo.isAccessible = CollectionManager::instance()->locationForAlbumRootId(imageinfo.albumRootId()).isAvailable();
 
-    DatabaseAccess access;
+    // plain queries, which may run in parallel to other thumbnail threads
+    DatabaseAccess access(DatabaseAccess::ReadAccess);
     values = access.db()->getImagesFields(imageinfo.id(),
                                           DatabaseFields::ModificationDate | DatabaseFields::FileSize | DatabaseFields::UniqueHash);
 
@@ -76,5 +83,84 @@ ThumbnailInfo DatabaseThumbnailInfoProvider::thumbnailInfo(const QString& path)
     return thumbinfo;
 }
 
+QList<ThumbnailInfo> DatabaseThumbnailInfoProvider::thumbnailInfos(const QStringList& paths)
+{
+    // Group the files by album, to resolve them with one query per album instead of one per file
+    typedef QPair<int, QString> AlbumKey;
+    QMap<AlbumKey, QHash<QString, QString> > pathsByAlbum;
+    QMap<AlbumKey, bool>                     albumIsAccessible;
+    QHash<QString, ThumbnailInfo>            infos;
+    QHash<qlonglong, QString>                pathForId;
+
+    foreach (const QString& path, paths)
+    {
+        KUrl url = KUrl::fromPath(path);
+        CollectionLocation location = CollectionManager::instance()->locationForUrl(url);
+
+        if (location.isNull())
+        {
+            continue;
+        }
+
+        KUrl dirUrl(url.directory());
+        AlbumKey key(location.id(), CollectionManager::instance()->album(dirUrl.toLocalFile()));
+        pathsByAlbum[key][url.fileName()] = path;
+        albumIsAccessible[key]            = location.isAvailable();
+    }
+
+    {
+        // plain queries, which may run in parallel to other thumbnail threads
+        DatabaseAccess access(DatabaseAccess::ReadAccess);
+
+        for (QMap<AlbumKey, QHash<QString, QString> >::const_iterator it = pathsByAlbum.constBegin();
+             it != pathsByAlbum.constEnd(); ++it)
+        {
+            QHash<QString, qlonglong> ids = access.db()->getItemIDs(it.key().first, it.key().second, it.value().keys());
+
+            for (QHash<QString, qlonglong>::const_iterator idIt = ids.constBegin(); idIt != ids.constEnd(); ++idIt)
+            {
+                const QString& path      = it.value().value(idIt.key());
+                ThumbnailInfo& thumbinfo = infos[path];
+                thumbinfo.filePath       = path;
+                thumbinfo.isAccessible   = albumIsAccessible.value(it.key());
+                pathForId[idIt.value()]  = path;
+            }
+        }
+
+        QList<qlonglong> idList = pathForId.keys();
+
+        // rows of id, modification date, file size, unique hash
+        QVariantList values = access.db()->getImagesFields(idList, DatabaseFields::ModificationDate |
+                                                           DatabaseFields::FileSize | DatabaseFields::UniqueHash);
+
+        for (QVariantList::const_iterator it = values.constBegin(); it != values.constEnd(); it += 4)
+        {
+            ThumbnailInfo& thumbinfo   = infos[pathForId.value((*it).toLongLong())];
+            thumbinfo.modificationDate = (*(it + 1)).toDateTime();
+            thumbinfo.fileSize         = (*(it + 2)).toInt();
+            thumbinfo.uniqueHash       = (*(it + 3)).toString();
+        }
+
+        // rows of id, orientation
+        values = access.db()->getImageInformation(idList, DatabaseFields::Orientation);
+
+        for (QVariantList::const_iterator it = values.constBegin(); it != values.constEnd(); it += 2)
+        {
+            infos[pathForId.value((*it).toLongLong())].orientationHint = (*(it + 1)).toInt();
+        }
+    }
+
+    QList<ThumbnailInfo> result;
+
+    foreach (const QString& path, paths)
+    {
+        QHash<QString, ThumbnailInfo>::const_iterator it = infos.constFind(path);
+
+        // files outside the collections or not in the database
+        result << (it == infos.constEnd() ? ThumbnailCreator::fileThumbnailInfo(path) : it.value());
+    }
+
+    return result;
+}
 
 }  // namespace Digikam
@@ -37,6 +37,7 @@ class DIGIKAM_DATABASE_EXPORT DatabaseThumbnailInfoProvider : public ThumbnailIn
 public:
 
     ThumbnailInfo thumbnailInfo(const QString& path);
+    QList<ThumbnailInfo> thumbnailInfos(const QStringList& paths);
 };
 
 
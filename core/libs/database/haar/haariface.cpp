@@ -35,10 +35,19 @@
 // Qt includes
 
 #include <QByteArray>
+#include <QHash>
 #include <QDataStream>
 #include <QImage>
 #include <QImageReader>
+#include <QAtomicInt>
 #include <QMap>
+#include <QPair>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QVector>
+#include <QtAlgorithms>
 
 // KDE includes
 
@@ -56,6 +65,9 @@
 #include "databasebackend.h"
 #include "searchxml.h"
 #include "haar.h"
+#include "haarindex.h"
+#include "haariface_p.h"
+#include "haarsignaturestore.h"
 #include "sqlquery.h"
 
 using namespace std;
@@ -63,85 +75,6 @@ using namespace std;
 namespace Digikam
 {
 
-typedef QMap<qlonglong, Haar::SignatureData> SignatureCache;
-
-/** This class encapsulates the Haar signature in a QByteArray
- *  that can be stored as a BLOB in the database.
- *
- *  Reading and writing is done in a platform-independent manner, which
- *  induces a certain overhead, but which is necessary IMO.
- */
-class DatabaseBlob
-{
-public:
-
-    enum { Version = 1 };
-
-public:
-
-    DatabaseBlob() {}
-
-    /** Read the QByteArray into the Haar::SignatureData.
-     */
-    void read(const QByteArray& array, Haar::SignatureData* data)
-    {
-        QDataStream stream(array);
-
-        // check version
-        qint32 version;
-        stream >> version;
-
-        if (version != Version)
-        {
-            kError() << "Unsupported binary version of Haar Blob in database";
-            return;
-        }
-
-        stream.setVersion(QDataStream::Qt_4_3);
-
-        // read averages
-        for (int i=0; i<3; ++i)
-        {
-            stream >> data->avg[i];
-        }
-
-        // read coefficients
-        for (int i=0; i<3; ++i)
-            for (int j=0; j<Haar::NumberOfCoefficients; ++j)
-            {
-                stream >> data->sig[i][j];
-            }
-    }
-
-    QByteArray write(Haar::SignatureData* data)
-    {
-        QByteArray array;
-        array.reserve(sizeof(qint32) + 3*sizeof(double) + 3*sizeof(qint32)*Haar::NumberOfCoefficients);
-        QDataStream stream(&array, QIODevice::WriteOnly);
-        stream.setVersion(QDataStream::Qt_4_3);
-
-        // write version
-        stream << (qint32)Version;
-
-        // write averages
-        for (int i=0; i<3; ++i)
-        {
-            stream << data->avg[i];
-        }
-
-        // write coefficients
-        for (int i=0; i<3; ++i)
-            for (int j=0; j<Haar::NumberOfCoefficients; ++j)
-            {
-                stream << data->sig[i][j];
-            }
-
-        return array;
-    }
-};
-
-// -----------------------------------------------------------------------------------------------------
-
 class HaarIface::HaarIfacePriv
 {
 public:
@@ -150,8 +83,7 @@ public:
     {
         data              = 0;
         bin               = 0;
-        signatureCache    = 0;
-        useSignatureCache = false;
+        indexChanged      = false;
 
         signatureQuery = QString("SELECT M.imageid, 0, M.matrix "
                                  " FROM ImageHaarMatrix AS M "
@@ -169,7 +101,6 @@ public:
     {
         delete data;
         delete bin;
-        delete signatureCache;
     }
 
     void createLoadingBuffer()
@@ -188,83 +119,89 @@ public:
         }
     }
 
-    void setSignatureCacheEnabled(bool cache, const QSet<qlonglong>& imageIds)
+    /** Reads the signatures of all available images from the database.
+     *  If filterByAlbumRoots is true, only images in the album roots to search are read.
+     */
+    Haar::SignatureStore readSignatures(bool filterByAlbumRoots)
     {
-        setSignatureCacheEnabled(cache);
+        Haar::SignatureStore store;
+        DatabaseAccess       access;
+        DatabaseBlob         blob;
+        Haar::SignatureData  targetSig;
 
-        // stop here if we disable cached signatures
-        if (!cache || imageIds.isEmpty())
+        filterByAlbumRoots = filterByAlbumRoots && !albumRootsToSearch.isEmpty();
+        SqlQuery query     = access.backend()->prepareQuery(filterByAlbumRoots ? signatureByAlbumRootsQuery
+                                                                                : signatureQuery);
+
+        if (!access.backend()->exec(query))
         {
-            return;
+            return store;
         }
 
-        // Remove all ids from the fully created signatureCache that are not needed for the duplicates search.
-        // This is usually faster then starting a query for every single id in imageIds.
-        //
-        // It might look like a waste of resources, but I tested this quite intense.
-        // Getting all signatures and removing the not wanted ones is really more efficient
-        // then doing X queries (where X = imageIds.count())
-
-        for (SignatureCache::iterator it = signatureCache->begin();
-             it != signatureCache->end(); )
+        // We don't use DatabaseBackend's convenience calls, as the result set is large
+        // and we try to avoid copying in a temporary QList<QVariant>
+        while (query.next())
         {
-            if (!imageIds.contains(it.key()))
+            if (filterByAlbumRoots && !albumRootsToSearch.contains(query.value(1).toInt()))
             {
-                it = signatureCache->erase(it);
-            }
-            else
-            {
-                ++it;
+                continue;
             }
+
+            blob.read(query.value(2).toByteArray(), &targetSig);
+            store.append(query.value(0).toLongLong(), targetSig);
         }
+
+        return store;
     }
 
-    void setSignatureCacheEnabled(bool cache)
+    /** Checks the given candidates against the database: only images which are available (status=1),
+     *  have a signature stored and are located in the album roots to search are returned.
+     */
+    QSet<qlonglong> availableImages(const QList<qlonglong>& candidates)
     {
-        delete signatureCache;
-	signatureCache = 0;
+        QSet<qlonglong> available;
+        const bool      filterByAlbumRoots = !albumRootsToSearch.isEmpty();
+        const int       chunkSize          = 500;
+        DatabaseAccess  access;
 
-        if (cache)
+        for (int i = 0; i < candidates.size(); i += chunkSize)
         {
-            signatureCache = new SignatureCache();
-        }
-
-        useSignatureCache = cache;
+            QList<QVariant> boundValues, values;
 
-        // stop here if we disable cached signatures
-        if (!cache)
-        {
-            return;
-        }
-
-        // Variables for data read from DB
-        DatabaseAccess      access;
-        DatabaseBlob        blob;
-        qlonglong           imageid;
-        Haar::SignatureData targetSig;
+            foreach (const qlonglong& id, candidates.mid(i, chunkSize))
+            {
+                boundValues << id;
+            }
 
-        // reference for easier access
-        SignatureCache& signatureCache = *this->signatureCache;
+            QString query("SELECT M.imageid, Albums.albumRoot "
+                          " FROM ImageHaarMatrix AS M "
+                          "    INNER JOIN Images ON Images.id=M.imageid "
+                          "    INNER JOIN Albums ON Albums.id=Images.album "
+                          " WHERE Images.status=1 AND M.imageid IN (");
+            access.db()->addBoundValuePlaceholders(query, boundValues.size());
+            query += ");";
+            access.backend()->execSql(query, boundValues, &values);
 
-        SqlQuery query = access.backend()->prepareQuery(signatureQuery);
+            for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+            {
+                qlonglong imageid = (*it).toLongLong();
+                ++it;
+                int albumRootId   = (*it).toInt();
+                ++it;
 
-        if (!access.backend()->exec(query))
-        {
-            return;
+                if (!filterByAlbumRoots || albumRootsToSearch.contains(albumRootId))
+                {
+                    available << imageid;
+                }
+            }
         }
 
-        while (query.next())
-        {
-            imageid = query.value(0).toLongLong();
-            blob.read(query.value(2).toByteArray(), &targetSig);
-            signatureCache[imageid] = targetSig;
-        }
+        return available;
     }
 
-    bool             useSignatureCache;
+    bool             indexChanged;
     Haar::ImageData* data;
     Haar::WeightBin* bin;
-    SignatureCache*  signatureCache;
     QString          signatureQuery;
     QString          signatureByAlbumRootsQuery;
     QSet<int>        albumRootsToSearch;
@@ -277,6 +214,12 @@ HaarIface::HaarIface()
 
 HaarIface::~HaarIface()
 {
+    // write the changes to the cache file once, not after every indexed image
+    if (d->indexChanged)
+    {
+        HaarIndex::instance()->save();
+    }
+
     delete d;
 }
 
@@ -363,27 +306,63 @@ bool HaarIface::indexImage(qlonglong imageid)
     Haar::Calculator haar;
     haar.transform(d->data);
 
-    Haar::SignatureData sig;
-    haar.calcHaar(d->data, &sig);
+    QMap<qlonglong, Haar::SignatureData> signatures;
+    haar.calcHaar(d->data, &signatures[imageid]);
 
-    DatabaseAccess access;
+    storeSignatures(signatures);
 
-    // Store main entry
-    {
-        // prepare blob
-        DatabaseBlob blob;
-        QByteArray array = blob.write(&sig);
+    return true;
+}
 
-        access.backend()->execSql(QString("REPLACE INTO ImageHaarMatrix "
-                                          " (imageid, modificationDate, uniqueHash, matrix) "
-                                          " SELECT id, modificationDate, uniqueHash, ? "
-                                          "  FROM Images WHERE id=?; "),
-                                  array, imageid);
+bool HaarIface::calculateSignature(const DImg& image, Haar::SignatureData* sig)
+{
+    if (image.isNull())
+    {
+        return false;
     }
 
+    d->createLoadingBuffer();
+    d->data->fillPixelData(image);
+
+    Haar::Calculator haar;
+    haar.transform(d->data);
+    haar.calcHaar(d->data, sig);
+
     return true;
 }
 
+void HaarIface::storeSignatures(const QMap<qlonglong, Haar::SignatureData>& signatures)
+{
+    if (signatures.isEmpty())
+    {
+        return;
+    }
+
+    // Store main entries
+    {
+        DatabaseAccess      access;
+        DatabaseTransaction transaction(&access);
+        DatabaseBlob        blob;
+
+        for (QMap<qlonglong, Haar::SignatureData>::const_iterator it = signatures.constBegin();
+             it != signatures.constEnd(); ++it)
+        {
+            // prepare blob
+            QByteArray array = blob.write(&it.value());
+
+            access.backend()->execSql(QString("REPLACE INTO ImageHaarMatrix "
+                                              " (imageid, modificationDate, uniqueHash, matrix) "
+                                              " SELECT id, modificationDate, uniqueHash, ? "
+                                              "  FROM Images WHERE id=?; "),
+                                      array, it.key());
+        }
+    }
+
+    // Keep the inverted index up to date
+    HaarIndex::instance()->addSignatures(signatures);
+    d->indexChanged = true;
+}
+
 QString HaarIface::signatureAsText(const QImage& image)
 {
     d->createLoadingBuffer();
@@ -428,24 +407,14 @@ QList<qlonglong> HaarIface::bestMatchesForImage(qlonglong imageid, int numberOfR
 QList<qlonglong> HaarIface::bestMatchesForImageWithThreshold(qlonglong imageid, double requiredPercentage,
         SketchType type)
 {
-    if ( !d->useSignatureCache || (d->signatureCache->isEmpty() && d->useSignatureCache) )
-    {
-        Haar::SignatureData sig;
-
-        if (!retrieveSignatureFromDB(imageid, &sig))
-        {
-            return QList<qlonglong>();
-        }
+    Haar::SignatureData sig;
 
-        return bestMatchesWithThreshold(&sig, requiredPercentage, type);
-    }
-    else
+    if (!retrieveSignatureFromDB(imageid, &sig))
     {
-        // reference for easier access
-        SignatureCache& signatureCache = *d->signatureCache;
-        Haar::SignatureData& sig = signatureCache[imageid];
-        return bestMatchesWithThreshold(&sig, requiredPercentage, type);
+        return QList<qlonglong>();
     }
+
+    return bestMatchesWithThreshold(&sig, requiredPercentage, type);
 }
 
 QList<qlonglong> HaarIface::bestMatchesForFile(const QString& filename, int numberOfResults, SketchType type)
@@ -473,7 +442,16 @@ QList<qlonglong> HaarIface::bestMatchesForSignature(const QString& signature, in
 
 QList<qlonglong> HaarIface::bestMatches(Haar::SignatureData* querySig, int numberOfResults, SketchType type)
 {
-    QMap<qlonglong, double> scores = searchDatabase(querySig, type);
+    QMap<qlonglong, double> scores;
+
+    if (HaarIndex::instance()->load())
+    {
+        scores = searchIndex(querySig, type, numberOfResults);
+    }
+    else
+    {
+        scores = searchDatabase(querySig, type);
+    }
 
     // Find out the best matches, those with the lowest score
     // We make use of the feature that QMap keys are sorted in ascending order
@@ -530,13 +508,25 @@ QList<qlonglong> HaarIface::bestMatches(Haar::SignatureData* querySig, int numbe
 QList<qlonglong> HaarIface::bestMatchesWithThreshold(Haar::SignatureData* querySig, double requiredPercentage,
         SketchType type)
 {
-    QMap<qlonglong, double> scores = searchDatabase(querySig, type);
+    d->createWeightBin();
+
     double lowest, highest;
     getBestAndWorstPossibleScore(querySig, type, &lowest, &highest);
 
     double range         = highest - lowest;
     double requiredScore = lowest + range * (1.0 - requiredPercentage);
 
+    QMap<qlonglong, double> scores;
+
+    if (HaarIndex::instance()->load())
+    {
+        scores = searchIndexWithThreshold(querySig, type, requiredScore);
+    }
+    else
+    {
+        scores = searchDatabase(querySig, type);
+    }
+
     QMultiMap<double, qlonglong> bestMatches;
     double score, percentage;
     qlonglong id;
@@ -577,96 +567,133 @@ QMap<qlonglong, double> HaarIface::searchDatabase(Haar::SignatureData* querySig,
     Haar::Weights weights((Haar::Weights::SketchType)type);
 
     // layout the query signature for fast lookup
-    Haar::SignatureMap queryMapY, queryMapI, queryMapQ;
-    queryMapY.fill(querySig->sig[0]);
-    queryMapI.fill(querySig->sig[1]);
-    queryMapQ.fill(querySig->sig[2]);
-    Haar::SignatureMap* queryMaps[3] = { &queryMapY, &queryMapI, &queryMapQ };
+    Haar::ScoringQuery query(weights, *d->bin);
+    query.setSignature(*querySig);
 
     // Map imageid -> score. Lowest score is best.
-    // any newly inserted value will be initialized with a score of 0, as required
     QMap<qlonglong, double> scores;
+    Haar::SignatureStore    store = d->readSignatures(true);
+    QVector<double>         storeScores(store.size());
+
+    store.score(query, 0, store.size(), storeScores.data());
+
+    for (int i = 0; i < store.size(); ++i)
+    {
+        scores[store.ids.at(i)] = storeScores.at(i);
+    }
+
+    return scores;
+}
 
-    // Variables for data read from DB
-    DatabaseAccess      access;
-    DatabaseBlob        blob;
-    qlonglong           imageid;
-    Haar::SignatureData targetSig;
+/// Scores every image using the inverted index and returns the numberOfResults best available images, and ties
+QMap<qlonglong, double> HaarIface::searchIndex(Haar::SignatureData* querySig, SketchType type, int numberOfResults)
+{
+    d->createWeightBin();
 
-    // reference for easier access
-    SignatureCache& signatureCache = *d->signatureCache;
+    Haar::Weights     weights((Haar::Weights::SketchType)type);
+    HaarIndex::Scores index;
+    HaarIndex::instance()->calculateScores(*querySig, weights, *d->bin, index);
 
-    bool filterByAlbumRoots = !d->albumRootsToSearch.isEmpty();
+    // Rank all indexed images by score, lowest (best) first
+    QVector<QPair<double, int> > ranking;
+    ranking.reserve(index.ids.size());
 
-    // if no cache is used or the cache signature map is empty, query the database
-    if ( !d->useSignatureCache || (signatureCache.isEmpty() && d->useSignatureCache) )
+    for (int i = 0; i < index.ids.size(); ++i)
     {
-        QString queryText;
-
-        if (filterByAlbumRoots)
+        if (index.ids.at(i))
         {
-            queryText = d->signatureByAlbumRootsQuery;
+            ranking << qMakePair(index.scores.at(i), i);
         }
-        else
+    }
+
+    qSort(ranking.begin(), ranking.end());
+
+    // The index does not know about removed images. Check the best candidates against the database,
+    // chunk by chunk, until we have enough results. Images with the same score as the last result are kept.
+    QMap<qlonglong, double> scores;
+    const int               chunkSize  = qMax(2 * numberOfResults, 100);
+    int                     found      = 0;
+    double                  worstScore = 0;
+    int                     pos        = 0;
+
+    while (pos < ranking.size())
+    {
+        if (found >= numberOfResults && ranking.at(pos).first > worstScore)
         {
-            queryText = d->signatureQuery;
+            break;
         }
 
-        SqlQuery query = access.backend()->prepareQuery(queryText);
+        const int        chunkStart = pos;
+        const int        chunkEnd   = qMin(pos + chunkSize, ranking.size());
+        QList<qlonglong> candidates;
 
-        if (!access.backend()->exec(query))
+        for (; pos < chunkEnd; ++pos)
         {
-            return scores;
+            candidates << index.ids.at(ranking.at(pos).second);
         }
 
-        // We don't use DatabaseBackend's convenience calls, as the result set is large
-        // and we try to avoid copying in a temporary QList<QVariant>
-        int albumRootId = 0;
+        QSet<qlonglong> available = d->availableImages(candidates);
 
-        while (query.next())
+        for (int i = chunkStart; i < chunkEnd; ++i)
         {
-            imageid = query.value(0).toLongLong();
+            const double score = ranking.at(i).first;
 
-            if (filterByAlbumRoots)
+            if (found >= numberOfResults && score > worstScore)
             {
-                albumRootId = query.value(1).toInt();
-
-                if (!d->albumRootsToSearch.contains(albumRootId))
-                {
-                    continue;
-                }
+                pos = ranking.size();
+                break;
             }
 
-            blob.read(query.value(2).toByteArray(), &targetSig);
+            const qlonglong imageid = index.ids.at(ranking.at(i).second);
 
-            if (d->useSignatureCache)
-            {
-                signatureCache[imageid] = targetSig;
-            }
-            else
+            if (available.contains(imageid))
             {
-                double&              score = scores[imageid];
-                Haar::SignatureData& qSig  = *querySig;
-                Haar::SignatureData& tSig  = targetSig;
-
-                score = calculateScore(qSig, tSig, weights, queryMaps);
+                scores[imageid] = score;
+                worstScore      = score;
+                ++found;
             }
         }
     }
-    // read cached signature map if possible
-    else
+
+    return scores;
+}
+
+/// Scores every image using the inverted index and returns all available images with at least the required score
+QMap<qlonglong, double> HaarIface::searchIndexWithThreshold(Haar::SignatureData* querySig, SketchType type,
+                                                            double requiredScore)
+{
+    d->createWeightBin();
+
+    Haar::Weights     weights((Haar::Weights::SketchType)type);
+    HaarIndex::Scores index;
+    HaarIndex::instance()->calculateScores(*querySig, weights, *d->bin, index);
+
+    QMap<qlonglong, double> candidates;
+
+    for (int i = 0; i < index.ids.size(); ++i)
     {
-        foreach (const qlonglong& imageid, signatureCache.keys())
+        if (index.ids.at(i) && index.scores.at(i) <= requiredScore)
         {
-            double& score              = scores[imageid];
-            Haar::SignatureData& qSig  = *querySig;
-            Haar::SignatureData& tSig  = signatureCache[imageid];
+            candidates[index.ids.at(i)] = index.scores.at(i);
+        }
+    }
+
+    // The index does not know about removed images
+    QSet<qlonglong> available = d->availableImages(candidates.keys());
 
-            score = calculateScore(qSig, tSig, weights, queryMaps);
+    for (QMap<qlonglong, double>::iterator it = candidates.begin(); it != candidates.end(); )
+    {
+        if (available.contains(it.key()))
+        {
+            ++it;
+        }
+        else
+        {
+            it = candidates.erase(it);
         }
     }
 
-    return scores;
+    return candidates;
 }
 
 QImage HaarIface::loadQImage(const QString& filename)
@@ -825,16 +852,156 @@ QMap< qlonglong, QList<qlonglong> > HaarIface::findDuplicatesInAlbumsAndTags(con
     return findDuplicates(idList, requiredPercentage, observer);
 }
 
+/** The duplicates search carries out one threshold search per image, in parallel on all cores.
+ *  A target image can only reach the required score if its luminance average is close enough to the query:
+ *  all coefficients in common can at most decrease the score by the lowest possible score.
+ *  So the signatures are sorted by luminance, and every query only scores the band of images
+ *  within this distance. The results are the same as with a full scan.
+ */
+class HaarIface::DuplicatesSearch
+{
+public:
+
+    enum { ChunkSize = 16 };
+
+    class Task : public QRunnable
+    {
+    public:
+
+        Task(DuplicatesSearch* search)
+            : search(search),
+              query(search->weights, search->bin)
+        {
+        }
+
+        virtual void run()
+        {
+            while (search->processNextChunk(query, scores))
+            {
+            }
+        }
+
+    private:
+
+        DuplicatesSearch* const search;
+        Haar::ScoringQuery      query;
+        QVector<double>         scores;
+    };
+
+public:
+
+    DuplicatesSearch(HaarIface* iface, double requiredPercentage)
+        : iface(iface), requiredPercentage(requiredPercentage),
+          weights(Haar::Weights::ScannedSketch), bin(*iface->d->bin)
+    {
+    }
+
+    /** Processes the next chunk of queries. Returns false if there is no work left.
+     *  Every thread takes the next chunk when it is done, so no thread runs idle while work is left.
+     */
+    bool processNextChunk(Haar::ScoringQuery& query, QVector<double>& scores)
+    {
+        const int start = next.fetchAndAddOrdered(ChunkSize);
+
+        if (start >= queries.size())
+        {
+            return false;
+        }
+
+        const int end = qMin(start + ChunkSize, queries.size());
+
+        for (int i = start; i < end; ++i)
+        {
+            results[i] = matches(queries.at(i), query, scores);
+        }
+
+        processed.fetchAndAddOrdered(end - start);
+        return true;
+    }
+
+    /** Returns all images with the required similarity to the entry at index,
+     *  sorted as by bestMatchesWithThreshold.
+     */
+    QList<qlonglong> matches(int index, Haar::ScoringQuery& query, QVector<double>& scores)
+    {
+        Haar::SignatureData querySig;
+        entries.signature(index, &querySig);
+
+        double lowest, highest;
+        iface->getBestAndWorstPossibleScore(&querySig, ScannedSketch, &lowest, &highest);
+
+        const double range         = highest - lowest;
+        const double requiredScore = lowest + range * (1.0 - requiredPercentage);
+
+        // The score starts with the weighted average differences; it is a sum of positive terms.
+        // Allow for rounding errors, candidates are checked with the full score anyway.
+        const double maxLuminanceDelta = (requiredScore - lowest) / weights.weightForAverage(0) * 1.000001;
+
+        const QVector<double>& luminance = entries.averages[0];
+        const int begin = qLowerBound(luminance.constBegin(), luminance.constEnd(),
+                                      querySig.avg[0] - maxLuminanceDelta) - luminance.constBegin();
+        const int end   = qUpperBound(luminance.constBegin(), luminance.constEnd(),
+                                      querySig.avg[0] + maxLuminanceDelta) - luminance.constBegin();
+
+        if (scores.size() < end - begin)
+        {
+            scores.resize(end - begin);
+        }
+
+        query.setSignature(querySig);
+        entries.score(query, begin, end, scores.data());
+
+        QList<QPair<double, qlonglong> > found;
+
+        for (int i = begin; i < end; ++i)
+        {
+            const double score = scores.at(i - begin);
+
+            if (score <= requiredScore)
+            {
+                found << qMakePair(1.0 - (score - lowest) / range, - entries.ids.at(i));
+            }
+        }
+
+        // Ascending percentage, equal percentages with descending id, as a QMultiMap filled by ascending ids
+        qSort(found);
+
+        QList<qlonglong> list;
+
+        for (int i = 0; i < found.size(); ++i)
+        {
+            list << - found.at(i).second;
+        }
+
+        return list;
+    }
+
+public:
+
+    HaarIface* const          iface;
+    const double              requiredPercentage;
+    const Haar::Weights       weights;
+    const Haar::WeightBin&    bin;
+
+    /// All signatures to compare with, sorted by luminance
+    Haar::SignatureStore      entries;
+    /// The index in entries of all signatures to search for, in the order of the search
+    QVector<int>              queries;
+    /// The result of each query
+    QVector<QList<qlonglong> > results;
+
+    QAtomicInt                next;
+    QAtomicInt                processed;
+};
+
 QMap< qlonglong, QList<qlonglong> > HaarIface::findDuplicates(const QSet<qlonglong>& images2Scan,
         double requiredPercentage, HaarProgressObserver* observer)
 {
     QMap< qlonglong, QList<qlonglong> >  resultsMap;
-    QSet<qlonglong>::const_iterator      it;
-    QList<qlonglong>                     list;
     QSet<qlonglong>                      resultsCandidates;
+    QSet<qlonglong>                      removedFromSearch;
 
     int                                  total        = 0;
-    int                                  progress     = 0;
     int                                  progressStep = 20;
 
     if (observer)
@@ -844,97 +1011,160 @@ QMap< qlonglong, QList<qlonglong> > HaarIface::findDuplicates(const QSet<qlonglo
         observer->totalNumberToScan(total);
     }
 
-    // create signature cache map for fast lookup
-    d->setSignatureCacheEnabled(true, images2Scan);
+    d->createWeightBin();
 
-    for (it = images2Scan.constBegin(); it != images2Scan.constEnd(); ++it)
+    // Collect the signatures of all images to scan, from the index if possible.
+    // The index does not know about removed images, they are checked against the database.
+    Haar::SignatureStore signatures;
+
+    if (HaarIndex::instance()->load())
     {
-        if (!resultsCandidates.contains(*it))
-        {
-            //list = bestMatchesForImage(*it, 20, ScannedSketch);
-            // find images with at least 90% similarity
-            list = bestMatchesForImageWithThreshold(*it, requiredPercentage, ScannedSketch);
+        Haar::SignatureStore index = HaarIndex::instance()->signatures();
+        QList<qlonglong>     candidates;
+        QList<int>           positions;
 
-            if (!list.isEmpty())
+        for (int i = 0; i < index.size(); ++i)
+        {
+            if (index.ids.at(i) && images2Scan.contains(index.ids.at(i)))
             {
-                // the list will usually contain one image: the original. Filter out.
-                if (!(list.count() == 1 && list.first() == *it))
-                {
-                    resultsMap.insert(*it, list);
-                    resultsCandidates << *it;
-
-                    foreach (const qlonglong& id, list)
-                    {
-                        resultsCandidates << id;
-                    }
-                }
+                candidates << index.ids.at(i);
+                positions  << i;
             }
         }
 
-        // if an imageid is not a results candidate, remove it from the cached signature map as well,
-        // to greatly improve speed
-        if (!resultsCandidates.contains(*it))
+        QSet<qlonglong> available = d->availableImages(candidates);
+        signatures.reserve(available.size());
+
+        for (int i = 0; i < candidates.size(); ++i)
         {
-            d->signatureCache->remove(*it);
+            if (available.contains(candidates.at(i)))
+            {
+                signatures.append(index, positions.at(i));
+            }
         }
+    }
+    else
+    {
+        // the same images as availableImages() returns for the index
+        Haar::SignatureStore all = d->readSignatures(true);
 
-        ++progress;
-
-        if (observer && (progress == total || progress % progressStep == 0))
+        for (int i = 0; i < all.size(); ++i)
         {
-            observer->processedNumber(progress);
+            if (images2Scan.contains(all.ids.at(i)))
+            {
+                signatures.append(all, i);
+            }
         }
     }
 
-    // make sure the progress bar is really set to 100% when search is finished
-    if (observer)
+    // Sort the signatures by luminance
+    QVector<QPair<double, int> > byLuminance;
+    byLuminance.reserve(signatures.size());
+
+    for (int i = 0; i < signatures.size(); ++i)
     {
-        observer->processedNumber(total);
+        byLuminance << qMakePair(signatures.averages[0].at(i), i);
     }
 
-    // disable cache
-    d->setSignatureCacheEnabled(false);
+    qSort(byLuminance.begin(), byLuminance.end());
 
-    return resultsMap;
-}
+    DuplicatesSearch      search(this, requiredPercentage);
+    QHash<qlonglong, int> positionOfId;
+    search.entries.reserve(signatures.size());
 
-double HaarIface::calculateScore(Haar::SignatureData& querySig, Haar::SignatureData& targetSig,
-                                 Haar::Weights& weights, Haar::SignatureMap** queryMaps)
-{
-    double score = 0.0;
+    for (int i = 0; i < byLuminance.size(); ++i)
+    {
+        positionOfId.insert(signatures.ids.at(byLuminance.at(i).second), i);
+        search.entries.append(signatures, byLuminance.at(i).second);
+    }
+
+    signatures.clear();
 
-    // Step 1: Initialize scores with average intensity values of all three channels
-    for (int channel = 0; channel < 3; ++channel)
+    // images without a signature cannot be searched
+    for (QSet<qlonglong>::const_iterator it = images2Scan.constBegin(); it != images2Scan.constEnd(); ++it)
     {
-        score += weights.weightForAverage(channel) * fabs( querySig.avg[channel] - targetSig.avg[channel] );
+        QHash<qlonglong, int>::const_iterator position = positionOfId.constFind(*it);
+
+        if (position != positionOfId.constEnd())
+        {
+            search.queries << position.value();
+        }
     }
 
-    // Step 2: Decrease the score if query and target have significant coefficients in common
-    Haar::Idx* sig               = 0;
-    Haar::SignatureMap* queryMap = 0;
-    int x                        = 0;
+    search.results.resize(search.queries.size());
+
+    // Step 1: search all images in parallel. This thread participates and reports progress.
+    QThreadPool pool;
+    const int   threads = qMax(QThread::idealThreadCount(), 1);
+    pool.setMaxThreadCount(threads);
 
-    for (int channel = 0; channel < 3; ++channel)
+    for (int i = 1; i < threads; ++i)
     {
-        sig      = targetSig.sig[channel];
-        queryMap = queryMaps[channel];
+        pool.start(new DuplicatesSearch::Task(&search));
+    }
 
-        for (int coef = 0; coef < Haar::NumberOfCoefficients; ++coef)
+    Haar::ScoringQuery query(search.weights, search.bin);
+    QVector<double>    scores;
+    int                reported = 0;
+
+    while (search.processNextChunk(query, scores))
+    {
+        int progress = search.processed;
+
+        if (observer && progress - reported >= progressStep)
+        {
+            observer->processedNumber(progress);
+            reported = progress;
+        }
+    }
+
+    pool.waitForDone();
+
+    // Step 2: Group the results, in the same way as a sequential search would do:
+    // An image which is already listed as a duplicate is not searched for itself.
+    // An image which has no duplicates is not found by subsequent searches.
+    for (int i = 0; i < search.queries.size(); ++i)
+    {
+        const qlonglong imageid = search.entries.ids.at(search.queries.at(i));
+
+        if (!resultsCandidates.contains(imageid))
         {
-            // x is a pixel index, either positive or negative, 0..16384
-            x = sig[coef];
+            QList<qlonglong> list;
+
+            foreach (const qlonglong& id, search.results.at(i))
+            {
+                if (!removedFromSearch.contains(id))
+                {
+                    list << id;
+                }
+            }
 
-            // If x is a significant coefficient with the same sign in the query signature as well,
-            // decrease the score (lower is better)
-            // Note: both method calls called with x accept positive or negative values
-            if ((*queryMap)[x])
+            // the list will usually contain one image: the original. Filter out.
+            if (!list.isEmpty() && !(list.count() == 1 && list.first() == imageid))
             {
-                score -= weights.weight(d->bin->binAbs(x), channel);
+                resultsMap.insert(imageid, list);
+                resultsCandidates << imageid;
+
+                foreach (const qlonglong& id, list)
+                {
+                    resultsCandidates << id;
+                }
             }
         }
+
+        if (!resultsCandidates.contains(imageid))
+        {
+            removedFromSearch << imageid;
+        }
     }
 
-    return score;
+    // make sure the progress bar is really set to 100% when search is finished
+    if (observer)
+    {
+        observer->processedNumber(total);
+    }
+
+    return resultsMap;
 }
 
 }  // namespace Digikam
@@ -83,6 +83,16 @@ public:
     bool indexImage(qlonglong imageid, const QImage& image);
     bool indexImage(qlonglong imageid, const DImg& image);
 
+    /** Calculates the signature of the image, without storing it.
+     *  Does not access the database. Returns false if the image is null.
+     */
+    bool calculateSignature(const DImg& image, Haar::SignatureData* sig);
+
+    /** Stores the given signatures (image id -> signature) in the database in one transaction.
+     *  Use this together with calculateSignature to index many images.
+     */
+    void storeSignatures(const QMap<qlonglong, Haar::SignatureData>& signatures);
+
     /** Searches the database for the best matches for the specified query image.
      *  The numberOfResults best matches are returned.
      */
@@ -155,11 +165,15 @@ private:
             double requiredPercentage, SketchType type);
 
     QMap<qlonglong, double> searchDatabase(Haar::SignatureData* data, SketchType type);
-    double calculateScore(Haar::SignatureData& querySig, Haar::SignatureData& targetSig,
-                          Haar::Weights& weights, Haar::SignatureMap** queryMaps);
+    QMap<qlonglong, double> searchIndex(Haar::SignatureData* data, SketchType type, int numberOfResults);
+    QMap<qlonglong, double> searchIndexWithThreshold(Haar::SignatureData* data, SketchType type,
+                                                     double requiredScore);
 
 private:
 
+    class DuplicatesSearch;
+    friend class DuplicatesSearch;
+
     class HaarIfacePriv;
     HaarIfacePriv* const d;
 };
@@ -0,0 +1,123 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2003-01-17
+ * Description : Haar Database interface - private containers
+ *
+ * Copyright (C) 2003 by Ricardo Niederberger Cabral <nieder at mail dot ru>
+ * Copyright (C) 2009-2011 by Gilles Caulier <caulier dot gilles at gmail dot com>
+ * Copyright (C) 2009-2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ * Copyright (C) 2009-2010 by Andi Clemens <andi dot clemens at gmx dot net>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef HAARIFACE_P_H
+#define HAARIFACE_P_H
+
+// Qt includes
+
+#include <QByteArray>
+#include <QDataStream>
+
+// KDE includes
+
+#include <kdebug.h>
+
+// Local includes
+
+#include "haar.h"
+
+namespace Digikam
+{
+
+/** This class encapsulates the Haar signature in a QByteArray
+ *  that can be stored as a BLOB in the database.
+ *
+ *  Reading and writing is done in a platform-independent manner, which
+ *  induces a certain overhead, but which is necessary IMO.
+ */
+class DatabaseBlob
+{
+public:
+
+    enum { Version = 1 };
+
+public:
+
+    DatabaseBlob() {}
+
+    /** Read the QByteArray into the Haar::SignatureData.
+     */
+    void read(const QByteArray& array, Haar::SignatureData* data)
+    {
+        QDataStream stream(array);
+
+        // check version
+        qint32 version;
+        stream >> version;
+
+        if (version != Version)
+        {
+            kError() << "Unsupported binary version of Haar Blob in database";
+            return;
+        }
+
+        stream.setVersion(QDataStream::Qt_4_3);
+
+        // read averages
+        for (int i=0; i<3; ++i)
+        {
+            stream >> data->avg[i];
+        }
+
+        // read coefficients
+        for (int i=0; i<3; ++i)
+            for (int j=0; j<Haar::NumberOfCoefficients; ++j)
+            {
+                stream >> data->sig[i][j];
+            }
+    }
+
+    QByteArray write(const Haar::SignatureData* data)
+    {
+        QByteArray array;
+        array.reserve(sizeof(qint32) + 3*sizeof(double) + 3*sizeof(qint32)*Haar::NumberOfCoefficients);
+        QDataStream stream(&array, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_4_3);
+
+        // write version
+        stream << (qint32)Version;
+
+        // write averages
+        for (int i=0; i<3; ++i)
+        {
+            stream << data->avg[i];
+        }
+
+        // write coefficients
+        for (int i=0; i<3; ++i)
+            for (int j=0; j<Haar::NumberOfCoefficients; ++j)
+            {
+                stream << data->sig[i][j];
+            }
+
+        return array;
+    }
+};
+
+}  // namespace Digikam
+
+#endif // HAARIFACE_P_H
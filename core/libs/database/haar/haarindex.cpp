@@ -0,0 +1,658 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-02
+ * Description : Inverted index of Haar signature coefficients
+ *               Index layout and query ideas based on the paper
+ *               "Fast Multiresolution Image Querying"
+ *               by Charles E. Jacobs, Adam Finkelstein and David H. Salesin.
+ *               http://www.cs.washington.edu/homes/salesin/abstracts.html
+ *
+ * Copyright (C) 2003 by Ricardo Niederberger Cabral <nieder at mail dot ru>
+ * Copyright (C) 2009-2011 by Gilles Caulier <caulier dot gilles at gmail dot com>
+ * Copyright (C) 2009-2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "haarindex.h"
+
+// C++ includes
+
+#include <cmath>
+
+// Qt includes
+
+#include <QDataStream>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QUuid>
+
+// KDE includes
+
+#include <kdebug.h>
+#include <kglobal.h>
+#include <ksavefile.h>
+#include <kstandarddirs.h>
+
+// Local includes
+
+#include "albumdb.h"
+#include "databaseaccess.h"
+#include "databasebackend.h"
+#include "haariface_p.h"
+#include "sqlquery.h"
+
+namespace Digikam
+{
+
+/** Number of posting lists per channel: one for each signed coefficient index.
+ *  First 16k for negative values, second 16k for positive values, as in Haar::SignatureMap.
+ */
+enum { NumberOfPostingLists = 2 * Haar::NumberOfPixelsSquared };
+
+class HaarIndexData
+{
+public:
+
+    enum { FileVersion = 2 };
+
+public:
+
+    QVector<qint32>& postings(int channel, Haar::Idx coef)
+    {
+        return lists[channel][coef + Haar::NumberOfPixelsSquared];
+    }
+
+    const QVector<qint32>& postings(int channel, Haar::Idx coef) const
+    {
+        return lists[channel][coef + Haar::NumberOfPixelsSquared];
+    }
+
+    void insert(qlonglong imageid, const Haar::SignatureData& sig)
+    {
+        // An old entry is only marked as unused. Its postings are skipped by the score's consumer.
+        remove(imageid);
+
+        const qint32 slot = store.size();
+        store.append(imageid, sig);
+        addPostings(slot);
+        slotOfId.insert(imageid, slot);
+    }
+
+    void remove(qlonglong imageid)
+    {
+        QHash<qlonglong, int>::iterator it = slotOfId.find(imageid);
+
+        if (it != slotOfId.end())
+        {
+            store.ids[it.value()] = 0;
+            slotOfId.erase(it);
+            ++unusedSlots;
+        }
+    }
+
+    /** Removes all unused slots and rebuilds the postings accordingly.
+     */
+    void compact()
+    {
+        if (!unusedSlots)
+        {
+            return;
+        }
+
+        Haar::SignatureStore newStore;
+        newStore.reserve(slotOfId.size());
+
+        for (int i = 0; i < store.size(); ++i)
+        {
+            if (store.ids.at(i))
+            {
+                newStore.append(store, i);
+            }
+        }
+
+        store = newStore;
+        rebuild();
+    }
+
+    bool read(QDataStream& stream, const QString& expectedToken)
+    {
+        qint32  version, count;
+        QString token;
+        stream >> version;
+
+        if (version != FileVersion)
+        {
+            return false;
+        }
+
+        stream >> token;
+
+        if (token != expectedToken)
+        {
+            return false;
+        }
+
+        stream >> count;
+
+        if (stream.status() != QDataStream::Ok || count < 0)
+        {
+            return false;
+        }
+
+        store.ids.resize(count);
+        store.coefficients.resize(count * Haar::SignatureStore::CoefficientsPerSignature);
+
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            store.averages[channel].resize(count);
+        }
+
+        qint16* coefs = store.coefficients.data();
+
+        for (int i = 0; i < count; ++i)
+        {
+            stream >> store.ids[i] >> store.averages[0][i] >> store.averages[1][i] >> store.averages[2][i];
+
+            for (int k = 0; k < Haar::SignatureStore::CoefficientsPerSignature; ++k, ++coefs)
+            {
+                stream >> *coefs;
+
+                if (*coefs <= -Haar::NumberOfPixelsSquared || *coefs >= Haar::NumberOfPixelsSquared)
+                {
+                    return false;
+                }
+            }
+        }
+
+        if (stream.status() != QDataStream::Ok)
+        {
+            return false;
+        }
+
+        rebuild();
+        return true;
+    }
+
+    void write(QDataStream& stream, const QString& token) const
+    {
+        // Only call after compact()
+        stream << (qint32)FileVersion;
+        stream << token;
+        stream << (qint32)store.size();
+
+        for (int i = 0; i < store.size(); ++i)
+        {
+            stream << store.ids[i] << store.averages[0][i] << store.averages[1][i] << store.averages[2][i];
+
+            const qint16* coefs = store.coefficientsAt(i);
+
+            for (int k = 0; k < Haar::SignatureStore::CoefficientsPerSignature; ++k)
+            {
+                stream << coefs[k];
+            }
+        }
+    }
+
+private:
+
+    void addPostings(qint32 slot)
+    {
+        const qint16* coefs = store.coefficientsAt(slot);
+
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            for (int coef = 0; coef < Haar::NumberOfCoefficients; ++coef)
+            {
+                postings(channel, *coefs++) << slot;
+            }
+        }
+    }
+
+    /** Recreates slots and postings from the store, which has no unused entries.
+     */
+    void rebuild()
+    {
+        unusedSlots = 0;
+        slotOfId.clear();
+
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            for (int x = 0; x < NumberOfPostingLists; ++x)
+            {
+                lists[channel][x].clear();
+            }
+        }
+
+        for (int i = 0; i < store.size(); ++i)
+        {
+            slotOfId.insert(store.ids.at(i), i);
+            addPostings(i);
+        }
+    }
+
+public:
+
+    HaarIndexData()
+        : unusedSlots(0)
+    {
+    }
+
+    int                   unusedSlots;
+    /// The signatures by slot. The id of unused slots is 0.
+    Haar::SignatureStore  store;
+    QHash<qlonglong, int> slotOfId;
+    QVector<qint32>       lists[3][NumberOfPostingLists];
+};
+
+// -----------------------------------------------------------------------------------------------------
+
+class HaarIndex::HaarIndexPriv
+{
+public:
+
+    HaarIndexPriv()
+    {
+        data    = 0;
+        changed = false;
+    }
+
+    ~HaarIndexPriv()
+    {
+        delete data;
+    }
+
+    static QString tokenSetting()
+    {
+        return QString("HaarIndexToken");
+    }
+
+    static QString cacheFilePath(const QUuid& databaseUuid)
+    {
+        QString cacheDir = KStandardDirs::locateLocal("cache", "digikam/");
+        return cacheDir + QString("haarindex-%1.bin").arg(databaseUuid.toString().remove('{').remove('}'));
+    }
+
+    static HaarIndexData* readFile(const QString& filePath, const QString& token)
+    {
+        QFile file(filePath);
+
+        if (token.isEmpty() || !file.open(QIODevice::ReadOnly))
+        {
+            return 0;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_4_3);
+
+        HaarIndexData* data = new HaarIndexData;
+
+        if (!data->read(stream, token))
+        {
+            kDebug() << "Haar index file" << filePath << "is outdated or invalid";
+            delete data;
+            return 0;
+        }
+
+        return data;
+    }
+
+    static bool writeFile(const HaarIndexData* data, const QString& filePath, const QString& token)
+    {
+        KSaveFile file(filePath);
+
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            kWarning() << "Cannot write Haar index file" << filePath;
+            return false;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_4_3);
+        data->write(stream, token);
+
+        return file.finalize();
+    }
+
+    static HaarIndexData* readDatabase(DatabaseAccess& access)
+    {
+        DatabaseBlob        blob;
+        Haar::SignatureData sig;
+
+        SqlQuery query = access.backend()->prepareQuery(QString("SELECT imageid, matrix FROM ImageHaarMatrix;"));
+
+        if (!access.backend()->exec(query))
+        {
+            return 0;
+        }
+
+        HaarIndexData* data = new HaarIndexData;
+
+        while (query.next())
+        {
+            blob.read(query.value(1).toByteArray(), &sig);
+            data->insert(query.value(0).toLongLong(), sig);
+        }
+
+        return data;
+    }
+
+    /** The signatures of deleted images are removed from the database by a trigger.
+     *  Removes them from data as well. Returns false if nothing was removed.
+     */
+    static bool removeDeletedImages(DatabaseAccess& access, HaarIndexData* data)
+    {
+        SqlQuery query = access.backend()->prepareQuery(QString("SELECT imageid FROM ImageHaarMatrix;"));
+
+        if (!access.backend()->exec(query))
+        {
+            return false;
+        }
+
+        QSet<qlonglong> ids;
+
+        while (query.next())
+        {
+            ids << query.value(0).toLongLong();
+        }
+
+        QList<qlonglong> deleted;
+
+        for (QHash<qlonglong, int>::const_iterator it = data->slotOfId.constBegin(); it != data->slotOfId.constEnd(); ++it)
+        {
+            if (!ids.contains(it.key()))
+            {
+                deleted << it.key();
+            }
+        }
+
+        foreach (const qlonglong& id, deleted)
+        {
+            data->remove(id);
+        }
+
+        if (!deleted.isEmpty())
+        {
+            kDebug() << "Removed" << deleted.size() << "deleted images from the Haar index";
+        }
+
+        return !deleted.isEmpty();
+    }
+
+public:
+
+    /// Serializes load() and save(). Taken before the DatabaseAccess lock.
+    QMutex                 loadMutex;
+    /** Protects the members below. May be taken while the DatabaseAccess lock is held, never the other way round,
+     *  so that the token in the database and the in-memory state are compared and changed in one step.
+     */
+    mutable QReadWriteLock lock;
+    HaarIndexData*         data;
+    bool                   changed;
+    QString                token;
+};
+
+// -----------------------------------------------------------------------------------------------------
+
+class HaarIndexCreator
+{
+public:
+
+    HaarIndex object;
+};
+
+K_GLOBAL_STATIC(HaarIndexCreator, creator)
+
+HaarIndex* HaarIndex::instance()
+{
+    return &creator->object;
+}
+
+HaarIndex::HaarIndex()
+    : d(new HaarIndexPriv)
+{
+}
+
+HaarIndex::~HaarIndex()
+{
+    delete d;
+}
+
+bool HaarIndex::load()
+{
+    QMutexLocker loadLocker(&d->loadMutex);
+
+    QString dbToken;
+    QUuid   databaseUuid;
+    {
+        DatabaseAccess access;
+        dbToken      = access.db()->getSetting(HaarIndexPriv::tokenSetting());
+        databaseUuid = access.db()->databaseUuid();
+    }
+
+    {
+        QReadLocker locker(&d->lock);
+
+        if (d->data && !dbToken.isEmpty() && dbToken == d->token)
+        {
+            return true;
+        }
+    }
+
+    const QString  filePath = HaarIndexPriv::cacheFilePath(databaseUuid);
+    HaarIndexData* data     = HaarIndexPriv::readFile(filePath, dbToken);
+
+    {
+        // Read and install the index while no signatures can be stored or added by other threads
+        DatabaseAccess access;
+
+        if (data && access.db()->getSetting(HaarIndexPriv::tokenSetting()) != dbToken)
+        {
+            // Changed since the file was read
+            delete data;
+            data = 0;
+        }
+
+        bool changed = false;
+
+        if (data)
+        {
+            changed = HaarIndexPriv::removeDeletedImages(access, data);
+        }
+        else
+        {
+            kDebug() << "Rebuilding Haar index from database";
+            data = HaarIndexPriv::readDatabase(access);
+
+            if (!data)
+            {
+                return false;
+            }
+
+            dbToken = QUuid::createUuid().toString();
+            access.db()->setSetting(HaarIndexPriv::tokenSetting(), dbToken);
+            changed = true;
+        }
+
+        QWriteLocker locker(&d->lock);
+        delete d->data;
+        d->data    = data;
+        d->token   = dbToken;
+        d->changed = changed;
+    }
+
+    // The new token is set already: if writing fails, the next load() will find an outdated file
+    QWriteLocker locker(&d->lock);
+
+    if (d->data && d->changed && d->token == dbToken)
+    {
+        d->data->compact();
+
+        if (HaarIndexPriv::writeFile(d->data, filePath, d->token))
+        {
+            d->changed = false;
+        }
+    }
+
+    return true;
+}
+
+void HaarIndex::save()
+{
+    QMutexLocker loadLocker(&d->loadMutex);
+
+    QString dbToken;
+    QUuid   databaseUuid;
+    {
+        DatabaseAccess access;
+        dbToken      = access.db()->getSetting(HaarIndexPriv::tokenSetting());
+        databaseUuid = access.db()->databaseUuid();
+    }
+
+    QWriteLocker locker(&d->lock);
+
+    // Do not overwrite a file which was written from a more recent state by another process
+    if (!d->data || !d->changed || d->token.isEmpty() || dbToken != d->token)
+    {
+        return;
+    }
+
+    d->data->compact();
+    HaarIndexPriv::writeFile(d->data, HaarIndexPriv::cacheFilePath(databaseUuid), d->token);
+    d->changed = false;
+}
+
+void HaarIndex::addSignature(qlonglong imageid, const Haar::SignatureData& sig)
+{
+    QMap<qlonglong, Haar::SignatureData> signatures;
+    signatures.insert(imageid, sig);
+    addSignatures(signatures);
+}
+
+void HaarIndex::addSignatures(const QMap<qlonglong, Haar::SignatureData>& signatures)
+{
+    // Another writer must not change the token between reading and writing it
+    DatabaseAccess access;
+    QString        dbToken = access.db()->getSetting(HaarIndexPriv::tokenSetting());
+    QString        newToken;
+
+    {
+        QWriteLocker locker(&d->lock);
+
+        if (d->data && dbToken == d->token && !d->token.isEmpty())
+        {
+            for (QMap<qlonglong, Haar::SignatureData>::const_iterator it = signatures.constBegin();
+                 it != signatures.constEnd(); ++it)
+            {
+                d->data->insert(it.key(), it.value());
+            }
+
+            d->token   = QUuid::createUuid().toString();
+            d->changed = true;
+            newToken   = d->token;
+        }
+        else
+        {
+            // Not loaded or not in sync: drop it. The next load() reads the database.
+            delete d->data;
+            d->data = 0;
+            d->token.clear();
+        }
+    }
+
+    // invalidate the cache file, or tie it to our current in-memory state
+    if (dbToken != newToken)
+    {
+        access.db()->setSetting(HaarIndexPriv::tokenSetting(), newToken);
+    }
+}
+
+int HaarIndex::count() const
+{
+    QReadLocker locker(&d->lock);
+    return d->data ? d->data->slotOfId.size() : 0;
+}
+
+Haar::SignatureStore HaarIndex::signatures() const
+{
+    QReadLocker locker(&d->lock);
+
+    if (!d->data)
+    {
+        return Haar::SignatureStore();
+    }
+
+    // implicitly shared, the index may be modified after we return
+    return d->data->store;
+}
+
+void HaarIndex::calculateScores(const Haar::SignatureData& querySig, const Haar::Weights& weights,
+                                const Haar::WeightBin& bin, Scores& result) const
+{
+    QReadLocker locker(&d->lock);
+
+    if (!d->data)
+    {
+        result.scores.clear();
+        result.ids.clear();
+        return;
+    }
+
+    const HaarIndexData& data = *d->data;
+    const int count           = data.store.size();
+
+    // implicitly shared, the index may be modified after we return
+    result.ids = data.store.ids;
+    result.scores.fill(0.0, count);
+    double* const scores = result.scores.data();
+
+    // Step 1: Initialize scores with average intensity values of all three channels
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        const double  weight   = weights.weightForAverage(channel);
+        const double  queryAvg = querySig.avg[channel];
+        const double* averages = data.store.averages[channel].constData();
+
+        for (int i = 0; i < count; ++i)
+        {
+            scores[i] += weight * fabs(queryAvg - averages[i]);
+        }
+    }
+
+    // Step 2: Decrease the score of all images which have significant coefficients in common
+    // with the query. Walking the posting lists, we only touch these images.
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        for (int coef = 0; coef < Haar::NumberOfCoefficients; ++coef)
+        {
+            const Haar::Idx        x      = querySig.sig[channel][coef];
+            const double           weight = weights.weight(bin.binAbs(x), channel);
+            const QVector<qint32>& list   = data.postings(channel, x);
+            const qint32*          slot   = list.constData();
+            const qint32*          end    = slot + list.size();
+
+            for (; slot != end; ++slot)
+            {
+                scores[*slot] -= weight;
+            }
+        }
+    }
+}
+
+}  // namespace Digikam
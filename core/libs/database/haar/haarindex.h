@@ -0,0 +1,121 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-02
+ * Description : Inverted index of Haar signature coefficients
+ *               Index layout and query ideas based on the paper
+ *               "Fast Multiresolution Image Querying"
+ *               by Charles E. Jacobs, Adam Finkelstein and David H. Salesin.
+ *               http://www.cs.washington.edu/homes/salesin/abstracts.html
+ *
+ * Copyright (C) 2003 by Ricardo Niederberger Cabral <nieder at mail dot ru>
+ * Copyright (C) 2009-2011 by Gilles Caulier <caulier dot gilles at gmail dot com>
+ * Copyright (C) 2009-2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef HAARINDEX_H
+#define HAARINDEX_H
+
+// Qt includes
+
+#include <QMap>
+#include <QVector>
+
+// Local includes
+
+#include "haar.h"
+#include "haarsignaturestore.h"
+
+namespace Digikam
+{
+
+/** The inverted index maps each (channel, signed coefficient index) to the list
+ *  of images whose signature contains this coefficient, as in the original imgSeek design.
+ *  A query then only touches the images which share coefficients with the query signature,
+ *  instead of decoding and comparing every signature stored in the database.
+ *
+ *  The index is shared by all HaarIface objects of a process. It is loaded on demand
+ *  from a cache file, or rebuilt from the ImageHaarMatrix table if the file is missing or outdated,
+ *  and kept up to date incrementally by HaarIface::indexImage.
+ *  The file is tied to the database by a token stored in the Settings table.
+ *
+ *  Images deleted from the database are removed from the index when it is loaded.
+ *  Until then, results may contain them and must be checked against the database by the caller.
+ *
+ *  All methods are thread-safe.
+ */
+class HaarIndex
+{
+public:
+
+    class Scores
+    {
+    public:
+
+        /** Aligned arrays: the score (lower is better) and the image id of each entry.
+         *  Entries with an id of 0 are unused and must be ignored.
+         */
+        QVector<double>    scores;
+        QVector<qlonglong> ids;
+    };
+
+public:
+
+    static HaarIndex* instance();
+
+    /** Makes sure that the index is loaded and corresponds to the database.
+     *  Returns false if the index cannot be used.
+     */
+    bool load();
+
+    /** Writes the index to its cache file, if it was changed since loading.
+     */
+    void save();
+
+    /** Add the signature of the given image, replacing any previous signature.
+     */
+    void addSignature(qlonglong imageid, const Haar::SignatureData& sig);
+    void addSignatures(const QMap<qlonglong, Haar::SignatureData>& signatures);
+
+    /** Calculate the score of every indexed image compared to the query signature.
+     *  The score is identical to the one calculated by a full comparison of the signatures.
+     */
+    void calculateScores(const Haar::SignatureData& querySig, const Haar::Weights& weights,
+                         const Haar::WeightBin& bin, Scores& result) const;
+
+    /** Returns a snapshot of all indexed signatures. Entries with an id of 0 are unused.
+     */
+    Haar::SignatureStore signatures() const;
+
+    /** Returns the number of indexed images.
+     */
+    int count() const;
+
+private:
+
+    HaarIndex();
+    ~HaarIndex();
+
+    friend class HaarIndexCreator;
+
+    class HaarIndexPriv;
+    HaarIndexPriv* const d;
+};
+
+}  // namespace Digikam
+
+#endif // HAARINDEX_H
@@ -0,0 +1,233 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-05
+ * Description : Flat in-memory store of Haar signatures
+ *               and vectorized scoring
+ *
+ * Copyright (C) 2009-2011 by Gilles Caulier <caulier dot gilles at gmail dot com>
+ * Copyright (C) 2009-2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "haarsignaturestore.h"
+
+// C++ includes
+
+#include <cmath>
+#include <cstring>
+
+// Local includes
+
+#include "config-digikam.h"
+#include "cpufeatures.h"
+
+namespace Digikam
+{
+
+namespace Haar
+{
+
+ScoringQuery::ScoringQuery(const Weights& w, const WeightBin& bin)
+    : m_bin(bin)
+{
+    memset(classes, 0, sizeof(classes));
+    memset(m_sig, 0, sizeof(m_sig));
+
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        averages[channel]       = 0;
+        averageWeights[channel] = w.weightForAverage(channel);
+
+        // class 0: the query does not have this coefficient, the score is not decreased
+        weights[channel][0] = 0.0;
+
+        for (int i = 1; i < NumberOfClasses; ++i)
+        {
+            weights[channel][i] = (i <= 6) ? w.weight(i - 1, channel) : 0.0;
+        }
+    }
+}
+
+void ScoringQuery::setSignature(const SignatureData& sig)
+{
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        quint8* const channelClasses = classes[channel] + NumberOfPixelsSquared;
+
+        // reset the previous query
+        for (int coef = 0; coef < NumberOfCoefficients; ++coef)
+        {
+            channelClasses[m_sig[channel][coef]] = 0;
+        }
+
+        averages[channel] = sig.avg[channel];
+
+        for (int coef = 0; coef < NumberOfCoefficients; ++coef)
+        {
+            const Idx x           = sig.sig[channel][coef];
+            channelClasses[x]     = m_bin.binAbs(x) + 1;
+            m_sig[channel][coef]  = x;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------
+
+void SignatureStore::reserve(int size)
+{
+    ids.reserve(size);
+
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        averages[channel].reserve(size);
+    }
+
+    coefficients.reserve(size * CoefficientsPerSignature);
+}
+
+void SignatureStore::clear()
+{
+    ids.clear();
+
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        averages[channel].clear();
+    }
+
+    coefficients.clear();
+}
+
+void SignatureStore::append(qlonglong imageid, const SignatureData& sig)
+{
+    ids << imageid;
+
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        averages[channel] << sig.avg[channel];
+
+        for (int coef = 0; coef < NumberOfCoefficients; ++coef)
+        {
+            coefficients << (qint16)sig.sig[channel][coef];
+        }
+    }
+}
+
+void SignatureStore::append(const SignatureStore& other, int index)
+{
+    ids << other.ids.at(index);
+
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        averages[channel] << other.averages[channel].at(index);
+    }
+
+    const qint16* coefs = other.coefficientsAt(index);
+
+    for (int i = 0; i < CoefficientsPerSignature; ++i)
+    {
+        coefficients << coefs[i];
+    }
+}
+
+void SignatureStore::signature(int index, SignatureData* sig) const
+{
+    const qint16* coefs = coefficientsAt(index);
+
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        sig->avg[channel] = averages[channel].at(index);
+
+        for (int coef = 0; coef < NumberOfCoefficients; ++coef)
+        {
+            sig->sig[channel][coef] = *coefs++;
+        }
+    }
+}
+
+void SignatureStore::score(const ScoringQuery& query, int begin, int end, double* scores) const
+{
+    if (end <= begin)
+    {
+        return;
+    }
+
+    const double* const entryAverages[3] = { averages[0].constData() + begin,
+                                             averages[1].constData() + begin,
+                                             averages[2].constData() + begin
+                                           };
+    const qint16* const entryCoefficients = coefficientsAt(begin);
+
+#ifdef HAVE_AVX2
+
+    if (CpuFeatures::hasAVX2())
+    {
+        scoreSignaturesAVX2(query, entryAverages, entryCoefficients, end - begin, scores);
+        return;
+    }
+
+#endif
+
+#ifdef HAVE_SSE2
+
+    if (CpuFeatures::hasSSE2())
+    {
+        scoreSignaturesSSE2(query, entryAverages, entryCoefficients, end - begin, scores);
+        return;
+    }
+
+#endif
+
+    scoreSignaturesScalar(query, entryAverages, entryCoefficients, end - begin, scores);
+}
+
+// ---------------------------------------------------------------------------------
+
+void scoreSignaturesScalar(const ScoringQuery& query, const double* const averages[3],
+                           const qint16* coefficients, int count, double* scores)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        double score = 0.0;
+
+        // Step 1: Initialize scores with average intensity values of all three channels
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            score += query.averageWeights[channel] * fabs(query.averages[channel] - averages[channel][i]);
+        }
+
+        // Step 2: Decrease the score if query and target have significant coefficients in common.
+        // Coefficients not in the query have class 0 and weight 0, so there is no branch.
+        const qint16* coefs = coefficients + i * SignatureStore::CoefficientsPerSignature;
+
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            const quint8* const classes = query.classes[channel] + NumberOfPixelsSquared;
+            const double* const weights = query.weights[channel];
+
+            for (int coef = 0; coef < NumberOfCoefficients; ++coef)
+            {
+                score -= weights[classes[*coefs++]];
+            }
+        }
+
+        scores[i] = score;
+    }
+}
+
+}  // namespace Haar
+
+}  // namespace Digikam
@@ -0,0 +1,140 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-05
+ * Description : Flat in-memory store of Haar signatures
+ *               and vectorized scoring
+ *
+ * Copyright (C) 2009-2011 by Gilles Caulier <caulier dot gilles at gmail dot com>
+ * Copyright (C) 2009-2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef HAARSIGNATURESTORE_H
+#define HAARSIGNATURESTORE_H
+
+// Qt includes
+
+#include <QVector>
+
+// Local includes
+
+#include "haar.h"
+
+namespace Digikam
+{
+
+namespace Haar
+{
+
+/** A query signature laid out for scoring many signatures.
+ *  For each channel and signed coefficient index, it stores the weight class
+ *  of the coefficient if the query has it, or 0.
+ *  The object is large; reuse it for subsequent queries with setSignature().
+ */
+class ScoringQuery
+{
+public:
+
+    /** Number of weight classes: 0 for "not in query", 1-6 for the bins of Haar::WeightBin.
+     *  Padded to a multiple of 4.
+     */
+    enum { NumberOfClasses = 8 };
+
+public:
+
+    ScoringQuery(const Weights& weights, const WeightBin& bin);
+
+    /// Prepare for scoring against the given signature
+    void setSignature(const SignatureData& sig);
+
+public:
+
+    double averages[3];
+    double averageWeights[3];
+    double weights[3][NumberOfClasses];
+    /// Padded by 4 bytes, the AVX2 kernel reads 32 bit at the last position
+    quint8 classes[3][2 * NumberOfPixelsSquared + 4];
+
+private:
+
+    const WeightBin& m_bin;
+    Idx              m_sig[3][NumberOfCoefficients];
+};
+
+// ---------------------------------------------------------------------------------
+
+/** Stores signatures as a structure of arrays: contiguous arrays of image ids,
+ *  of the averages per channel and of the coefficient indices, packed to 16 bit.
+ *  Copying is cheap, the arrays are implicitly shared.
+ */
+class SignatureStore
+{
+public:
+
+    enum { CoefficientsPerSignature = 3 * NumberOfCoefficients };
+
+public:
+
+    int  size() const
+    {
+        return ids.size();
+    }
+
+    void reserve(int size);
+    void clear();
+
+    void append(qlonglong imageid, const SignatureData& sig);
+    /// Appends the entry at index from the other store
+    void append(const SignatureStore& other, int index);
+    void signature(int index, SignatureData* sig) const;
+
+    /// Returns the coefficients of the given entry, channel after channel
+    const qint16* coefficientsAt(int index) const
+    {
+        return coefficients.constData() + index * CoefficientsPerSignature;
+    }
+
+    /** Scores the entries in the range [begin, end) against the query.
+     *  The score is identical to HaarIface's score: lower is better.
+     *  Uses the fastest code path supported by the processor.
+     */
+    void score(const ScoringQuery& query, int begin, int end, double* scores) const;
+
+public:
+
+    QVector<qlonglong> ids;
+    QVector<double>    averages[3];
+    QVector<qint16>    coefficients;
+};
+
+// ---------------------------------------------------------------------------------
+
+/** The scoring kernels. All compute bit-identical results.
+ *  averages point to the averages of the first entry, coefficients to its coefficients.
+ */
+void scoreSignaturesScalar(const ScoringQuery& query, const double* const averages[3],
+                           const qint16* coefficients, int count, double* scores);
+void scoreSignaturesSSE2(const ScoringQuery& query, const double* const averages[3],
+                         const qint16* coefficients, int count, double* scores);
+void scoreSignaturesAVX2(const ScoringQuery& query, const double* const averages[3],
+                         const qint16* coefficients, int count, double* scores);
+
+}  // namespace Haar
+
+}  // namespace Digikam
+
+#endif // HAARSIGNATURESTORE_H
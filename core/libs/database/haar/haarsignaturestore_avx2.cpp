@@ -0,0 +1,98 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-05
+ * Description : Haar signature scoring, AVX2 code path
+ *
+ * Copyright (C) 2009-2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "haarsignaturestore.h"
+
+// Local includes
+
+#include "config-digikam.h"
+
+#ifdef HAVE_AVX2
+
+// C++ includes
+
+#include <immintrin.h>
+
+namespace Digikam
+{
+
+namespace Haar
+{
+
+/** Scores four signatures per register. The class and weight lookups are done with gather instructions.
+ *  Each lane carries out the same operations in the same order as the scalar code,
+ *  so the results are bit-identical.
+ */
+void scoreSignaturesAVX2(const ScoringQuery& query, const double* const averages[3],
+                         const qint16* coefficients, int count, double* scores)
+{
+    const int     stride   = SignatureStore::CoefficientsPerSignature;
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    int i                  = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256d score = _mm256_setzero_pd();
+
+        // Step 1: weighted absolute differences of the averages
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            __m256d diff = _mm256_sub_pd(_mm256_set1_pd(query.averages[channel]),
+                                         _mm256_loadu_pd(averages[channel] + i));
+            diff         = _mm256_andnot_pd(signMask, diff);
+            score        = _mm256_add_pd(score, _mm256_mul_pd(_mm256_set1_pd(query.averageWeights[channel]), diff));
+        }
+
+        // Step 2: coefficients in common
+        const qint16* coefs = coefficients + i * stride;
+
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            // Reads 32 bit at the position of a coefficient, the upper bytes are masked out
+            const int* const    classes = (const int*)(query.classes[channel] + NumberOfPixelsSquared);
+            const double* const weights = query.weights[channel];
+
+            for (int coef = 0; coef < NumberOfCoefficients; ++coef, ++coefs)
+            {
+                __m128i index = _mm_set_epi32(coefs[3 * stride], coefs[2 * stride], coefs[stride], coefs[0]);
+                __m128i cls   = _mm_and_si128(_mm_i32gather_epi32(classes, index, 1), byteMask);
+                score         = _mm256_sub_pd(score, _mm256_i32gather_pd(weights, cls, 8));
+            }
+        }
+
+        _mm256_storeu_pd(scores + i, score);
+    }
+
+    if (i < count)
+    {
+        const double* const rest[3] = { averages[0] + i, averages[1] + i, averages[2] + i };
+        scoreSignaturesScalar(query, rest, coefficients + i * stride, count - i, scores + i);
+    }
+}
+
+}  // namespace Haar
+
+}  // namespace Digikam
+
+#endif // HAVE_AVX2
@@ -0,0 +1,93 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-05
+ * Description : Haar signature scoring, SSE2 code path
+ *
+ * Copyright (C) 2009-2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "haarsignaturestore.h"
+
+// Local includes
+
+#include "config-digikam.h"
+
+#ifdef HAVE_SSE2
+
+// C++ includes
+
+#include <emmintrin.h>
+
+namespace Digikam
+{
+
+namespace Haar
+{
+
+/** Scores two signatures per register. Each lane carries out the same operations
+ *  in the same order as the scalar code, so the results are bit-identical.
+ */
+void scoreSignaturesSSE2(const ScoringQuery& query, const double* const averages[3],
+                         const qint16* coefficients, int count, double* scores)
+{
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    int i                  = 0;
+
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128d score = _mm_setzero_pd();
+
+        // Step 1: weighted absolute differences of the averages
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            __m128d diff = _mm_sub_pd(_mm_set1_pd(query.averages[channel]), _mm_loadu_pd(averages[channel] + i));
+            diff         = _mm_andnot_pd(signMask, diff);
+            score        = _mm_add_pd(score, _mm_mul_pd(_mm_set1_pd(query.averageWeights[channel]), diff));
+        }
+
+        // Step 2: coefficients in common. SSE2 has no gather, the lookups stay scalar.
+        const qint16* coefs0 = coefficients + i * SignatureStore::CoefficientsPerSignature;
+        const qint16* coefs1 = coefs0 + SignatureStore::CoefficientsPerSignature;
+
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            const quint8* const classes = query.classes[channel] + NumberOfPixelsSquared;
+            const double* const weights = query.weights[channel];
+
+            for (int coef = 0; coef < NumberOfCoefficients; ++coef)
+            {
+                score = _mm_sub_pd(score, _mm_set_pd(weights[classes[*coefs1++]], weights[classes[*coefs0++]]));
+            }
+        }
+
+        _mm_storeu_pd(scores + i, score);
+    }
+
+    if (i < count)
+    {
+        const double* const rest[3] = { averages[0] + i, averages[1] + i, averages[2] + i };
+        scoreSignaturesScalar(query, rest, coefficients + i * SignatureStore::CoefficientsPerSignature,
+                              count - i, scores + i);
+    }
+}
+
+}  // namespace Haar
+
+}  // namespace Digikam
+
+#endif // HAVE_SSE2
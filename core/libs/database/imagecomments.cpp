@@ -56,8 +56,13 @@ public:
 
     void init(DatabaseAccess& access, qlonglong imageId)
     {
-        id = imageId;
-        infos = access.db()->getImageComments(id);
+        init(imageId, access.db()->getImageComments(imageId));
+    }
+
+    void init(qlonglong imageId, const QList<CommentInfo>& commentInfos)
+    {
+        id    = imageId;
+        infos = commentInfos;
 
         for (int i=0; i<infos.size(); i++)
         {
@@ -162,6 +167,12 @@ ImageComments::ImageComments(DatabaseAccess& access, qlonglong imageid)
     d->init(access, imageid);
 }
 
+ImageComments::ImageComments(qlonglong imageid, const QList<CommentInfo>& infos)
+    : d(new ImageCommentsPriv)
+{
+    d->init(imageid, infos);
+}
+
 ImageComments::ImageComments(const ImageComments& other)
 {
     d = other.d;
@@ -98,6 +98,12 @@ public:
      * The existing DatabaseAccess object will be used to access the database.
      */
     ImageComments(DatabaseAccess& access, qlonglong imageid);
+    /**
+     * Create a ImageComments object for the image with the specified id,
+     * from comments already read from the database, for example with
+     * AlbumDB::getImageComments(const QList<qlonglong>&).
+     */
+    ImageComments(qlonglong imageid, const QList<CommentInfo>& infos);
 
     ImageComments(const ImageComments& other);
     ~ImageComments();
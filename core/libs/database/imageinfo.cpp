@@ -648,7 +648,7 @@ bool ImageInfo::isVisible() const
         return false;
     }
 
-    QVariantList value = DatabaseAccess().db()->getImagesFields(m_data->id, DatabaseFields::Status);
+    QVariantList value = DatabaseAccess(DatabaseAccess::ReadAccess).db()->getImagesFields(m_data->id, DatabaseFields::Status);
 
     if (!value.isEmpty())
     {
@@ -681,7 +681,7 @@ bool ImageInfo::hasDerivedImages() const
         return false;
     }
 
-    return DatabaseAccess().db()->hasImagesRelatingTo(m_data->id, DatabaseRelation::DerivedFrom);
+    return DatabaseAccess(DatabaseAccess::ReadAccess).db()->hasImagesRelatingTo(m_data->id, DatabaseRelation::DerivedFrom);
 }
 
 bool ImageInfo::hasAncestorImages() const
@@ -691,7 +691,7 @@ bool ImageInfo::hasAncestorImages() const
         return false;
     }
 
-    return DatabaseAccess().db()->hasImagesRelatedFrom(m_data->id, DatabaseRelation::DerivedFrom);
+    return DatabaseAccess(DatabaseAccess::ReadAccess).db()->hasImagesRelatedFrom(m_data->id, DatabaseRelation::DerivedFrom);
 }
 
 QList<ImageInfo> ImageInfo::derivedImages() const
@@ -701,7 +701,7 @@ QList<ImageInfo> ImageInfo::derivedImages() const
         return QList<ImageInfo>();
     }
 
-    return ImageInfoList(DatabaseAccess().db()->getImagesRelatingTo(m_data->id, DatabaseRelation::DerivedFrom));
+    return ImageInfoList(DatabaseAccess(DatabaseAccess::ReadAccess).db()->getImagesRelatingTo(m_data->id, DatabaseRelation::DerivedFrom));
 }
 
 QList<ImageInfo> ImageInfo::ancestorImages() const
@@ -711,7 +711,7 @@ QList<ImageInfo> ImageInfo::ancestorImages() const
         return QList<ImageInfo>();
     }
 
-    return ImageInfoList(DatabaseAccess().db()->getImagesRelatedFrom(m_data->id, DatabaseRelation::DerivedFrom));
+    return ImageInfoList(DatabaseAccess(DatabaseAccess::ReadAccess).db()->getImagesRelatedFrom(m_data->id, DatabaseRelation::DerivedFrom));
 }
 
 QList<QPair<qlonglong, qlonglong> > ImageInfo::relationCloud() const
@@ -721,7 +721,7 @@ QList<QPair<qlonglong, qlonglong> > ImageInfo::relationCloud() const
         return QList<QPair<qlonglong, qlonglong> >();
     }
 
-    return DatabaseAccess().db()->getRelationCloud(m_data->id, DatabaseRelation::DerivedFrom);
+    return DatabaseAccess(DatabaseAccess::ReadAccess).db()->getRelationCloud(m_data->id, DatabaseRelation::DerivedFrom);
 }
 
 void ImageInfo::markDerivedFrom(const ImageInfo& ancestor)
@@ -1053,7 +1053,7 @@ HistoryImageId ImageInfo::historyImageId() const
     id.setFileName(name());
     id.setPathOnDisk(filePath());
 
-    if (DatabaseAccess().db()->isUniqueHashV2())
+    if (DatabaseAccess().db()->getUniqueHashVersion() >= 2)
     {
         ItemScanInfo info = DatabaseAccess().db()->getItemScanInfo(m_data->id);
         id.setUniqueHash(info.uniqueHash, info.fileSize);
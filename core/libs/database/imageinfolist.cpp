@@ -23,9 +23,17 @@
 
 #include "imageinfolist.h"
 
+// Qt includes
+
+#include <QHash>
+
 // Local includes
 
+#include "albumdb.h"
+#include "databaseaccess.h"
+#include "imagecomments.h"
 #include "imageinfo.h"
+#include "imageinfodata.h"
 
 namespace Digikam
 {
@@ -48,4 +56,249 @@ QList<qlonglong> ImageInfoList::toImageIdList() const
     return idList;
 }
 
+void ImageInfoList::loadFields(const DatabaseFields::Set& fields) const
+{
+    DatabaseFields::Images imagesFields        = fields;
+    DatabaseFields::ImageInformation infoFields = fields;
+    DatabaseFields::ImageComments commentFields = fields;
+
+    imagesFields &= DatabaseFields::Category | DatabaseFields::ModificationDate | DatabaseFields::FileSize;
+    infoFields   &= DatabaseFields::Rating   | DatabaseFields::CreationDate     | DatabaseFields::Format |
+                    DatabaseFields::Width    | DatabaseFields::Height;
+
+    // the size is cached as a whole
+    if (infoFields & (DatabaseFields::Width | DatabaseFields::Height))
+    {
+        infoFields |= DatabaseFields::Width | DatabaseFields::Height;
+    }
+
+    if (imagesFields == DatabaseFields::ImagesNone && infoFields == DatabaseFields::ImageInformationNone &&
+        !(commentFields & DatabaseFields::Comment))
+    {
+        return;
+    }
+
+    // Cached fields must only be accessed with the lock held, see ImageInfoCache
+    DatabaseAccess access;
+
+    QHash<qlonglong, ImageInfoData*> imagesData, infoData, commentData;
+
+    foreach (const ImageInfo& info, *this)
+    {
+        ImageInfoData* const data = info.m_data.constCastData();
+
+        if (!data)
+        {
+            continue;
+        }
+
+        if (((imagesFields & DatabaseFields::Category)         && !data->categoryCached)         ||
+            ((imagesFields & DatabaseFields::ModificationDate) && !data->modificationDateCached) ||
+            ((imagesFields & DatabaseFields::FileSize)         && !data->fileSizeCached))
+        {
+            imagesData[data->id] = data;
+        }
+
+        if (((infoFields & DatabaseFields::Rating)       && !data->ratingCached)       ||
+            ((infoFields & DatabaseFields::CreationDate) && !data->creationDateCached) ||
+            ((infoFields & DatabaseFields::Format)       && !data->formatCached)       ||
+            ((infoFields & DatabaseFields::Width)        && !data->imageSizeCached))
+        {
+            infoData[data->id] = data;
+        }
+
+        if ((commentFields & DatabaseFields::Comment) && !data->defaultCommentCached)
+        {
+            commentData[data->id] = data;
+        }
+    }
+
+    if (!imagesData.isEmpty())
+    {
+        QStringList fieldNames = AlbumDB::imagesFieldList(imagesFields);
+        QVariantList values    = access.db()->getImagesFields(imagesData.keys(), imagesFields);
+        const int rowSize      = fieldNames.size() + 1;
+
+        for (int i = 0; i + rowSize <= values.size(); i += rowSize)
+        {
+            ImageInfoData* const data = imagesData.take(values.at(i).toLongLong());
+
+            if (!data)
+            {
+                continue;
+            }
+
+            for (int f = 0; f < fieldNames.size(); ++f)
+            {
+                const QString& name  = fieldNames.at(f);
+                const QVariant value = values.at(i + 1 + f);
+
+                if (name == "category")
+                {
+                    data->category = (DatabaseItem::Category)value.toInt();
+                }
+                else if (name == "modificationDate")
+                {
+                    data->modificationDate = value.toDateTime();
+                }
+                else if (name == "fileSize")
+                {
+                    data->fileSize = value.toUInt();
+                }
+            }
+
+            data->categoryCached         = data->categoryCached         || (imagesFields & DatabaseFields::Category);
+            data->modificationDateCached = data->modificationDateCached || (imagesFields & DatabaseFields::ModificationDate);
+            data->fileSizeCached         = data->fileSizeCached         || (imagesFields & DatabaseFields::FileSize);
+        }
+
+        // no entry in the database: cache the default values, as ImageInfo does
+        foreach (ImageInfoData* const data, imagesData)
+        {
+            data->categoryCached         = data->categoryCached         || (imagesFields & DatabaseFields::Category);
+            data->modificationDateCached = data->modificationDateCached || (imagesFields & DatabaseFields::ModificationDate);
+            data->fileSizeCached         = data->fileSizeCached         || (imagesFields & DatabaseFields::FileSize);
+        }
+    }
+
+    if (!infoData.isEmpty())
+    {
+        QStringList fieldNames = AlbumDB::imageInformationFieldList(infoFields);
+        QVariantList values    = access.db()->getImageInformation(infoData.keys(), infoFields);
+        const int rowSize      = fieldNames.size() + 1;
+
+        for (int i = 0; i + rowSize <= values.size(); i += rowSize)
+        {
+            ImageInfoData* const data = infoData.take(values.at(i).toLongLong());
+
+            if (!data)
+            {
+                continue;
+            }
+
+            int width  = 0;
+            int height = 0;
+
+            for (int f = 0; f < fieldNames.size(); ++f)
+            {
+                const QString& name  = fieldNames.at(f);
+                const QVariant value = values.at(i + 1 + f);
+
+                if (name == "rating")
+                {
+                    data->rating = value.toInt();
+                }
+                else if (name == "creationDate")
+                {
+                    data->creationDate = value.toDateTime();
+                }
+                else if (name == "format")
+                {
+                    data->format = value.toString();
+                }
+                else if (name == "width")
+                {
+                    width = value.toInt();
+                }
+                else if (name == "height")
+                {
+                    height = value.toInt();
+                }
+            }
+
+            if (infoFields & DatabaseFields::Width)
+            {
+                data->imageSize = QSize(width, height);
+            }
+
+            data->ratingCached       = data->ratingCached       || (infoFields & DatabaseFields::Rating);
+            data->creationDateCached = data->creationDateCached || (infoFields & DatabaseFields::CreationDate);
+            data->formatCached       = data->formatCached       || (infoFields & DatabaseFields::Format);
+            data->imageSizeCached    = data->imageSizeCached    || (infoFields & DatabaseFields::Width);
+        }
+
+        foreach (ImageInfoData* const data, infoData)
+        {
+            data->ratingCached       = data->ratingCached       || (infoFields & DatabaseFields::Rating);
+            data->creationDateCached = data->creationDateCached || (infoFields & DatabaseFields::CreationDate);
+            data->formatCached       = data->formatCached       || (infoFields & DatabaseFields::Format);
+            data->imageSizeCached    = data->imageSizeCached    || (infoFields & DatabaseFields::Width);
+        }
+    }
+
+    if (!commentData.isEmpty())
+    {
+        QHash<qlonglong, QList<CommentInfo> > comments = access.db()->getImageComments(commentData.keys());
+
+        foreach (ImageInfoData* const data, commentData)
+        {
+            data->defaultComment       = ImageComments(data->id, comments.value(data->id)).defaultComment();
+            data->defaultCommentCached = true;
+        }
+    }
+}
+
+void ImageInfoList::loadTagIds() const
+{
+    DatabaseAccess access;
+
+    QHash<qlonglong, ImageInfoData*> tagData;
+
+    foreach (const ImageInfo& info, *this)
+    {
+        ImageInfoData* const data = info.m_data.constCastData();
+
+        if (data && !data->tagIdsCached)
+        {
+            tagData[data->id] = data;
+        }
+    }
+
+    if (tagData.isEmpty())
+    {
+        return;
+    }
+
+    QHash<qlonglong, QList<int> > tagIds = access.db()->getItemTagIDs(tagData.keys());
+
+    foreach (ImageInfoData* const data, tagData)
+    {
+        data->tagIds       = tagIds.value(data->id);
+        data->tagIdsCached = true;
+    }
+}
+
+void ImageInfoList::loadGroupImageIds() const
+{
+    DatabaseAccess access;
+
+    QHash<qlonglong, ImageInfoData*> groupData;
+
+    foreach (const ImageInfo& info, *this)
+    {
+        ImageInfoData* const data = info.m_data.constCastData();
+
+        if (data && !data->groupImageIsCached)
+        {
+            groupData[data->id] = data;
+        }
+    }
+
+    if (groupData.isEmpty())
+    {
+        return;
+    }
+
+    QHash<qlonglong, QList<qlonglong> > leaders = access.db()->getImagesRelatedFrom(groupData.keys(),
+                                                                                   DatabaseRelation::Grouped);
+
+    foreach (ImageInfoData* const data, groupData)
+    {
+        // list size should be 0 or 1
+        QList<qlonglong> ids     = leaders.value(data->id);
+        data->groupImage         = ids.isEmpty() ? -1 : ids.first();
+        data->groupImageIsCached = true;
+    }
+}
+
 } // namespace Digikam
@@ -31,6 +31,7 @@
 // Local includes
 
 #include "imageinfo.h"
+#include "databasefields.h"
 #include "digikam_export.h"
 #include "config-digikam.h"
 
@@ -50,6 +51,25 @@ public:
         : QList<ImageInfo>(list) {}
 
     QList<qlonglong> toImageIdList() const;
+
+    /**
+     * Reads the given fields for all infos in this list which do not have them cached yet,
+     * with a few set-based database queries instead of one query per info.
+     * Supported are the fields cached by ImageInfo: Category, ModificationDate, FileSize,
+     * Rating, CreationDate, Format, Width and Height, and Comment.
+     * Other fields are ignored.
+     */
+    void loadFields(const DatabaseFields::Set& fields) const;
+
+    /**
+     * Reads the tag ids for all infos in this list, as returned by ImageInfo::tagIds().
+     */
+    void loadTagIds() const;
+
+    /**
+     * Reads the group leader for all infos in this list, as used by ImageInfo::isGrouped().
+     */
+    void loadGroupImageIds() const;
 };
 
 typedef ImageInfoList::iterator ImageInfoListIterator;
@@ -38,6 +38,7 @@
 #include <QDataStream>
 #include <QRegExp>
 #include <QDir>
+#include <QHash>
 
 // KDE includes
 
@@ -64,6 +65,87 @@
 namespace Digikam
 {
 
+static inline int digitsToInt(const QChar* c, int count, bool* ok)
+{
+    int value = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const int digit = c[i].unicode() - '0';
+
+        if (digit < 0 || digit > 9)
+        {
+            *ok = false;
+            return 0;
+        }
+
+        value = value * 10 + digit;
+    }
+
+    return value;
+}
+
+/**
+ * Converts a date as returned from the database.
+ * SQLite returns the string written by QDateTime::toString(Qt::ISODate), which is parsed
+ * here directly, without the generic (and slow) QDateTime::fromString. MySQL returns a QDateTime.
+ */
+static QDateTime dateTimeFromDatabase(const QVariant& value)
+{
+    if (value.isNull())
+    {
+        return QDateTime();
+    }
+
+    if (value.type() == QVariant::DateTime)
+    {
+        return value.toDateTime();
+    }
+
+    const QString str = value.toString();
+
+    // yyyy-MM-ddThh:mm:ss
+    if (str.length() == 19 && str.at(4) == '-' && str.at(7) == '-' && str.at(10) == 'T'
+        && str.at(13) == ':' && str.at(16) == ':')
+    {
+        const QChar* const c = str.constData();
+        bool ok              = true;
+        const QDate date(digitsToInt(c, 4, &ok), digitsToInt(c + 5, 2, &ok), digitsToInt(c + 8, 2, &ok));
+        const QTime time(digitsToInt(c + 11, 2, &ok), digitsToInt(c + 14, 2, &ok), digitsToInt(c + 17, 2, &ok));
+
+        if (ok && date.isValid() && time.isValid())
+        {
+            return QDateTime(date, time);
+        }
+    }
+
+    return QDateTime::fromString(str, Qt::ISODate);
+}
+
+/**
+ * Reads the columns most listings start with from the current row of the query:
+ * Images.id, Images.name, Images.album, Albums.albumRoot, ImageInformation.rating,
+ * Images.category, ImageInformation.format, ImageInformation.creationDate,
+ * Images.modificationDate, Images.fileSize, ImageInformation.width, ImageInformation.height.
+ * Returns the index of the first column following these.
+ */
+static int readRecord(const QSqlQuery& query, ImageListerRecord& record)
+{
+    record.imageID          = query.value(0).toLongLong();
+    record.name             = query.value(1).toString();
+    record.albumID          = query.value(2).toInt();
+    record.albumRootID      = query.value(3).toInt();
+    record.rating           = query.value(4).toInt();
+    record.category         = (DatabaseItem::Category)query.value(5).toInt();
+    record.format           = query.value(6).toString();
+    record.creationDate     = dateTimeFromDatabase(query.value(7));
+    record.modificationDate = dateTimeFromDatabase(query.value(8));
+    record.fileSize         = query.value(9).toInt();
+    record.imageSize        = QSize(query.value(10).toInt(), query.value(11).toInt());
+
+    return 12;
+}
+
 ImageLister::ImageLister()
 {
     m_recursive = true;
@@ -163,65 +245,47 @@ void ImageLister::listAlbum(ImageListerReceiver* receiver,
         albumIds << albumId;
     }
 
-    QList<QVariant> values;
-
-    QString query = "SELECT DISTINCT Images.id, Images.name, Images.album, "
-                    "       ImageInformation.rating, Images.category, "
-                    "       ImageInformation.format, ImageInformation.creationDate, "
-                    "       Images.modificationDate, Images.fileSize, "
-                    "       ImageInformation.width, ImageInformation.height "
-                    " FROM Images "
-                    "       INNER JOIN ImageInformation ON Images.id=ImageInformation.imageid "
-                    " WHERE Images.status=1 AND ";
+    QString sql = "SELECT DISTINCT Images.id, Images.name, Images.album, "
+                  "       Albums.albumRoot, "
+                  "       ImageInformation.rating, Images.category, "
+                  "       ImageInformation.format, ImageInformation.creationDate, "
+                  "       Images.modificationDate, Images.fileSize, "
+                  "       ImageInformation.width, ImageInformation.height "
+                  " FROM Images "
+                  "       INNER JOIN ImageInformation ON Images.id=ImageInformation.imageid "
+                  "       INNER JOIN Albums ON Albums.id=Images.album "
+                  " WHERE Images.status=1 AND ";
 
     if (m_recursive)
     {
-        DatabaseAccess access;
-        query += "Images.album IN (";
-        access.db()->addBoundValuePlaceholders(query, albumIds.size());
-        query += ");";
-        access.backend()->execSql(query, albumIds, &values);
+        sql += "Images.album IN (";
+        AlbumDB::addBoundValuePlaceholders(sql, albumIds.size());
+        sql += ");";
     }
     else
     {
-        DatabaseAccess access;
-        query += "Images.album = ?;";
-        access.backend()->execSql(query, albumIds, &values);
+        sql += "Images.album = ?;";
     }
 
-    int width, height;
+    DatabaseAccess access(DatabaseAccess::ReadAccess);
+    SqlQuery query = access.backend()->prepareQuery(sql);
 
-    for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+    for (int i = 0; i < albumIds.size(); ++i)
+    {
+        query.bindValue(i, albumIds.at(i));
+    }
+
+    if (!access.backend()->exec(query))
+    {
+        receiver->error(access.backend()->lastError());
+        return;
+    }
+
+    // Records are passed on while reading, without collecting all rows first
+    while (!receiver->isCancelled() && query.next())
     {
         ImageListerRecord record;
-        record.imageID           = (*it).toLongLong();
-        ++it;
-        record.name              = (*it).toString();
-        ++it;
-        record.albumID           = (*it).toInt();
-        ++it;
-        record.rating            = (*it).toInt();
-        ++it;
-        record.category          = (DatabaseItem::Category)(*it).toInt();
-        ++it;
-        record.format            = (*it).toString();
-        ++it;
-        record.creationDate      = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.modificationDate  = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.fileSize          = (*it).toInt();
-        ++it;
-        width                    = (*it).toInt();
-        ++it;
-        height                   = (*it).toInt();
-        ++it;
-
-        record.imageSize         = QSize(width, height);
-
-        record.albumRootID = albumRootId;
+        readRecord(query, record);
 
         receiver->receive(record);
     }
@@ -229,64 +293,26 @@ void ImageLister::listAlbum(ImageListerReceiver* receiver,
 
 void ImageLister::listTag(ImageListerReceiver* receiver, int tagId)
 {
-    QList<QVariant> values;
     QMap<QString, QVariant> parameters;
     parameters.insert(":tagPID", tagId);
     parameters.insert(":tagID",  tagId);
 
-    DatabaseAccess access;
-
-    if (m_recursive)
-    {
-        access.backend()->execDBAction(access.backend()->getDBAction(QString("listTagRecursive")), parameters, &values);
-    }
-    else
-    {
-        access.backend()->execDBAction(access.backend()->getDBAction(QString("listTag")), parameters, &values);
-    }
-
     QSet<int> albumRoots = albumRootsToList();
 
-    int width, height;
+    DatabaseAccess access(DatabaseAccess::ReadAccess);
+    QSqlQuery query = access.backend()->execDBActionQuery(m_recursive ? QString("listTagRecursive") : QString("listTag"),
+                                                          parameters);
 
-    for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+    while (!receiver->isCancelled() && query.next())
     {
         ImageListerRecord record;
-
-        record.imageID           = (*it).toLongLong();
-        ++it;
-        record.name              = (*it).toString();
-        ++it;
-        record.albumID           = (*it).toInt();
-        ++it;
-        record.albumRootID       = (*it).toInt();
-        ++it;
-        record.rating            = (*it).toInt();
-        ++it;
-        record.category          = (DatabaseItem::Category)(*it).toInt();
-        ++it;
-        record.format            = (*it).toString();
-        ++it;
-        record.creationDate      = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.modificationDate  = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.fileSize          = (*it).toInt();
-        ++it;
-        width                    = (*it).toInt();
-        ++it;
-        height                   = (*it).toInt();
-        ++it;
+        readRecord(query, record);
 
         if (m_listOnlyAvailableImages && !albumRoots.contains(record.albumRootID))
         {
             continue;
         }
 
-        record.imageSize         = QSize(width, height);
-
         receiver->receive(record);
     }
 }
@@ -333,70 +359,41 @@ void ImageLister::listFaces(ImageListerReceiver* receiver, int personId)
 
 void ImageLister::listDateRange(ImageListerReceiver* receiver, const QDate& startDate, const QDate& endDate)
 {
-    QList<QVariant> values;
-
-    {
-        DatabaseAccess access;
-        access.backend()->execSql(QString("SELECT DISTINCT Images.id, Images.name, Images.album, "
-                                          "       Albums.albumRoot, "
-                                          "       ImageInformation.rating, Images.category, "
-                                          "       ImageInformation.format, ImageInformation.creationDate, "
-                                          "       Images.modificationDate, Images.fileSize, "
-                                          "       ImageInformation.width, ImageInformation.height "
-                                          " FROM Images "
-                                          "       INNER JOIN ImageInformation ON Images.id=ImageInformation.imageid "
-                                          "       INNER JOIN Albums ON Albums.id=Images.album "
-                                          " WHERE Images.status=1 "
-                                          "   AND ImageInformation.creationDate < ? "
-                                          "   AND ImageInformation.creationDate >= ? "
-                                          " ORDER BY Albums.id;"),
-                                  QDateTime(endDate).toString(Qt::ISODate),
-                                  QDateTime(startDate).toString(Qt::ISODate),
-                                  &values);
-    }
-
     QSet<int> albumRoots = albumRootsToList();
 
-    int width, height;
+    DatabaseAccess access(DatabaseAccess::ReadAccess);
+    SqlQuery query = access.backend()->prepareQuery(QString("SELECT DISTINCT Images.id, Images.name, Images.album, "
+                                                            "       Albums.albumRoot, "
+                                                            "       ImageInformation.rating, Images.category, "
+                                                            "       ImageInformation.format, ImageInformation.creationDate, "
+                                                            "       Images.modificationDate, Images.fileSize, "
+                                                            "       ImageInformation.width, ImageInformation.height "
+                                                            " FROM Images "
+                                                            "       INNER JOIN ImageInformation ON Images.id=ImageInformation.imageid "
+                                                            "       INNER JOIN Albums ON Albums.id=Images.album "
+                                                            " WHERE Images.status=1 "
+                                                            "   AND ImageInformation.creationDate < ? "
+                                                            "   AND ImageInformation.creationDate >= ? "
+                                                            " ORDER BY Albums.id;"));
+    query.bindValue(0, QDateTime(endDate).toString(Qt::ISODate));
+    query.bindValue(1, QDateTime(startDate).toString(Qt::ISODate));
+
+    if (!access.backend()->exec(query))
+    {
+        receiver->error(access.backend()->lastError());
+        return;
+    }
 
-    for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+    while (!receiver->isCancelled() && query.next())
     {
         ImageListerRecord record;
-
-        record.imageID           = (*it).toLongLong();
-        ++it;
-        record.name              = (*it).toString();
-        ++it;
-        record.albumID           = (*it).toInt();
-        ++it;
-        record.albumRootID       = (*it).toInt();
-        ++it;
-        record.rating            = (*it).toInt();
-        ++it;
-        record.category          = (DatabaseItem::Category)(*it).toInt();
-        ++it;
-        record.format            = (*it).toString();
-        ++it;
-        record.creationDate      = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.modificationDate  = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.fileSize          = (*it).toInt();
-        ++it;
-        width                    = (*it).toInt();
-        ++it;
-        height                   = (*it).toInt();
-        ++it;
+        readRecord(query, record);
 
         if (m_listOnlyAvailableImages && !albumRoots.contains(record.albumRootID))
         {
             continue;
         }
 
-        record.imageSize         = QSize(width, height);
-
         receiver->receive(record);
     }
 }
@@ -404,65 +401,56 @@ void ImageLister::listDateRange(ImageListerReceiver* receiver, const QDate& star
 void ImageLister::listAreaRange(ImageListerReceiver* receiver,
                                 double lat1, double lat2, double lon1, double lon2)
 {
-    QList<QVariant> values;
     QList<QVariant> boundValues;
-    boundValues << lat1 << lat2 << lon1 << lon2;
 
     kDebug() << "Listing area" << lat1 << lat2 << lon1 << lon2;
 
-    DatabaseAccess access;
+    QSet<int> albumRoots = albumRootsToList();
 
-    access.backend()->execSql(QString("SELECT DISTINCT Images.id, "
-                                      "       Albums.albumRoot, ImageInformation.rating, ImageInformation.creationDate, "
-                                      "       ImagePositions.latitudeNumber, ImagePositions.longitudeNumber "
-                                      " FROM Images "
-                                      "       INNER JOIN ImageInformation ON Images.id=ImageInformation.imageid "
-                                      "       INNER JOIN Albums ON Albums.id=Images.album "
-                                      "       INNER JOIN ImagePositions   ON Images.id=ImagePositions.imageid "
-                                      " WHERE Images.status=1 "
-                                      "   AND (ImagePositions.latitudeNumber>? AND ImagePositions.latitudeNumber<?) "
-                                      "   AND (ImagePositions.longitudeNumber>? AND ImagePositions.longitudeNumber<?);"),
-                              boundValues,
-                              &values);
+    DatabaseAccess access;
 
+    SqlQuery query = access.backend()->prepareQuery(QString("SELECT DISTINCT Images.id, "
+                                                            "       Albums.albumRoot, ImageInformation.rating, ImageInformation.creationDate, "
+                                                            "       ImagePositions.latitudeNumber, ImagePositions.longitudeNumber "
+                                                            " FROM Images "
+                                                            "       INNER JOIN ImageInformation ON Images.id=ImageInformation.imageid "
+                                                            "       INNER JOIN Albums ON Albums.id=Images.album "
+                                                            "       INNER JOIN ImagePositions   ON Images.id=ImagePositions.imageid "
+                                                            " WHERE Images.status=1 "
+                                                            "   AND ") +
+                                                    access.db()->imagePositionsAreaCondition(lat1, lat2, lon1, lon2, &boundValues) + ';');
 
-    kDebug() << "Results:" << values.size() / 14;
-    QSet<int> albumRoots = albumRootsToList();
+    for (int i = 0; i < boundValues.size(); ++i)
+    {
+        query.bindValue(i, boundValues.at(i));
+    }
 
-    double lat, lon;
+    if (!access.backend()->exec(query))
+    {
+        receiver->error(access.backend()->lastError());
+        return;
+    }
 
-    for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+    while (!receiver->isCancelled() && query.next())
     {
         ImageListerRecord record(m_allowExtraValues ? ImageListerRecord::ExtraValueFormat : ImageListerRecord::TraditionalFormat);
 
-        record.imageID           = (*it).toLongLong();
-        ++it;
-        record.albumRootID       = (*it).toInt();
-        ++it;
-
-        record.rating            = (*it).toInt();
-        ++it;
-        record.creationDate      = (*it).toDateTime();
-        ++it;
-        lat                      = (*it).toDouble();
-        ++it;
-        lon                      = (*it).toDouble();
-        ++it;
+        record.imageID           = query.value(0).toLongLong();
+        record.albumRootID       = query.value(1).toInt();
+        record.rating            = query.value(2).toInt();
+        record.creationDate      = dateTimeFromDatabase(query.value(3));
 
         if (m_listOnlyAvailableImages && !albumRoots.contains(record.albumRootID))
         {
             continue;
         }
 
-        record.extraValues       << lat << lon;
+        record.extraValues       << query.value(4).toDouble() << query.value(5).toDouble();
 
         receiver->receive(record);
     }
-
-
 }
 
-
 void ImageLister::listSearch(ImageListerReceiver* receiver,
                              const QString& xml,
                              int limit)
@@ -473,9 +461,7 @@ void ImageLister::listSearch(ImageListerReceiver* receiver,
     }
 
     QList<QVariant> boundValues;
-    QList<QVariant> values;
     QString sqlQuery;
-    QString errMsg;
 
     // query head
     sqlQuery = "SELECT DISTINCT Images.id, Images.name, Images.album, "
@@ -508,77 +494,37 @@ void ImageLister::listSearch(ImageListerReceiver* receiver,
 
     kDebug() << "Search query:\n" << sqlQuery << "\n" << boundValues;
 
-    bool executionSuccess;
-    {
-        DatabaseAccess access;
-        executionSuccess = access.backend()->execSql(sqlQuery, boundValues, &values);
+    QSet<int> albumRoots = albumRootsToList();
 
-        if (!executionSuccess)
-        {
-            errMsg = access.backend()->lastError();
-        }
+    DatabaseAccess access(DatabaseAccess::ReadAccess);
+    SqlQuery query = access.backend()->prepareQuery(sqlQuery);
+
+    for (int i = 0; i < boundValues.size(); ++i)
+    {
+        query.bindValue(i, boundValues.at(i));
     }
 
-    if (!executionSuccess)
+    if (!access.backend()->exec(query))
     {
-        receiver->error(errMsg);
+        receiver->error(access.backend()->lastError());
         return;
     }
 
-    kDebug() << "Search result:" << values.size();
-
-    QSet<int> albumRoots = albumRootsToList();
-
-    int width, height;
-    double lat,lon;
-
-    for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+    while (!receiver->isCancelled() && query.next())
     {
         ImageListerRecord record;
-
-        record.imageID           = (*it).toLongLong();
-        ++it;
-        record.name              = (*it).toString();
-        ++it;
-        record.albumID           = (*it).toInt();
-        ++it;
-        record.albumRootID       = (*it).toInt();
-        ++it;
-        record.rating            = (*it).toInt();
-        ++it;
-        record.category          = (DatabaseItem::Category)(*it).toInt();
-        ++it;
-        record.format            = (*it).toString();
-        ++it;
-        record.creationDate      = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.modificationDate  = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.fileSize          = (*it).toInt();
-        ++it;
-        width                    = (*it).toInt();
-        ++it;
-        height                   = (*it).toInt();
-        ++it;
-        lat                      = (*it).toDouble();
-        ++it;
-        lon                      = (*it).toDouble();
-        ++it;
+        const int column = readRecord(query, record);
 
         if (m_listOnlyAvailableImages && !albumRoots.contains(record.albumRootID))
         {
             continue;
         }
 
-        if (!hooks.checkPosition(lat, lon))
+        if (!hooks.checkPosition(query.value(column).toDouble(), query.value(column + 1).toDouble()))
         {
             continue;
         }
 
-        record.imageSize         = QSize(width, height);
-
         receiver->receive(record);
     }
 }
@@ -591,9 +537,7 @@ void ImageLister::listImageTagPropertySearch(ImageListerReceiver* receiver, cons
     }
 
     QList<QVariant> boundValues;
-    QList<QVariant> values;
     QString sqlQuery;
-    QString errMsg;
 
     // Currently, for optimization, this does not allow a general-purpose search,
     // ImageMetadata and ImagePositions are not joined and hooks are ignored.
@@ -621,73 +565,36 @@ void ImageLister::listImageTagPropertySearch(ImageListerReceiver* receiver, cons
 
     kDebug() << "Search query:\n" << sqlQuery << "\n" << boundValues;
 
-    bool executionSuccess;
-    {
-        DatabaseAccess access;
-        executionSuccess = access.backend()->execSql(sqlQuery, boundValues, &values);
+    QSet<int> albumRoots = albumRootsToList();
 
-        if (!executionSuccess)
-        {
-            errMsg = access.backend()->lastError();
-        }
+    DatabaseAccess access(DatabaseAccess::ReadAccess);
+    SqlQuery query = access.backend()->prepareQuery(sqlQuery);
+
+    for (int i = 0; i < boundValues.size(); ++i)
+    {
+        query.bindValue(i, boundValues.at(i));
     }
 
-    if (!executionSuccess)
+    if (!access.backend()->exec(query))
     {
-        receiver->error(errMsg);
+        receiver->error(access.backend()->lastError());
         return;
     }
 
-    kDebug() << "Search result:" << values.size();
-
-    QSet<int> albumRoots = albumRootsToList();
-
-    int width, height;
-
-    for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+    while (!receiver->isCancelled() && query.next())
     {
         ImageListerRecord record(m_allowExtraValues ? ImageListerRecord::ExtraValueFormat : ImageListerRecord::TraditionalFormat);
-
-        record.imageID           = (*it).toLongLong();
-        ++it;
-        record.name              = (*it).toString();
-        ++it;
-        record.albumID           = (*it).toInt();
-        ++it;
-        record.albumRootID       = (*it).toInt();
-        ++it;
-        record.rating            = (*it).toInt();
-        ++it;
-        record.category          = (DatabaseItem::Category)(*it).toInt();
-        ++it;
-        record.format            = (*it).toString();
-        ++it;
-        record.creationDate      = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.modificationDate  = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.fileSize          = (*it).toInt();
-        ++it;
-        width                    = (*it).toInt();
-        ++it;
-        height                   = (*it).toInt();
-        ++it;
-        // sync the following order with the places where it's read, e.g., DatabaseFace
-        record.extraValues      << (*it); // value
-        ++it;
-        record.extraValues      << (*it); // property
-        ++it;
-        record.extraValues      << (*it); // tag id
-        ++it;
+        const int column = readRecord(query, record);
 
         if (m_listOnlyAvailableImages && !albumRoots.contains(record.albumRootID))
         {
             continue;
         }
 
-        record.imageSize         = QSize(width, height);
+        // sync the following order with the places where it's read, e.g., DatabaseFace
+        record.extraValues      << query.value(column);     // value
+        record.extraValues      << query.value(column + 1); // property
+        record.extraValues      << query.value(column + 2); // tag id
 
         receiver->receive(record);
     }
@@ -764,106 +671,69 @@ void ImageLister::listHaarSearch(ImageListerReceiver* receiver, const QString& x
 
 void ImageLister::listFromIdList(ImageListerReceiver* receiver, QList<qlonglong> imageIds)
 {
-    QList<QVariant> values;
-    QString errMsg;
-    bool executionSuccess = true;
+    QHash<qlonglong, ImageListerRecord> records;
 
     {
-        /*
-        // Unfortunately, we need to convert to QVariant
-        QList<QVariant> variantIdList;
-        foreach (const qlonglong& id, imageIds)
-        {
-            variantIdList << id;
-        }
+        // Query a few hundred ids at once instead of one query per id.
+        DatabaseAccess access(DatabaseAccess::ReadAccess);
 
-        DatabaseAccess access;
-        QSqlQuery query = access.backend()->prepareQuery(QString(
-                    "SELECT DISTINCT Images.id, Images.name, Images.album, "
-                    "       ImageInformation.rating, ImageInformation.creationDate, "
-                    "       Images.modificationDate, Images.fileSize, "
-                    "       ImageInformation.width, ImageInformation.height "
-                    " FROM Images "
-                    "       LEFT JOIN ImageInformation ON Images.id=ImageInformation.imageid "
-                    " WHERE Images.id = ?;"
-                                                                ));
-
-        query.addBindValue(variantIdList);
-        executionSuccess = query.execBatch
-        */
-        DatabaseAccess access;
-        SqlQuery query = access.backend()->prepareQuery(QString(
-                             "SELECT DISTINCT Images.id, Images.name, Images.album, "
-                             "       Albums.albumRoot, "
-                             "       ImageInformation.rating, Images.category, "
-                             "       ImageInformation.format, ImageInformation.creationDate, "
-                             "       Images.modificationDate, Images.fileSize, "
-                             "       ImageInformation.width, ImageInformation.height "
-                             " FROM Images "
-                             "       LEFT JOIN ImageInformation ON Images.id=ImageInformation.imageid "
-                             "       LEFT JOIN Albums ON Albums.id=Images.album "
-                             " WHERE Images.status=1 AND Images.id = ?;"
-                         ));
-
-        foreach (const qlonglong& id, imageIds)
+        foreach (const QList<qlonglong>& chunk, AlbumDB::splitForBoundValues(imageIds))
         {
-            query.bindValue(0, id);
-            executionSuccess = access.backend()->exec(query);
+            if (receiver->isCancelled())
+            {
+                return;
+            }
 
-            if (!executionSuccess)
+            QString sql("SELECT DISTINCT Images.id, Images.name, Images.album, "
+                        "       Albums.albumRoot, "
+                        "       ImageInformation.rating, Images.category, "
+                        "       ImageInformation.format, ImageInformation.creationDate, "
+                        "       Images.modificationDate, Images.fileSize, "
+                        "       ImageInformation.width, ImageInformation.height "
+                        " FROM Images "
+                        "       LEFT JOIN ImageInformation ON Images.id=ImageInformation.imageid "
+                        "       LEFT JOIN Albums ON Albums.id=Images.album "
+                        " WHERE Images.status=1 AND Images.id IN (");
+            AlbumDB::addBoundValuePlaceholders(sql, chunk.size());
+            sql += ");";
+
+            SqlQuery query = access.backend()->prepareQuery(sql);
+
+            for (int i = 0; i < chunk.size(); ++i)
             {
-                errMsg = access.backend()->lastError();
-                break;
+                query.bindValue(i, chunk.at(i));
             }
 
-            // append results to list
-            values << access.backend()->readToList(query);
-        }
+            if (!access.backend()->exec(query))
+            {
+                receiver->error(access.backend()->lastError());
+                return;
+            }
 
-    }
+            while (query.next())
+            {
+                ImageListerRecord record;
+                readRecord(query, record);
 
-    if (!executionSuccess)
-    {
-        receiver->error(errMsg);
-        return;
+                records.insert(record.imageID, record);
+            }
+        }
     }
 
-    int width, height;
-
-    for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd();)
+    // The order of the ids is significant, e.g. for similarity search results
+    foreach (const qlonglong& id, imageIds)
     {
-        ImageListerRecord record;
+        if (receiver->isCancelled())
+        {
+            return;
+        }
 
-        record.imageID           = (*it).toLongLong();
-        ++it;
-        record.name              = (*it).toString();
-        ++it;
-        record.albumID           = (*it).toInt();
-        ++it;
-        record.albumRootID       = (*it).toInt();
-        ++it;
-        record.rating            = (*it).toInt();
-        ++it;
-        record.category          = (DatabaseItem::Category)(*it).toInt();
-        ++it;
-        record.format            = (*it).toString();
-        ++it;
-        record.creationDate      = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.modificationDate  = (*it).isNull() ? QDateTime()
-                                   : QDateTime::fromString((*it).toString(), Qt::ISODate);
-        ++it;
-        record.fileSize          = (*it).toInt();
-        ++it;
-        width                    = (*it).toInt();
-        ++it;
-        height                   = (*it).toInt();
-        ++it;
-
-        record.imageSize         = QSize(width, height);
+        QHash<qlonglong, ImageListerRecord>::const_iterator it = records.constFind(id);
 
-        receiver->receive(record);
+        if (it != records.constEnd())
+        {
+            receiver->receive(it.value());
+        }
     }
 }
 
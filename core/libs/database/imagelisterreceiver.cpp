@@ -23,6 +23,10 @@
 
 #include "imagelisterreceiver.h"
 
+// C++ includes
+
+#include <limits>
+
 // Qt includes
 
 #include <QList>
@@ -30,20 +34,62 @@
 namespace Digikam
 {
 
+// Dates are transferred as seconds since 1970-01-01, in the time spec of the database (local time).
+// Dates before 1970 are negative, an invalid date is written as the smallest value.
+
+static const qint64 julianDayOfEpoch = 2440588;
+static const qint64 secondsPerDay    = 86400;
+
+static inline qint64 toEpochSeconds(const QDateTime& dateTime)
+{
+    if (!dateTime.isValid())
+    {
+        return std::numeric_limits<qint64>::min();
+    }
+
+    return (dateTime.date().toJulianDay() - julianDayOfEpoch) * secondsPerDay
+           + QTime(0, 0).secsTo(dateTime.time());
+}
+
+static inline QDateTime fromEpochSeconds(qint64 seconds)
+{
+    if (seconds == std::numeric_limits<qint64>::min())
+    {
+        return QDateTime();
+    }
+
+    qint64 days        = seconds / secondsPerDay;
+    qint64 secondOfDay = seconds % secondsPerDay;
+
+    if (secondOfDay < 0)
+    {
+        secondOfDay += secondsPerDay;
+        --days;
+    }
+
+    return QDateTime(QDate::fromJulianDay(days + julianDayOfEpoch), QTime(0, 0).addSecs(secondOfDay));
+}
+
+/*
+ * The record is written with all fixed-size fields first, followed by the two strings
+ * and, for the ExtraValueFormat, the extra values.
+ */
+
 QDataStream& operator<<(QDataStream& os, const ImageListerRecord& record)
 {
     os << record.imageID;
-    os << record.albumID;
-    os << record.albumRootID;
-    os << record.name;
+    os << (qint32)record.albumID;
+    os << (qint32)record.albumRootID;
+    os << (qint32)record.rating;
+    os << (qint32)record.category;
+    os << (qint32)record.fileSize;
+    os << (qint32)record.imageSize.width();
+    os << (qint32)record.imageSize.height();
+    os << toEpochSeconds(record.creationDate);
+    os << toEpochSeconds(record.modificationDate);
 
-    os << record.rating;
-    os << (int)record.category;
+    os << record.name;
     os << record.format;
-    os << record.creationDate;
-    os << record.modificationDate;
-    os << record.fileSize;
-    os << record.imageSize;
 
     if (record.binaryFormat == ImageListerRecord::ExtraValueFormat)
     {
@@ -55,20 +101,31 @@ QDataStream& operator<<(QDataStream& os, const ImageListerRecord& record)
 
 QDataStream& operator>>(QDataStream& ds, ImageListerRecord& record)
 {
-    int category;
-    ds >> record.imageID;
-    ds >> record.albumID;
-    ds >> record.albumRootID;
-    ds >> record.name;
+    qint32 albumID, albumRootID, rating, category, fileSize, width, height;
+    qint64 creationDate, modificationDate;
 
-    ds >> record.rating;
+    ds >> record.imageID;
+    ds >> albumID;
+    ds >> albumRootID;
+    ds >> rating;
     ds >> category;
-    record.category = (DatabaseItem::Category)category;
+    ds >> fileSize;
+    ds >> width;
+    ds >> height;
+    ds >> creationDate;
+    ds >> modificationDate;
+
+    record.albumID          = albumID;
+    record.albumRootID      = albumRootID;
+    record.rating           = rating;
+    record.category         = (DatabaseItem::Category)category;
+    record.fileSize         = fileSize;
+    record.imageSize        = QSize(width, height);
+    record.creationDate     = fromEpochSeconds(creationDate);
+    record.modificationDate = fromEpochSeconds(modificationDate);
+
+    ds >> record.name;
     ds >> record.format;
-    ds >> record.creationDate;
-    ds >> record.modificationDate;
-    ds >> record.fileSize;
-    ds >> record.imageSize;
 
     if (record.binaryFormat == ImageListerRecord::ExtraValueFormat)
     {
@@ -125,6 +182,18 @@ void ImageListerValueListReceiver::receive(const ImageListerRecord& record)
 ImageListerSlaveBaseReceiver::ImageListerSlaveBaseReceiver(KIO::SlaveBase* slave)
     : m_slave(slave)
 {
+    m_buffer.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    m_stream.setDevice(&m_buffer);
+}
+
+void ImageListerSlaveBaseReceiver::receive(const ImageListerRecord& record)
+{
+    if (m_buffer.pos() == 0)
+    {
+        ImageListerRecord::initializeStream(record.binaryFormat, m_stream);
+    }
+
+    m_stream << record;
 }
 
 void ImageListerSlaveBaseReceiver::error(const QString& errMsg)
@@ -135,22 +204,10 @@ void ImageListerSlaveBaseReceiver::error(const QString& errMsg)
 
 void ImageListerSlaveBaseReceiver::sendData()
 {
-    QByteArray  ba;
-    QDataStream os(&ba, QIODevice::WriteOnly);
-
-    if (!records.isEmpty())
-    {
-        ImageListerRecord::initializeStream(records.first().binaryFormat, os);
-    }
-
-    for (QList<ImageListerRecord>::const_iterator it = records.constBegin(); it != records.constEnd(); ++it)
-    {
-        os << *it;
-    }
-
-    m_slave->data(ba);
+    m_slave->data(m_buffer.data());
 
-    records.clear();
+    m_buffer.close();
+    m_buffer.open(QIODevice::WriteOnly | QIODevice::Truncate);
 }
 
 ImageListerSlaveBasePartsSendingReceiver::ImageListerSlaveBasePartsSendingReceiver(KIO::SlaveBase* slave, int limit)
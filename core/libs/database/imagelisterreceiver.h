@@ -29,6 +29,8 @@
 
 #include <QString>
 #include <QList>
+#include <QBuffer>
+#include <QDataStream>
 
 // KDE includes
 
@@ -44,7 +46,11 @@ class QDataStream;
 namespace Digikam
 {
 
-//TODO: Docs
+/**
+ * Receives the records listed by ImageLister.
+ * Records are passed on while the database is read with a shared DatabaseAccess,
+ * so receive() must not access the database, ImageInfo or other objects relying on the lock.
+ */
 class DIGIKAM_DATABASE_EXPORT ImageListerReceiver
 {
 
@@ -53,6 +59,12 @@ public:
     virtual ~ImageListerReceiver() {};
     virtual void receive(const ImageListerRecord& record) = 0;
     virtual void error(const QString& /*errMsg*/) {};
+
+    /**
+     * Returns true if no more records are wanted.
+     * ImageLister checks this while reading the results and stops listing.
+     */
+    virtual bool isCancelled() const { return false; };
 };
 
 class DIGIKAM_DATABASE_EXPORT ImageListerValueListReceiver
@@ -72,18 +84,28 @@ public:
 
 // ------------------------------------------------------------------------------------------------
 
+/**
+ * Writes the received records directly into the binary stream sent by sendData(),
+ * the records are not kept in the records list.
+ */
 class DIGIKAM_DATABASE_EXPORT ImageListerSlaveBaseReceiver : public ImageListerValueListReceiver
 {
 
 public:
 
     ImageListerSlaveBaseReceiver(KIO::SlaveBase* slave);
+    virtual void receive(const ImageListerRecord& record);
     virtual void error(const QString& errMsg);
     void sendData();
 
 protected:
 
     KIO::SlaveBase* m_slave;
+
+private:
+
+    QBuffer         m_buffer;
+    QDataStream     m_stream;
 };
 
 class DIGIKAM_DATABASE_EXPORT ImageListerSlaveBasePartsSendingReceiver
@@ -0,0 +1,183 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-22
+ * Description : Listing information from database in a thread of the application
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "imagelisterthread.moc"
+
+// Qt includes
+
+#include <QMetaType>
+
+// KDE includes
+
+#include <kdebug.h>
+
+// Local includes
+
+#include "imagelister.h"
+
+namespace Digikam
+{
+
+class ImageListerThread::ImageListerThreadPriv
+{
+public:
+
+    ImageListerThreadPriv()
+    {
+        recursive      = true;
+        deleteWhenDone = false;
+        limit          = 200;
+    }
+
+    DatabaseUrl              url;
+    bool                     recursive;
+    QString                  specialListing;
+
+    bool                     deleteWhenDone;
+
+    QList<ImageListerRecord> records;
+    int                      limit;
+};
+
+ImageListerThread::ImageListerThread(const DatabaseUrl& url, QObject* parent)
+    : DynamicThread(parent), d(new ImageListerThreadPriv)
+{
+    d->url = url;
+
+    qRegisterMetaType<QList<ImageListerRecord> >("QList<ImageListerRecord>");
+
+    // finished() is emitted in any case, even if stopped before run() was entered
+    setEmitSignals(true);
+    connect(this, SIGNAL(finished()),
+            this, SLOT(slotThreadFinished()), Qt::QueuedConnection);
+}
+
+ImageListerThread::~ImageListerThread()
+{
+    shutDown();
+    delete d;
+}
+
+bool ImageListerThread::canList(const DatabaseUrl& url)
+{
+    return url.isAlbumUrl() || url.isTagUrl() || url.isDateUrl();
+}
+
+void ImageListerThread::setRecursive(bool recursive)
+{
+    d->recursive = recursive;
+}
+
+void ImageListerThread::setSpecialTagListing(const QString& specialListing)
+{
+    d->specialListing = specialListing;
+}
+
+void ImageListerThread::cancel()
+{
+    if (state() == Inactive)
+    {
+        deleteLater();
+        return;
+    }
+
+    // deleted in slotThreadFinished
+    d->deleteWhenDone = true;
+    stop();
+}
+
+void ImageListerThread::slotThreadFinished()
+{
+    if (d->deleteWhenDone)
+    {
+        deleteLater();
+    }
+}
+
+void ImageListerThread::run()
+{
+    // the same as the ioslaves do
+    ImageLister lister;
+    lister.setRecursive(d->recursive);
+
+    if (d->url.isTagUrl() && !d->specialListing.isNull())
+    {
+        QString searchXml = lister.tagSearchXml(d->url, d->specialListing);
+        lister.setAllowExtraValues(true); // pass property value as extra value
+        lister.listImageTagPropertySearch(this, searchXml);
+    }
+    else
+    {
+        lister.list(this, d->url);
+    }
+
+    // the listing was cancelled, the receiver does not expect any more signals
+    if (!runningFlag())
+    {
+        return;
+    }
+
+    sendRecords();
+    emit signalFinished();
+}
+
+void ImageListerThread::receive(const ImageListerRecord& record)
+{
+    if (!runningFlag())
+    {
+        return;
+    }
+
+    d->records << record;
+
+    // send data in growing parts, to be responsive for the first images
+    // while keeping the overhead for large albums small
+    if (d->records.size() >= d->limit)
+    {
+        sendRecords();
+        d->limit = qMin(d->limit + 100, 2000);
+    }
+}
+
+bool ImageListerThread::isCancelled() const
+{
+    return !runningFlag();
+}
+
+void ImageListerThread::error(const QString& errMsg)
+{
+    kWarning() << "Failed to list" << d->url << errMsg;
+}
+
+void ImageListerThread::sendRecords()
+{
+    if (d->records.isEmpty())
+    {
+        return;
+    }
+
+    emit signalRecords(d->records);
+    d->records.clear();
+}
+
+} // namespace Digikam
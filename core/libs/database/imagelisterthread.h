@@ -0,0 +1,118 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-22
+ * Description : Listing information from database in a thread of the application
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef IMAGELISTERTHREAD_H
+#define IMAGELISTERTHREAD_H
+
+// Qt includes
+
+#include <QList>
+#include <QString>
+
+// Local includes
+
+#include "digikam_export.h"
+#include "databaseurl.h"
+#include "dynamicthread.h"
+#include "imagelisterreceiver.h"
+#include "imagelisterrecord.h"
+
+namespace Digikam
+{
+
+/**
+ * Lists an album, tag or date URL in a thread of the application,
+ * doing the same as the listing ioslaves without starting a process
+ * and without transferring the records through KIO.
+ * Use canList() to find out if an URL can be listed this way,
+ * all other URLs need ImageLister::startListJob().
+ */
+class DIGIKAM_DATABASE_EXPORT ImageListerThread : public DynamicThread, private ImageListerReceiver
+{
+    Q_OBJECT
+
+public:
+
+    explicit ImageListerThread(const DatabaseUrl& url, QObject* parent = 0);
+    ~ImageListerThread();
+
+    /**
+     * Returns true for album, tag and date URLs.
+     */
+    static bool canList(const DatabaseUrl& url);
+
+    /**
+     * Adjust the setting if album or tags will be listed recursively.
+     * Corresponds to the "listAlbumsRecursively" and "listTagsRecursively" meta data of the ioslaves.
+     */
+    void setRecursive(bool recursive);
+
+    /**
+     * For tag URLs, list a special tag listing like "faces", as the "specialTagListing" meta data.
+     * The records will then carry extra values.
+     */
+    void setSpecialTagListing(const QString& specialListing);
+
+    /**
+     * Stops the listing, if it is still running, and deletes this object
+     * as soon as the thread has finished. Call this instead of deleting the object.
+     * The listing is interrupted while reading the results, and signalFinished() is not emitted.
+     * Note that signals already queued may still be delivered.
+     */
+    void cancel();
+
+Q_SIGNALS:
+
+    /**
+     * Emitted from the thread with the listed records, in parts of growing size
+     */
+    void signalRecords(const QList<ImageListerRecord>& records);
+
+    /**
+     * Emitted from the thread after the last records were sent.
+     * Not emitted if the listing was cancelled.
+     */
+    void signalFinished();
+
+protected:
+
+    virtual void run();
+
+private Q_SLOTS:
+
+    void slotThreadFinished();
+
+private:
+
+    virtual void receive(const ImageListerRecord& record);
+    virtual void error(const QString& errMsg);
+    virtual bool isCancelled() const;
+    void sendRecords();
+
+    class ImageListerThreadPriv;
+    ImageListerThreadPriv* const d;
+};
+
+} // namespace Digikam
+
+#endif // IMAGELISTERTHREAD_H
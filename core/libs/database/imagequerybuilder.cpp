@@ -33,6 +33,7 @@
 #include <QDir>
 #include <QMap>
 #include <QRectF>
+#include <QRegExp>
 
 // KDE includes
 
@@ -50,6 +51,7 @@
 // Local includes
 
 #include "databaseaccess.h"
+#include "databaseparameters.h"
 #include "albumdb.h"
 #include "geodetictools.h"
 
@@ -131,6 +133,9 @@ QString ImageQueryBuilder::buildQueryFromXml(const QString& xml, QList<QVariant>
     QString sql;
     bool firstGroup = true;
 
+    // some fields look up the database
+    DatabaseAccess access;
+
     while (!reader.atEnd())
     {
         reader.readNext();
@@ -149,7 +154,7 @@ QString ImageQueryBuilder::buildQueryFromXml(const QString& xml, QList<QVariant>
                 firstGroup = false;
             }
 
-            buildGroup(sql, reader, boundValues, hooks);
+            buildGroup(sql, reader, boundValues, hooks, access.db());
         }
     }
 
@@ -158,7 +163,7 @@ QString ImageQueryBuilder::buildQueryFromXml(const QString& xml, QList<QVariant>
 }
 
 void ImageQueryBuilder::buildGroup(QString& sql, SearchXmlCachingReader& reader,
-                                   QList<QVariant> *boundValues, ImageQueryPostHooks* hooks) const
+                                   QList<QVariant> *boundValues, ImageQueryPostHooks* hooks, AlbumDB* db) const
 {
     sql += " (";
 
@@ -187,7 +192,7 @@ void ImageQueryBuilder::buildGroup(QString& sql, SearchXmlCachingReader& reader,
                 firstField = false;
             }
 
-            buildGroup(sql, reader, boundValues, hooks);
+            buildGroup(sql, reader, boundValues, hooks, db);
         }
 
         if (reader.isFieldElement())
@@ -201,7 +206,7 @@ void ImageQueryBuilder::buildGroup(QString& sql, SearchXmlCachingReader& reader,
                 firstField = false;
             }
 
-            if (!buildField(sql, reader, reader.fieldName(), boundValues, hooks))
+            if (!buildField(sql, reader, reader.fieldName(), boundValues, hooks, db))
             {
                 addNoEffectContent(sql, fieldOperator);
             }
@@ -221,8 +226,9 @@ class FieldQueryBuilder
 public:
 
     FieldQueryBuilder(QString& sql, SearchXmlCachingReader& reader,
-                      QList<QVariant> *boundValues, ImageQueryPostHooks* hooks, SearchXml::Relation relation)
-        : sql(sql), reader(reader), boundValues(boundValues), hooks(hooks), relation(relation)
+                      QList<QVariant> *boundValues, ImageQueryPostHooks* hooks, SearchXml::Relation relation,
+                      AlbumDB* db)
+        : sql(sql), reader(reader), boundValues(boundValues), hooks(hooks), relation(relation), db(db)
     {
     }
 
@@ -231,6 +237,7 @@ public:
     QList<QVariant>        *boundValues;
     ImageQueryPostHooks*    hooks;
     SearchXml::Relation     relation;
+    AlbumDB*                db;
 
     inline QString prepareForLike(const QString& str) const
     {
@@ -743,9 +750,8 @@ public:
         // lon1 is always West of lon2. If the rectangle crosses 180 longitude, we have to treat a special case.
         if (lon1 <= lon2)
         {
-            sql += " ImagePositions.LongitudeNumber > ? AND ImagePositions.LatitudeNumber < ? "
-                   " AND ImagePositions.LongitudeNumber < ? AND ImagePositions.LatitudeNumber > ? ";
-            *boundValues << lon1 << lat1 << lon2 << lat2;
+            // lat1 is North of lat2
+            sql += ' ' + db->imagePositionsAreaCondition(lat2, lat1, lon1, lon2, boundValues) + ' ';
         }
         else
         {
@@ -760,10 +766,16 @@ public:
 
 
 bool ImageQueryBuilder::buildField(QString& sql, SearchXmlCachingReader& reader, const QString& name,
-                                   QList<QVariant> *boundValues, ImageQueryPostHooks* hooks) const
+                                   QList<QVariant> *boundValues, ImageQueryPostHooks* hooks, AlbumDB* db) const
 {
     SearchXml::Relation relation = reader.fieldRelation();
-    FieldQueryBuilder fieldQuery(sql, reader, boundValues, hooks, relation);
+
+    if (buildTextIndexField(sql, reader, name, relation, boundValues, db))
+    {
+        return true;
+    }
+
+    FieldQueryBuilder fieldQuery(sql, reader, boundValues, hooks, relation, db);
 
     if (name == "albumid")
     {
@@ -791,9 +803,8 @@ bool ImageQueryBuilder::buildField(QString& sql, SearchXmlCachingReader& reader,
                 addSqlOperator(sql, SearchXml::Or, firstCondition);
                 firstCondition = false;
 
-                DatabaseAccess access;
-                int rootId = access.db()->getAlbumRootId(albumID);
-                QString relativePath = access.db()->getAlbumRelativePath(albumID);
+                int rootId = db->getAlbumRootId(albumID);
+                QString relativePath = db->getAlbumRelativePath(albumID);
 
                 QString childrenWildcard;
 
@@ -1147,7 +1158,7 @@ bool ImageQueryBuilder::buildField(QString& sql, SearchXmlCachingReader& reader,
                "  WHERE type=? AND comment ";
         ImageQueryBuilder::addSqlRelation(sql, relation);
         sql += " ?)) ";
-        *boundValues << DatabaseComment::Comment << fieldQuery.prepareForLike(reader.value());
+        *boundValues << DatabaseComment::Title << fieldQuery.prepareForLike(reader.value());
     }
     else if (name == "imagetagproperty")
     {
@@ -1250,22 +1261,22 @@ bool ImageQueryBuilder::buildField(QString& sql, SearchXmlCachingReader& reader,
         sql += " ( ";
 
         addSqlOperator(sql, SearchXml::Or, true);
-        buildField(sql, reader, "albumname", boundValues, hooks);
+        buildField(sql, reader, "albumname", boundValues, hooks, db);
 
         addSqlOperator(sql, SearchXml::Or, false);
-        buildField(sql, reader, "filename", boundValues, hooks);
+        buildField(sql, reader, "filename", boundValues, hooks, db);
 
         addSqlOperator(sql, SearchXml::Or, false);
-        buildField(sql, reader, "tagname", boundValues, hooks);
+        buildField(sql, reader, "tagname", boundValues, hooks, db);
 
         addSqlOperator(sql, SearchXml::Or, false);
-        buildField(sql, reader, "albumcaption", boundValues, hooks);
+        buildField(sql, reader, "albumcaption", boundValues, hooks, db);
 
         addSqlOperator(sql, SearchXml::Or, false);
-        buildField(sql, reader, "albumcollection", boundValues, hooks);
+        buildField(sql, reader, "albumcollection", boundValues, hooks, db);
 
         addSqlOperator(sql, SearchXml::Or, false);
-        buildField(sql, reader, "comment", boundValues, hooks);
+        buildField(sql, reader, "comment", boundValues, hooks, db);
 
         sql += " ) ";
     }
@@ -1282,6 +1293,125 @@ bool ImageQueryBuilder::buildField(QString& sql, SearchXmlCachingReader& reader,
     return true;
 }
 
+bool ImageQueryBuilder::buildTextIndexField(QString& sql, SearchXmlCachingReader& reader, const QString& name,
+                                            SearchXml::Relation relation, QList<QVariant> *boundValues,
+                                            AlbumDB* db) const
+{
+    // Searches for words in file names, comments and tag names use the full text index, if available.
+    // Note that this matches words by their beginning, while LIKE matches any part of the text.
+    // NotLike keeps using LIKE: "NOT IN (matches)" would also return images without any comment or tag,
+    // and images where the text is contained in the middle of a word.
+
+    if (relation != SearchXml::Like)
+    {
+        return false;
+    }
+
+    if (name != "filename" && name != "comment" && name != "headline" && name != "title" && name != "tagname")
+    {
+        return false;
+    }
+
+    if (db->getTextIndexVersion() < 1)
+    {
+        return false;
+    }
+
+    bool isSQLite = db->isSQLite();
+
+    // Split into words like the index does: The SQLite tokenizer splits at underscores, MySQL does not.
+    QStringList words = reader.value().split(QRegExp(isSQLite ? "[\\W_]+" : "\\W+"), QString::SkipEmptyParts);
+
+    if (words.isEmpty())
+    {
+        return false;
+    }
+
+    QString match;
+
+    foreach (const QString& word, words)
+    {
+        if (isSQLite)
+        {
+            // all words are required by default
+            match += word + "* ";
+        }
+        else
+        {
+            // MySQL does not index words shorter than ft_min_word_len, 4 by default
+            if (word.length() < 4)
+            {
+                return false;
+            }
+
+            match += '+' + word + "* ";
+        }
+    }
+
+    match.chop(1);
+
+    if (name == "filename")
+    {
+        if (isSQLite)
+        {
+            sql += " (Images.id IN (SELECT docid FROM ImagesFts WHERE ImagesFts MATCH ?)) ";
+        }
+        else
+        {
+            sql += " (MATCH (Images.name) AGAINST (? IN BOOLEAN MODE)) ";
+        }
+
+        *boundValues << match;
+    }
+    else if (name == "tagname")
+    {
+        sql += " (Images.id IN "
+               "   (SELECT imageid FROM ImageTags "
+               "    WHERE tagid IN ";
+
+        if (isSQLite)
+        {
+            sql += "   (SELECT docid FROM TagsFts WHERE TagsFts MATCH ?))) ";
+        }
+        else
+        {
+            sql += "   (SELECT id FROM Tags WHERE MATCH (name) AGAINST (? IN BOOLEAN MODE)))) ";
+        }
+
+        *boundValues << match;
+    }
+    else
+    {
+        DatabaseComment::Type type = DatabaseComment::Comment;
+
+        if (name == "headline")
+        {
+            type = DatabaseComment::Headline;
+        }
+        else if (name == "title")
+        {
+            type = DatabaseComment::Title;
+        }
+
+        sql += " (Images.id IN "
+               " (SELECT imageid FROM ImageComments "
+               "  WHERE type=? AND ";
+
+        if (isSQLite)
+        {
+            sql += "id IN (SELECT docid FROM ImageCommentsFts WHERE ImageCommentsFts MATCH ?))) ";
+        }
+        else
+        {
+            sql += "MATCH (comment) AGAINST (? IN BOOLEAN MODE))) ";
+        }
+
+        *boundValues << type << match;
+    }
+
+    return true;
+}
+
 void ImageQueryBuilder::addSqlOperator(QString& sql, SearchXml::Operator op, bool isFirst)
 {
     if (isFirst)
@@ -40,6 +40,7 @@ class KUrl;
 
 namespace Digikam
 {
+class AlbumDB;
 class ImageQueryPostHook;
 
 class ImageQueryPostHooks
@@ -80,9 +81,11 @@ public:
 protected:
 
     void buildGroup(QString& sql, SearchXmlCachingReader& reader,
-                    QList<QVariant> *boundValues, ImageQueryPostHooks* hooks) const;
+                    QList<QVariant> *boundValues, ImageQueryPostHooks* hooks, AlbumDB* db) const;
     bool buildField(QString& sql, SearchXmlCachingReader& reader, const QString& name,
-                    QList<QVariant> *boundValues, ImageQueryPostHooks* hooks) const;
+                    QList<QVariant> *boundValues, ImageQueryPostHooks* hooks, AlbumDB* db) const;
+    bool buildTextIndexField(QString& sql, SearchXmlCachingReader& reader, const QString& name,
+                             SearchXml::Relation relation, QList<QVariant> *boundValues, AlbumDB* db) const;
 
     QString possibleDate(const QString& str, bool& exact) const;
 
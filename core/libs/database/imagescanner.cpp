@@ -53,19 +53,20 @@ namespace Digikam
 {
 
 ImageScanner::ImageScanner(const QFileInfo& info, const ItemScanInfo& scanInfo)
-    : m_hasImage(false), m_hasMetadata(false),
+    : m_hasImage(false), m_hasMetadata(false), m_loadedFromDisk(false),
       m_fileInfo(info), m_scanInfo(scanInfo), m_scanMode(ModifiedScan), m_hasHistoryToResolve(false)
 {
 }
 
 ImageScanner::ImageScanner(const QFileInfo& info)
-    : m_hasImage(false), m_hasMetadata(false),
+    : m_hasImage(false), m_hasMetadata(false), m_loadedFromDisk(false),
       m_fileInfo(info), m_scanMode(ModifiedScan), m_hasHistoryToResolve(false)
 {
 }
 
 ImageScanner::ImageScanner(qlonglong imageid)
-    : m_hasImage(false), m_hasMetadata(false), m_scanMode(ModifiedScan), m_hasHistoryToResolve(false)
+    : m_hasImage(false), m_hasMetadata(false), m_loadedFromDisk(false),
+      m_scanMode(ModifiedScan), m_hasHistoryToResolve(false)
 {
     ItemShortInfo shortInfo;
     {
@@ -122,6 +123,12 @@ void ImageScanner::rescan()
     scanFile(Rescan);
 }
 
+void ImageScanner::loadFile(int uniqueHashVersion)
+{
+    loadFromDisk();
+    m_loadedUniqueHash = uniqueHash(uniqueHashVersion);
+}
+
 void ImageScanner::copiedFrom(int albumId, qlonglong srcId)
 {
     loadFromDisk();
@@ -828,6 +835,44 @@ bool ImageScanner::sameReferredImage(const HistoryImageId& id1, const HistoryIma
     return false;
 }
 
+QList<ItemScanInfo> ImageScanner::identicalFilesWithOtherHashVersion(const HistoryImageId& historyId)
+{
+    QList<ItemScanInfo> candidates, identical;
+    QStringList         paths;
+
+    {
+        DatabaseAccess access;
+        candidates = access.db()->getFilesWithOtherHashVersion(historyId.m_uniqueHash, historyId.m_fileSize);
+
+        foreach (const ItemScanInfo& info, candidates)
+        {
+            int albumRootId       = access.db()->getAlbumRootId(info.albumID);
+            QString albumRootPath = CollectionManager::instance()->albumRootPath(albumRootId);
+            paths << DatabaseUrl::fromAlbumAndName(info.itemName, access.db()->getAlbumRelativePath(info.albumID),
+                                                   albumRootPath, albumRootId).fileUrl().toLocalFile();
+        }
+    }
+
+    // hash the files without holding the database lock. V3 hashes have 16 characters, V2 hashes 32.
+    for (int i = 0; i < candidates.size(); ++i)
+    {
+        if (candidates.at(i).status == DatabaseItem::Removed || !QFileInfo(paths.at(i)).exists())
+        {
+            continue;
+        }
+
+        QString hash = historyId.m_uniqueHash.length() == 16 ? QString(DImg::getUniqueHashV3(paths.at(i)))
+                                                              : QString(DImg::getUniqueHashV2(paths.at(i)));
+
+        if (hash == historyId.m_uniqueHash)
+        {
+            identical << candidates.at(i);
+        }
+    }
+
+    return identical;
+}
+
 QList<qlonglong> ImageScanner::resolveHistoryImageId(const HistoryImageId& historyId)
 {
     // first and foremost: UUID
@@ -842,10 +887,17 @@ QList<qlonglong> ImageScanner::resolveHistoryImageId(const HistoryImageId& histo
     }
 
     // Second: uniqueHash + fileSize. Sufficient to assume that a file is identical, but subject to frequent change.
-    if (historyId.hasUniqueHashIdentifier() && DatabaseAccess().db()->isUniqueHashV2())
+    if (historyId.hasUniqueHashIdentifier() && DatabaseAccess().db()->getUniqueHashVersion() >= 2)
     {
         QList<ItemScanInfo> infos = DatabaseAccess().db()->getIdenticalFiles(historyId.m_uniqueHash, historyId.m_fileSize);
 
+        // The id may carry a hash of another version than the database, V2 or V3,
+        // for example written before the database was updated.
+        if (infos.isEmpty())
+        {
+            infos = identicalFilesWithOtherHashVersion(historyId);
+        }
+
         if (!infos.isEmpty())
         {
             QList<qlonglong> ids;
@@ -1101,6 +1153,12 @@ void ImageScanner::copyProperties(qlonglong source, qlonglong dest)
 
 void ImageScanner::loadFromDisk()
 {
+    // already done by loadFile()
+    if (m_loadedFromDisk)
+    {
+        return;
+    }
+
     MetadataSettings* const mSettings = MetadataSettings::instance();
 
     if (mSettings)
@@ -1126,21 +1184,37 @@ void ImageScanner::loadFromDisk()
     {
         m_img.setMetadata(m_metadata.data());
     }
+
+    m_loadedFromDisk = true;
 }
 
 QString ImageScanner::uniqueHash()
+{
+    if (!m_loadedUniqueHash.isNull())
+    {
+        return m_loadedUniqueHash;
+    }
+
+    return uniqueHash(DatabaseAccess().db()->getScanUniqueHashVersion());
+}
+
+QString ImageScanner::uniqueHash(int version)
 {
     // the QByteArray is an ASCII hex string
     if (m_scanInfo.category == DatabaseItem::Image)
     {
-        if (DatabaseAccess().db()->isUniqueHashV2())
+        if (version >= 3)
+            return QString(m_img.getUniqueHashV3());
+        else if (version == 2)
             return QString(m_img.getUniqueHashV2());
         else
             return QString(m_img.getUniqueHash());
     }
     else
     {
-        if (DatabaseAccess().db()->isUniqueHashV2())
+        if (version >= 3)
+            return QString(DImg::getUniqueHashV3(m_fileInfo.filePath()));
+        else if (version == 2)
             return QString(DImg::getUniqueHashV2(m_fileInfo.filePath()));
         else
             return QString(DImg::getUniqueHash(m_fileInfo.filePath()));
@@ -115,6 +115,16 @@ public:
      */
     void copiedFrom(int albumId, qlonglong srcId);
 
+    /**
+     * Reads the information needed for scanning from the file on disk: the metadata,
+     * the image information and the unique hash of the given version.
+     * This method does not access the database and may be called from another thread
+     * than the scanning methods above. The next call of one of these methods will use
+     * the information read here instead of reading the file again.
+     * Call setCategory() before.
+     */
+    void loadFile(int uniqueHashVersion);
+
     /**
      * Returns true if this file has been marked as needing history resolution at a later stage
      */
@@ -235,14 +245,23 @@ protected:
     void prepareImage();
     void loadFromDisk();
     QString uniqueHash();
+    QString uniqueHash(int version);
     QString detectFormat();
     QString detectVideoFormat();
     QString detectAudioFormat();
 
+    /**
+     * Returns the available items which are identical to the history id, if the id carries
+     * a unique hash of another version than the database. Hashes the candidate files.
+     */
+    static QList<ItemScanInfo> identicalFilesWithOtherHashVersion(const HistoryImageId& historyId);
+
 protected:
 
     bool         m_hasImage;
     bool         m_hasMetadata;
+    bool         m_loadedFromDisk;
+    QString      m_loadedUniqueHash;
 
     QFileInfo    m_fileInfo;
 
@@ -70,12 +70,46 @@ int SchemaUpdater::filterSettingsVersion()
 
 int SchemaUpdater::uniqueHashVersion()
 {
-    return 2;
+    return 3;
+}
+
+int SchemaUpdater::textIndexVersion()
+{
+    return 1;
+}
+
+int SchemaUpdater::spatialIndexVersion()
+{
+    return 1;
 }
 
 bool SchemaUpdater::isUniqueHashUpToDate()
 {
-    return DatabaseAccess().db()->getUniqueHashVersion() >= uniqueHashVersion();
+    // an update running in the background needs no action of the user
+    return DatabaseAccess().db()->getScanUniqueHashVersion() >= uniqueHashVersion();
+}
+
+bool SchemaUpdater::prepareUniqueHashUpdateInBackground()
+{
+    // Since version 2, the hash is calculated from the file content only, so existing
+    // hashes can be replaced file per file, see CollectionScanner::updateUniqueHashes().
+    // New and modified files get the current hash right away.
+    // Version 1 requires updateUniqueHash(), which the user must confirm.
+    DatabaseAccess access;
+    int version = access.db()->getUniqueHashVersion();
+
+    // The database keeps the old version until all hashes are replaced
+    if (version < 2 || version >= uniqueHashVersion())
+    {
+        return false;
+    }
+
+    if (access.db()->getUniqueHashUpdateVersion() != uniqueHashVersion())
+    {
+        access.db()->setUniqueHashUpdateVersion(uniqueHashVersion());
+    }
+
+    return true;
 }
 
 const QString SchemaUpdater::getLastErrorMessage()
@@ -117,6 +151,8 @@ bool SchemaUpdater::update()
     }
 
     updateFilterSettings();
+    createTextIndex();
+    createSpatialIndex();
 
     if (m_observer)
     {
@@ -484,6 +520,54 @@ bool SchemaUpdater::updateFilterSettings()
     return true;
 }
 
+bool SchemaUpdater::createTextIndex()
+{
+    if (m_AlbumDB->getTextIndexVersion() >= textIndexVersion())
+    {
+        return true;
+    }
+
+    // A failed attempt is not repeated on every start: the MySQL statements are not run in a
+    // transaction, and after a partial success, the indexes created before would fail the next time.
+    // Remove the setting to try again.
+    if (m_AlbumDB->getSetting("textIndexFailedVersion").toInt() >= textIndexVersion())
+    {
+        return false;
+    }
+
+    // The full text index is optional, text searches fall back to LIKE without it.
+    // It is kept up to date by triggers, or by the database server itself.
+    if (!m_Backend->execDBAction(m_Backend->getDBAction("CreateTextIndex")))
+    {
+        kWarning() << "Could not create the full text index, text searches will not use it:"
+                   << m_Backend->lastError();
+        m_AlbumDB->setSetting("textIndexFailedVersion", QString::number(textIndexVersion()));
+        return false;
+    }
+
+    m_AlbumDB->setTextIndexVersion(textIndexVersion());
+    return true;
+}
+
+bool SchemaUpdater::createSpatialIndex()
+{
+    if (m_AlbumDB->getSpatialIndexVersion() >= spatialIndexVersion())
+    {
+        return true;
+    }
+
+    // Optional as well, area queries compare the coordinates directly without it.
+    if (!m_Backend->execDBAction(m_Backend->getDBAction("CreateSpatialIndex")))
+    {
+        kWarning() << "Could not create the spatial index, map queries will not use it:"
+                   << m_Backend->lastError();
+        return false;
+    }
+
+    m_AlbumDB->setSpatialIndexVersion(spatialIndexVersion());
+    return true;
+}
+
 bool SchemaUpdater::createDatabase()
 {
     if ( createTables()
@@ -539,6 +623,7 @@ bool SchemaUpdater::updateUniqueHash()
         DatabaseTransaction transaction;
 
         DatabaseAccess().db()->setUniqueHashVersion(uniqueHashVersion());
+        DatabaseAccess().db()->setUniqueHashUpdateVersion(0);
 
         CollectionScanner scanner;
         scanner.setNeedFileCount(true);
@@ -50,7 +50,10 @@ public:
     static int schemaVersion();
     static int filterSettingsVersion();
     static int uniqueHashVersion();
+    static int textIndexVersion();
+    static int spatialIndexVersion();
     static bool isUniqueHashUpToDate();
+    static bool prepareUniqueHashUpdateInBackground();
     bool update();
     bool updateUniqueHash();
     void setObserver(InitializationObserver* observer);
@@ -68,6 +71,8 @@ private:
                                QStringList& defaultAudioFilter);
     bool createFilterSettings();
     bool updateFilterSettings();
+    bool createTextIndex();
+    bool createSpatialIndex();
     bool createDatabase();
     bool createTables();
     bool createIndices();
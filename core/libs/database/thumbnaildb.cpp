@@ -29,6 +29,7 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
+#include <QSet>
 
 // KDE includes
 
@@ -91,6 +92,19 @@ QString ThumbnailDB::getSetting(const QString& keyword)
     }
 }
 
+static void fillThumbnailInfo(QList<QVariant>::const_iterator it, DatabaseThumbnailInfo& info)
+{
+    info.id               = (*it).toInt();
+    ++it;
+    info.type             = (DatabaseThumbnail::Type)(*it).toInt();
+    ++it;
+    info.modificationDate = (*it).isNull() ? QDateTime() : QDateTime::fromString((*it).toString(), Qt::ISODate);
+    ++it;
+    info.orientationHint  = (*it).toInt();
+    ++it;
+    info.data             = (*it).toByteArray();
+}
+
 static void fillThumbnailInfo(const QList<QVariant> &values, DatabaseThumbnailInfo& info)
 {
     if (values.isEmpty())
@@ -98,13 +112,12 @@ static void fillThumbnailInfo(const QList<QVariant> &values, DatabaseThumbnailIn
         return;
     }
 
-    info.id               = values[0].toInt();
-    info.type             = (DatabaseThumbnail::Type)values[1].toInt();
-    info.modificationDate = values[2].isNull() ? QDateTime() : QDateTime::fromString(values[2].toString(), Qt::ISODate);
-    info.orientationHint  = values[3].toInt();
-    info.data             = values[4].toByteArray();
+    fillThumbnailInfo(values.constBegin(), info);
 }
 
+/// The number of bound values per query used by the batch methods, below SQLite's limit of 999
+static const int batchSize = 500;
+
 DatabaseThumbnailInfo ThumbnailDB::findByHash(const QString& uniqueHash, int fileSize)
 {
     QList<QVariant> values;
@@ -171,6 +184,137 @@ DatabaseThumbnailInfo ThumbnailDB::findByFilePath(const QString& path, const QSt
     }
 }
 
+QHash<QPair<QString, int>, DatabaseThumbnailInfo> ThumbnailDB::findByHashes(const QList<QPair<QString, int> >& hashesAndSizes)
+{
+    QHash<QPair<QString, int>, DatabaseThumbnailInfo> infos;
+
+    for (int start = 0; start < hashesAndSizes.size(); start += batchSize)
+    {
+        QSet<QPair<QString, int> > chunk = hashesAndSizes.mid(start, batchSize).toSet();
+        QList<QVariant>            boundValues;
+        QList<QVariant>            values;
+
+        for (int i=start; i<start + batchSize && i<hashesAndSizes.size(); ++i)
+        {
+            boundValues << hashesAndSizes.at(i).first;
+        }
+
+        // fileSize is rarely ambiguous for a given hash, it is compared below
+        QString sql = QString("SELECT uniqueHash, fileSize, id, type, modificationDate, orientationHint, data "
+                              "FROM UniqueHashes "
+                              "   INNER JOIN Thumbnails ON thumbId = id "
+                              "WHERE uniqueHash IN (");
+        DatabaseCoreBackend::addBoundValuePlaceholders(sql, boundValues.size());
+        sql += ");";
+
+        d->db->execSql(sql, boundValues, &values);
+
+        for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd(); it += 7)
+        {
+            QPair<QString, int> key((*it).toString(), (*(it + 1)).toInt());
+
+            if (chunk.contains(key))
+            {
+                DatabaseThumbnailInfo info;
+                fillThumbnailInfo(it + 2, info);
+                infos.insert(key, info);
+            }
+        }
+    }
+
+    return infos;
+}
+
+QHash<QString, DatabaseThumbnailInfo> ThumbnailDB::findByFilePaths(const QStringList& paths, const QStringList& uniqueHashes)
+{
+    QHash<QString, DatabaseThumbnailInfo> infos;
+
+    for (int start = 0; start < paths.size(); start += batchSize)
+    {
+        QStringList     chunk = paths.mid(start, batchSize);
+        QList<QVariant> boundValues;
+        QList<QVariant> values;
+
+        foreach (const QString& path, chunk)
+        {
+            boundValues << path;
+        }
+
+        QString sql = QString("SELECT path, id, type, modificationDate, orientationHint, data "
+                              "FROM FilePaths "
+                              "   INNER JOIN Thumbnails ON thumbId = id "
+                              "WHERE path IN (");
+        DatabaseCoreBackend::addBoundValuePlaceholders(sql, boundValues.size());
+        sql += ");";
+
+        d->db->execSql(sql, boundValues, &values);
+
+        for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd(); it += 6)
+        {
+            DatabaseThumbnailInfo info;
+            fillThumbnailInfo(it + 1, info);
+            infos.insert((*it).toString(), info);
+        }
+    }
+
+    if (uniqueHashes.isEmpty() || infos.isEmpty())
+    {
+        return infos;
+    }
+
+    // double check that no thumbnail is referenced by a different hash, as in findByFilePath
+    QMultiHash<int, QString> hashesOfThumbnails;
+    QList<QVariant>          ids;
+
+    for (QHash<QString, DatabaseThumbnailInfo>::const_iterator it = infos.constBegin(); it != infos.constEnd(); ++it)
+    {
+        ids << it.value().id;
+    }
+
+    for (int start = 0; start < ids.size(); start += batchSize)
+    {
+        QList<QVariant> chunk = ids.mid(start, batchSize);
+        QList<QVariant> values;
+
+        QString sql = QString("SELECT thumbId, uniqueHash FROM UniqueHashes WHERE thumbId IN (");
+        DatabaseCoreBackend::addBoundValuePlaceholders(sql, chunk.size());
+        sql += ");";
+
+        d->db->execSql(sql, chunk, &values);
+
+        for (QList<QVariant>::const_iterator it = values.constBegin(); it != values.constEnd(); it += 2)
+        {
+            hashesOfThumbnails.insert((*it).toInt(), (*(it + 1)).toString());
+        }
+    }
+
+    for (int i=0; i<paths.size() && i<uniqueHashes.size(); ++i)
+    {
+        const QString& uniqueHash = uniqueHashes.at(i);
+
+        if (uniqueHash.isNull())
+        {
+            continue;
+        }
+
+        QHash<QString, DatabaseThumbnailInfo>::iterator it = infos.find(paths.at(i));
+
+        if (it == infos.end())
+        {
+            continue;
+        }
+
+        QList<QString> hashes = hashesOfThumbnails.values(it.value().id);
+
+        if (!hashes.isEmpty() && !hashes.contains(uniqueHash))
+        {
+            infos.erase(it);
+        }
+    }
+
+    return infos;
+}
+
 DatabaseThumbnailInfo ThumbnailDB::findByCustomIdentifier(const QString& id)
 {
     QList<QVariant> values;
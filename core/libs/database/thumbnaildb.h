@@ -100,6 +100,15 @@ public:
      */
     DatabaseThumbnailInfo findByFilePath(const QString& path, const QString& uniqueHash);
 
+    /** Batch versions of findByHash and findByFilePath: Look up the thumbnails of many files
+     *  with a few queries. Files without a thumbnail are not contained in the returned hash.
+     *  For findByFilePaths, uniqueHashes is either empty or aligned with paths; a hash given
+     *  for a path has the same effect as in findByFilePath(path, uniqueHash).
+     */
+    QHash<QPair<QString, int>, DatabaseThumbnailInfo> findByHashes(const QList<QPair<QString, int> >& hashesAndSizes);
+    QHash<QString, DatabaseThumbnailInfo> findByFilePaths(const QStringList& paths,
+                                                          const QStringList& uniqueHashes = QStringList());
+
     DatabaseCoreBackend::QueryState insertUniqueHash(const QString& uniqueHash, int fileSize, int thumbId);
     DatabaseCoreBackend::QueryState insertFilePath(const QString& path, int thumbId);
     DatabaseCoreBackend::QueryState insertCustomIdentifier(const QString& id, int thumbId);
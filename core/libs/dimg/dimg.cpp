@@ -48,6 +48,8 @@ extern "C"
 #include <QFileInfo>
 #include <QMap>
 #include <QPixmap>
+#include <QReadWriteLock>
+#include <QScopedPointer>
 #include <QSysInfo>
 #include <QDebug>
 #include <QUuid>
@@ -208,7 +210,14 @@ void DImg::detach()
     copyImageData(old);
     copyMetaData(old);
 
-    if (old->data)
+    // old is still shared, another thread may move its tiles to data meanwhile
+    DImgTilesLocker locker(old.data());
+
+    if (locker.tiles())
+    {
+        m_priv->tiles = locker.tiles()->copy();
+    }
+    else if (old->data)
     {
         int size = allocateData();
         memcpy(m_priv->data, old->data, size);
@@ -225,6 +234,8 @@ void DImg::putImageData(uint width, uint height, bool sixteenBit, bool alpha, uc
 
     // replace data
     delete [] m_priv->data;
+    delete m_priv->tiles;
+    m_priv->tiles = 0;
 
     if (null)
     {
@@ -260,15 +271,26 @@ void DImg::putImageData(uchar* data, bool copyData)
     {
         delete [] m_priv->data;
         m_priv->data = 0;
+        delete m_priv->tiles;
+        m_priv->tiles = 0;
         m_priv->null = true;
     }
     else if (copyData)
     {
-        memcpy(m_priv->data, data, numBytes());
+        if (m_priv->tiles)
+        {
+            m_priv->tiles->writeRegion(QRect(0, 0, width(), height()), data, width() * bytesDepth());
+        }
+        else
+        {
+            memcpy(m_priv->data, data, numBytes());
+        }
     }
     else
     {
-        m_priv->data = data;
+        delete m_priv->tiles;
+        m_priv->tiles = 0;
+        m_priv->data  = data;
     }
 }
 
@@ -281,7 +303,7 @@ void DImg::resetMetaData()
 
 uchar* DImg::stripImageData()
 {
-    uchar* data  = m_priv->data;
+    uchar* data  = bits();
     m_priv->data = 0;
     m_priv->null = true;
     return data;
@@ -845,9 +867,77 @@ QSize DImg::size() const
 
 uchar* DImg::bits() const
 {
+    if (!m_priv->data && !m_priv->null)
+    {
+        moveTilesToData();
+    }
+
     return m_priv->data;
 }
 
+void DImg::moveTilesToData() const
+{
+    // Lazy conversion, the pixels stay the same.
+    // Shared images may be read from multiple threads, see DImgTilesLocker.
+    DImgPrivate* const priv = m_priv.constCastData();
+    QWriteLocker lock(&priv->tilesLock);
+
+    if (!priv->tiles)
+    {
+        return;
+    }
+
+    uchar* data = DImgLoader::new_failureTolerant(numBytes());
+
+    if (!data)
+    {
+        kWarning() << "Cannot allocate" << numBytes() << "bytes for the pixels of a tiled image";
+        return;
+    }
+
+    priv->tiles->moveAllTo(data);
+    priv->data  = data;
+    delete priv->tiles;
+    priv->tiles = 0;
+}
+
+bool DImg::isTiled() const
+{
+    return m_priv->tiles;
+}
+
+void DImg::setTiled(bool tiled)
+{
+    if (isNull() || tiled == isTiled())
+    {
+        return;
+    }
+
+    if (!tiled)
+    {
+        bits();
+        return;
+    }
+
+    DImgTileStore* tiles = new DImgTileStore(width(), height(), bytesDepth());
+    tiles->writeRegion(QRect(0, 0, width(), height()), m_priv->data, width() * bytesDepth());
+
+    if (m_priv->hasMoreReferences())
+    {
+        DSharedDataPointer<DImgPrivate> old = m_priv;
+        m_priv = new DImgPrivate;
+        copyImageData(old);
+        copyMetaData(old);
+    }
+    else
+    {
+        delete [] m_priv->data;
+        m_priv->data = 0;
+    }
+
+    m_priv->tiles = tiles;
+}
+
 uchar* DImg::copyBits() const
 {
     uchar* data = new uchar[numBytes()];
@@ -1064,7 +1154,8 @@ QStringList DImgPrivate::fileOriginAttributes()
          << "rawDecodingSettings"
          << "rawDecodingFilterAction"
          << "uniqueHash"
-         << "uniqueHashV2";
+         << "uniqueHashV2"
+         << "uniqueHashV3";
     return list;
 }
 
@@ -1144,6 +1235,16 @@ DColor DImg::getPixelColor(uint x, uint y) const
     }
 
     int depth   = bytesDepth();
+
+    DImgTilesLocker locker(m_priv.constCastData());
+
+    if (locker.tiles())
+    {
+        uchar pixel[8];
+        locker.tiles()->readRegion(QRect(x, y, 1, 1), pixel, depth);
+        return( DColor(pixel, m_priv->sixteenBit) );
+    }
+
     uchar* data = m_priv->data + x*depth + (m_priv->width*y*depth);
 
     return( DColor(data, m_priv->sixteenBit) );
@@ -1416,6 +1517,15 @@ void DImg::setPixelColor(uint x, uint y, const DColor& color)
     }
 
     int depth   = bytesDepth();
+
+    if (m_priv->tiles)
+    {
+        uchar pixel[8];
+        color.setPixel(pixel);
+        m_priv->tiles->writeRegion(QRect(x, y, 1, 1), pixel, depth);
+        return;
+    }
+
     uchar* data = m_priv->data + x*depth + (m_priv->width*y*depth);
     color.setPixel(data);
 }
@@ -1434,6 +1544,13 @@ DImg DImg::copy() const
 
 DImg DImg::copyImageData() const
 {
+    if (m_priv->tiles)
+    {
+        DImg img(width(), height(), sixteenBit(), hasAlpha(), 0, true);
+        img.bitBltImage(this, 0, 0);
+        return img;
+    }
+
     DImg img(width(), height(), sixteenBit(), hasAlpha(), bits(), true);
     return img;
 }
@@ -1508,10 +1625,57 @@ void DImg::bitBltImage(const DImg* src, int sx, int sy, int w, int h, int dx, in
         h = src->height();
     }
 
+    {
+        // src may be shared with another thread calling bits()
+        DImgTilesLocker locker(src->m_priv.constCastData());
+
+        if (locker.tiles() || m_priv->tiles)
+        {
+            bitBltTiles(src, locker.tiles(), sx, sy, w, h, dx, dy);
+            return;
+        }
+    }
+
     bitBlt(src->bits(), bits(), sx, sy, w, h, dx, dy,
            src->width(), src->height(), width(), height(), sixteenBit(), src->bytesDepth(), bytesDepth());
 }
 
+void DImg::bitBltTiles(const DImg* src, DImgTileStore* srcTiles, int sx, int sy, int w, int h, int dx, int dy)
+{
+    if (!normalizeRegionArguments(sx, sy, w, h, dx, dy, src->width(), src->height(), width(), height()))
+    {
+        return;
+    }
+
+    const int depth = bytesDepth();
+
+    if (!m_priv->tiles)
+    {
+        // from tiles to a buffer
+        const int lineLength = width() * depth;
+        srcTiles->readRegion(QRect(sx, sy, w, h),
+                             m_priv->data + dy * lineLength + dx * depth, lineLength);
+    }
+    else if (!srcTiles)
+    {
+        // from a buffer to tiles
+        const int lineLength = src->width() * depth;
+        m_priv->tiles->writeRegion(QRect(dx, dy, w, h),
+                                   src->m_priv->data + sy * lineLength + sx * depth, lineLength);
+    }
+    else
+    {
+        // from tiles to tiles, line by line
+        QScopedArrayPointer<uchar> line(new uchar[w * depth]);
+
+        for (int y = 0; y < h; ++y)
+        {
+            srcTiles->readRegion(QRect(sx, sy + y, w, 1), line.data(), w * depth);
+            m_priv->tiles->writeRegion(QRect(dx, dy + y, w, 1), line.data(), w * depth);
+        }
+    }
+}
+
 void DImg::bitBltImage(const uchar* src, int sx, int sy, int w, int h, int dx, int dy,
                        uint swidth, uint sheight, int sdepth)
 {
@@ -1532,6 +1696,16 @@ void DImg::bitBltImage(const uchar* src, int sx, int sy, int w, int h, int dx, i
         h = sheight;
     }
 
+    if (m_priv->tiles)
+    {
+        if (normalizeRegionArguments(sx, sy, w, h, dx, dy, swidth, sheight, width(), height()))
+        {
+            m_priv->tiles->writeRegion(QRect(dx, dy, w, h), src + (sy * swidth + sx) * sdepth, swidth * sdepth);
+        }
+
+        return;
+    }
+
     bitBlt(src, bits(), sx, sy, w, h, dx, dy, swidth, sheight, width(), height(), sixteenBit(), sdepth, bytesDepth());
 }
 
@@ -1876,7 +2050,7 @@ QImage DImg::pureColorMask(ExposureSettingsContainer* expoSettings)
 
     if (sixteenBit())
     {
-        unsigned short* sptr = (unsigned short*)m_priv->data;
+        unsigned short* sptr = (unsigned short*)this->bits();
 
         for (uint i = 0; i < dim; ++i)
         {
@@ -1931,7 +2105,7 @@ QImage DImg::pureColorMask(ExposureSettingsContainer* expoSettings)
     }
     else
     {
-        uchar* sptr = m_priv->data;
+        uchar* sptr = this->bits();
 
         for (uint i = 0; i < dim; ++i)
         {
@@ -2004,6 +2178,31 @@ void DImg::crop(int x, int y, int w, int h)
         return;
     }
 
+    if (m_priv->tiles)
+    {
+        if (!DImgPrivate::clipped(x, y, w, h, width(), height()))
+        {
+            return;
+        }
+
+        // copy the region in bands of tiles, without moving all pixels to one buffer
+        DImgTileStore* tiles = new DImgTileStore(w, h, bytesDepth());
+        const int lineLength = w * bytesDepth();
+        QScopedArrayPointer<uchar> band(new uchar[DImgTileStore::TileSize * lineLength]);
+
+        for (int by = 0; by < h; by += DImgTileStore::TileSize)
+        {
+            const int rows = qMin((int)DImgTileStore::TileSize, h - by);
+            m_priv->tiles->readRegion(QRect(x, y + by, w, rows), band.data(), lineLength);
+            tiles->writeRegion(QRect(0, by, w, rows), band.data(), lineLength);
+        }
+
+        delete m_priv->tiles;
+        m_priv->tiles = tiles;
+        setImageDimension(w, h);
+        return;
+    }
+
     uint  oldw = width();
     uint  oldh = height();
     uchar* old = stripImageData();
@@ -2025,10 +2224,18 @@ void DImg::resize(int w, int h)
     }
 
     DImg image = smoothScale(w, h);
+    bool tiled = isTiled();
 
     delete [] m_priv->data;
-    m_priv->data = image.stripImageData();
+    delete m_priv->tiles;
+    m_priv->tiles = 0;
+    m_priv->data  = image.stripImageData();
     setImageDimension(w, h);
+
+    if (tiled)
+    {
+        setTiled(true);
+    }
 }
 
 void DImg::rotate(ANGLE angle)
@@ -2051,7 +2258,7 @@ void DImg::rotate(ANGLE angle)
             {
                 ullong* newData = new ullong[w*h];
 
-                ullong* from = (ullong*) m_priv->data;
+                ullong* from = (ullong*) bits();
                 ullong* to;
 
                 for (int y = w-1; y >=0; --y)
@@ -2074,7 +2281,7 @@ void DImg::rotate(ANGLE angle)
             {
                 uint* newData = new uint[w*h];
 
-                uint* from = (uint*) m_priv->data;
+                uint* from = (uint*) bits();
                 uint* to;
 
                 for (int y = w-1; y >=0; --y)
@@ -2184,7 +2391,7 @@ void DImg::rotate(ANGLE angle)
             {
                 ullong* newData = new ullong[w*h];
 
-                ullong* from = (ullong*) m_priv->data;
+                ullong* from = (ullong*) bits();
                 ullong* to;
 
                 for (uint y = 0; y < w; ++y)
@@ -2207,7 +2414,7 @@ void DImg::rotate(ANGLE angle)
             {
                 uint* newData = new uint[w*h];
 
-                uint* from = (uint*) m_priv->data;
+                uint* from = (uint*) bits();
                 uint* to;
 
                 for (uint y = 0; y < w; ++y)
@@ -2546,7 +2753,7 @@ void DImg::fill(const DColor& color)
 
     if (sixteenBit())
     {
-        unsigned short* imgData16 = (unsigned short*)m_priv->data;
+        unsigned short* imgData16 = (unsigned short*)bits();
         unsigned short red        = (unsigned short)color.red();
         unsigned short green      = (unsigned short)color.green();
         unsigned short blue       = (unsigned short)color.blue();
@@ -2562,7 +2769,7 @@ void DImg::fill(const DColor& color)
     }
     else
     {
-        uchar* imgData = m_priv->data;
+        uchar* imgData = bits();
         uchar red      = (uchar)color.red();
         uchar green    = (uchar)color.green();
         uchar blue     = (uchar)color.blue();
@@ -2638,6 +2845,34 @@ QByteArray DImg::getUniqueHashV2(const QString& filePath)
     return DImgLoader::uniqueHashV2(filePath);
 }
 
+QByteArray DImg::getUniqueHashV3() const
+{
+    if (m_priv->attributes.contains("uniqueHashV3"))
+    {
+        return m_priv->attributes["uniqueHashV3"].toByteArray();
+    }
+
+    if (!m_priv->attributes.contains("originalFilePath"))
+    {
+        kWarning() << "DImg::getUniqueHash called without originalFilePath property set!";
+        return QByteArray();
+    }
+
+    QString filePath = m_priv->attributes.value("originalFilePath").toString();
+
+    if (filePath.isEmpty())
+    {
+        return QByteArray();
+    }
+
+    return DImgLoader::uniqueHashV3(filePath, this);
+}
+
+QByteArray DImg::getUniqueHashV3(const QString& filePath)
+{
+    return DImgLoader::uniqueHashV3(filePath);
+}
+
 QByteArray DImg::createImageUniqueId() const
 {
     NonDeterministicRandomData randomData(16);
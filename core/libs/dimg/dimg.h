@@ -60,6 +60,7 @@ typedef KExiv2Iface::KExiv2Data KExiv2Data;
 class ExposureSettingsContainer;
 class DImageHistory;
 class DImgPrivate;
+class DImgTileStore;
 class FilterAction;
 class IccTransform;
 class DImgLoaderObserver;
@@ -229,7 +230,13 @@ public:
     uint        width()          const;
     uint        height()         const;
     QSize       size()           const;
+
     uchar*      copyBits()       const;
+
+    /** Returns the pixels in one buffer of numBytes() size.
+        If the image is tiled, the pixels are moved to such a buffer first,
+        and the image is no longer tiled. This applies to scanLine() as well.
+     */
     uchar*      bits()           const;
     uchar*      scanLine(uint i) const;
     bool        hasAlpha()       const;
@@ -237,6 +244,21 @@ public:
     uint        numBytes()       const;
     uint        numPixels()      const;
 
+    /** Returns if the pixels are kept in tiles, see setTiled().
+     */
+    bool        isTiled()        const;
+
+    /** Moves the pixels to a tiled store, or back to one buffer.
+        The tiles are allocated when first written to, and when an image takes much memory,
+        its tiles are moved to a memory-mapped scratch file (see DImgTileStore).
+        This is meant for very large images.
+        getPixelColor(), setPixelColor(), copy(), crop(), bitBltImage() and the smooth scaling
+        methods work on the tiles they need. bits(), scanLine() and all other methods accessing
+        the pixels move the pixels back to one buffer.
+        If the data is shared, the other images keep the buffer and this image is detached.
+     */
+    void        setTiled(bool tiled);
+
     /** Return the number of bytes depth of one pixel : 4 (non sixteenBit) or 8 (sixteen)
      */
     int         bytesDepth() const;
@@ -549,6 +571,13 @@ public:
     QByteArray getUniqueHashV2() const;
     static QByteArray getUniqueHashV2(const QString& filePath);
 
+    /** Like getUniqueHashV2, calculated on the same parts of the file,
+        but with the much faster 64-bit xxHash instead of MD5.
+        The hash will be returned as a 16-byte hexadecimal string.
+     */
+    QByteArray getUniqueHashV3() const;
+    static QByteArray getUniqueHashV3(const QString& filePath);
+
     /** This method creates a new 256-bit UUID meant to be globally unique.
      *  The UUID will be returned as a 64-byte hexadecimal string.
      *  At least 128bits of the UUID will be created by the platform random number
@@ -571,6 +600,8 @@ private:
     void       setImageData(bool null, uint width, uint height, bool sixteenBit, bool alpha);
     void       setImageDimension(uint width, uint height);
     int        allocateData();
+    void       moveTilesToData() const;
+    void       bitBltTiles(const DImg* src, DImgTileStore* srcTiles, int sx, int sy, int w, int h, int dx, int dy);
     DImg(const DImg& image, int w, int h);
     static void bitBlt(const uchar* src, uchar* dest,
                        int sx, int sy, int w, int h, int dx, int dy,
@@ -31,6 +31,7 @@
 #include <QByteArray>
 #include <QVariant>
 #include <QMap>
+#include <QReadWriteLock>
 
 // Local includes
 
@@ -38,6 +39,7 @@
 #include "dmetadata.h"
 #include "dshareddata.h"
 #include "dimagehistory.h"
+#include "dimgtilestore.h"
 #include "iccprofile.h"
 
 /** Lanczos kernel is precomputed in a table with this resolution
@@ -72,11 +74,13 @@ class DIGIKAM_EXPORT DImgPrivate : public DSharedData
 public:
 
     DImgPrivate()
+        : tilesLock(QReadWriteLock::Recursive)
     {
         null         = true;
         width        = 0;
         height       = 0;
         data         = 0;
+        tiles        = 0;
         lanczos_func = 0;
         alpha        = false;
         sixteenBit   = false;
@@ -85,6 +89,7 @@ public:
     ~DImgPrivate()
     {
         delete [] data;
+        delete tiles;
         delete [] lanczos_func;
     }
 
@@ -96,6 +101,18 @@ public:
     unsigned int            height;
 
     unsigned char*          data;
+
+    /// If the image is tiled, the pixels are here, and data is 0
+    DImgTileStore*          tiles;
+
+    /**
+     * bits() moves the tiles to data, even on a const image which may be shared
+     * between threads. It holds this lock for writing, and sets data before it
+     * deletes the tiles. Any other reader of the tiles holds it for reading,
+     * see DImgTilesLocker.
+     */
+    QReadWriteLock          tilesLock;
+
     LANCZOS_DATA_TYPE*      lanczos_func;
 
     KExiv2Data              metaData;
@@ -115,6 +132,57 @@ public:
     static bool clipped(int& x, int& y, int& w, int& h, uint width, uint height);
 };
 
+// ---------------------------------------------------------------------------------------
+
+/**
+ * Keeps the tiles of an image valid while they are read.
+ * If the image has data, no lock is taken, and tiles() returns 0.
+ * Do not call bits() or scanLine() of the image while the tiles are locked.
+ */
+class DImgTilesLocker
+{
+public:
+
+    explicit DImgTilesLocker(DImgPrivate* const priv)
+        : priv(priv), locked(false)
+    {
+        if (!priv->data && !priv->null)
+        {
+            priv->tilesLock.lockForRead();
+            locked = true;
+
+            if (!priv->tiles)
+            {
+                unlock();
+            }
+        }
+    }
+
+    ~DImgTilesLocker()
+    {
+        unlock();
+    }
+
+    DImgTileStore* tiles() const
+    {
+        return locked ? priv->tiles : 0;
+    }
+
+    void unlock()
+    {
+        if (locked)
+        {
+            priv->tilesLock.unlock();
+            locked = false;
+        }
+    }
+
+private:
+
+    DImgPrivate* const priv;
+    bool               locked;
+};
+
 }  // namespace Digikam
 
 #endif /* DIMGPRIVATE_H */
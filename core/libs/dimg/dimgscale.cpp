@@ -34,125 +34,353 @@
  *
  * ============================================================ */
 
-// C ANSI includes
-
-extern "C"
-{
-#include <stdint.h>
-}
-
 // C++ includes
 
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
 
+// Qt includes
+
+#include <QThread>
+
 // KDE includes
 
 #include <kdebug.h>
 
 // Local includes
 
+#include "config-digikam.h"
+#include "cpufeatures.h"
 #include "dimg_p.h"
 #include "dimg.h"
-
-typedef uint64_t ullong;
-typedef int64_t  llong;
+#include "dimgscale.h"
+#include "parallelbands.h"
 
 namespace Digikam
 {
 
 namespace DImgScale
 {
-class DImgScaleInfo
+
+static CodePath selectedCodePath = AutomaticCodePath;
+static bool     parallelBands    = true;
+
+/// Scaling operations reading fewer source pixels are computed in the calling thread only
+static const qint64 parallelScaleMinPixels = 1024 * 1024;
+
+static bool isCodePathAvailable(CodePath path)
+{
+    switch (path)
+    {
+        case AutomaticCodePath:
+        case ScalarCodePath:
+            return true;
+#ifdef HAVE_SSE2
+        case SSE2CodePath:
+            return CpuFeatures::hasSSE2();
+#endif
+#ifdef HAVE_AVX2
+        case AVX2CodePath:
+            return CpuFeatures::hasAVX2();
+#endif
+        default:
+            return false;
+    }
+}
+
+bool setCodePath(CodePath path)
+{
+    if (!isCodePathAvailable(path))
+    {
+        return false;
+    }
+
+    selectedCodePath = path;
+    return true;
+}
+
+void setParallelBands(bool parallel)
+{
+    parallelBands = parallel;
+}
+
+static CodePath codePath()
+{
+    if (selectedCodePath != AutomaticCodePath)
+    {
+        return selectedCodePath;
+    }
+
+    if (isCodePathAvailable(AVX2CodePath))
+    {
+        return AVX2CodePath;
+    }
+
+    if (isCodePathAvailable(SSE2CodePath))
+    {
+        return SSE2CodePath;
+    }
+
+    return ScalarCodePath;
+}
+
+/**
+ * The bands of destination rows of a scaling operation.
+ * The area sampling functions compute the rows clip_dy to clip_dy + clip_dh
+ * independently of each other, so a band is a clip rectangle of its own.
+ */
+template <typename T>
+class DImgScaleRowBands : public ParallelBands
 {
 public:
 
-    DImgScaleInfo()
+    typedef void (*Function)(DImgScaleInfo* isi, T* dest,
+                             int dxx, int dyy, int dw, int dh, int dow, int sow,
+                             int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+
+    DImgScaleRowBands(Function function, DImgScaleInfo* isi, T* dest,
+                      int dxx, int dyy, int dw, int dh, int dow, int sow,
+                      int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+        : ParallelBands(clip_dh, ParallelBands::bandSize(clip_dh, 4, 64)),
+          function(function), isi(isi), dest(dest),
+          dxx(dxx), dyy(dyy), dw(dw), dh(dh), dow(dow), sow(sow),
+          clip_dx(clip_dx), clip_dy(clip_dy), clip_dw(clip_dw)
     {
-        xpoints = 0;
-        ypoints = 0;
-        ypoints16 = 0;
-        xapoints  = 0;
-        yapoints  = 0;
-        xup_yup   = 0;
     }
 
-    ~DImgScaleInfo()
+protected:
+
+    virtual void processBand(int start, int stop, int)
     {
-        delete [] xpoints;
-        delete [] ypoints;
-        delete [] ypoints16;
-        delete [] xapoints;
-        delete [] yapoints;
+        function(isi, dest + (qint64)start * dow, dxx, dyy, dw, dh, dow, sow,
+                 clip_dx, clip_dy + start, clip_dw, stop - start);
     }
 
-    int*     xpoints;
-    uint**   ypoints;
-    ullong** ypoints16;
-    int*     xapoints;
-    int*     yapoints;
-    int      xup_yup;
+private:
+
+    const Function       function;
+    DImgScaleInfo* const isi;
+    T* const             dest;
+    const int            dxx, dyy, dw, dh, dow, sow;
+    const int            clip_dx, clip_dy, clip_dw;
 };
 
-uint**   dimgCalcYPoints(uint* src, int sw, int sh, int dh);
-ullong** dimgCalcYPoints16(ullong* src, int sw, int sh, int dh);
-int*     dimgCalcXPoints(int sw, int dw);
-int*     dimgCalcApoints(int s, int d, int up);
+template <typename T>
+static void dimgScaleInBands(typename DImgScaleRowBands<T>::Function function, qint64 sourcePixels,
+                             DImgScaleInfo* isi, T* dest,
+                             int dxx, int dyy, int dw, int dh, int dow, int sow,
+                             int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    if (!parallelBands || QThread::idealThreadCount() < 2 || clip_dh < 2 || sourcePixels < parallelScaleMinPixels)
+    {
+        function(isi, dest, dxx, dyy, dw, dh, dow, sow, clip_dx, clip_dy, clip_dw, clip_dh);
+        return;
+    }
 
-DImgScaleInfo* dimgCalcScaleInfo(const DImg& img,
-                                 int sw, int sh,
-                                 int dw, int dh,
-                                 bool sixteenBit,
-                                 bool aa);
-
-// 8 bit, not smoothed
-void dimgSampleRGBA(DImgScaleInfo* isi, uint* dest,
-                    int dxx, int dyy, int dw, int dh, int dow);
-void dimgSampleRGBA(DImgScaleInfo* isi, uint* dest,
-                    int dxx, int dyy, int dw, int dh, int dow,
-                    int clip_dx, int clip_dy, int clip_dw, int clip_dh);
-
-// 16 bit, not smoothed
-void dimgSampleRGBA16(DImgScaleInfo* isi, ullong* dest,
-                      int dxx, int dyy, int dw, int dh, int dow);
-void dimgSampleRGBA16(DImgScaleInfo* isi, ullong* dest,
-                      int dxx, int dyy, int dw, int dh, int dow,
-                      int clip_dx, int clip_dy, int clip_dw, int clip_dh);
-
-// 8 bit, RGBA
-void dimgScaleAARGBA(DImgScaleInfo* isi, uint* dest,
-                     int dxx, int dyy, int dw, int dh, int dow, int sow);
-void dimgScaleAARGBA(DImgScaleInfo* isi, uint* dest,
-                     int dxx, int dyy, int dw, int dh, int dow, int sow,
-                     int clip_dx, int clip_dy, int clip_dw, int clip_dh);
-
-// 8 bit, RGB
-void dimgScaleAARGB(DImgScaleInfo* isi, uint* dest,
-                    int dxx, int dyy, int dw, int dh, int dow, int sow);
-void dimgScaleAARGB(DImgScaleInfo* isi, uint* dest,
-                    int dxx, int dyy, int dw, int dh, int dow, int sow,
-                    int clip_dx, int clip_dy, int clip_dw, int clip_dh);
-
-// 16 bit, RGBA
-void dimgScaleAARGBA16(DImgScaleInfo* isi, ullong* dest,
-                       int dxx, int dyy, int dw, int dh,
-                       int dow, int sow);
-void dimgScaleAARGBA16(DImgScaleInfo* isi, ullong* dest,
-                       int dxx, int dyy, int dw, int dh,
-                       int dow, int sow,
-                       int clip_dx, int clip_dy, int clip_dw, int clip_dh);
-
-// 16 bit, RGB
-void dimgScaleAARGB16(DImgScaleInfo* isi, ullong* dest,
-                      int dxx, int dyy, int dw, int dh,
-                      int dow, int sow);
-void dimgScaleAARGB16(DImgScaleInfo* isi, ullong* dest,
-                      int dxx, int dyy, int dw, int dh,
-                      int dow, int sow,
-                      int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+    DImgScaleRowBands<T> bands(function, isi, dest, dxx, dyy, dw, dh, dow, sow,
+                               clip_dx, clip_dy, clip_dw, clip_dh);
+    bands.process();
+}
+
+static DImgScaleRowBands<uint>::Function scaleFunction(bool hasAlpha)
+{
+    switch (codePath())
+    {
+#ifdef HAVE_AVX2
+        case AVX2CodePath:
+            if (hasAlpha)
+            {
+                return dimgScaleAARGBA_AVX2;
+            }
+
+            return dimgScaleAARGB_AVX2;
+#endif
+#ifdef HAVE_SSE2
+        case SSE2CodePath:
+            if (hasAlpha)
+            {
+                return dimgScaleAARGBA_SSE2;
+            }
+
+            return dimgScaleAARGB_SSE2;
+#endif
+        default:
+            if (hasAlpha)
+            {
+                return dimgScaleAARGBA;
+            }
+
+            return dimgScaleAARGB;
+    }
+}
+
+static DImgScaleRowBands<ullong>::Function scaleFunction16(bool hasAlpha)
+{
+    switch (codePath())
+    {
+#ifdef HAVE_AVX2
+        case AVX2CodePath:
+            if (hasAlpha)
+            {
+                return dimgScaleAARGBA16_AVX2;
+            }
+
+            return dimgScaleAARGB16_AVX2;
+#endif
+#ifdef HAVE_SSE2
+        case SSE2CodePath:
+            if (hasAlpha)
+            {
+                return dimgScaleAARGBA16_SSE2;
+            }
+
+            return dimgScaleAARGB16_SSE2;
+#endif
+        default:
+            if (hasAlpha)
+            {
+                return dimgScaleAARGBA16;
+            }
+
+            return dimgScaleAARGB16;
+    }
 }
 
+/**
+ * Scales by area sampling, with the code path selected for the processor,
+ * and in parallel bands of rows if the image is large.
+ * sw and sh are the size of the source section, the other arguments are those of dimgScaleAARGBA().
+ */
+static void dimgScaleAABuffer(DImgScaleInfo* isi, const DImg& image, uchar* dest,
+                              int sw, int sh, int dxx, int dyy, int dw, int dh, int dow, int sow,
+                              int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    // Estimated number of source pixels read
+    qint64 sourcePixels = (qint64)clip_dw * clip_dh;
+
+    if (sw > dw)
+    {
+        sourcePixels = sourcePixels * sw / dw;
+    }
+
+    if (sh > dh)
+    {
+        sourcePixels = sourcePixels * sh / dh;
+    }
+
+    if (image.sixteenBit())
+    {
+        dimgScaleInBands<ullong>(scaleFunction16(image.hasAlpha()), sourcePixels, isi, (ullong*)dest,
+                                 dxx, dyy, dw, dh, dow, sow,
+                                 clip_dx, clip_dy, clip_dw, clip_dh);
+    }
+    else
+    {
+        dimgScaleInBands<uint>(scaleFunction(image.hasAlpha()), sourcePixels, isi, (uint*)dest,
+                               dxx, dyy, dw, dh, dow, sow,
+                               clip_dx, clip_dy, clip_dw, clip_dh);
+    }
+}
+
+/// A tiled image is scaled in bands, reading about this many bytes of source pixels at once
+static const qint64 tiledScaleBandBytes = 64 * 1024 * 1024;
+
+/**
+ * Like dimgScaleAABuffer(), for tiled images. Only the source pixels needed for
+ * the destination rectangle are read from the tiles, in bands of destination rows.
+ * For each band, the scale info is pointed to a buffer holding its source pixels.
+ * dimgCalcScaleInfo() left the row pointers to this function.
+ */
+static void dimgScaleAATiles(DImgScaleInfo* isi, const DImg& image, const DImgTileStore* tiles, uchar* dest,
+                             int sw, int sh, int dxx, int dyy, int dw, int dh, int dow,
+                             int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    // as in dimgCalcScaleInfo() and dimgCalcYPoints()
+    const int    scw     = dw * image.width()  / sw;
+    const int    sch     = dh * image.height() / sh;
+    const ullong inc     = (((ullong)image.height()) << 16) / sch;
+    const int    depth   = image.bytesDepth();
+
+    // From its point, a destination pixel reads the source pixels it covers, and one more
+    const int    extentX = image.width()  / scw + 2;
+    const int    extentY = image.height() / sch + 2;
+
+    const int    x_begin = dxx + clip_dx;
+    const int    x_end   = x_begin + clip_dw;
+    const int    left    = isi->xpoints[x_begin];
+    const int    right   = qMin((int)image.width(), isi->xpoints[x_end - 1] + extentX);
+    const int    sow     = right - left;
+
+    // Only the entries of the destination rectangle are used
+    for (int x = x_begin; x < x_end; ++x)
+    {
+        isi->xpoints[x] -= left;
+    }
+
+    if (image.sixteenBit())
+    {
+        isi->ypoints16 = new ullong*[sch + 1];
+    }
+    else
+    {
+        isi->ypoints   = new uint*[sch + 1];
+    }
+
+    const qint64 bytesPerRow = (qint64)sow * depth * (image.height() / sch + 1);
+    const int    bandRows    = (int)qBound((qint64)1, tiledScaleBandBytes / bytesPerRow, (qint64)clip_dh);
+
+    for (int band = 0; band < clip_dh; band += bandRows)
+    {
+        const int rows    = qMin(bandRows, clip_dh - band);
+        const int y_begin = dyy + clip_dy + band;
+        const int y_end   = y_begin + rows;
+        const int top     = (int)(((ullong)y_begin * inc) >> 16);
+        const int bottom  = qMin((int)image.height(), (int)((((ullong)(y_end - 1) * inc) >> 16) + extentY));
+
+        uchar* buffer     = new uchar[(size_t)sow * (bottom - top) * depth];
+        tiles->readRegion(QRect(left, top, sow, bottom - top), buffer, sow * depth);
+
+        for (int y = y_begin; y < y_end; ++y)
+        {
+            const int row = (int)(((ullong)y * inc) >> 16) - top;
+
+            if (image.sixteenBit())
+            {
+                isi->ypoints16[y] = (ullong*)buffer + row * sow;
+            }
+            else
+            {
+                isi->ypoints[y]   = (uint*)buffer + row * sow;
+            }
+        }
+
+        dimgScaleAABuffer(isi, image, dest + (qint64)band * dow * depth,
+                          sw, sh, dxx, dyy, dw, dh, dow, sow,
+                          clip_dx, clip_dy + band, clip_dw, rows);
+
+        delete [] buffer;
+    }
+}
+
+static void dimgScaleAA(DImgScaleInfo* isi, const DImg& image, const DImgTileStore* tiles, uchar* dest,
+                        int sw, int sh, int dxx, int dyy, int dw, int dh, int dow,
+                        int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    if (tiles)
+    {
+        dimgScaleAATiles(isi, image, tiles, dest, sw, sh, dxx, dyy, dw, dh, dow,
+                         clip_dx, clip_dy, clip_dw, clip_dh);
+    }
+    else
+    {
+        dimgScaleAABuffer(isi, image, dest, sw, sh, dxx, dyy, dw, dh, dow, image.width(),
+                          clip_dx, clip_dy, clip_dw, clip_dh);
+    }
+}
+
+}  // namespace DImgScale
+
 using namespace DImgScale;
 
 /*
@@ -240,40 +468,16 @@ DImg DImg::smoothScaleClipped(int dw, int dh,
         }
     }
 
-    DImgScaleInfo* scaleinfo = dimgCalcScaleInfo(*this, w, h, dw, dh, sixteenBit(), true);
+    // the tiles must stay valid if another thread moves them to data
+    DImgTilesLocker locker(m_priv.constCastData());
+
+    DImgScaleInfo* scaleinfo = dimgCalcScaleInfo(*this, w, h, dw, dh, sixteenBit(), true, locker.tiles() != 0);
 
     DImg buffer(*this, clipw, cliph);
 
-    if (sixteenBit())
-    {
-        if (hasAlpha())
-        {
-            dimgScaleAARGBA16(scaleinfo, (ullong*) buffer.bits(),
-                              0, 0, dw, dh, clipw, w,
-                              clipx, clipy, clipw, cliph);
-        }
-        else
-        {
-            dimgScaleAARGB16(scaleinfo, (ullong*) buffer.bits(),
-                             0, 0, dw, dh, clipw, w,
-                             clipx, clipy, clipw, cliph);
-        }
-    }
-    else
-    {
-        if (hasAlpha())
-        {
-            dimgScaleAARGBA(scaleinfo, (uint*)buffer.bits(),
-                            0, 0, dw, dh, clipw, w,
-                            clipx, clipy, clipw, cliph);
-        }
-        else
-        {
-            dimgScaleAARGB(scaleinfo, (uint*)buffer.bits(),
-                           0, 0, dw, dh, clipw, w,
-                           clipx, clipy, clipw, cliph);
-        }
-    }
+    dimgScaleAA(scaleinfo, *this, locker.tiles(), buffer.bits(),
+                w, h, 0, 0, dw, dh, clipw,
+                clipx, clipy, clipw, cliph);
 
     delete scaleinfo;
 
@@ -346,51 +550,17 @@ DImg DImg::smoothScaleSection(int sx, int sy,
         return copy(sx, sy, sw, sh);
     }
 
+    // the tiles must stay valid if another thread moves them to data
+    DImgTilesLocker locker(m_priv.constCastData());
+
     // calculate scaleinfo
-    DImgScaleInfo* scaleinfo = dimgCalcScaleInfo(*this, sw, sh, dw, dh, sixteenBit(), true);
+    DImgScaleInfo* scaleinfo = dimgCalcScaleInfo(*this, sw, sh, dw, dh, sixteenBit(), true, locker.tiles() != 0);
 
     DImg buffer(*this, dw, dh);
 
-    if (sixteenBit())
-    {
-        if (hasAlpha())
-        {
-            dimgScaleAARGBA16(scaleinfo, (ullong*) buffer.bits(),
-                              ((sx * dw) / sw),
-                              ((sy * dh) / sh),
-                              dw, dh,
-                              dw, w);
-        }
-        else
-        {
-            dimgScaleAARGB16(scaleinfo, (ullong*) buffer.bits(),
-                             ((sx * dw) / sw),
-                             ((sy * dh) / sh),
-                             dw, dh,
-                             dw, w);
-        }
-    }
-    else
-    {
-        if (hasAlpha())
-        {
-            dimgScaleAARGBA(scaleinfo,
-                            (uint*)buffer.bits(),
-                            ((sx * dw) / sw),
-                            ((sy * dh) / sh),
-                            dw, dh,
-                            dw, w);
-        }
-        else
-        {
-            dimgScaleAARGB(scaleinfo,
-                           (uint*)buffer.bits(),
-                           ((sx * dw) / sw),
-                           ((sy * dh) / sh),
-                           dw, dh,
-                           dw, w);
-        }
-    }
+    dimgScaleAA(scaleinfo, *this, locker.tiles(), buffer.bits(),
+                sw, sh, ((sx * dw) / sw), ((sy * dh) / sh), dw, dh, dw,
+                0, 0, dw, dh);
 
     delete scaleinfo;
 
@@ -523,7 +693,8 @@ DImgScaleInfo* DImgScale::dimgCalcScaleInfo(const DImg& img,
         int sw, int sh,
         int dw, int dh,
         bool /*sixteenBit*/,
-        bool aa)
+        bool aa,
+        bool tiled)
 {
     DImgScaleInfo* isi = new DImgScaleInfo;
     int scw, sch;
@@ -535,7 +706,13 @@ DImgScaleInfo* DImgScale::dimgCalcScaleInfo(const DImg& img,
 
     isi->xpoints = dimgCalcXPoints(img.width(), scw);
 
-    if (img.sixteenBit())
+    if (tiled)
+    {
+        // set up by dimgScaleAATiles() for the rows needed
+        isi->ypoints   = 0;
+        isi->ypoints16 = 0;
+    }
+    else if (img.sixteenBit())
     {
         isi->ypoints   = 0;
         isi->ypoints16 = dimgCalcYPoints16((ullong*)img.bits(), img.width(), img.height(), sch);
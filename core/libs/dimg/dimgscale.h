@@ -0,0 +1,204 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-27
+ * Description : Internals of the smooth scaling of DImg,
+ *               shared by the scalar and the vectorized code paths
+ *
+ * Copyright (C) 2005 by Renchi Raju <renchi@pooh.tam.uiuc.edu>
+ * Copyright (C) 2006-2010 by Gilles Caulier <caulier dot gilles at gmail dot com>
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef DIMGSCALE_H
+#define DIMGSCALE_H
+
+// C ANSI includes
+
+extern "C"
+{
+#include <stdint.h>
+}
+
+// Qt includes
+
+#include <QtGlobal>
+
+// Local includes
+
+#include "digikam_export.h"
+
+typedef uint64_t ullong;
+typedef int64_t  llong;
+
+namespace Digikam
+{
+
+class DImg;
+
+namespace DImgScale
+{
+
+class DImgScaleInfo
+{
+public:
+
+    DImgScaleInfo()
+    {
+        xpoints = 0;
+        ypoints = 0;
+        ypoints16 = 0;
+        xapoints  = 0;
+        yapoints  = 0;
+        xup_yup   = 0;
+    }
+
+    ~DImgScaleInfo()
+    {
+        delete [] xpoints;
+        delete [] ypoints;
+        delete [] ypoints16;
+        delete [] xapoints;
+        delete [] yapoints;
+    }
+
+    int*     xpoints;
+    uint**   ypoints;
+    ullong** ypoints16;
+    int*     xapoints;
+    int*     yapoints;
+    int      xup_yup;
+};
+
+uint**   dimgCalcYPoints(uint* src, int sw, int sh, int dh);
+ullong** dimgCalcYPoints16(ullong* src, int sw, int sh, int dh);
+int*     dimgCalcXPoints(int sw, int dw);
+int*     dimgCalcApoints(int s, int d, int up);
+
+DImgScaleInfo* dimgCalcScaleInfo(const DImg& img,
+                                 int sw, int sh,
+                                 int dw, int dh,
+                                 bool sixteenBit,
+                                 bool aa,
+                                 bool tiled = false);
+
+// 8 bit, not smoothed
+void dimgSampleRGBA(DImgScaleInfo* isi, uint* dest,
+                    int dxx, int dyy, int dw, int dh, int dow);
+void dimgSampleRGBA(DImgScaleInfo* isi, uint* dest,
+                    int dxx, int dyy, int dw, int dh, int dow,
+                    int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+
+// 16 bit, not smoothed
+void dimgSampleRGBA16(DImgScaleInfo* isi, ullong* dest,
+                      int dxx, int dyy, int dw, int dh, int dow);
+void dimgSampleRGBA16(DImgScaleInfo* isi, ullong* dest,
+                      int dxx, int dyy, int dw, int dh, int dow,
+                      int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+
+// 8 bit, RGBA
+void dimgScaleAARGBA(DImgScaleInfo* isi, uint* dest,
+                     int dxx, int dyy, int dw, int dh, int dow, int sow);
+void dimgScaleAARGBA(DImgScaleInfo* isi, uint* dest,
+                     int dxx, int dyy, int dw, int dh, int dow, int sow,
+                     int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+
+// 8 bit, RGB
+void dimgScaleAARGB(DImgScaleInfo* isi, uint* dest,
+                    int dxx, int dyy, int dw, int dh, int dow, int sow);
+void dimgScaleAARGB(DImgScaleInfo* isi, uint* dest,
+                    int dxx, int dyy, int dw, int dh, int dow, int sow,
+                    int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+
+// 16 bit, RGBA
+void dimgScaleAARGBA16(DImgScaleInfo* isi, ullong* dest,
+                       int dxx, int dyy, int dw, int dh,
+                       int dow, int sow);
+void dimgScaleAARGBA16(DImgScaleInfo* isi, ullong* dest,
+                       int dxx, int dyy, int dw, int dh,
+                       int dow, int sow,
+                       int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+
+// 16 bit, RGB
+void dimgScaleAARGB16(DImgScaleInfo* isi, ullong* dest,
+                      int dxx, int dyy, int dw, int dh,
+                      int dow, int sow);
+void dimgScaleAARGB16(DImgScaleInfo* isi, ullong* dest,
+                      int dxx, int dyy, int dw, int dh,
+                      int dow, int sow,
+                      int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+
+/**
+ * The vectorized code paths of the area sampling functions above, see dimgscaleaa_p.h.
+ * They compute bit-identical results. The RGB variant sets the alpha channel to opaque,
+ * like dimgScaleAARGB(). Only compiled if HAVE_SSE2 resp. HAVE_AVX2 is defined
+ * in config-digikam.h, and only to be called if CpuFeatures reports the instruction set.
+ */
+void dimgScaleAARGBA_SSE2(DImgScaleInfo* isi, uint* dest,
+                          int dxx, int dyy, int dw, int dh, int dow, int sow,
+                          int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+void dimgScaleAARGB_SSE2(DImgScaleInfo* isi, uint* dest,
+                         int dxx, int dyy, int dw, int dh, int dow, int sow,
+                         int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+void dimgScaleAARGBA16_SSE2(DImgScaleInfo* isi, ullong* dest,
+                            int dxx, int dyy, int dw, int dh, int dow, int sow,
+                            int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+void dimgScaleAARGB16_SSE2(DImgScaleInfo* isi, ullong* dest,
+                           int dxx, int dyy, int dw, int dh, int dow, int sow,
+                           int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+
+void dimgScaleAARGBA_AVX2(DImgScaleInfo* isi, uint* dest,
+                          int dxx, int dyy, int dw, int dh, int dow, int sow,
+                          int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+void dimgScaleAARGB_AVX2(DImgScaleInfo* isi, uint* dest,
+                         int dxx, int dyy, int dw, int dh, int dow, int sow,
+                         int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+void dimgScaleAARGBA16_AVX2(DImgScaleInfo* isi, ullong* dest,
+                            int dxx, int dyy, int dw, int dh, int dow, int sow,
+                            int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+void dimgScaleAARGB16_AVX2(DImgScaleInfo* isi, ullong* dest,
+                           int dxx, int dyy, int dw, int dh, int dow, int sow,
+                           int clip_dx, int clip_dy, int clip_dw, int clip_dh);
+
+enum CodePath
+{
+    /// The fastest code path supported by the processor
+    AutomaticCodePath,
+    ScalarCodePath,
+    SSE2CodePath,
+    AVX2CodePath
+};
+
+/**
+ * Selects the code path of the smooth scaling functions of DImg.
+ * Meant for tests and benchmarks, the default is AutomaticCodePath.
+ * Returns false, and leaves the setting unchanged, if the code path was not compiled
+ * or is not supported by the processor.
+ */
+DIGIKAM_EXPORT bool setCodePath(CodePath path);
+
+/**
+ * Enables or disables the computation of large images in parallel bands of rows.
+ * Meant for tests and benchmarks, enabled by default.
+ */
+DIGIKAM_EXPORT void setParallelBands(bool parallel);
+
+}  // namespace DImgScale
+
+}  // namespace Digikam
+
+#endif // DIMGSCALE_H
@@ -0,0 +1,209 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-27
+ * Description : Area sampling scaling of DImg, AVX2 code path
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "dimgscale.h"
+
+// Local includes
+
+#include "config-digikam.h"
+
+#ifdef HAVE_AVX2
+
+// C++ includes
+
+#include <immintrin.h>
+
+// Local includes
+
+#include "dimgscaleaa_p.h"
+
+namespace Digikam
+{
+
+namespace DImgScale
+{
+
+namespace
+{
+
+/** 8 bit: the channels of a pixel in four 32 bit lanes. A pixel does not fill
+ *  a 256 bit register, but the instruction set has 32 bit multiplication and byte shuffles.
+ *  The 16 bit multiply-add is faster than the 32 bit multiplication where the factors allow it.
+ */
+class OpsAVX2
+{
+public:
+
+    typedef uint    Pixel;
+    typedef __m128i Channels;
+    typedef __m128i Weight;
+
+    static Pixel** ypoints(DImgScaleInfo* isi)
+    {
+        return isi->ypoints;
+    }
+
+    static Channels load(const Pixel* pix)
+    {
+        return _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)*pix));
+    }
+
+    static Weight weight(int w)
+    {
+        return _mm_set1_epi32(w);
+    }
+
+    /// Both factors are below 2^15
+    static Channels mul(Channels c, Weight w)
+    {
+        return _mm_madd_epi16(c, w);
+    }
+
+    static Channels mulWide(Channels c, Weight w)
+    {
+        return _mm_mullo_epi32(c, w);
+    }
+
+    static Channels add(Channels a, Channels b)
+    {
+        return _mm_add_epi32(a, b);
+    }
+
+    static Channels shr(Channels c, int n)
+    {
+        return _mm_srl_epi32(c, _mm_cvtsi32_si128(n));
+    }
+
+    static void store(Pixel* dptr, Channels c, bool opaque)
+    {
+        // the lowest byte of each lane
+        const __m128i bytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        uint p              = (uint)_mm_cvtsi128_si32(_mm_shuffle_epi8(c, bytes));
+
+        if (opaque)
+        {
+            p |= 0xFF000000;
+        }
+
+        *dptr = p;
+    }
+};
+
+/** 16 bit: the channels of a pixel in four 64 bit lanes
+ */
+class OpsAVX2_16
+{
+public:
+
+    typedef ullong  Pixel;
+    typedef __m256i Channels;
+    typedef __m256i Weight;
+
+    static Pixel** ypoints(DImgScaleInfo* isi)
+    {
+        return isi->ypoints16;
+    }
+
+    static Channels load(const Pixel* pix)
+    {
+        return _mm256_cvtepu16_epi64(_mm_loadl_epi64((const __m128i*)pix));
+    }
+
+    static Weight weight(int w)
+    {
+        return _mm256_set1_epi32(w);
+    }
+
+    /// The channel values are below 2^32, the upper halves of the lanes are ignored
+    static Channels mul(Channels c, Weight w)
+    {
+        return _mm256_mul_epu32(c, w);
+    }
+
+    static Channels mulWide(Channels c, Weight w)
+    {
+        return _mm256_mul_epu32(c, w);
+    }
+
+    static Channels add(Channels a, Channels b)
+    {
+        return _mm256_add_epi64(a, b);
+    }
+
+    static Channels shr(Channels c, int n)
+    {
+        return _mm256_srl_epi64(c, _mm_cvtsi32_si128(n));
+    }
+
+    static void store(Pixel* dptr, Channels c, bool opaque)
+    {
+        // the lower 32 bit of the four lanes, then their lower 16 bit
+        const __m256i dwords = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+        const __m128i words  = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+        __m128i p            = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(c, dwords));
+        p                    = _mm_shuffle_epi8(p, words);
+
+        if (opaque)
+        {
+            p = _mm_or_si128(p, _mm_set_epi16(0, 0, 0, 0, -1, 0, 0, 0));
+        }
+
+        _mm_storel_epi64((__m128i*)dptr, p);
+    }
+};
+
+} // namespace
+
+void dimgScaleAARGBA_AVX2(DImgScaleInfo* isi, uint* dest,
+                          int dxx, int dyy, int, int, int dow, int sow,
+                          int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    dimgScaleAA<OpsAVX2>(isi, dest, dxx, dyy, dow, sow, clip_dx, clip_dy, clip_dw, clip_dh, false);
+}
+
+void dimgScaleAARGB_AVX2(DImgScaleInfo* isi, uint* dest,
+                         int dxx, int dyy, int, int, int dow, int sow,
+                         int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    dimgScaleAA<OpsAVX2>(isi, dest, dxx, dyy, dow, sow, clip_dx, clip_dy, clip_dw, clip_dh, true);
+}
+
+void dimgScaleAARGBA16_AVX2(DImgScaleInfo* isi, ullong* dest,
+                            int dxx, int dyy, int, int, int dow, int sow,
+                            int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    dimgScaleAA<OpsAVX2_16>(isi, dest, dxx, dyy, dow, sow, clip_dx, clip_dy, clip_dw, clip_dh, false);
+}
+
+void dimgScaleAARGB16_AVX2(DImgScaleInfo* isi, ullong* dest,
+                           int dxx, int dyy, int, int, int dow, int sow,
+                           int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    dimgScaleAA<OpsAVX2_16>(isi, dest, dxx, dyy, dow, sow, clip_dx, clip_dy, clip_dw, clip_dh, true);
+}
+
+}  // namespace DImgScale
+
+}  // namespace Digikam
+
+#endif // HAVE_AVX2
@@ -0,0 +1,238 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-27
+ * Description : Area sampling scaling of DImg, SSE2 code path
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "dimgscale.h"
+
+// Local includes
+
+#include "config-digikam.h"
+
+#ifdef HAVE_SSE2
+
+// C++ includes
+
+#include <emmintrin.h>
+
+// Local includes
+
+#include "dimgscaleaa_p.h"
+
+namespace Digikam
+{
+
+namespace DImgScale
+{
+
+namespace
+{
+
+/** 8 bit: the channels of a pixel in four 32 bit lanes.
+ *  SSE2 has no 32 bit multiplication. The upper halves of the lanes are zero,
+ *  so a 16 bit multiply-add computes the product, or it is put together from 16 bit halves.
+ */
+class OpsSSE2
+{
+public:
+
+    typedef uint    Pixel;
+    typedef __m128i Channels;
+    typedef __m128i Weight;
+
+    static Pixel** ypoints(DImgScaleInfo* isi)
+    {
+        return isi->ypoints;
+    }
+
+    static Channels load(const Pixel* pix)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i c          = _mm_cvtsi32_si128((int)*pix);
+        c                  = _mm_unpacklo_epi8(c, zero);
+        return _mm_unpacklo_epi16(c, zero);
+    }
+
+    static Weight weight(int w)
+    {
+        return _mm_set1_epi32(w);
+    }
+
+    /// Both factors are below 2^15
+    static Channels mul(Channels c, Weight w)
+    {
+        return _mm_madd_epi16(c, w);
+    }
+
+    /// Both factors are below 2^16
+    static Channels mulWide(Channels c, Weight w)
+    {
+        const __m128i low  = _mm_mullo_epi16(c, w);
+        const __m128i high = _mm_mulhi_epu16(c, w);
+        return _mm_or_si128(low, _mm_slli_epi32(high, 16));
+    }
+
+    static Channels add(Channels a, Channels b)
+    {
+        return _mm_add_epi32(a, b);
+    }
+
+    static Channels shr(Channels c, int n)
+    {
+        return _mm_srl_epi32(c, _mm_cvtsi32_si128(n));
+    }
+
+    static void store(Pixel* dptr, Channels c, bool opaque)
+    {
+        c       = _mm_and_si128(c, _mm_set1_epi32(0xFF));
+        c       = _mm_packs_epi32(c, c);
+        c       = _mm_packus_epi16(c, c);
+        uint p  = (uint)_mm_cvtsi128_si32(c);
+
+        if (opaque)
+        {
+            p |= 0xFF000000;
+        }
+
+        *dptr = p;
+    }
+};
+
+/** 16 bit: the channels of a pixel in 64 bit lanes of two registers
+ */
+class OpsSSE2_16
+{
+public:
+
+    typedef ullong  Pixel;
+    typedef __m128i Weight;
+
+    class Channels
+    {
+    public:
+
+        __m128i bg;
+        __m128i ra;
+    };
+
+    static Pixel** ypoints(DImgScaleInfo* isi)
+    {
+        return isi->ypoints16;
+    }
+
+    static Channels load(const Pixel* pix)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i p          = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)pix), zero);
+        Channels c;
+        c.bg               = _mm_unpacklo_epi32(p, zero);
+        c.ra               = _mm_unpackhi_epi32(p, zero);
+        return c;
+    }
+
+    static Weight weight(int w)
+    {
+        return _mm_set1_epi32(w);
+    }
+
+    /// The channel values are below 2^32, the upper halves of the lanes are ignored
+    static Channels mul(const Channels& c, Weight w)
+    {
+        Channels p;
+        p.bg = _mm_mul_epu32(c.bg, w);
+        p.ra = _mm_mul_epu32(c.ra, w);
+        return p;
+    }
+
+    static Channels mulWide(const Channels& c, Weight w)
+    {
+        return mul(c, w);
+    }
+
+    static Channels add(const Channels& a, const Channels& b)
+    {
+        Channels s;
+        s.bg = _mm_add_epi64(a.bg, b.bg);
+        s.ra = _mm_add_epi64(a.ra, b.ra);
+        return s;
+    }
+
+    static Channels shr(const Channels& c, int n)
+    {
+        const __m128i count = _mm_cvtsi32_si128(n);
+        Channels s;
+        s.bg = _mm_srl_epi64(c.bg, count);
+        s.ra = _mm_srl_epi64(c.ra, count);
+        return s;
+    }
+
+    static void store(Pixel* dptr, const Channels& c, bool opaque)
+    {
+        // lower 32 bit of the four lanes, then the lower 16 bit, sign extended for the saturating pack
+        __m128i p = _mm_unpacklo_epi64(_mm_shuffle_epi32(c.bg, _MM_SHUFFLE(3, 1, 2, 0)),
+                                       _mm_shuffle_epi32(c.ra, _MM_SHUFFLE(3, 1, 2, 0)));
+        p         = _mm_srai_epi32(_mm_slli_epi32(p, 16), 16);
+        p         = _mm_packs_epi32(p, p);
+
+        if (opaque)
+        {
+            p = _mm_or_si128(p, _mm_set_epi16(0, 0, 0, 0, -1, 0, 0, 0));
+        }
+
+        _mm_storel_epi64((__m128i*)dptr, p);
+    }
+};
+
+} // namespace
+
+void dimgScaleAARGBA_SSE2(DImgScaleInfo* isi, uint* dest,
+                          int dxx, int dyy, int, int, int dow, int sow,
+                          int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    dimgScaleAA<OpsSSE2>(isi, dest, dxx, dyy, dow, sow, clip_dx, clip_dy, clip_dw, clip_dh, false);
+}
+
+void dimgScaleAARGB_SSE2(DImgScaleInfo* isi, uint* dest,
+                         int dxx, int dyy, int, int, int dow, int sow,
+                         int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    dimgScaleAA<OpsSSE2>(isi, dest, dxx, dyy, dow, sow, clip_dx, clip_dy, clip_dw, clip_dh, true);
+}
+
+void dimgScaleAARGBA16_SSE2(DImgScaleInfo* isi, ullong* dest,
+                            int dxx, int dyy, int, int, int dow, int sow,
+                            int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    dimgScaleAA<OpsSSE2_16>(isi, dest, dxx, dyy, dow, sow, clip_dx, clip_dy, clip_dw, clip_dh, false);
+}
+
+void dimgScaleAARGB16_SSE2(DImgScaleInfo* isi, ullong* dest,
+                           int dxx, int dyy, int, int, int dow, int sow,
+                           int clip_dx, int clip_dy, int clip_dw, int clip_dh)
+{
+    dimgScaleAA<OpsSSE2_16>(isi, dest, dxx, dyy, dow, sow, clip_dx, clip_dy, clip_dw, clip_dh, true);
+}
+
+}  // namespace DImgScale
+
+}  // namespace Digikam
+
+#endif // HAVE_SSE2
@@ -0,0 +1,272 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-27
+ * Description : Area sampling scaling of DImg, generic version
+ *               for the vectorized code paths
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef DIMGSCALEAA_P_H
+#define DIMGSCALEAA_P_H
+
+// Local includes
+
+#include "dimgscale.h"
+
+namespace Digikam
+{
+
+namespace DImgScale
+{
+
+/**
+ * The area sampling algorithm of dimgScaleAARGBA() and its 16 bit and RGB variants,
+ * with the four channels of a pixel computed at once.
+ *
+ * The instruction set is provided by the Ops class:
+ *
+ *  - Pixel:    uint or ullong, a pixel of the image
+ *  - Channels: the four channels of a pixel, unpacked to integers
+ *  - Weight:   a weight, as needed by mul()
+ *  - Pixel** ypoints(DImgScaleInfo*)
+ *  - Channels load(const Pixel*)
+ *  - Weight weight(int)
+ *  - Channels mul(Channels, Weight)
+ *  - Channels mulWide(Channels, Weight): the same as mul(), for the larger channel values
+ *    of the interpolation between two rows when scaling up both ways
+ *  - Channels add(Channels, Channels)
+ *  - Channels shr(Channels, int)
+ *  - void store(Pixel*, Channels, bool opaque): truncates each channel like an assignment
+ *    to uchar resp. ushort does. If opaque, the alpha channel is set to the maximum.
+ *
+ * All channel values and weights are positive. The weights are at most 2^14.
+ * For 8 bit images, the channel values passed to mul() are below 2^15, those passed
+ * to mulWide() below 2^16, and the products below 2^32. For 16 bit images, the channel
+ * values are below 2^32 and the products below 2^64. Each channel carries out the same
+ * integer operations as the scalar code, so the results are bit-identical.
+ * This header must only be included by the files of the code paths.
+ */
+template <class Ops>
+inline typename Ops::Channels dimgScaleAAAccumulate(const typename Ops::Pixel* pix, int step,
+                                                    int ap, int C, int shift)
+{
+    typename Ops::Channels c      = Ops::shr(Ops::mul(Ops::load(pix), Ops::weight(ap)), shift);
+    const typename Ops::Weight wc = Ops::weight(C);
+    int j;
+
+    for (j = (1 << 14) - ap; j > C; j -= C)
+    {
+        pix += step;
+        c   = Ops::add(c, Ops::shr(Ops::mul(Ops::load(pix), wc), shift));
+    }
+
+    if (j > 0)
+    {
+        pix += step;
+        c   = Ops::add(c, Ops::shr(Ops::mul(Ops::load(pix), Ops::weight(j)), shift));
+    }
+
+    return c;
+}
+
+template <class Ops>
+void dimgScaleAA(DImgScaleInfo* isi, typename Ops::Pixel* dest,
+                 int dxx, int dyy, int dow, int sow,
+                 int clip_dx, int clip_dy, int clip_dw, int clip_dh,
+                 bool opaque)
+{
+    typedef typename Ops::Pixel    Pixel;
+    typedef typename Ops::Channels Channels;
+    typedef typename Ops::Weight   Weight;
+
+    Pixel** ypoints = Ops::ypoints(isi);
+    int* xpoints    = isi->xpoints;
+    int* xapoints   = isi->xapoints;
+    int* yapoints   = isi->yapoints;
+
+    const int x_begin = dxx + clip_dx;     // no clip set = dxx
+    const int x_end   = x_begin + clip_dw; // no clip set = dxx + dw
+    const int y_begin = clip_dy;           // no clip set = 0
+    const int y_end   = clip_dy + clip_dh; // no clip set = dh
+
+    /* scaling up both ways */
+    if (isi->xup_yup == 3)
+    {
+        for (int y = y_begin; y < y_end; ++y)
+        {
+            Pixel* dptr       = dest + (y - y_begin) * dow;
+            const Pixel* sptr = ypoints[dyy + y];
+            const int yap     = yapoints[dyy + y];
+
+            if (yap > 0)
+            {
+                const Weight wy    = Ops::weight(yap);
+                const Weight invWy = Ops::weight(256 - yap);
+
+                for (int x = x_begin; x < x_end; ++x, ++dptr)
+                {
+                    const Pixel* pix = sptr + xpoints[x];
+                    const int xap    = xapoints[x];
+
+                    if (xap > 0)
+                    {
+                        const Weight wx    = Ops::weight(xap);
+                        const Weight invWx = Ops::weight(256 - xap);
+                        Channels top       = Ops::add(Ops::mul(Ops::load(pix),           invWx),
+                                                      Ops::mul(Ops::load(pix + 1),       wx));
+                        Channels bottom    = Ops::add(Ops::mul(Ops::load(pix + sow + 1), wx),
+                                                      Ops::mul(Ops::load(pix + sow),     invWx));
+                        Channels c         = Ops::add(Ops::mulWide(bottom, wy), Ops::mulWide(top, invWy));
+                        Ops::store(dptr, Ops::shr(c, 16), opaque);
+                    }
+                    else
+                    {
+                        Channels c = Ops::add(Ops::mul(Ops::load(pix), invWy), Ops::mul(Ops::load(pix + sow), wy));
+                        Ops::store(dptr, Ops::shr(c, 8), opaque);
+                    }
+                }
+            }
+            else
+            {
+                for (int x = x_begin; x < x_end; ++x, ++dptr)
+                {
+                    const Pixel* pix = sptr + xpoints[x];
+                    const int xap    = xapoints[x];
+
+                    if (xap > 0)
+                    {
+                        Channels c = Ops::add(Ops::mul(Ops::load(pix), Ops::weight(256 - xap)),
+                                              Ops::mul(Ops::load(pix + 1), Ops::weight(xap)));
+                        Ops::store(dptr, Ops::shr(c, 8), opaque);
+                    }
+                    else
+                    {
+                        *dptr = *pix;
+                    }
+                }
+            }
+        }
+    }
+    /* if we're scaling down vertically */
+    else if (isi->xup_yup == 1)
+    {
+        for (int y = y_begin; y < y_end; ++y)
+        {
+            const int Cy      = yapoints[dyy + y] >> 16;
+            const int yap     = yapoints[dyy + y] & 0xffff;
+            Pixel* dptr       = dest + (y - y_begin) * dow;
+            const Pixel* sptr = ypoints[dyy + y];
+
+            for (int x = x_begin; x < x_end; ++x, ++dptr)
+            {
+                const Pixel* pix = sptr + xpoints[x];
+                const int xap    = xapoints[x];
+                Channels c       = dimgScaleAAAccumulate<Ops>(pix, sow, yap, Cy, 10);
+
+                if (xap > 0)
+                {
+                    Channels cc = dimgScaleAAAccumulate<Ops>(pix + 1, sow, yap, Cy, 10);
+                    c           = Ops::shr(Ops::add(Ops::mul(c,  Ops::weight(256 - xap)),
+                                                    Ops::mul(cc, Ops::weight(xap))), 12);
+                }
+                else
+                {
+                    c = Ops::shr(c, 4);
+                }
+
+                Ops::store(dptr, c, opaque);
+            }
+        }
+    }
+    /* if we're scaling down horizontally */
+    else if (isi->xup_yup == 2)
+    {
+        for (int y = y_begin; y < y_end; ++y)
+        {
+            const int yap     = yapoints[dyy + y];
+            Pixel* dptr       = dest + (y - y_begin) * dow;
+            const Pixel* sptr = ypoints[dyy + y];
+
+            for (int x = x_begin; x < x_end; ++x, ++dptr)
+            {
+                const int Cx     = xapoints[x] >> 16;
+                const int xap    = xapoints[x] & 0xffff;
+                const Pixel* pix = sptr + xpoints[x];
+                Channels c       = dimgScaleAAAccumulate<Ops>(pix, 1, xap, Cx, 10);
+
+                if (yap > 0)
+                {
+                    Channels cc = dimgScaleAAAccumulate<Ops>(pix + sow, 1, xap, Cx, 10);
+                    c           = Ops::shr(Ops::add(Ops::mul(c,  Ops::weight(256 - yap)),
+                                                    Ops::mul(cc, Ops::weight(yap))), 12);
+                }
+                else
+                {
+                    c = Ops::shr(c, 4);
+                }
+
+                Ops::store(dptr, c, opaque);
+            }
+        }
+    }
+    /* if we're scaling down horizontally & vertically */
+    else
+    {
+        for (int y = y_begin; y < y_end; ++y)
+        {
+            const int Cy    = yapoints[dyy + y] >> 16;
+            const int yap   = yapoints[dyy + y] & 0xffff;
+            const Weight wy = Ops::weight(yap);
+            const Weight wc = Ops::weight(Cy);
+            Pixel* dptr     = dest + (y - y_begin) * dow;
+
+            for (int x = x_begin; x < x_end; ++x, ++dptr)
+            {
+                const int Cx      = xapoints[x] >> 16;
+                const int xap     = xapoints[x] & 0xffff;
+                const Pixel* sptr = ypoints[dyy + y] + xpoints[x];
+                Channels rx       = dimgScaleAAAccumulate<Ops>(sptr, 1, xap, Cx, 9);
+                Channels c        = Ops::shr(Ops::mul(rx, wy), 14);
+                int j;
+
+                for (j = (1 << 14) - yap; j > Cy; j -= Cy)
+                {
+                    sptr += sow;
+                    rx   = dimgScaleAAAccumulate<Ops>(sptr, 1, xap, Cx, 9);
+                    c    = Ops::add(c, Ops::shr(Ops::mul(rx, wc), 14));
+                }
+
+                if (j > 0)
+                {
+                    sptr += sow;
+                    rx   = dimgScaleAAAccumulate<Ops>(sptr, 1, xap, Cx, 9);
+                    c    = Ops::add(c, Ops::shr(Ops::mul(rx, Ops::weight(j)), 14));
+                }
+
+                Ops::store(dptr, Ops::shr(c, 5), opaque);
+            }
+        }
+    }
+}
+
+}  // namespace DImgScale
+
+}  // namespace Digikam
+
+#endif // DIMGSCALEAA_P_H
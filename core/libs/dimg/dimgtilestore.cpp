@@ -0,0 +1,422 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-29
+ * Description : tiled pixel store of DImg for very large images
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "dimgtilestore.h"
+
+// C++ includes
+
+#include <cstring>
+
+// Qt includes
+
+#include <QBitArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QVector>
+
+// KDE includes
+
+#include <kdebug.h>
+#include <kglobal.h>
+#include <kstandarddirs.h>
+#include <ktemporaryfile.h>
+
+namespace Digikam
+{
+
+static qint64 tileStoreResidentLimit = 256 * 1024 * 1024;
+
+K_GLOBAL_STATIC(QString, tileStoreScratchDirectory)
+K_GLOBAL_STATIC(QMutex,  tileStoreScratchDirectoryMutex)
+
+class DImgTileStore::DImgTileStorePriv
+{
+public:
+
+    DImgTileStorePriv(uint width, uint height, int bytesDepth)
+        : width(width),
+          height(height),
+          bytesDepth(bytesDepth),
+          tilesX((width  + TileSize - 1) / TileSize),
+          tilesY((height + TileSize - 1) / TileSize),
+          tileLineLength(TileSize * bytesDepth),
+          tileBytes(TileSize * TileSize * bytesDepth),
+          tiles(tilesX * tilesY, 0),
+          spilled(tilesX * tilesY),
+          spilledCount(0),
+          scratch(0),
+          scratchData(0),
+          scratchFailed(false)
+    {
+    }
+
+    ~DImgTileStorePriv()
+    {
+        releaseTiles();
+    }
+
+    /// Returns the tile, or 0 if it was never written and create is false
+    uchar* tile(int index, bool create);
+    void   spillTiles();
+    bool   openScratchFile();
+    void   releaseTiles();
+
+    /**
+     * Calls copy(tilePointer, tileLineLength, rectPointer, lineLength, bytes)
+     * for each line of each part of rect lying in one tile.
+     */
+    template <class Copy>
+    void forTilesIn(const QRect& rect, uchar* pixels, int lineLength, bool create, Copy copy);
+
+public:
+
+    const uint       width;
+    const uint       height;
+    const int        bytesDepth;
+    const int        tilesX;
+    const int        tilesY;
+    const int        tileLineLength;
+    const int        tileBytes;
+
+    QVector<uchar*>  tiles;
+    QBitArray        spilled;
+    QQueue<int>      residentQueue;
+    int              spilledCount;
+
+    KTemporaryFile*  scratch;
+    uchar*           scratchData;
+    bool             scratchFailed;
+
+    QMutex           mutex;
+};
+
+uchar* DImgTileStore::DImgTileStorePriv::tile(int index, bool create)
+{
+    if (tiles[index] || !create)
+    {
+        return tiles[index];
+    }
+
+    uchar* data = new uchar[tileBytes];
+    memset(data, 0, tileBytes);
+    tiles[index] = data;
+    residentQueue.enqueue(index);
+
+    spillTiles();
+
+    return tiles[index];
+}
+
+void DImgTileStore::DImgTileStorePriv::spillTiles()
+{
+    const qint64 limit = tileStoreResidentLimit;
+
+    if (limit <= 0 || scratchFailed)
+    {
+        return;
+    }
+
+    // Keep the newest tile in memory, it is about to be used
+    while (residentQueue.size() > 1 && (qint64)residentQueue.size() * tileBytes > limit)
+    {
+        if (!scratchData && !openScratchFile())
+        {
+            return;
+        }
+
+        const int index   = residentQueue.dequeue();
+        uchar* const slot = scratchData + (qint64)index * tileBytes;
+
+        memcpy(slot, tiles[index], tileBytes);
+        delete [] tiles[index];
+        tiles[index]      = slot;
+        spilled.setBit(index);
+        ++spilledCount;
+    }
+}
+
+bool DImgTileStore::DImgTileStorePriv::openScratchFile()
+{
+    // One slot per tile. The file is sparse, only spilled tiles take disk space.
+    const qint64 size = (qint64)tiles.size() * tileBytes;
+    scratch           = new KTemporaryFile;
+    scratch->setPrefix(scratchDirectory() + "digikam-tiles-");
+
+    if (scratch->open() && scratch->resize(size))
+    {
+        scratchData = scratch->map(0, size);
+    }
+
+    if (!scratchData)
+    {
+        kWarning() << "Cannot map a scratch file of" << size << "bytes, keeping all tiles in memory:"
+                   << scratch->errorString();
+        delete scratch;
+        scratch       = 0;
+        scratchFailed = true;
+        return false;
+    }
+
+    return true;
+}
+
+void DImgTileStore::DImgTileStorePriv::releaseTiles()
+{
+    for (int i = 0; i < tiles.size(); ++i)
+    {
+        if (!spilled.testBit(i))
+        {
+            delete [] tiles[i];
+        }
+
+        tiles[i] = 0;
+    }
+
+    spilled.fill(false);
+    residentQueue.clear();
+    spilledCount = 0;
+
+    // removes the file and its mapping
+    delete scratch;
+    scratch     = 0;
+    scratchData = 0;
+}
+
+template <class Copy>
+void DImgTileStore::DImgTileStorePriv::forTilesIn(const QRect& rect, uchar* pixels, int lineLength,
+                                                  bool create, Copy copy)
+{
+    const int firstTileY = rect.top()    / TileSize;
+    const int lastTileY  = rect.bottom() / TileSize;
+    const int firstTileX = rect.left()   / TileSize;
+    const int lastTileX  = rect.right()  / TileSize;
+
+    for (int ty = firstTileY; ty <= lastTileY; ++ty)
+    {
+        for (int tx = firstTileX; tx <= lastTileX; ++tx)
+        {
+            const QRect part = rect & QRect(tx * TileSize, ty * TileSize, TileSize, TileSize);
+            uchar* data      = tile(ty * tilesX + tx, create);
+            const int bytes  = part.width() * bytesDepth;
+            uchar* rectPtr   = pixels + (part.top() - rect.top()) * lineLength +
+                               (part.left() - rect.left()) * bytesDepth;
+            uchar* tilePtr   = data ? data + (part.top() - ty * TileSize) * tileLineLength +
+                                            (part.left() - tx * TileSize) * bytesDepth
+                                    : 0;
+
+            for (int y = 0; y < part.height(); ++y)
+            {
+                copy(tilePtr, rectPtr, bytes);
+                rectPtr += lineLength;
+
+                if (tilePtr)
+                {
+                    tilePtr += tileLineLength;
+                }
+            }
+        }
+    }
+}
+
+namespace
+{
+
+class ReadFromTile
+{
+public:
+
+    void operator()(const uchar* tile, uchar* rect, int bytes) const
+    {
+        if (tile)
+        {
+            memcpy(rect, tile, bytes);
+        }
+        else
+        {
+            memset(rect, 0, bytes);
+        }
+    }
+};
+
+class WriteToTile
+{
+public:
+
+    void operator()(uchar* tile, const uchar* rect, int bytes) const
+    {
+        memcpy(tile, rect, bytes);
+    }
+};
+
+} // namespace
+
+// --------------------------------------------------------------------------------------------------------
+
+DImgTileStore::DImgTileStore(uint width, uint height, int bytesDepth)
+    : d(new DImgTileStorePriv(width, height, bytesDepth))
+{
+}
+
+DImgTileStore::~DImgTileStore()
+{
+    delete d;
+}
+
+uint DImgTileStore::width() const
+{
+    return d->width;
+}
+
+uint DImgTileStore::height() const
+{
+    return d->height;
+}
+
+int DImgTileStore::bytesDepth() const
+{
+    return d->bytesDepth;
+}
+
+void DImgTileStore::readRegion(const QRect& rect, uchar* dest, int lineLength) const
+{
+    if (rect.isEmpty())
+    {
+        return;
+    }
+
+    QMutexLocker lock(&d->mutex);
+    d->forTilesIn(rect, dest, lineLength, false, ReadFromTile());
+}
+
+void DImgTileStore::writeRegion(const QRect& rect, const uchar* src, int lineLength)
+{
+    if (rect.isEmpty())
+    {
+        return;
+    }
+
+    QMutexLocker lock(&d->mutex);
+    // WriteToTile only reads from the rect
+    d->forTilesIn(rect, const_cast<uchar*>(src), lineLength, true, WriteToTile());
+}
+
+void DImgTileStore::moveAllTo(uchar* dest)
+{
+    QMutexLocker lock(&d->mutex);
+
+    const int lineLength = d->width * d->bytesDepth;
+
+    for (int ty = 0; ty < d->tilesY; ++ty)
+    {
+        for (int tx = 0; tx < d->tilesX; ++tx)
+        {
+            const int index  = ty * d->tilesX + tx;
+            const QRect part = QRect(tx * TileSize, ty * TileSize, TileSize, TileSize) &
+                               QRect(0, 0, d->width, d->height);
+
+            d->forTilesIn(part, dest + part.top() * lineLength + part.left() * d->bytesDepth,
+                          lineLength, false, ReadFromTile());
+
+            // Release as we go, so that the memory is not needed twice
+            if (!d->spilled.testBit(index))
+            {
+                delete [] d->tiles[index];
+            }
+
+            d->tiles[index] = 0;
+        }
+    }
+
+    d->releaseTiles();
+}
+
+DImgTileStore* DImgTileStore::copy() const
+{
+    QMutexLocker lock(&d->mutex);
+
+    DImgTileStore* store = new DImgTileStore(d->width, d->height, d->bytesDepth);
+
+    for (int i = 0; i < d->tiles.size(); ++i)
+    {
+        if (d->tiles[i])
+        {
+            // the new store is not yet shared, no need to lock it
+            memcpy(store->d->tile(i, true), d->tiles[i], d->tileBytes);
+        }
+    }
+
+    return store;
+}
+
+int DImgTileStore::residentTiles() const
+{
+    QMutexLocker lock(&d->mutex);
+    return d->residentQueue.size();
+}
+
+int DImgTileStore::spilledTiles() const
+{
+    QMutexLocker lock(&d->mutex);
+    return d->spilledCount;
+}
+
+void DImgTileStore::setResidentLimit(qint64 bytes)
+{
+    tileStoreResidentLimit = bytes;
+}
+
+qint64 DImgTileStore::residentLimit()
+{
+    return tileStoreResidentLimit;
+}
+
+void DImgTileStore::setScratchDirectory(const QString& path)
+{
+    QMutexLocker lock(tileStoreScratchDirectoryMutex);
+
+    if (path.isEmpty() || path.endsWith('/'))
+    {
+        *tileStoreScratchDirectory = path;
+    }
+    else
+    {
+        *tileStoreScratchDirectory = path + '/';
+    }
+}
+
+QString DImgTileStore::scratchDirectory()
+{
+    QMutexLocker lock(tileStoreScratchDirectoryMutex);
+
+    if (tileStoreScratchDirectory->isEmpty())
+    {
+        // The temp dir is often a tmpfs in memory, which would defeat moving tiles out of memory.
+        // The cache dir is on disk, and is not backed up.
+        *tileStoreScratchDirectory = KStandardDirs::locateLocal("cache", "digikam/");
+    }
+
+    return *tileStoreScratchDirectory;
+}
+
+}  // namespace Digikam
@@ -0,0 +1,118 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-29
+ * Description : tiled pixel store of DImg for very large images
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef DIMGTILESTORE_H
+#define DIMGTILESTORE_H
+
+// Qt includes
+
+#include <QtCore/QRect>
+#include <QtCore/QString>
+
+// Local includes
+
+#include "digikam_export.h"
+
+namespace Digikam
+{
+
+/**
+ * Keeps the pixels of an image in square tiles instead of one contiguous buffer.
+ *
+ * A tile is allocated when it is first written to; tiles which were never written
+ * read as zero. When the tiles of a store take more memory than residentLimit(),
+ * the oldest tiles are moved to a memory-mapped scratch file, from where the
+ * operating system pages them in on demand.
+ *
+ * The layout of the pixels is that of DImg. No pointers into the tiles are handed out,
+ * pixels are copied in and out by rectangles. All methods are thread-safe.
+ */
+class DIGIKAM_EXPORT DImgTileStore
+{
+public:
+
+    /// Width and height of a tile in pixels
+    enum { TileSize = 256 };
+
+    DImgTileStore(uint width, uint height, int bytesDepth);
+    ~DImgTileStore();
+
+    uint width()      const;
+    uint height()     const;
+    int  bytesDepth() const;
+
+    /**
+     * Copies the pixels of rect, which must lie inside the image, to dest.
+     * The lines of dest are lineLength bytes apart.
+     */
+    void readRegion(const QRect& rect, uchar* dest, int lineLength) const;
+
+    /**
+     * Copies the pixels from src to rect, which must lie inside the image.
+     * The lines of src are lineLength bytes apart.
+     */
+    void writeRegion(const QRect& rect, const uchar* src, int lineLength);
+
+    /**
+     * Copies all pixels to dest, a buffer of the size of the image,
+     * releasing each tile after it was copied. The store is empty afterwards.
+     */
+    void moveAllTo(uchar* dest);
+
+    /// Returns a deep copy of this store
+    DImgTileStore* copy() const;
+
+    /// The number of tiles held in memory resp. in the scratch file
+    int residentTiles() const;
+    int spilledTiles()  const;
+
+    /**
+     * The number of bytes the tiles of one store may take in memory
+     * before tiles are moved to the scratch file. 0 disables moving tiles.
+     */
+    static void   setResidentLimit(qint64 bytes);
+    static qint64 residentLimit();
+
+    /**
+     * The directory of the scratch files. It should be on a disk, not on a tmpfs.
+     * Default is the digikam directory in the user's cache directory.
+     * Applies to scratch files created afterwards.
+     */
+    static void    setScratchDirectory(const QString& path);
+    static QString scratchDirectory();
+
+private:
+
+    // Disable
+    DImgTileStore(const DImgTileStore&);
+    DImgTileStore& operator=(const DImgTileStore&);
+
+private:
+
+    class DImgTileStorePriv;
+    DImgTileStorePriv* const d;
+};
+
+}  // namespace Digikam
+
+#endif /* DIMGTILESTORE_H */
@@ -144,7 +144,9 @@ void BCGFilter::filterImage()
     setGamma(d->settings.gamma);
     setBrightness(d->settings.brightness);
     setContrast(d->settings.contrast);
-    applyBCG(m_orgImage);
+
+    // the image is changed in place
+    processRowBands();
     m_destImage = m_orgImage;
 }
 
@@ -208,31 +210,16 @@ void BCGFilter::reset()
     }
 }
 
-void BCGFilter::applyBCG(DImg& image)
+void BCGFilter::filterRows(int start, int stop, int, int)
 {
-    if (image.isNull())
-    {
-        return;
-    }
+    const int width = m_orgImage.width();
 
-    applyBCG(image.bits(), image.width(), image.height(), image.sixteenBit());
-}
-
-void BCGFilter::applyBCG(uchar* bits, uint width, uint height, bool sixteenBits)
-{
-    if (!bits)
+    if (!m_orgImage.sixteenBit())                    // 8 bits image.
     {
-        return;
-    }
-
-    uint size = width*height;
-    int  progress;
+        uchar* data = m_orgImage.scanLine(start);
+        uchar* end  = m_orgImage.scanLine(stop - 1) + width * 4;
 
-    if (!sixteenBits)                    // 8 bits image.
-    {
-        uchar* data = bits;
-
-        for (uint i=0; runningFlag() && (i<size); ++i)
+        for (; data < end; data += 4)
         {
             switch (d->settings.channel)
             {
@@ -254,22 +241,14 @@ void BCGFilter::applyBCG(uchar* bits, uint width, uint height, bool sixteenBits)
                     data[2] = CLAMP0255(d->map[data[2]]);
                     break;
             }
-
-            data += 4;
-
-            progress = (int)(((double)i * 100.0) / size);
-
-            if ( progress%5 == 0 )
-            {
-                postProgress( progress );
-            }
         }
     }
     else                                        // 16 bits image.
     {
-        ushort* data = (ushort*)bits;
+        ushort* data = (ushort*)m_orgImage.scanLine(start);
+        ushort* end  = (ushort*)m_orgImage.scanLine(stop - 1) + width * 4;
 
-        for (uint i=0; runningFlag() && (i<size); ++i)
+        for (; data < end; data += 4)
         {
             switch (d->settings.channel)
             {
@@ -291,18 +270,8 @@ void BCGFilter::applyBCG(uchar* bits, uint width, uint height, bool sixteenBits)
                     data[2] = CLAMP065535(d->map16[data[2]]);
                     break;
             }
-
-            data += 4;
-
-            progress = (int)(((double)i * 100.0) / size);
-
-            if ( progress%5 == 0 )
-            {
-                postProgress( progress );
-            }
         }
     }
-
 }
 
 }  // namespace Digikam
@@ -82,8 +82,7 @@ private:
     void setGamma(double val);
     void setBrightness(double val);
     void setContrast(double val);
-    void applyBCG(DImg& image);
-    void applyBCG(uchar* bits, uint width, uint height, bool sixteenBits);
+    void filterRows(int start, int stop, int haloStart, int haloStop);
 
 private:
 
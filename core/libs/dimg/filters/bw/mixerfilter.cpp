@@ -63,13 +63,16 @@ void MixerFilter::filterImage()
 {
     m_destImage.putImageData(m_orgImage.bits());
 
-    uchar* bits     = m_destImage.bits();
-    uint width      = m_destImage.width();
-    uint height     = m_destImage.height();
+    // the destination image is changed in place
+    processRowBands();
+}
+
+void MixerFilter::filterRows(int start, int stop, int, int)
+{
+    uchar* bits     = m_destImage.scanLine(start);
     bool sixteenBit = m_destImage.sixteenBit();
 
-    uint size = width*height;
-    int  progress;
+    uint size = (uint)((stop - start) * m_destImage.width());
 
     register uint i;
 
@@ -112,13 +115,6 @@ void MixerFilter::filterImage()
             }
 
             ptr += 4;
-
-            progress = (int)(((double)i * 100.0) / size);
-
-            if ( progress%5 == 0 )
-            {
-                postProgress( progress );
-            }
         }
     }
     else               // 16 bits image.
@@ -149,13 +145,6 @@ void MixerFilter::filterImage()
             }
 
             ptr += 4;
-
-            progress = (int)(((double)i * 100.0) / size);
-
-            if ( progress%5 == 0 )
-            {
-                postProgress( progress );
-            }
         }
     }
 }
@@ -121,6 +121,7 @@ public:
 private:
 
     void filterImage();
+    void filterRows(int start, int stop, int haloStart, int haloStop);
 
     inline double CalculateNorm(double RedGain, double GreenGain, double BlueGain, bool bPreserveLum);
 
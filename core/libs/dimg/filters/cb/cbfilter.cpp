@@ -85,7 +85,10 @@ CBFilter::~CBFilter()
 void CBFilter::filterImage()
 {
     setGamma(d->settings.gamma);
-    applyCBFilter(m_orgImage, d->settings.red, d->settings.green, d->settings.blue, d->settings.alpha);
+    adjustRGB(d->settings.red, d->settings.green, d->settings.blue, d->settings.alpha, m_orgImage.sixteenBit());
+
+    // the image is changed in place
+    processRowBands();
     m_destImage = m_orgImage;
 }
 
@@ -212,58 +215,34 @@ void CBFilter::getTables(int* redMap, int* greenMap, int* blueMap, int* alphaMap
     }
 }
 
-void CBFilter::applyCBFilter(DImg& image, double r, double g, double b, double a)
+void CBFilter::filterRows(int start, int stop, int, int)
 {
-    if (image.isNull())
-    {
-        return;
-    }
-
-    uint size = image.width()*image.height();
-    int  progress;
+    const int width = m_orgImage.width();
 
-    adjustRGB(r, g, b, a, image.sixteenBit());
-
-    if (!image.sixteenBit())                    // 8 bits image.
+    if (!m_orgImage.sixteenBit())                    // 8 bits image.
     {
-        uchar* data = (uchar*) image.bits();
+        uchar* data = m_orgImage.scanLine(start);
+        uchar* end  = m_orgImage.scanLine(stop - 1) + width * 4;
 
-        for (uint i=0; runningFlag() && (i<size); ++i)
+        for (; data < end; data += 4)
         {
             data[0] = d->blueMap[data[0]];
             data[1] = d->greenMap[data[1]];
             data[2] = d->redMap[data[2]];
             data[3] = d->alphaMap[data[3]];
-
-            data += 4;
-
-            progress = (int)(((double)i * 100.0) / size);
-
-            if ( progress%5 == 0 )
-            {
-                postProgress( progress );
-            }
         }
     }
     else                                        // 16 bits image.
     {
-        ushort* data = (ushort*) image.bits();
+        ushort* data = (ushort*)m_orgImage.scanLine(start);
+        ushort* end  = (ushort*)m_orgImage.scanLine(stop - 1) + width * 4;
 
-        for (uint i=0; runningFlag() && (i<size); ++i)
+        for (; data < end; data += 4)
         {
             data[0] = d->blueMap16[data[0]];
             data[1] = d->greenMap16[data[1]];
             data[2] = d->redMap16[data[2]];
             data[3] = d->alphaMap16[data[3]];
-
-            data += 4;
-
-            progress = (int)(((double)i * 100.0) / size);
-
-            if ( progress%5 == 0 )
-            {
-                postProgress( progress );
-            }
         }
     }
 }
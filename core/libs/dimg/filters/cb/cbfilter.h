@@ -108,7 +108,7 @@ private:
     void setTables(int* redMap, int* greenMap, int* blueMap, int* alphaMap, bool sixteenBit);
     void getTables(int* redMap, int* greenMap, int* blueMap, int* alphaMap, bool sixteenBit);
     void adjustRGB(double r, double g, double b, double a, bool sixteenBit);
-    void applyCBFilter(DImg& image, double r, double g, double b, double a);
+    void filterRows(int start, int stop, int haloStart, int haloStop);
 
 private:
 
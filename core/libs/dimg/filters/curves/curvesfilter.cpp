@@ -36,13 +36,15 @@ namespace Digikam
 {
 
 CurvesFilter::CurvesFilter(QObject* parent)
-    : DImgThreadedFilter(parent)
+    : DImgThreadedFilter(parent),
+      m_curves(0)
 {
     initFilter();
 }
 
 CurvesFilter::CurvesFilter(DImg* orgImage, QObject* parent, const CurvesContainer& settings)
-    : DImgThreadedFilter(orgImage, parent, "CurvesFilter")
+    : DImgThreadedFilter(orgImage, parent, "CurvesFilter"),
+      m_curves(0)
 {
     m_settings = settings;
     initFilter();
@@ -50,7 +52,8 @@ CurvesFilter::CurvesFilter(DImg* orgImage, QObject* parent, const CurvesContaine
 
 CurvesFilter::CurvesFilter(const CurvesContainer& settings, DImgThreadedFilter* master,
                            const DImg& orgImage, DImg& destImage, int progressBegin, int progressEnd)
-    : DImgThreadedFilter(master, orgImage, destImage, progressBegin, progressEnd, "CurvesFilter")
+    : DImgThreadedFilter(master, orgImage, destImage, progressBegin, progressEnd, "CurvesFilter"),
+      m_curves(0)
 {
     m_settings = settings;
 
@@ -83,8 +86,15 @@ void CurvesFilter::filterImage()
     curves.curvesLutSetup(AlphaChannel);
     postProgress(75);
 
-    curves.curvesLutProcess(m_orgImage.bits(), m_destImage.bits(), m_orgImage.width(), m_orgImage.height());
-    postProgress(100);
+    m_curves = &curves;
+    processRowBands(75, 100);
+    m_curves = 0;
+}
+
+void CurvesFilter::filterRows(int start, int stop, int, int)
+{
+    m_curves->curvesLutProcess(m_orgImage.scanLine(start), m_destImage.scanLine(start),
+                               m_orgImage.width(), stop - start);
 }
 
 FilterAction CurvesFilter::filterAction()
@@ -81,10 +81,13 @@ public:
 private:
 
     void filterImage();
+    void filterRows(int start, int stop, int haloStart, int haloStop);
 
 private:
 
     CurvesContainer m_settings;
+    /// only valid during filterImage()
+    ImageCurves*    m_curves;
 };
 
 }  // namespace Digikam
@@ -32,9 +32,60 @@
 
 #include <kdebug.h>
 
+// Local includes
+
+#include "parallelbands.h"
+
 namespace Digikam
 {
 
+/**
+ * The bands of rows of a processRowBands() computation.
+ * Enough bands per thread to balance the load and to post smooth progress.
+ */
+class DImgThreadedFilterRowBands : public ParallelBands
+{
+public:
+
+    DImgThreadedFilterRowBands(DImgThreadedFilter* filter, int height, int haloRows,
+                               int progressBegin, int progressEnd)
+        : ParallelBands(height, ParallelBands::bandSize(height, 8, 64)),
+          filter(filter),
+          haloRows(haloRows),
+          progressBegin(progressBegin),
+          progressEnd(progressEnd)
+    {
+    }
+
+protected:
+
+    virtual void processBand(int start, int stop, int)
+    {
+        if (!filter->runningFlag())
+        {
+            cancel();
+            return;
+        }
+
+        filter->filterRows(start, stop, qMax(0, start - haloRows), qMin(count(), stop + haloRows));
+    }
+
+    /// The calling thread posts the progress of all threads
+    virtual void bandProcessed()
+    {
+        filter->postProgress(progressBegin + (int)((qint64)(progressEnd - progressBegin) * doneItems() / count()));
+    }
+
+private:
+
+    DImgThreadedFilter* const filter;
+    const int                 haloRows;
+    const int                 progressBegin;
+    const int                 progressEnd;
+};
+
+// ----------------------------------------------------------------------------------------
+
 DImgThreadedFilter::DImgThreadedFilter(QObject* parent, const QString& name)
     : DynamicThread(parent)
 {
@@ -244,6 +295,28 @@ void DImgThreadedFilter::postProgress(int progr)
     }
 }
 
+void DImgThreadedFilter::processRowBands(int progressBegin, int progressEnd, int haloRows)
+{
+    const int height = m_orgImage.height();
+
+    if (height <= 0)
+    {
+        return;
+    }
+
+    DImgThreadedFilterRowBands bands(this, height, haloRows, progressBegin, progressEnd);
+    bands.process();
+
+    if (runningFlag())
+    {
+        postProgress(progressEnd);
+    }
+}
+
+void DImgThreadedFilter::filterRows(int, int, int, int)
+{
+}
+
 void DImgThreadedFilter::setSlave(DImgThreadedFilter* slave)
 {
     m_slave = slave;
@@ -43,6 +43,8 @@ class QObject;
 namespace Digikam
 {
 
+class DImgThreadedFilterRowBands;
+
 class DIGIKAM_EXPORT DImgThreadedFilter : public DynamicThread
 {
     Q_OBJECT
@@ -156,6 +158,28 @@ protected:
     /** Emit progress info */
     void postProgress(int progress);
 
+    /**
+     * Support for filters computing the image in parallel, in bands of rows.
+     * Reimplement filterRows() and call processRowBands() from filterImage().
+     * The rows of the original image are divided in bands, which are computed
+     * by a pool of threads, the calling thread included.
+     * Progress is posted in the span from progressBegin to progressEnd,
+     * and computation stops as soon as runningFlag() returns false.
+     * A filter which needs neighbouring pixels passes the number of rows
+     * it needs above and below each row as haloRows.
+     */
+    void processRowBands(int progressBegin = 0, int progressEnd = 100, int haloRows = 0);
+
+    /**
+     * Compute the rows from start to stop (exclusive) for processRowBands().
+     * The rows from haloStart to haloStop (exclusive) are the band extended by the
+     * halo rows, clipped to the image. A neighbourhood filter may read these rows
+     * from the original image.
+     * Note: This method is called from several threads at the same time.
+     * Do not change any member variables, and do not post progress.
+     */
+    virtual void filterRows(int start, int stop, int haloStart, int haloStop);
+
 protected:
 
     /**
@@ -240,6 +264,10 @@ protected:
 
     /** The master of this slave filter. Progress info will be routed to this one. */
     DImgThreadedFilter* m_master;
+
+private:
+
+    friend class DImgThreadedFilterRowBands;
 };
 
 }  // namespace Digikam
@@ -60,32 +60,45 @@ void ColorFXFilter::filterImage()
     switch (m_colorFXType)
     {
         case Solarize:
-            solarize(&m_orgImage, &m_destImage, m_level);
+        case Neon:
+        case FindEdges:
+            processRowBands();
             break;
 
         case Vivid:
+            // the mixer and curves filters compute in parallel bands themselves
             vivid(&m_orgImage, &m_destImage, m_level);
             break;
+    }
+}
+
+void ColorFXFilter::filterRows(int start, int stop, int, int)
+{
+    switch (m_colorFXType)
+    {
+        case Solarize:
+            solarize(&m_orgImage, &m_destImage, m_level, start, stop);
+            break;
 
         case Neon:
-            neon(&m_orgImage, &m_destImage, m_level, m_iterations);
+            neon(&m_orgImage, &m_destImage, m_level, m_iterations, start, stop);
             break;
 
         case FindEdges:
-            findEdges(&m_orgImage, &m_destImage, m_level, m_iterations);
+            findEdges(&m_orgImage, &m_destImage, m_level, m_iterations, start, stop);
             break;
     }
 }
 
-void ColorFXFilter::solarize(DImg* orgImage, DImg* destImage, int factor)
+void ColorFXFilter::solarize(DImg* orgImage, DImg* destImage, int factor, int start, int stop)
 {
     bool stretch = true;
 
     int w             = orgImage->width();
-    int h             = orgImage->height();
-    const uchar* data = orgImage->bits();
+    int h             = stop - start;
+    const uchar* data = orgImage->scanLine(start);
     bool sb           = orgImage->sixteenBit();
-    uchar* pResBits   = destImage->bits();
+    uchar* pResBits   = destImage->scanLine(start);
 
     if (!sb)        // 8 bits image.
     {
@@ -243,9 +256,9 @@ void ColorFXFilter::vivid(DImg* orgImage, DImg* destImage, int factor)
  *                     like this on PSC. Is very similar to Growing Edges (photoshop)
  *                     Some pictures will be very interesting
  */
-void ColorFXFilter::neon(DImg* orgImage, DImg* destImage, int Intensity, int BW)
+void ColorFXFilter::neon(DImg* orgImage, DImg* destImage, int Intensity, int BW, int start, int stop)
 {
-    neonFindEdges(orgImage, destImage, true, Intensity, BW);
+    neonFindEdges(orgImage, destImage, true, Intensity, BW, start, stop);
 }
 
 /* Function to apply the Find Edges effect
@@ -260,9 +273,9 @@ void ColorFXFilter::neon(DImg* orgImage, DImg* destImage, int Intensity, int BW)
  *                     Neon effect ? This is the same engine, but is inversed with
  *                     255 - color.
  */
-void ColorFXFilter::findEdges(DImg* orgImage, DImg* destImage, int Intensity, int BW)
+void ColorFXFilter::findEdges(DImg* orgImage, DImg* destImage, int Intensity, int BW, int start, int stop)
 {
-    neonFindEdges(orgImage, destImage, false, Intensity, BW);
+    neonFindEdges(orgImage, destImage, false, Intensity, BW, start, stop);
 }
 
 static inline int getOffset(int Width, int X, int Y, int bytesDepth)
@@ -283,7 +296,10 @@ static inline int Lim_Max(int Now, int Up, int Max)
 }
 
 // Implementation of neon and FindEdges. They share 99% of their code.
-void ColorFXFilter::neonFindEdges(DImg* orgImage, DImg* destImage, bool neon, int Intensity, int BW)
+// A pixel is compared with the original values of the pixels right of and below it,
+// so the rows from start to stop can be computed independently of the others.
+void ColorFXFilter::neonFindEdges(DImg* orgImage, DImg* destImage, bool neon, int Intensity, int BW,
+                                  int start, int stop)
 {
     int Width         = orgImage->width();
     int Height        = orgImage->height();
@@ -295,31 +311,33 @@ void ColorFXFilter::neonFindEdges(DImg* orgImage, DImg* destImage, bool neon, in
     Intensity = (Intensity < 0) ? 0 : (Intensity > 5) ? 5 : Intensity;
     BW        = (BW < 1) ? 1 : (BW > 5) ? 5 : BW;
 
-    uchar* ptr, *ptr1, *ptr2;
+    uchar* ptr;
+    const uchar* ptr1, *ptr2;
 
     // these must be uint, we need full 2^32 range for 16 bit
     uint color_1, color_2, colorPoint, colorOther1, colorOther2;
 
     // initial copy
-    memcpy (pResBits, data, Width*Height*bytesDepth);
+    memcpy (pResBits + getOffset(Width, 0, start, bytesDepth), data + getOffset(Width, 0, start, bytesDepth),
+            Width*(stop-start)*bytesDepth);
 
     double intensityFactor = sqrt( 1 << Intensity );
 
-    for (int h = 0; h < Height; ++h)
+    for (int h = start; h < stop; ++h)
     {
         for (int w = 0; w < Width; ++w)
         {
             ptr  = pResBits + getOffset(Width, w, h, bytesDepth);
-            ptr1 = pResBits + getOffset(Width, w + Lim_Max (w, BW, Width), h, bytesDepth);
-            ptr2 = pResBits + getOffset(Width, w, h + Lim_Max (h, BW, Height), bytesDepth);
+            ptr1 = data + getOffset(Width, w + Lim_Max (w, BW, Width), h, bytesDepth);
+            ptr2 = data + getOffset(Width, w, h + Lim_Max (h, BW, Height), bytesDepth);
 
             if (sixteenBit)
             {
                 for (int k = 0; k <= 2; ++k)
                 {
                     colorPoint  = ((unsigned short*)ptr)[k];
-                    colorOther1 = ((unsigned short*)ptr1)[k];
-                    colorOther2 = ((unsigned short*)ptr2)[k];
+                    colorOther1 = ((const unsigned short*)ptr1)[k];
+                    colorOther2 = ((const unsigned short*)ptr2)[k];
                     color_1     = (colorPoint - colorOther1) * (colorPoint - colorOther1);
                     color_2     = (colorPoint - colorOther2) * (colorPoint - colorOther2);
 
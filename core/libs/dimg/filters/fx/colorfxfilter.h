@@ -87,12 +87,13 @@ public:
 private:
 
     void filterImage();
+    void filterRows(int start, int stop, int haloStart, int haloStop);
 
-    void solarize(DImg* orgImage, DImg* destImage, int factor);
+    void solarize(DImg* orgImage, DImg* destImage, int factor, int start, int stop);
     void vivid(DImg* orgImage, DImg* destImage, int factor);
-    void neon(DImg* orgImage, DImg* destImage, int Intensity, int BW);
-    void findEdges(DImg* orgImage, DImg* destImage, int Intensity, int BW);
-    void neonFindEdges(DImg* orgImage, DImg* destImage, bool neon, int Intensity, int BW);
+    void neon(DImg* orgImage, DImg* destImage, int Intensity, int BW, int start, int stop);
+    void findEdges(DImg* orgImage, DImg* destImage, int Intensity, int BW, int start, int stop);
+    void neonFindEdges(DImg* orgImage, DImg* destImage, bool neon, int Intensity, int BW, int start, int stop);
 
 private:
 
@@ -63,12 +63,18 @@ InvertFilter::~InvertFilter()
 void InvertFilter::filterImage()
 {
     m_destImage.putImageData(m_orgImage.bits());
+    processRowBands();
+}
+
+void InvertFilter::filterRows(int start, int stop, int, int)
+{
+    const uint pixels = (stop - start) * m_destImage.width();
 
     if (!m_destImage.sixteenBit())        // 8 bits image.
     {
-        uchar* ptr = m_destImage.bits();
+        uchar* ptr = m_destImage.scanLine(start);
 
-        for (uint i = 0 ; i < m_destImage.numPixels() ; ++i)
+        for (uint i = 0 ; i < pixels ; ++i)
         {
             ptr[0] = 255 - ptr[0];
             ptr[1] = 255 - ptr[1];
@@ -79,9 +85,9 @@ void InvertFilter::filterImage()
     }
     else               // 16 bits image.
     {
-        unsigned short* ptr = (unsigned short*)m_destImage.bits();
+        unsigned short* ptr = (unsigned short*)m_destImage.scanLine(start);
 
-        for (uint i = 0 ; i < m_destImage.numPixels() ; ++i)
+        for (uint i = 0 ; i < pixels ; ++i)
         {
             ptr[0] = 65535 - ptr[0];
             ptr[1] = 65535 - ptr[1];
@@ -74,6 +74,7 @@ public:
 private:
 
     void filterImage();
+    void filterRows(int start, int stop, int haloStart, int haloStop);
 };
 
 }  // namespace Digikam
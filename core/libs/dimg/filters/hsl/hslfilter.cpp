@@ -86,7 +86,9 @@ void HSLFilter::filterImage()
     setHue(d->settings.hue);
     setSaturation(d->settings.saturation);
     setLightness(d->settings.lightness);
-    applyHSL(m_orgImage);
+
+    // the image is changed in place
+    processRowBands();
     m_destImage = m_orgImage;
 }
 
@@ -226,25 +228,20 @@ int HSLFilter::vibranceBias(double sat, double hue, double vib, bool sixteenbit)
     }
 }
 
-void HSLFilter::applyHSL(DImg& image)
+void HSLFilter::filterRows(int start, int stop, int, int)
 {
-    if (image.isNull())
-    {
-        return;
-    }
-
-    bool   sixteenBit     = image.sixteenBit();
-    uint   numberOfPixels = image.numPixels();
-    int    progress;
-    int    hue, sat, lig;
-    double vib = d->settings.vibrance;
-    DColor color;
+    const bool   sixteenBit = m_orgImage.sixteenBit();
+    const int    width      = m_orgImage.width();
+    const double vib        = d->settings.vibrance;
+    int          hue, sat, lig;
+    DColor       color;
 
     if (sixteenBit)                   // 16 bits image.
     {
-        unsigned short* data = (unsigned short*) image.bits();
+        unsigned short* data = (unsigned short*)m_orgImage.scanLine(start);
+        unsigned short* end  = (unsigned short*)m_orgImage.scanLine(stop - 1) + width * 4;
 
-        for (uint i=0; runningFlag() && (i<numberOfPixels); ++i)
+        for (; data < end; data += 4)
         {
             color = DColor(data[2], data[1], data[0], 0, sixteenBit);
 
@@ -257,22 +254,14 @@ void HSLFilter::applyHSL(DImg& image)
             data[2] = color.red();
             data[1] = color.green();
             data[0] = color.blue();
-
-            data += 4;
-
-            progress = (int)(((double)i * 100.0) / numberOfPixels);
-
-            if ( progress%5 == 0 )
-            {
-                postProgress( progress );
-            }
         }
     }
     else                                      // 8 bits image.
     {
-        uchar* data = image.bits();
+        uchar* data = m_orgImage.scanLine(start);
+        uchar* end  = m_orgImage.scanLine(stop - 1) + width * 4;
 
-        for (uint i=0; runningFlag() && (i<numberOfPixels); ++i)
+        for (; data < end; data += 4)
         {
             color = DColor(data[2], data[1], data[0], 0, sixteenBit);
 
@@ -285,15 +274,6 @@ void HSLFilter::applyHSL(DImg& image)
             data[2] = color.red();
             data[1] = color.green();
             data[0] = color.blue();
-
-            data += 4;
-
-            progress = (int)(((double)i * 100.0) / numberOfPixels);
-
-            if ( progress%5 == 0 )
-            {
-                postProgress( progress );
-            }
         }
     }
 }
@@ -104,7 +104,7 @@ private:
     void setHue(double val);
     void setSaturation(double val);
     void setLightness(double val);
-    void applyHSL(DImg& image);
+    void filterRows(int start, int stop, int haloStart, int haloStop);
     int  vibranceBias(double sat, double hue, double vib, bool sixteenbit);
 
 private:
@@ -27,9 +27,13 @@
 
 // Qt includes
 
+#include <QCache>
 #include <QDataStream>
 #include <QFile>
 #include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
 #include <QVarLengthArray>
 
 // KDE includes
@@ -50,6 +54,7 @@
 // Local includes
 
 #include "dimgloaderobserver.h"
+#include "parallelbands.h"
 
 namespace Digikam
 {
@@ -64,6 +69,7 @@ public:
         outputFormat   = 0;
         intent         = 0;
         transformFlags = 0;
+        proofIntent    = 0;
     }
 
     bool operator==(const TransformDescription& other) const
@@ -88,6 +94,251 @@ public:
     int        proofIntent;
 };
 
+/**
+ * Profiles are equal if they are read from the same file, or, if loaded from memory, have the same data.
+ * Profiles from memory, typically embedded profiles, are only told apart by operator==,
+ * which is good enough for the few transforms that are cached.
+ */
+static inline uint qHashProfile(const IccProfile& profile)
+{
+    if (profile.isNull())
+    {
+        return 0;
+    }
+
+    if (!profile.filePath().isNull())
+    {
+        return qHash(profile.filePath());
+    }
+
+    return 1;
+}
+
+uint qHash(const TransformDescription& description)
+{
+    return qHashProfile(description.inputProfile)                   ^
+           (qHashProfile(description.outputProfile) << 1)           ^
+           (qHashProfile(description.proofProfile)  << 2)           ^
+           uint(description.inputFormat)                            ^
+           (uint(description.outputFormat) << 8)                    ^
+           (uint(description.intent) << 16)                         ^
+           (uint(description.proofIntent) << 20)                    ^
+           uint(description.transformFlags);
+}
+
+// --------------------------------------------------------------------------------------
+
+/**
+ * An LCMS transform, shared by all IccTransform objects with the same TransformDescription.
+ * It is deleted when the last user and the cache have released it.
+ */
+class IccTransformHandle : public QSharedData
+{
+public:
+
+    explicit IccTransformHandle(cmsHTRANSFORM transform)
+        : transform(transform)
+    {
+    }
+
+    ~IccTransformHandle()
+    {
+        LcmsLock lock;
+        cmsDeleteTransform(transform);
+
+        foreach (cmsHTRANSFORM clone, clones)
+        {
+            cmsDeleteTransform(clone);
+        }
+    }
+
+    /**
+     * A transform must not be used by two threads at the same time.
+     * For parallel transforms, each thread takes a separate, equal transform.
+     * Returns 0 if there is none available, then you need to create one.
+     */
+    cmsHTRANSFORM takeClone()
+    {
+        QMutexLocker lock(&mutex);
+        return clones.isEmpty() ? 0 : clones.takeLast();
+    }
+
+    /// Gives back a clone, or a newly created transform, for later use
+    void returnClone(cmsHTRANSFORM clone)
+    {
+        QMutexLocker lock(&mutex);
+        clones << clone;
+    }
+
+    cmsHTRANSFORM        transform;
+
+private:
+
+    QMutex               mutex;
+    QList<cmsHTRANSFORM> clones;
+};
+
+typedef QExplicitlySharedDataPointer<IccTransformHandle> IccTransformHandlePtr;
+
+/**
+ * Creating a transform costs a lot more than applying it to a thumbnail or preview.
+ * Keep the recently used transforms, for all threads.
+ */
+class IccTransformCache
+{
+public:
+
+    IccTransformCache()
+        : cache(16)
+    {
+    }
+
+    ~IccTransformCache()
+    {
+        // At exit, the LCMS lock may already be destroyed. Leave the transforms to the system.
+        foreach (const TransformDescription& description, cache.keys())
+        {
+            cache.object(description)->data()->ref.ref();
+        }
+    }
+
+    IccTransformHandlePtr find(const TransformDescription& description)
+    {
+        QMutexLocker lock(&mutex);
+        IccTransformHandlePtr* handle = cache.object(description);
+        return handle ? *handle : IccTransformHandlePtr();
+    }
+
+    void insert(const TransformDescription& description, const IccTransformHandlePtr& handle)
+    {
+        QMutexLocker lock(&mutex);
+        cache.insert(description, new IccTransformHandlePtr(handle));
+    }
+
+private:
+
+    QMutex                                               mutex;
+    QCache<TransformDescription, IccTransformHandlePtr> cache;
+};
+
+K_GLOBAL_STATIC(IccTransformCache, transformCache)
+
+static cmsHTRANSFORM createLcmsTransform(const TransformDescription& description)
+{
+    LcmsLock lock;
+
+    if (description.proofProfile.isNull())
+    {
+        return cmsCreateTransform(description.inputProfile,
+                                  description.inputFormat,
+                                  description.outputProfile,
+                                  description.outputFormat,
+                                  description.intent,
+                                  description.transformFlags);
+    }
+
+    return cmsCreateProofingTransform(description.inputProfile,
+                                      description.inputFormat,
+                                      description.outputProfile,
+                                      description.outputFormat,
+                                      description.proofProfile,
+                                      description.intent,
+                                      description.proofIntent,
+                                      description.transformFlags);
+}
+
+// --------------------------------------------------------------------------------------
+
+/**
+ * The pixel data of an image, divided in bands of ten scanlines, which are transformed
+ * in parallel. Each thread uses its own transform, so no LcmsLock is needed.
+ */
+class IccTransformBands : public ParallelBands
+{
+public:
+
+    IccTransformBands(DImg& image, const QList<cmsHTRANSFORM>& transforms, bool sameFormat,
+                      DImgLoaderObserver* observer)
+        : ParallelBands(image.height(), 10),
+          image(image),
+          data(image.bits()),
+          width(image.width()),
+          bytesDepth(image.bytesDepth()),
+          transforms(transforms),
+          sameFormat(sameFormat),
+          observer(observer),
+          granularity(1),
+          checkPoint(0)
+    {
+        // the granularity used by the sequential transform
+        if (observer)
+        {
+            granularity = qMax(1, (int)((image.height() / (20 * 0.9)) / observer->granularity()));
+        }
+    }
+
+protected:
+
+    virtual void processBand(int start, int stop, int helper)
+    {
+        const cmsHTRANSFORM transform = transforms.at(helper);
+        const int pixels              = (stop - start) * width;
+        uchar* bandData               = data + start * width * bytesDepth;
+
+        // it is safe to use the same input and output buffer if the format is the same
+        if (sameFormat)
+        {
+            cmsDoTransform(transform, bandData, bandData, pixels);
+        }
+        else
+        {
+            QVarLengthArray<uchar> buffer(pixels * bytesDepth);
+            memcpy(buffer.data(), bandData, pixels * bytesDepth);
+            cmsDoTransform(transform, buffer.data(), bandData, pixels);
+        }
+    }
+
+    /// The calling thread reports the progress of all threads
+    virtual void bandProcessed()
+    {
+        if (!observer)
+        {
+            return;
+        }
+
+        if (!observer->continueQuery(&image))
+        {
+            cancel();
+            return;
+        }
+
+        const int done = doneItems();
+
+        if (done >= checkPoint)
+        {
+            checkPoint = done + granularity;
+            observer->progressInfo(&image, 0.1 + 0.9 * float(done) / float(count()));
+        }
+    }
+
+private:
+
+    DImg&                       image;
+    uchar* const                data;
+    const int                   width;
+    const int                   bytesDepth;
+    const QList<cmsHTRANSFORM>  transforms;
+    const bool                  sameFormat;
+    DImgLoaderObserver* const   observer;
+    int                         granularity;
+    int                         checkPoint;
+};
+
+/// Below this size, creating the transforms for the threads costs more than it saves
+static const int parallelTransformMinPixels = 2 * 1024 * 1024;
+
+// --------------------------------------------------------------------------------------
+
 class IccTransformPriv : public QSharedData
 {
 public:
@@ -100,13 +351,11 @@ public:
         checkGamut      = false;
         doNotEmbed      = false;
         checkGamutColor = QColor(126, 255, 255);
-        handle          = 0;
     }
 
     IccTransformPriv(const IccTransformPriv& other)
         : QSharedData(other)
     {
-        handle = 0;
         operator=(other);
     }
 
@@ -128,8 +377,6 @@ public:
         builtinProfile     = other.builtinProfile;
 
         close();
-        handle             = 0;
-        currentDescription = TransformDescription();
 
         return *this;
     }
@@ -141,13 +388,9 @@ public:
 
     void close()
     {
-        if (handle)
-        {
-            currentDescription = TransformDescription();
-            LcmsLock lock;
-            cmsDeleteTransform(handle);
-            handle = 0;
-        }
+        // the transform itself is owned by the cache
+        currentDescription = TransformDescription();
+        handle             = IccTransformHandlePtr();
     }
 
     IccTransform::RenderingIntent intent;
@@ -205,8 +448,8 @@ public:
         }
     }
 
-    cmsHTRANSFORM        handle;
-    TransformDescription currentDescription;
+    IccTransformHandlePtr handle;
+    TransformDescription  currentDescription;
 };
 
 IccTransform::IccTransform()
@@ -522,55 +765,56 @@ bool IccTransform::open(TransformDescription& description)
         }
     }
 
-    d->currentDescription = description;
+    // A transform with the same profiles and options may have been created before,
+    // then we do not need to open the profiles at all.
+    d->handle = transformCache->find(description);
 
-    LcmsLock lock;
-    d->handle = cmsCreateTransform(description.inputProfile,
-                                   description.inputFormat,
-                                   description.outputProfile,
-                                   description.outputFormat,
-                                   description.intent,
-                                   description.transformFlags);
+    if (d->handle)
+    {
+        d->currentDescription = description;
+        return true;
+    }
+
+    if (!openProfiles(description))
+    {
+        return false;
+    }
+
+    cmsHTRANSFORM transform = createLcmsTransform(description);
 
-    if (!d->handle)
+    if (!transform)
     {
         kDebug() << "LCMS internal error: cannot create a color transform instance";
         return false;
     }
 
+    d->handle             = new IccTransformHandle(transform);
+    d->currentDescription = description;
+    transformCache->insert(description, d->handle);
+
     return true;
 }
 
 bool IccTransform::openProofing(TransformDescription& description)
 {
-    if (d->handle)
+    // the description tells apart proofing transforms
+    return open(description);
+}
+
+bool IccTransform::openProfiles(TransformDescription& description)
+{
+    if (!checkProfiles())
     {
-        if (d->currentDescription == description)
-        {
-            return true;
-        }
-        else
-        {
-            close();
-        }
+        return false;
     }
 
-    d->currentDescription = description;
-
-    LcmsLock lock;
-    d->handle = cmsCreateProofingTransform(description.inputProfile,
-                                           description.inputFormat,
-                                           description.outputProfile,
-                                           description.outputFormat,
-                                           description.proofProfile,
-                                           description.intent,
-                                           description.proofIntent,
-                                           description.transformFlags);
+    // Opening may have detached our profiles from the copies in the description
+    description.inputProfile  = d->effectiveInputProfile();
+    description.outputProfile = d->outputProfile;
 
-    if (!d->handle)
+    if (!description.proofProfile.isNull())
     {
-        kDebug() << "LCMS internal error: cannot create a color transform instance";
-        return false;
+        description.proofProfile = d->proofProfile;
     }
 
     return true;
@@ -614,11 +858,7 @@ bool IccTransform::apply(DImg& image, DImgLoaderObserver* observer)
         return true;
     }
 
-    if (!checkProfiles())
-    {
-        return false;
-    }
-
+    // the profiles are opened by open() only if the transform is not cached
     TransformDescription description;
 
     if (d->proofProfile.isNull())
@@ -673,11 +913,6 @@ bool IccTransform::apply(QImage& qimage)
         return true;
     }
 
-    if (!checkProfiles())
-    {
-        return false;
-    }
-
     TransformDescription description;
     description = getDescription(qimage);
 
@@ -693,6 +928,14 @@ bool IccTransform::apply(QImage& qimage)
 
 void IccTransform::transform(DImg& image, const TransformDescription& description, DImgLoaderObserver* observer)
 {
+    if (QThread::idealThreadCount() > 1 && image.width() * image.height() >= parallelTransformMinPixels)
+    {
+        if (transformParallel(image, description, observer))
+        {
+            return;
+        }
+    }
+
     const int bytesDepth = image.bytesDepth();
     const int pixels     = image.width() * image.height();
     // convert ten scanlines in a batch
@@ -717,7 +960,7 @@ void IccTransform::transform(DImg& image, const TransformDescription& descriptio
             int pixelsThisStep = qMin(p, pixelsPerStep);
             int size           = pixelsThisStep * bytesDepth;
             LcmsLock lock;
-            cmsDoTransform(d->handle, data, data, pixelsThisStep);
+            cmsDoTransform(d->handle->transform, data, data, pixelsThisStep);
             data += size;
 
             if (observer && p <= checkPoint)
@@ -737,7 +980,7 @@ void IccTransform::transform(DImg& image, const TransformDescription& descriptio
             int size           = pixelsThisStep * bytesDepth;
             LcmsLock lock;
             memcpy(buffer.data(), data, size);
-            cmsDoTransform(d->handle, buffer.data(), data, pixelsThisStep);
+            cmsDoTransform(d->handle->transform, buffer.data(), data, pixelsThisStep);
             data += size;
 
             if (observer && p <= checkPoint)
@@ -749,6 +992,50 @@ void IccTransform::transform(DImg& image, const TransformDescription& descriptio
     }
 }
 
+bool IccTransform::transformParallel(DImg& image, const TransformDescription& desc, DImgLoaderObserver* observer)
+{
+    const int threads = QThread::idealThreadCount();
+
+    // Get one transform for each thread, this one included
+    QList<cmsHTRANSFORM> transforms;
+    TransformDescription description = desc;
+
+    for (int i = 0; i < threads; ++i)
+    {
+        cmsHTRANSFORM transform = d->handle->takeClone();
+
+        if (!transform)
+        {
+            if (!openProfiles(description) || !(transform = createLcmsTransform(description)))
+            {
+                break;
+            }
+        }
+
+        transforms << transform;
+    }
+
+    if (transforms.size() < 2)
+    {
+        foreach (cmsHTRANSFORM transform, transforms)
+        {
+            d->handle->returnClone(transform);
+        }
+
+        return false;
+    }
+
+    IccTransformBands bands(image, transforms, description.inputFormat == description.outputFormat, observer);
+    bands.process(transforms.size() - 1);
+
+    foreach (cmsHTRANSFORM transform, transforms)
+    {
+        d->handle->returnClone(transform);
+    }
+
+    return true;
+}
+
 void IccTransform::transform(QImage& image, const TransformDescription&)
 {
     const int bytesDepth    = 4;
@@ -762,7 +1049,7 @@ void IccTransform::transform(QImage& image, const TransformDescription&)
         int pixelsThisStep = qMin(p, pixelsPerStep);
         int size           = pixelsThisStep * bytesDepth;
         LcmsLock lock;
-        cmsDoTransform(d->handle, data, data, pixelsThisStep);
+        cmsDoTransform(d->handle->transform, data, data, pixelsThisStep);
         data += size;
     }
 }
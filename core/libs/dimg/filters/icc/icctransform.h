@@ -145,7 +145,9 @@ private:
     TransformDescription getDescription(const QImage& image);
     bool open(TransformDescription& description);
     bool openProofing(TransformDescription& description);
+    bool openProfiles(TransformDescription& description);
     void transform(DImg& img, const TransformDescription&, DImgLoaderObserver* observer = 0);
+    bool transformParallel(DImg& img, const TransformDescription&, DImgLoaderObserver* observer);
     void transform(QImage& img, const TransformDescription&);
 
 private:
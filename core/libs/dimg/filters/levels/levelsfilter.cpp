@@ -37,13 +37,15 @@ namespace Digikam
 {
 
 LevelsFilter::LevelsFilter(QObject* parent)
-    : DImgThreadedFilter(parent)
+    : DImgThreadedFilter(parent),
+      m_levels(0)
 {
     initFilter();
 }
 
 LevelsFilter::LevelsFilter(DImg* orgImage, QObject* parent, const LevelsContainer& settings)
-    : DImgThreadedFilter(orgImage, parent, "LevelsFilter")
+    : DImgThreadedFilter(orgImage, parent, "LevelsFilter"),
+      m_levels(0)
 {
     m_settings = settings;
     initFilter();
@@ -80,8 +82,15 @@ void LevelsFilter::filterImage()
     levels.levelsLutSetup(AlphaChannel);
     postProgress(80);
 
-    levels.levelsLutProcess(m_orgImage.bits(), m_destImage.bits(), m_orgImage.width(), m_orgImage.height());
-    postProgress(90);
+    m_levels = &levels;
+    processRowBands(80, 90);
+    m_levels = 0;
+}
+
+void LevelsFilter::filterRows(int start, int stop, int, int)
+{
+    m_levels->levelsLutProcess(m_orgImage.scanLine(start), m_destImage.scanLine(start),
+                               m_orgImage.width(), stop - start);
 }
 
 FilterAction LevelsFilter::filterAction()
@@ -37,6 +37,7 @@ namespace Digikam
 {
 
 class DImg;
+class ImageLevels;
 
 class DIGIKAM_EXPORT LevelsContainer
 {
@@ -105,10 +106,13 @@ public:
 private:
 
     void filterImage();
+    void filterRows(int start, int stop, int haloStart, int haloStop);
 
 private:
 
     LevelsContainer m_settings;
+    /// only valid during filterImage()
+    ImageLevels*    m_levels;
 };
 
 }  // namespace Digikam
@@ -175,8 +175,8 @@ void WBFilter::filterImage()
     setLUTv();
     setRGBmult();
 
-    // Apply White balance adjustments.
-    adjustWhiteBalance(m_orgImage.bits(), m_orgImage.width(), m_orgImage.height(), m_orgImage.sixteenBit());
+    // Apply White balance adjustments, in place.
+    processRowBands();
     m_destImage = m_orgImage;
 }
 
@@ -380,18 +380,17 @@ void WBFilter::setLUTv()
     }
 }
 
-void WBFilter::adjustWhiteBalance(uchar* data, int width, int height, bool sixteenBit)
+void WBFilter::filterRows(int start, int stop, int, int)
 {
-    uint size = (uint)(width*height);
+    const uint size = (uint)((stop - start) * m_orgImage.width());
     uint i, j;
-    int  progress;
 
-    if (!sixteenBit)        // 8 bits image.
+    if (!m_orgImage.sixteenBit())        // 8 bits image.
     {
         uchar  red, green, blue;
-        uchar* ptr = data;
+        uchar* ptr = m_orgImage.scanLine(start);
 
-        for (j = 0 ; runningFlag() && (j < size) ; ++j)
+        for (j = 0 ; j < size ; ++j)
         {
             int v, rv[3];
 
@@ -416,21 +415,14 @@ void WBFilter::adjustWhiteBalance(uchar* data, int width, int height, bool sixte
             ptr[1] = (uchar)pixelColor(rv[1], i, v);
             ptr[2] = (uchar)pixelColor(rv[2], i, v);
             ptr    += 4;
-
-            progress = (int)(((double)j * 100.0) / size);
-
-            if ( progress%5 == 0 )
-            {
-                postProgress( progress );
-            }
         }
     }
     else               // 16 bits image.
     {
         unsigned short  red, green, blue;
-        unsigned short* ptr = (unsigned short*)data;
+        unsigned short* ptr = (unsigned short*)m_orgImage.scanLine(start);
 
-        for (j = 0 ; runningFlag() && (j < size) ; ++j)
+        for (j = 0 ; j < size ; ++j)
         {
             int v, rv[3];
 
@@ -455,13 +447,6 @@ void WBFilter::adjustWhiteBalance(uchar* data, int width, int height, bool sixte
             ptr[1] = pixelColor(rv[1], i, v);
             ptr[2] = pixelColor(rv[2], i, v);
             ptr    += 4;
-
-            progress = (int)(((double)j * 100.0) / size);
-
-            if ( progress%5 == 0 )
-            {
-                postProgress( progress );
-            }
         }
     }
 }
@@ -93,7 +93,7 @@ private:
 
     void setRGBmult();
     void setLUTv();
-    void adjustWhiteBalance(uchar* data, int width, int height, bool sixteenBit);
+    void filterRows(int start, int stop, int haloStart, int haloStop);
     inline unsigned short pixelColor(int colorMult, int index, int value);
 
     static void setRGBmult(double& temperature, double& green, float& mr, float& mg, float& mb);
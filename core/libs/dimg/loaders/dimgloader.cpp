@@ -33,6 +33,7 @@
 #include <QCryptographicHash>
 #include <QFile>
 #include <QFileInfo>
+#include <QtEndian>
 
 // KDE includes
 
@@ -50,6 +51,97 @@
 namespace Digikam
 {
 
+// xxHash64 by Yann Collet, see http://code.google.com/p/xxhash/
+// A non-cryptographic hash, an order of magnitude faster than MD5.
+
+static const quint64 xxPrime64_1 = 11400714785074694791ULL;
+static const quint64 xxPrime64_2 = 14029467366897019727ULL;
+static const quint64 xxPrime64_3 =  1609587929392839161ULL;
+static const quint64 xxPrime64_4 =  9650029242287828579ULL;
+static const quint64 xxPrime64_5 =  2870177450012600261ULL;
+
+static inline quint64 xxRotateLeft(quint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline quint64 xxRound(quint64 acc, quint64 input)
+{
+    acc += input * xxPrime64_2;
+    acc  = xxRotateLeft(acc, 31);
+    return acc * xxPrime64_1;
+}
+
+static inline quint64 xxMergeRound(quint64 acc, quint64 value)
+{
+    acc ^= xxRound(0, value);
+    return acc * xxPrime64_1 + xxPrime64_4;
+}
+
+static quint64 xxHash64(const uchar* data, qint64 length)
+{
+    const uchar* p   = data;
+    const uchar* end = data + length;
+    quint64      h;
+
+    if (length >= 32)
+    {
+        quint64 v1 = xxPrime64_1 + xxPrime64_2;
+        quint64 v2 = xxPrime64_2;
+        quint64 v3 = 0;
+        quint64 v4 = -xxPrime64_1;
+
+        for (; p + 32 <= end; p += 32)
+        {
+            v1 = xxRound(v1, qFromLittleEndian<quint64>(p));
+            v2 = xxRound(v2, qFromLittleEndian<quint64>(p + 8));
+            v3 = xxRound(v3, qFromLittleEndian<quint64>(p + 16));
+            v4 = xxRound(v4, qFromLittleEndian<quint64>(p + 24));
+        }
+
+        h = xxRotateLeft(v1, 1) + xxRotateLeft(v2, 7) + xxRotateLeft(v3, 12) + xxRotateLeft(v4, 18);
+        h = xxMergeRound(h, v1);
+        h = xxMergeRound(h, v2);
+        h = xxMergeRound(h, v3);
+        h = xxMergeRound(h, v4);
+    }
+    else
+    {
+        h = xxPrime64_5;
+    }
+
+    h += (quint64)length;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= xxRound(0, qFromLittleEndian<quint64>(p));
+        h  = xxRotateLeft(h, 27) * xxPrime64_1 + xxPrime64_4;
+    }
+
+    if (p + 4 <= end)
+    {
+        h ^= (quint64)qFromLittleEndian<quint32>(p) * xxPrime64_1;
+        h  = xxRotateLeft(h, 23) * xxPrime64_2 + xxPrime64_3;
+        p += 4;
+    }
+
+    for (; p < end; ++p)
+    {
+        h ^= (*p) * xxPrime64_5;
+        h  = xxRotateLeft(h, 11) * xxPrime64_1;
+    }
+
+    h ^= h >> 33;
+    h *= xxPrime64_2;
+    h ^= h >> 29;
+    h *= xxPrime64_3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+// ---------------------------------------------------------------------------------------------------
+
 DImgLoader::DImgLoader(DImg* image)
     : m_image(image)
 {
@@ -85,6 +177,8 @@ int DImgLoader::granularity(DImgLoaderObserver* observer, int total, float progr
 
 unsigned char*& DImgLoader::imageData()
 {
+    // The pixels of a tiled image are moved to one buffer
+    m_image->bits();
     return m_image->m_priv->data;
 }
 
@@ -289,7 +383,7 @@ HistoryImageId DImgLoader::createHistoryImageId(const QString& filePath, const D
     id.setCreationDate(dt);
     id.setFileName(file.fileName());
     id.setPathOnDisk(file.path());
-    id.setUniqueHash(uniqueHashV2(filePath, &image), file.size());
+    id.setUniqueHash(uniqueHashV3(filePath, &image), file.size());
 
     return id;
 }
@@ -361,6 +455,57 @@ QByteArray DImgLoader::uniqueHashV2(const QString& filePath, const DImg* img)
 }
 
 
+QByteArray DImgLoader::uniqueHashV3(const QString& filePath, const DImg* img)
+{
+    QFile file( filePath );
+    if (!file.open( QIODevice::Unbuffered | QIODevice::ReadOnly ))
+    {
+        return QByteArray();
+    }
+
+    // Same parts of the file as uniqueHashV2: first and last 100 kB, limited to file size
+    const qint64 specifiedSize = 100 * 1024; // 100 kB
+    qint64 size = qMin(file.size(), specifiedSize);
+    quint64 hash;
+
+    if (size)
+    {
+        char* databuf = new char[2 * size];
+        int   length  = 0;
+        int   read;
+
+        // Read first 100 kB
+        if ((read = file.read(databuf, size)) > 0 )
+        {
+            length += read;
+        }
+
+        // Read last 100 kB
+        file.seek(file.size() - size);
+        if ((read = file.read(databuf + length, size)) > 0 )
+        {
+            length += read;
+        }
+
+        hash = xxHash64((const uchar*)databuf, length);
+
+        delete [] databuf;
+    }
+    else
+    {
+        hash = xxHash64(0, 0);
+    }
+
+    QByteArray hexHash = QByteArray::number((qulonglong)hash, 16).rightJustified(16, '0');
+
+    if (img)
+    {
+        const_cast<DImg*>(img)->setAttribute("uniqueHashV3", hexHash);
+    }
+
+    return hexHash;
+}
+
 QByteArray DImgLoader::uniqueHash(const QString& filePath, const DImg& img, bool loadMetadata)
 {
     QByteArray bv;
@@ -25,6 +25,7 @@
 
 // Qt includes
 
+#include <QSet>
 #include <QTimer>
 
 // KDE includes
@@ -34,14 +35,19 @@
 
 // Local includes
 
+#include "albumdb.h"
 #include "albummanager.h"
+#include "collectionlocation.h"
+#include "collectionmanager.h"
 #include "databaseaccess.h"
 #include "databasechangesets.h"
+#include "databaseconstants.h"
 #include "databaseface.h"
 #include "databasewatch.h"
 #include "imageinfo.h"
 #include "imageinfolist.h"
 #include "imagelister.h"
+#include "imagelisterthread.h"
 
 namespace Digikam
 {
@@ -54,17 +60,45 @@ public:
     {
         currentAlbum        = 0;
         job                 = 0;
+        listerThread        = 0;
         refreshTimer        = 0;
         incrementalTimer    = 0;
+        deltaTimer          = 0;
         recurseAlbums       = false;
         recurseTags         = false;
         extraValueJob       = false;
     }
 
+    bool isListing() const
+    {
+        return job || listerThread;
+    }
+
+    void stopListing()
+    {
+        if (job)
+        {
+            job->kill();
+            job = 0;
+        }
+
+        if (listerThread)
+        {
+            listerThread->cancel();
+            listerThread = 0;
+        }
+    }
+
+public:
+
     Album*                   currentAlbum;
     KIO::TransferJob*        job;
+    ImageListerThread*       listerThread;
     QTimer*                  refreshTimer;
     QTimer*                  incrementalTimer;
+    QTimer*                  deltaTimer;
+
+    QSet<qlonglong>          deltaIds;
 
     bool                     recurseAlbums;
     bool                     recurseTags;
@@ -83,12 +117,18 @@ ImageAlbumModel::ImageAlbumModel(QObject* parent)
     d->incrementalTimer = new QTimer(this);
     d->incrementalTimer->setSingleShot(true);
 
+    d->deltaTimer = new QTimer(this);
+    d->deltaTimer->setSingleShot(true);
+
     connect(d->refreshTimer, SIGNAL(timeout()),
             this, SLOT(slotNextRefresh()));
 
     connect(d->incrementalTimer, SIGNAL(timeout()),
             this, SLOT(slotNextIncrementalRefresh()));
 
+    connect(d->deltaTimer, SIGNAL(timeout()),
+            this, SLOT(slotNextDeltaRefresh()));
+
     connect(this, SIGNAL(readyForIncrementalRefresh()),
             this, SLOT(incrementalRefresh()));
 
@@ -114,11 +154,7 @@ ImageAlbumModel::ImageAlbumModel(QObject* parent)
 
 ImageAlbumModel::~ImageAlbumModel()
 {
-    if (d->job)
-    {
-        d->job->kill();
-        d->job = 0;
-    }
+    d->stopListing();
 
     delete d;
 }
@@ -179,11 +215,9 @@ void ImageAlbumModel::openAlbum(Album* album)
 
 void ImageAlbumModel::refresh()
 {
-    if (d->job)
-    {
-        d->job->kill();
-        d->job = 0;
-    }
+    d->stopListing();
+    d->deltaTimer->stop();
+    d->deltaIds.clear();
 
     clearImageInfos();
 
@@ -214,11 +248,9 @@ void ImageAlbumModel::incrementalRefresh()
         return;
     }
 
-    if (d->job)
-    {
-        d->job->kill();
-        d->job = 0;
-    }
+    d->stopListing();
+    d->deltaTimer->stop();
+    d->deltaIds.clear();
 
     startIncrementalRefresh();
 
@@ -247,11 +279,173 @@ void ImageAlbumModel::scheduleIncrementalRefresh()
     }
 }
 
+bool ImageAlbumModel::canRefreshDelta() const
+{
+    if (!d->currentAlbum || d->isListing() || hasScheduledRefresh() || isRefreshing())
+    {
+        return false;
+    }
+
+    // For physical albums and plain tag listings, we can find out from the database
+    // if a single image belongs to the album. Dates and searches need a full listing.
+    switch (d->currentAlbum->type())
+    {
+        case Album::PHYSICAL:
+            return true;
+        case Album::TAG:
+            return d->specialListing.isNull();
+        default:
+            return false;
+    }
+}
+
+void ImageAlbumModel::scheduleDeltaRefresh(const QList<qlonglong>& ids)
+{
+    if (!canRefreshDelta())
+    {
+        scheduleIncrementalRefresh();
+        return;
+    }
+
+    foreach (const qlonglong& id, ids)
+    {
+        d->deltaIds << id;
+    }
+
+    // collect the changes of the next 100ms, for example from a running scan
+    if (!d->deltaTimer->isActive())
+    {
+        d->deltaTimer->start(100);
+    }
+}
+
+void ImageAlbumModel::slotNextDeltaRefresh()
+{
+    QList<qlonglong> ids = d->deltaIds.toList();
+    d->deltaIds.clear();
+
+    if (ids.isEmpty())
+    {
+        return;
+    }
+
+    // the situation may have changed since the delta was scheduled
+    if (!canRefreshDelta())
+    {
+        scheduleIncrementalRefresh();
+        return;
+    }
+
+    QVariantList                  values;
+    QHash<qlonglong, QList<int> > tagIds;
+    {
+        DatabaseAccess access;
+        values = access.db()->getImagesFields(ids, DatabaseFields::Album | DatabaseFields::Status);
+
+        if (d->currentAlbum->type() == Album::TAG)
+        {
+            tagIds = access.db()->getItemTagIDs(ids);
+        }
+    }
+
+    QSet<qlonglong> belonging;
+
+    // The values are rows of id, album and status
+    for (QVariantList::const_iterator it = values.constBegin(); it != values.constEnd();)
+    {
+        qlonglong id = (*it).toLongLong();
+        ++it;
+        int albumId  = (*it).toInt();
+        ++it;
+        int status   = (*it).toInt();
+        ++it;
+
+        if (status == DatabaseItem::Visible && belongsToCurrentAlbum(albumId, tagIds.value(id)))
+        {
+            belonging << id;
+        }
+    }
+
+    QList<ImageInfo>   newInfos;
+    QList<QModelIndex> removedIndexes;
+
+    foreach (const qlonglong& id, ids)
+    {
+        if (belonging.contains(id))
+        {
+            if (!hasImage(id))
+            {
+                newInfos << ImageInfo(id);
+            }
+        }
+        else
+        {
+            QModelIndex index = indexForImageId(id);
+
+            if (index.isValid())
+            {
+                removedIndexes << index;
+            }
+        }
+    }
+
+    if (!removedIndexes.isEmpty())
+    {
+        removeIndexes(removedIndexes);
+    }
+
+    if (!newInfos.isEmpty())
+    {
+        addImageInfos(newInfos);
+    }
+}
+
+bool ImageAlbumModel::belongsToCurrentAlbum(int albumId, const QList<int>& tagIds) const
+{
+    PAlbum* palbum = AlbumManager::instance()->findPAlbum(albumId);
+
+    if (!palbum)
+    {
+        return false;
+    }
+
+    if (d->currentAlbum->type() == Album::PHYSICAL)
+    {
+        return palbum == d->currentAlbum || (d->recurseAlbums && d->currentAlbum->isAncestorOf(palbum));
+    }
+
+    // the listing of tags contains only images on available collections
+    if (!CollectionManager::instance()->locationForAlbumRootId(palbum->albumRootId()).isAvailable())
+    {
+        return false;
+    }
+
+    foreach (int tagId, tagIds)
+    {
+        if (tagId == d->currentAlbum->id())
+        {
+            return true;
+        }
+
+        if (d->recurseTags)
+        {
+            Album* a = AlbumManager::instance()->findTAlbum(tagId);
+
+            if (a && d->currentAlbum->isAncestorOf(a))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 void ImageAlbumModel::slotNextRefresh()
 {
     // Refresh, unless job is running, then postpone restart until job is finished
     // Rationale: Let the job run, don't stop it possibly several times
-    if (d->job)
+    if (d->isListing())
     {
         d->refreshTimer->start(50);
     }
@@ -263,7 +457,7 @@ void ImageAlbumModel::slotNextRefresh()
 
 void ImageAlbumModel::slotNextIncrementalRefresh()
 {
-    if (d->job)
+    if (d->isListing())
     {
         d->incrementalTimer->start(50);
     }
@@ -275,8 +469,39 @@ void ImageAlbumModel::slotNextIncrementalRefresh()
 
 void ImageAlbumModel::startListJob(Album* album)
 {
-    KUrl url = album->databaseUrl();
+    DatabaseUrl url  = album->databaseUrl();
     d->extraValueJob = false;
+
+    // Albums, tags and dates are listed in a thread, without the round-trip through an ioslave
+    if (ImageListerThread::canList(url))
+    {
+        d->listerThread = new ImageListerThread(url, this);
+
+        if (album->type() == Album::TAG)
+        {
+            d->listerThread->setRecursive(d->recurseTags);
+
+            if (!d->specialListing.isNull())
+            {
+                d->listerThread->setSpecialTagListing(d->specialListing);
+                d->extraValueJob = true;
+            }
+        }
+        else
+        {
+            d->listerThread->setRecursive(d->recurseAlbums);
+        }
+
+        connect(d->listerThread, SIGNAL(signalRecords(const QList<ImageListerRecord>&)),
+                this, SLOT(slotRecords(const QList<ImageListerRecord>&)));
+
+        connect(d->listerThread, SIGNAL(signalFinished()),
+                this, SLOT(slotListerThreadFinished()));
+
+        d->listerThread->start();
+        return;
+    }
+
     d->job = ImageLister::startListJob(url);
     d->job->addMetaData("listAlbumsRecursively", d->recurseAlbums ? "true" : "false");
     d->job->addMetaData("listTagsRecursively", d->recurseTags ? "true" : "false");
@@ -321,15 +546,13 @@ void ImageAlbumModel::slotData(KIO::Job*, const QByteArray& data)
         return;
     }
 
-    ImageInfoList newItemsList;
+    QList<ImageListerRecord> records;
 
     QByteArray tmp(data);
     QDataStream ds(&tmp, QIODevice::ReadOnly);
 
     if (d->extraValueJob)
     {
-        QList<QVariant> extraValues;
-
         if (!ImageListerRecord::checkStream(ImageListerRecord::ExtraValueFormat, ds))
         {
             kError() << "Binary stream from ioslave is not valid, rejecting";
@@ -340,7 +563,58 @@ void ImageAlbumModel::slotData(KIO::Job*, const QByteArray& data)
         {
             ImageListerRecord record(ImageListerRecord::ExtraValueFormat);
             ds >> record;
+            records << record;
+        }
+    }
+    else
+    {
+        while (!ds.atEnd())
+        {
+            ImageListerRecord record;
+            ds >> record;
+            records << record;
+        }
+    }
 
+    addRecords(records);
+}
+
+void ImageAlbumModel::slotRecords(const QList<ImageListerRecord>& records)
+{
+    // signals queued before the thread was cancelled
+    if (sender() != d->listerThread)
+    {
+        return;
+    }
+
+    addRecords(records);
+}
+
+void ImageAlbumModel::slotListerThreadFinished()
+{
+    if (sender() != d->listerThread)
+    {
+        return;
+    }
+
+    d->listerThread->cancel();
+    d->listerThread = 0;
+
+    // either of the two
+    finishRefresh();
+    finishIncrementalRefresh();
+}
+
+void ImageAlbumModel::addRecords(const QList<ImageListerRecord>& records)
+{
+    ImageInfoList newItemsList;
+
+    if (d->extraValueJob)
+    {
+        QList<QVariant> extraValues;
+
+        foreach (const ImageListerRecord& record, records)
+        {
             ImageInfo info(record);
             newItemsList << info;
 
@@ -371,13 +645,9 @@ void ImageAlbumModel::slotData(KIO::Job*, const QByteArray& data)
     }
     else
     {
-        while (!ds.atEnd())
+        foreach (const ImageListerRecord& record, records)
         {
-            ImageListerRecord record;
-            ds >> record;
-
-            ImageInfo info(record);
-            newItemsList << info;
+            newItemsList << ImageInfo(record);
         }
 
         addImageInfos(newItemsList);
@@ -400,7 +670,7 @@ void ImageAlbumModel::slotImageChange(const ImageChangeset& changeset)
     // this is for the case that _only_ the status changes, i.e., explicit setVisible()
     if ((DatabaseFields::Images)changeset.changes() == DatabaseFields::Status)
     {
-        scheduleIncrementalRefresh();
+        scheduleDeltaRefresh(changeset.ids());
     }
 
     if (d->currentAlbum->type() == Album::SEARCH)
@@ -451,7 +721,8 @@ void ImageAlbumModel::slotImageTagChange(const ImageTagChangeset& changeset)
 
     if (doRefresh)
     {
-        scheduleIncrementalRefresh();
+        // Only the membership of the given images can have changed
+        scheduleDeltaRefresh(changeset.ids());
     }
 
     ImageModel::slotImageTagChange(changeset);
@@ -503,6 +774,8 @@ void ImageAlbumModel::slotCollectionImageChange(const CollectionImageChangeset&
                     break;
             }
 
+            break;
+
         case CollectionImageChangeset::Removed:
         case CollectionImageChangeset::RemovedAll:
             // is one of our images affected?
@@ -515,6 +788,13 @@ void ImageAlbumModel::slotCollectionImageChange(const CollectionImageChangeset&
                     break;
                 }
             }
+
+            // RemovedAll may not list the image ids, only the albums
+            if (!doRefresh && changeset.ids().isEmpty() && changeset.operation() == CollectionImageChangeset::RemovedAll)
+            {
+                doRefresh = !isEmpty();
+            }
+
             break;
 
         default:
@@ -523,7 +803,15 @@ void ImageAlbumModel::slotCollectionImageChange(const CollectionImageChangeset&
 
     if (doRefresh)
     {
-        scheduleIncrementalRefresh();
+        if (changeset.ids().isEmpty())
+        {
+            scheduleIncrementalRefresh();
+        }
+        else
+        {
+            // Only the given images can have been added to or removed from our album
+            scheduleDeltaRefresh(changeset.ids());
+        }
     }
 }
 
@@ -43,6 +43,7 @@ class CollectionImageChangeset;
 class SearchChangeset;
 class Album;
 class ImageAlbumModelPriv;
+class ImageListerRecord;
 
 class ImageAlbumModel : public ImageThumbnailModel
 {
@@ -86,9 +87,12 @@ protected Q_SLOTS:
 
     void slotResult(KJob* job);
     void slotData(KIO::Job* job, const QByteArray& data);
+    void slotRecords(const QList<ImageListerRecord>& records);
+    void slotListerThreadFinished();
 
     void slotNextRefresh();
     void slotNextIncrementalRefresh();
+    void slotNextDeltaRefresh();
 
     virtual void slotImageChange(const ImageChangeset& changeset);
     virtual void slotImageTagChange(const ImageTagChangeset& changeset);
@@ -105,6 +109,16 @@ protected Q_SLOTS:
 protected:
 
     void startListJob(Album* album);
+    void addRecords(const QList<ImageListerRecord>& records);
+
+    /**
+     * Instead of relisting the whole album, checks only the given images
+     * if they belong to the current album, and adds or removes them accordingly.
+     * Falls back to scheduleIncrementalRefresh() if this is not possible.
+     */
+    void scheduleDeltaRefresh(const QList<qlonglong>& ids);
+    bool canRefreshDelta() const;
+    bool belongsToCurrentAlbum(int albumId, const QList<int>& tagIds) const;
 
 private:
 
@@ -225,6 +225,8 @@ ImageFilterModelPrivate::ImageFilterModelPrivate()
     lastDiscardVersion    = 0;
     sentOut               = 0;
     sentOutForReAdd       = 0;
+    nextSequence          = 0;
+    nextIncorporatedSequence = 0;
     updateFilterTimer     = 0;
     needPrepare           = false;
     needPrepareComments   = false;
@@ -234,6 +236,7 @@ ImageFilterModelPrivate::ImageFilterModelPrivate()
     filterer              = 0;
     hasOneMatch           = false;
     hasOneMatchForText    = false;
+    sortKeyVersion        = 0;
 
     setupWorkers();
 }
@@ -281,6 +284,10 @@ void ImageFilterModelPrivate::init(ImageFilterModel* _q)
     connect(updateFilterTimer, SIGNAL(timeout()),
             q, SLOT(slotUpdateFilter()));
 
+    // the cached sort keys contain the album and path
+    connect(DatabaseAccess::databaseWatch(), SIGNAL(collectionImageChange(const CollectionImageChangeset&)),
+            q, SLOT(slotCollectionImageChange(const CollectionImageChangeset&)));
+
     // inter-thread redirection
     qRegisterMetaType<ImageFilterModelTodoPackage>("ImageFilterModelTodoPackage");
 }
@@ -571,11 +578,15 @@ void ImageFilterModel::slotModelReset()
         // discard all packages on the way
         d->version++;
         d->sentOut            = 0;
+        // all packages on the way are discarded, so do not wait for them
+        d->nextIncorporatedSequence = d->nextSequence;
 
         d->hasOneMatch        = false;
         d->hasOneMatchForText = false;
     }
     d->filterResults.clear();
+    d->sortKeys.clear();
+    d->finishedPackages.clear();
 }
 
 bool ImageFilterModel::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const
@@ -674,21 +685,22 @@ void ImageFilterModelPrivate::processAddedInfos(const QList<ImageInfo>& infos, c
 void ImageFilterModelPrivate::setupWorkers()
 {
     preparer = new ImageFilterModelPreparer(this);
-    filterer = new ImageFilterModelFilterer(this);
+    filterer = new ImageFilterModelParallelFilterer(this);
 
     // A package in constructed in infosToProcess.
     // Normal flow is infosToProcess -> preparer::process -> filterer::process -> packageFinished.
     // If no preparation is needed, the first step is skipped.
     // If filter version changes, both will discard old package and send them to packageDiscarded.
+    // The parallel filterer only dispatches to its workers, so it is called directly from the sending thread.
 
     connect(this, SIGNAL(packageToPrepare(const ImageFilterModelTodoPackage&)),
             preparer, SLOT(process(ImageFilterModelTodoPackage)));
 
     connect(this, SIGNAL(packageToFilter(const ImageFilterModelTodoPackage&)),
-            filterer, SLOT(process(ImageFilterModelTodoPackage)));
+            filterer, SLOT(process(const ImageFilterModelTodoPackage&)), Qt::DirectConnection);
 
     connect(preparer, SIGNAL(processed(const ImageFilterModelTodoPackage&)),
-            filterer, SLOT(process(ImageFilterModelTodoPackage)));
+            filterer, SLOT(process(const ImageFilterModelTodoPackage&)), Qt::DirectConnection);
 
     connect(filterer, SIGNAL(processed(const ImageFilterModelTodoPackage&)),
             this, SLOT(packageFinished(const ImageFilterModelTodoPackage&)));
@@ -712,7 +724,7 @@ void ImageFilterModelPrivate::infosToProcess(const QList<ImageInfo>& infos, cons
         return;
     }
 
-    filterer->schedule();
+    // the filterers are scheduled when they receive a package
 
     if (needPrepare)
     {
@@ -751,13 +763,16 @@ void ImageFilterModelPrivate::infosToProcess(const QList<ImageInfo>& infos, cons
             ++sentOutForReAdd;
         }
 
+        ImageFilterModelTodoPackage package(infoVector, version, forReAdd, extraValueVector);
+        package.sequence = nextSequence++;
+
         if (needPrepare)
         {
-            emit packageToPrepare(ImageFilterModelTodoPackage(infoVector, version, forReAdd, extraValueVector));
+            emit packageToPrepare(package);
         }
         else
         {
-            emit packageToFilter(ImageFilterModelTodoPackage(infoVector, version, forReAdd, extraValueVector));
+            emit packageToFilter(package);
         }
     }
 }
@@ -771,6 +786,28 @@ void ImageFilterModelPrivate::packageFinished(const ImageFilterModelTodoPackage&
         return;
     }
 
+    // The packages are filtered in parallel and may return out of order.
+    // Keep them until all previously sent packages have been incorporated.
+    finishedPackages.insert(package.sequence, package);
+
+    while (!finishedPackages.isEmpty() && finishedPackages.constBegin().key() == nextIncorporatedSequence)
+    {
+        ImageFilterModelTodoPackage next = finishedPackages.take(nextIncorporatedSequence);
+
+        // the filter may have changed while it was waiting
+        if (next.version != version)
+        {
+            packageDiscarded(next);
+            break;
+        }
+
+        ++nextIncorporatedSequence;
+        incorporatePackage(next);
+    }
+}
+
+void ImageFilterModelPrivate::incorporatePackage(const ImageFilterModelTodoPackage& package)
+{
     // incorporate result
     QHash<qlonglong, bool>::const_iterator it = package.filterResults.constBegin();
 
@@ -779,6 +816,17 @@ void ImageFilterModelPrivate::packageFinished(const ImageFilterModelTodoPackage&
         filterResults.insert(it.key(), it.value());
     }
 
+    // keys read with different sort settings are useless
+    if (package.sortKeyVersion == sortKeyVersion)
+    {
+        QHash<qlonglong, ImageSortKey>::const_iterator kit = package.sortKeys.constBegin();
+
+        for (; kit != package.sortKeys.constEnd(); ++kit)
+        {
+            sortKeys.insert(kit.key(), kit.value());
+        }
+    }
+
     // re-add if necessary
     if (package.isForReAdd)
     {
@@ -819,13 +867,17 @@ void ImageFilterModelPrivate::packageDiscarded(const ImageFilterModelTodoPackage
         // Recycle packages: Send again with current version
         // Do not increment sentOut or sentOutForReAdd here: it was not decremented!
 
+        // Keep the sequence number: The following packages wait for this one.
+        ImageFilterModelTodoPackage recycled(package.infos, version, package.isForReAdd);
+        recycled.sequence = package.sequence;
+
         if (needPrepare)
         {
-            emit packageToPrepare(ImageFilterModelTodoPackage(package.infos, version, package.isForReAdd));
+            emit packageToPrepare(recycled);
         }
         else
         {
-            emit packageToFilter(ImageFilterModelTodoPackage(package.infos, version, package.isForReAdd));
+            emit packageToFilter(recycled);
         }
     }
 }
@@ -849,13 +901,12 @@ void ImageFilterModelPreparer::process(ImageFilterModelTodoPackage package)
         prepareHooks        = d->prepareHooks;
     }
 
-    //TODO: Make efficient!!
+    // Read the needed data for all infos of the package with a few set-based queries
+    ImageInfoList infos = package.infos.toList();
+
     if (needPrepareComments)
     {
-        foreach(const ImageInfo& info, package.infos)
-        {
-            info.comment();
-        }
+        infos.loadFields(DatabaseFields::Comment);
     }
 
     if (!checkVersion(package))
@@ -864,22 +915,14 @@ void ImageFilterModelPreparer::process(ImageFilterModelTodoPackage package)
         return;
     }
 
-    //TODO: Make efficient!!
     if (needPrepareTags)
     {
-        foreach(const ImageInfo& info, package.infos)
-        {
-            info.tagIds();
-        }
+        infos.loadTagIds();
     }
 
-    //TODO: Make efficient!!
     if (needPrepareGroups)
     {
-        foreach(const ImageInfo& info, package.infos)
-        {
-            info.isGrouped();
-        }
+        infos.loadGroupImageIds();
     }
 
     foreach (ImageFilterModelPrepareHook* hook, prepareHooks)
@@ -902,15 +945,18 @@ void ImageFilterModelFilterer::process(ImageFilterModelTodoPackage package)
     ImageFilterSettings localFilter;
     VersionImageFilterSettings localVersionFilter;
     GroupImageFilterSettings localGroupFilter;
+    ImageSortSettings localSorter;
     bool hasOneMatch;
     bool hasOneMatchForText;
     {
         QMutexLocker lock(&d->mutex);
-        localFilter        = d->filterCopy;
-        localVersionFilter = d->versionFilterCopy;
-        localGroupFilter   = d->groupFilterCopy;
-        hasOneMatch        = d->hasOneMatch;
-        hasOneMatchForText = d->hasOneMatchForText;
+        localFilter            = d->filterCopy;
+        localVersionFilter     = d->versionFilterCopy;
+        localGroupFilter       = d->groupFilterCopy;
+        localSorter            = d->sorterCopy;
+        package.sortKeyVersion = d->sortKeyVersion;
+        hasOneMatch            = d->hasOneMatch;
+        hasOneMatchForText     = d->hasOneMatchForText;
     }
 
     // Actual filtering. The variants to spare checking hasOneMatch over and over again.
@@ -960,45 +1006,140 @@ void ImageFilterModelFilterer::process(ImageFilterModelTodoPackage package)
         }
     }
 
+    // Read the sort keys of the matching infos here, instead of in the UI thread while sorting
+    foreach (const ImageInfo& info, package.infos)
+    {
+        if (package.filterResults.value(info.id()))
+        {
+            package.sortKeys[info.id()] = localSorter.sortKey(info);
+        }
+    }
+
     if (checkVersion(package))
     {
+        // other filterers may have found a match in the meantime, do not reset it
         QMutexLocker lock(&d->mutex);
-        d->hasOneMatch = hasOneMatch;
-        d->hasOneMatchForText = hasOneMatchForText;
+        d->hasOneMatch        = d->hasOneMatch || hasOneMatch;
+        d->hasOneMatchForText = d->hasOneMatchForText || hasOneMatchForText;
     }
 
     emit processed(package);
 }
 
+ImageFilterModelParallelFilterer::ImageFilterModelParallelFilterer(ImageFilterModelPrivate* d)
+    : m_currentIndex(0)
+{
+    const int n = qMax(QThread::idealThreadCount(), 1);
+
+    for (int i=0; i<n; i++)
+    {
+        ImageFilterModelFilterer* worker = new ImageFilterModelFilterer(d);
+
+        // collect the worker's signals and bundle them to our signals
+        connect(worker, SIGNAL(processed(const ImageFilterModelTodoPackage&)),
+                this, SIGNAL(processed(const ImageFilterModelTodoPackage&)));
+
+        connect(worker, SIGNAL(discarded(const ImageFilterModelTodoPackage&)),
+                this, SIGNAL(discarded(const ImageFilterModelTodoPackage&)));
+
+        m_workers << worker;
+    }
+}
+
+ImageFilterModelParallelFilterer::~ImageFilterModelParallelFilterer()
+{
+    foreach (ImageFilterModelFilterer* worker, m_workers)
+    {
+        delete worker;
+    }
+}
+
+void ImageFilterModelParallelFilterer::schedule()
+{
+    foreach (ImageFilterModelFilterer* worker, m_workers)
+    {
+        worker->schedule();
+    }
+}
+
+void ImageFilterModelParallelFilterer::deactivate(WorkerObject::DeactivatingMode mode)
+{
+    foreach (ImageFilterModelFilterer* worker, m_workers)
+    {
+        worker->deactivate(mode);
+    }
+}
+
+void ImageFilterModelParallelFilterer::process(const ImageFilterModelTodoPackage& package)
+{
+    // Here, we send the package to one of the workers, in turn.
+    // Called from the UI thread and the preparer thread.
+    const int index                  = uint(m_currentIndex.fetchAndAddOrdered(1)) % uint(m_workers.size());
+    ImageFilterModelFilterer* worker = m_workers.at(index);
+
+    worker->schedule();
+    QMetaObject::invokeMethod(worker, "process", Qt::QueuedConnection,
+                              Q_ARG(ImageFilterModelTodoPackage, package));
+}
+
 // -------------- Sorting and Categorization -------------------------------------------------------
 
 void ImageFilterModel::setImageSortSettings(const ImageSortSettings& sorter)
 {
     Q_D(ImageFilterModel);
+    // the sort keys depend on sort role and categorization mode, but not on the sort orders
+    bool keysValid = (d->sorter.sortRole == sorter.sortRole &&
+                      d->sorter.categorizationMode == sorter.categorizationMode);
+
     d->sorter = sorter;
     setCategorizedModel(d->sorter.categorizationMode != ImageSortSettings::NoCategories);
+
+    {
+        QMutexLocker lock(&d->mutex);
+        d->sorterCopy = sorter;
+
+        if (!keysValid)
+        {
+            d->sortKeyVersion++;
+        }
+    }
+
+    if (!keysValid)
+    {
+        d->sortKeys.clear();
+
+        // Read the sort keys of all infos at once, not one by one while sorting
+        if (d->imageModel)
+        {
+            ImageInfoList(d->imageModel->imageInfos()).loadFields(d->sorter.watchFlags());
+        }
+    }
+
     invalidate();
 }
 
 void ImageFilterModel::setCategorizationMode(ImageSortSettings::CategorizationMode mode)
 {
     Q_D(ImageFilterModel);
-    d->sorter.setCategorizationMode(mode);
-    setImageSortSettings(d->sorter);
+    ImageSortSettings sorter = d->sorter;
+    sorter.setCategorizationMode(mode);
+    setImageSortSettings(sorter);
 }
 
 void ImageFilterModel::setSortRole(ImageSortSettings::SortRole role)
 {
     Q_D(ImageFilterModel);
-    d->sorter.setSortRole(role);
-    setImageSortSettings(d->sorter);
+    ImageSortSettings sorter = d->sorter;
+    sorter.setSortRole(role);
+    setImageSortSettings(sorter);
 }
 
 void ImageFilterModel::setSortOrder(ImageSortSettings::SortOrder order)
 {
     Q_D(ImageFilterModel);
-    d->sorter.setSortOrder(order);
-    setImageSortSettings(d->sorter);
+    ImageSortSettings sorter = d->sorter;
+    sorter.setSortOrder(order);
+    setImageSortSettings(sorter);
 }
 
 int ImageFilterModel::compareCategories(const QModelIndex& left, const QModelIndex& right) const
@@ -1053,7 +1194,7 @@ int ImageFilterModel::compareInfosCategories(const ImageInfo& left, const ImageI
 {
     // Note: reimplemented in ImageImageSortFilterModel
     Q_D(const ImageFilterModel);
-    return d->sorter.compareCategories(left, right);
+    return d->compareCategories(left, right);
 }
 
 // Feel free to optimize. QString::number is 3x slower.
@@ -1097,7 +1238,32 @@ QString ImageFilterModel::categoryIdentifier(const ImageInfo& info) const
 bool ImageFilterModel::infosLessThan(const ImageInfo& left, const ImageInfo& right) const
 {
     Q_D(const ImageFilterModel);
-    return d->sorter.lessThan(left, right);
+    return d->lessThan(left, right);
+}
+
+void ImageFilterModelPrivate::ensureSortKeys(const ImageInfo& left, const ImageInfo& right) const
+{
+    if (!sortKeys.contains(left.id()))
+    {
+        sortKeys.insert(left.id(), sorter.sortKey(left));
+    }
+
+    if (!sortKeys.contains(right.id()))
+    {
+        sortKeys.insert(right.id(), sorter.sortKey(right));
+    }
+}
+
+bool ImageFilterModelPrivate::lessThan(const ImageInfo& left, const ImageInfo& right) const
+{
+    ensureSortKeys(left, right);
+    return sorter.lessThan(*sortKeys.constFind(left.id()), *sortKeys.constFind(right.id()));
+}
+
+int ImageFilterModelPrivate::compareCategories(const ImageInfo& left, const ImageInfo& right) const
+{
+    ensureSortKeys(left, right);
+    return sorter.compareCategories(*sortKeys.constFind(left.id()), *sortKeys.constFind(right.id()));
 }
 
 // -------------- Watching changes -----------------------------------------------------------------
@@ -1146,15 +1312,29 @@ void ImageFilterModel::slotImageChange(const ImageChangeset& changeset)
         return;
     }
 
+    // is one of the values affected that we filter or sort by?
+    DatabaseFields::Set set = changeset.changes();
+    bool sortAffected       = (set & d->sorter.watchFlags());
+
+    // the cached sort keys of the changed images need to be read again
+    DatabaseFields::Set keyFields = d->sorter.watchFlags();
+    keyFields |= DatabaseFields::Name | DatabaseFields::FileSize | DatabaseFields::ModificationDate;
+    keyFields |= DatabaseFields::CreationDate;
+
+    if (set & keyFields)
+    {
+        foreach (const qlonglong& id, changeset.ids())
+        {
+            d->sortKeys.remove(id);
+        }
+    }
+
     // already scheduled to re-filter?
     if (d->updateFilterTimer->isActive())
     {
         return;
     }
 
-    // is one of the values affected that we filter or sort by?
-    DatabaseFields::Set set = changeset.changes();
-    bool sortAffected       = (set & d->sorter.watchFlags());
     bool filterAffected     = (set & d->filter.watchFlags()) || (set & d->groupFilter.watchFlags());
 
     if (!sortAffected && !filterAffected)
@@ -1189,6 +1369,34 @@ void ImageFilterModel::slotImageChange(const ImageChangeset& changeset)
     }
 }
 
+void ImageFilterModel::slotCollectionImageChange(const CollectionImageChangeset& changeset)
+{
+    Q_D(ImageFilterModel);
+
+    // Moved images keep their id, so the album and path of their cached sort keys are outdated
+    if (changeset.operation() != CollectionImageChangeset::Moved &&
+        changeset.operation() != CollectionImageChangeset::Copied)
+    {
+        return;
+    }
+
+    bool imageAffected = false;
+
+    foreach (const qlonglong& id, changeset.ids())
+    {
+        if (d->sortKeys.remove(id) && d->imageModel && d->imageModel->hasImage(id))
+        {
+            imageAffected = true;
+        }
+    }
+
+    if (imageAffected && (d->sorter.sortRole == ImageSortSettings::SortByFilePath ||
+                          d->sorter.categorizationMode == ImageSortSettings::CategoryByAlbum))
+    {
+        invalidate();    // just resort, reuse filter results
+    }
+}
+
 // -------------------------------------------------------------------------------------------------------
 
 NoDuplicatesImageFilterModel::NoDuplicatesImageFilterModel(QObject* parent)
@@ -41,6 +41,7 @@
 namespace Digikam
 {
 
+class CollectionImageChangeset;
 class ImageChangeset;
 class ImageFilterModel;
 class ImageTagChangeset;
@@ -244,6 +245,7 @@ protected Q_SLOTS:
 
     void slotImageTagChange(const ImageTagChangeset& changeset);
     void slotImageChange(const ImageChangeset& changeset);
+    void slotCollectionImageChange(const CollectionImageChangeset& changeset);
 
     void slotRowsInserted(const QModelIndex& parent, int start, int end);
     void slotRowsAboutToBeRemoved(const QModelIndex& parent, int start, int end);
@@ -27,6 +27,7 @@
 // Qt includes
 
 #include <QHash>
+#include <QMap>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QSet>
@@ -49,22 +50,26 @@ class ImageFilterModelTodoPackage
 public:
 
     ImageFilterModelTodoPackage()
-        : version(0), isForReAdd(false) {}
+        : version(0), isForReAdd(false), sortKeyVersion(0), sequence(0) {}
     ImageFilterModelTodoPackage(const QVector<ImageInfo>& infos, int version, bool isForReAdd,
                                 const QVector<QVariant>& extraValues = QVector<QVariant>())
-        : infos(infos), extraValues(extraValues), version(version), isForReAdd(isForReAdd) {}
+        : infos(infos), extraValues(extraValues), version(version), isForReAdd(isForReAdd), sortKeyVersion(0), sequence(0) {}
 
     QVector<ImageInfo>         infos;
     QVector<QVariant>          extraValues;
     unsigned int               version;
     bool                       isForReAdd;
     QHash<qlonglong, bool>     filterResults;
+    QHash<qlonglong, ImageSortKey> sortKeys;
+    unsigned int               sortKeyVersion;
+    /// Packages are incorporated in the order they were sent out
+    int                        sequence;
 };
 
 // ------------------------------------------------------------------------------------------------
 
 class ImageFilterModelPreparer;
-class ImageFilterModelFilterer;
+class ImageFilterModelParallelFilterer;
 
 class DIGIKAM_DATABASE_EXPORT ImageFilterModelPrivate : public QObject
 {
@@ -79,6 +84,12 @@ public:
     void setupWorkers();
     void infosToProcess(const QList<ImageInfo>& infos);
     void infosToProcess(const QList<ImageInfo>& infos, const QList<QVariant>& extraValues, bool forReAdd = true);
+    void incorporatePackage(const ImageFilterModelTodoPackage& package);
+
+    /// Compare by the cached sort keys of left and right, reading them first if necessary
+    bool lessThan(const ImageInfo& left, const ImageInfo& right) const;
+    int compareCategories(const ImageInfo& left, const ImageInfo& right) const;
+    void ensureSortKeys(const ImageInfo& left, const ImageInfo& right) const;
 
 public:
 
@@ -96,6 +107,9 @@ public:
     unsigned int               lastFilteredVersion;
     int                        sentOut;
     int                        sentOutForReAdd;
+    int                        nextSequence;
+    int                        nextIncorporatedSequence;
+    QMap<int, ImageFilterModelTodoPackage> finishedPackages;
 
     QTimer*                    updateFilterTimer;
 
@@ -108,13 +122,18 @@ public:
     ImageFilterSettings        filterCopy;
     VersionImageFilterSettings versionFilterCopy;
     GroupImageFilterSettings   groupFilterCopy;
+    ImageSortSettings          sorterCopy;
+    unsigned int               sortKeyVersion;
     ImageFilterModelPreparer*  preparer;
-    ImageFilterModelFilterer*  filterer;
+    ImageFilterModelParallelFilterer* filterer;
 
     QHash<qlonglong, bool>     filterResults;
     bool                       hasOneMatch;
     bool                       hasOneMatchForText;
 
+    /// Read in the filterer thread, or on demand when sorting. Cleared when sort role or categorization change.
+    mutable QHash<qlonglong, ImageSortKey> sortKeys;
+
     QList<ImageFilterModelPrepareHook*> prepareHooks;
 
     /*
@@ -26,6 +26,8 @@
 
 // Qt includes
 
+#include <QAtomicInt>
+#include <QList>
 #include <QThread>
 
 // Local includes
@@ -87,6 +89,37 @@ public:
     void process(ImageFilterModelTodoPackage package);
 };
 
+/**
+ * Distributes the packages to a number of filterers, one per core,
+ * and bundles their signals. process() can be called directly from any thread.
+ */
+class DIGIKAM_DATABASE_EXPORT ImageFilterModelParallelFilterer : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    ImageFilterModelParallelFilterer(ImageFilterModelPrivate* d);
+    ~ImageFilterModelParallelFilterer();
+
+    void schedule();
+    void deactivate(WorkerObject::DeactivatingMode mode = WorkerObject::FlushSignals);
+
+public Q_SLOTS:
+
+    void process(const ImageFilterModelTodoPackage& package);
+
+Q_SIGNALS:
+
+    void processed(const ImageFilterModelTodoPackage& package);
+    void discarded(const ImageFilterModelTodoPackage& package);
+
+protected:
+
+    QList<ImageFilterModelFilterer*> m_workers;
+    QAtomicInt                       m_currentIndex;
+};
+
 } // namespace Digikam
 
 #endif // IMAGEFILTERMODELTHREADS_H
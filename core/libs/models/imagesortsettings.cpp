@@ -28,6 +28,10 @@
 #include <QDateTime>
 #include <QRectF>
 
+// C++ includes
+
+#include <limits>
+
 // Local includes
 
 #include "databasefields.h"
@@ -307,6 +311,145 @@ bool ImageSortSettings::lessThan(const QVariant& left, const QVariant& right) co
     }
 }
 
+static inline qint64 sortableDateTime(const QDateTime& dateTime)
+{
+    if (!dateTime.isValid())
+    {
+        return std::numeric_limits<qint64>::min();
+    }
+
+    return qint64(dateTime.date().toJulianDay()) * 86400 + QTime(0, 0).secsTo(dateTime.time());
+}
+
+ImageSortKey ImageSortSettings::sortKey(const ImageInfo& info) const
+{
+    ImageSortKey key;
+    key.id               = info.id();
+    key.albumId          = info.albumId();
+
+    // needed for the hierarchy of sort orders in lessThan()
+    key.name             = info.name();
+    key.fileSize         = info.fileSize();
+    key.creationDate     = sortableDateTime(info.dateTime());
+    key.modificationDate = sortableDateTime(info.modDateTime());
+
+    switch (sortRole)
+    {
+        case SortByFilePath:
+            key.path = info.filePath();
+            break;
+        case SortByRating:
+            key.rating = info.rating();
+            break;
+        case SortByImageSize:
+        {
+            QSize size = info.dimensions();
+            key.pixels = qlonglong(size.width()) * size.height();
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (categorizationMode == CategoryByFormat)
+    {
+        key.format = info.format();
+    }
+
+    return key;
+}
+
+int ImageSortSettings::compareCategories(const ImageSortKey& left, const ImageSortKey& right) const
+{
+    switch (categorizationMode)
+    {
+        case NoCategories:
+        case OneCategory:
+            return 0;
+        case CategoryByAlbum:
+            return compareByOrder(left.albumId, right.albumId, currentCategorizationSortOrder);
+        case CategoryByFormat:
+            return naturalCompare(left.format, right.format,
+                                  currentCategorizationSortOrder, categorizationCaseSensitivity);
+        default:
+            return 0;
+    }
+}
+
+bool ImageSortSettings::lessThan(const ImageSortKey& left, const ImageSortKey& right) const
+{
+    int result = compare(left, right, sortRole);
+
+    if (result != 0)
+    {
+        return result < 0;
+    }
+
+    // are they identical?
+    if (left.id == right.id)
+    {
+        return false;
+    }
+
+    // Same hierarchy of sort orders as above
+    if ( (result = compare(left, right, SortByFileName)) != 0)
+    {
+        return result < 0;
+    }
+
+    if ( (result = compare(left, right, SortByCreationDate)) != 0)
+    {
+        return result < 0;
+    }
+
+    if ( (result = compare(left, right, SortByModificationDate)) != 0)
+    {
+        return result < 0;
+    }
+
+    if ( (result = compare(left, right, SortByFilePath)) != 0)
+    {
+        return result < 0;
+    }
+
+    if ( (result = compare(left, right, SortByFileSize)) != 0)
+    {
+        return result < 0;
+    }
+
+    return false;
+}
+
+int ImageSortSettings::compare(const ImageSortKey& left, const ImageSortKey& right, SortRole role) const
+{
+    switch (role)
+    {
+        case SortByFileName:
+            return naturalCompare(left.name, right.name, currentSortOrder, sortCaseSensitivity);
+        case SortByFilePath:
+
+            // The path is only read when sorting by path. Otherwise, with equal names, the album decides.
+            if (left.path.isNull() || right.path.isNull())
+            {
+                return compareByOrder(left.albumId, right.albumId, currentSortOrder);
+            }
+
+            return naturalCompare(left.path, right.path, currentSortOrder, sortCaseSensitivity);
+        case SortByFileSize:
+            return compareByOrder(left.fileSize, right.fileSize, currentSortOrder);
+        case SortByModificationDate:
+            return compareByOrder(left.modificationDate, right.modificationDate, currentSortOrder);
+        case SortByCreationDate:
+            return compareByOrder(left.creationDate, right.creationDate, currentSortOrder);
+        case SortByRating:
+            return - compareByOrder(left.rating, right.rating, currentSortOrder);
+        case SortByImageSize:
+            return compareByOrder(left.pixels, right.pixels, currentSortOrder);
+        default:
+            return 1;
+    }
+}
+
 DatabaseFields::Set ImageSortSettings::watchFlags() const
 {
     DatabaseFields::Set set;
@@ -48,6 +48,36 @@ namespace DatabaseFields
 class Set;
 }
 
+/**
+ * The values of one image needed for sorting and categorizing.
+ * Read once with ImageSortSettings::sortKey(), so that comparing
+ * does not need to go through ImageInfo again and again.
+ */
+class DIGIKAM_DATABASE_EXPORT ImageSortKey
+{
+public:
+
+    ImageSortKey()
+        : id(0), albumId(0), fileSize(0), creationDate(0), modificationDate(0), rating(0), pixels(0)
+    {
+    }
+
+    qlonglong id;
+    int       albumId;
+    QString   name;
+    /// only set if sorting by file path
+    QString   path;
+    /// only set if categorizing by format
+    QString   format;
+    qlonglong fileSize;
+    /// seconds since an arbitrary epoch, invalid dates sort first
+    qint64    creationDate;
+    qint64    modificationDate;
+    /// only set if sorting by rating resp. image size
+    int       rating;
+    qlonglong pixels;
+};
+
 class DIGIKAM_DATABASE_EXPORT ImageSortSettings
 {
 public:
@@ -80,6 +110,16 @@ public:
      */
     bool lessThan(const QVariant& left, const QVariant& right) const;
 
+    /** Reads the values from info needed to sort by the current settings.
+     *  The key is valid as long as sort role and categorization mode are not changed.
+     */
+    ImageSortKey sortKey(const ImageInfo& info) const;
+
+    /** Variants of the above methods working on precomputed sort keys */
+    int compareCategories(const ImageSortKey& left, const ImageSortKey& right) const;
+    bool lessThan(const ImageSortKey& left, const ImageSortKey& right) const;
+    int compare(const ImageSortKey& left, const ImageSortKey& right, SortRole sortRole) const;
+
     enum SortOrder
     {
         AscendingOrder = Qt::AscendingOrder,
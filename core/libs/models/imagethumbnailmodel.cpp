@@ -179,6 +179,21 @@ void ImageThumbnailModel::prepareThumbnails(const QList<QModelIndex>& indexesToP
     d->thread->findGroup(filePaths, thumbSize.size());
 }
 
+void ImageThumbnailModel::prefetchThumbnails(const QList<QModelIndex>& indexesToPrefetch, const ThumbnailSize& thumbSize)
+{
+    if (!d->thread)
+    {
+        return;
+    }
+
+    QStringList filePaths;
+    foreach(const QModelIndex& index, indexesToPrefetch)
+    {
+        filePaths << imageInfoRef(index).filePath();
+    }
+    d->thread->preloadGroup(filePaths, thumbSize.size());
+}
+
 void ImageThumbnailModel::preloadThumbnails(const QList<ImageInfo>& infos)
 {
     if (!d->preloadThread)
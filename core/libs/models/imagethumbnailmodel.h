@@ -98,6 +98,11 @@ public Q_SLOTS:
     void prepareThumbnails(const QList<QModelIndex>& indexesToPrepare);
     void prepareThumbnails(const QList<QModelIndex>& indexesToPrepare, const ThumbnailSize& thumbSize);
 
+    /** Load the thumbnails for the given indexes with low priority, after those given to prepareThumbnails.
+     *  Use for the indexes which are expected to become visible next.
+     */
+    void prefetchThumbnails(const QList<QModelIndex>& indexesToPrefetch, const ThumbnailSize& thumbSize);
+
     /**
      *  Preload thumbnail for the given infos resp. indexes.
      *  Note: Use setPreloadThumbnails to automatically preload all entries in the model.
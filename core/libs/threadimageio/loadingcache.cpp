@@ -28,8 +28,11 @@
 #include <QCoreApplication>
 #include <QEvent>
 #include <QCustomEvent>
-#include <QCache>
 #include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QTimer>
+#include <QWaitCondition>
 
 // KDE includes
 
@@ -40,35 +43,77 @@
 
 #include "iccsettings.h"
 #include "kmemoryinfo.h"
+#include "loadingcache_p.h"
+#include "previewdiskcache.h"
 
 namespace Digikam
 {
 
 class LoadingCachePriv
 {
+public:
+
+    enum { NumberOfWaitConditions = 16 };
+    enum { NumberOfCaches = 3 };
+
 public:
 
     LoadingCachePriv(LoadingCache* q) : q(q)
     {
         // Note: Don't make the mutex recursive, we need to use a wait condition on it
-        watch = 0;
+        watch      = 0;
+        adaptTimer = 0;
+
+        for (int i = 0; i < NumberOfCaches; ++i)
+        {
+            configuredSize[i] = 0;
+        }
     }
 
-    QCache<QString, DImg>           imageCache;
-    QCache<QString, QImage>         thumbnailImageCache;
-    QCache<QString, QPixmap>        thumbnailPixmapCache;
+    ShardedLoadingCache<DImg>       imageCache;
+    ShardedLoadingCache<QImage>     thumbnailImageCache;
+    ShardedLoadingCache<QPixmap>    thumbnailPixmapCache;
+
+    /// Protects the two file path hashes. Never held together with a cache shard lock.
+    QMutex                          filePathMutex;
     QMultiHash<QString, QString>    imageFilePathHash;
     QMultiHash<QString, QString>    thumbnailFilePathHash;
-    QHash<QString, LoadingProcess*> loadingDict;
+
+    /// The CacheLock: protects loadingDict and the loading processes' listeners
     QMutex                          mutex;
-    QWaitCondition                  condVar;
+    QHash<QString, LoadingProcess*> loadingDict;
+    /// Waiting on a loading process is striped by its cache key, used together with mutex
+    QWaitCondition                  condVars[NumberOfWaitConditions];
+
+    /// Protects watch. Never held when calling into the cache.
+    QMutex                          watchMutex;
     LoadingCacheFileWatch*          watch;
 
+    /// Protects the members below
+    QMutex                          sizeMutex;
+    QAtomicInt                      adaptive;
+    QTimer*                         adaptTimer;
+    /// The sizes set by the API user, in bytes
+    qint64                          configuredSize[NumberOfCaches];
+    /// The statistics at the last adaptation
+    LoadingCache::Statistics        previousStatistics[NumberOfCaches];
+
+    LoadingCache::Statistics statistics(LoadingCache::CacheType type) const;
+    void setMaxCost(LoadingCache::CacheType type, qint64 maxCost);
+    void setConfiguredSize(LoadingCache::CacheType type, qint64 size);
+    qint64 adaptedSize(LoadingCache::CacheType type, qint64 totalRam, qint64 availableRam) const;
+
     void mapImageFilePath(const QString& filePath, const QString& cacheKey);
     void mapThumbnailFilePath(const QString& filePath, const QString& cacheKey);
     void cleanUpImageFilePathHash();
     void cleanUpThumbnailFilePathHash();
-    LoadingCacheFileWatch* fileWatch();
+    void notifyAddedImage(const QString& filePath);
+    void notifyAddedThumbnail(const QString& filePath);
+
+    QWaitCondition& waitCondition(const QString& cacheKey)
+    {
+        return condVars[qHash(cacheKey) % NumberOfWaitConditions];
+    }
 
     LoadingCache* q;
 };
@@ -97,6 +142,18 @@ LoadingCache::LoadingCache()
     setCacheSize(qBound(60, int(memory.megabytes(KMemoryInfo::TotalRam)*0.05), 200));
     setThumbnailCacheSize(5, 100); // the pixmap number should not be based on system memory, it's graphics memory
 
+    d->adaptTimer = new QTimer(this);
+    d->adaptTimer->setInterval(5000);
+
+    // The timer for adaptive sizing must live in the main thread
+    if (QCoreApplication::instance() && thread() != QCoreApplication::instance()->thread())
+    {
+        moveToThread(QCoreApplication::instance()->thread());
+    }
+
+    connect(d->adaptTimer, SIGNAL(timeout()),
+            this, SLOT(adaptCacheSizes()));
+
     // good place to call it here as LoadingCache is a singleton
     qRegisterMetaType<LoadingDescription>("LoadingDescription");
     qRegisterMetaType<DImg>("DImg");
@@ -112,23 +169,31 @@ LoadingCache::~LoadingCache()
     m_instance = 0;
 }
 
-DImg* LoadingCache::retrieveImage(const QString& cacheKey)
+DImg LoadingCache::retrieveImage(const QString& cacheKey, LookupMode mode)
 {
-    return d->imageCache[cacheKey];
+    DImg img;
+    bool hit = d->imageCache.find(cacheKey, &img);
+
+    if (hit || mode == CountLookup)
+    {
+        d->imageCache.countLookup(hit);
+    }
+
+    return img;
 }
 
-bool LoadingCache::putImage(const QString& cacheKey, DImg* img, const QString& filePath)
+bool LoadingCache::putImage(const QString& cacheKey, const DImg& img, const QString& filePath)
 {
     bool successfulyInserted;
 
-    int cost = img->numBytes();
+    int cost = img.numBytes();
 
     successfulyInserted = d->imageCache.insert(cacheKey, img, cost);
 
     if (successfulyInserted && !filePath.isEmpty())
     {
         d->mapImageFilePath(filePath, cacheKey);
-        d->fileWatch()->addedImage(filePath);
+        d->notifyAddedImage(filePath);
     }
 
     return successfulyInserted;
@@ -147,7 +212,7 @@ void LoadingCache::removeImages()
 bool LoadingCache::isCacheable(const DImg* img)
 {
     // return whether image fits in cache
-    return (uint)d->imageCache.maxCost() >= img->numBytes();
+    return d->imageCache.maxCost() >= (qint64)img->numBytes();
 }
 
 void LoadingCache::addLoadingProcess(LoadingProcess* process)
@@ -177,19 +242,35 @@ void LoadingCache::notifyNewLoadingProcess(LoadingProcess* process, LoadingDescr
 void LoadingCache::setCacheSize(int megabytes)
 {
     kDebug() << "Allowing a cache size of" << megabytes << "MB";
-    d->imageCache.setMaxCost(megabytes * 1024 * 1024);
+    d->setConfiguredSize(ImageCache, (qint64)megabytes * 1024 * 1024);
 }
 
 // --- Thumbnails ----
 
-const QImage* LoadingCache::retrieveThumbnail(const QString& cacheKey) const
+QImage LoadingCache::retrieveThumbnail(const QString& cacheKey, LookupMode mode) const
 {
-    return d->thumbnailImageCache[cacheKey];
+    QImage thumb;
+    bool hit = d->thumbnailImageCache.find(cacheKey, &thumb);
+
+    if (hit || mode == CountLookup)
+    {
+        d->thumbnailImageCache.countLookup(hit);
+    }
+
+    return thumb;
 }
 
-const QPixmap* LoadingCache::retrieveThumbnailPixmap(const QString& cacheKey) const
+QPixmap LoadingCache::retrieveThumbnailPixmap(const QString& cacheKey, LookupMode mode) const
 {
-    return d->thumbnailPixmapCache[cacheKey];
+    QPixmap thumb;
+    bool hit = d->thumbnailPixmapCache.find(cacheKey, &thumb);
+
+    if (hit || mode == CountLookup)
+    {
+        d->thumbnailPixmapCache.countLookup(hit);
+    }
+
+    return thumb;
 }
 
 bool LoadingCache::hasThumbnailPixmap(const QString& cacheKey) const
@@ -201,22 +282,21 @@ void LoadingCache::putThumbnail(const QString& cacheKey, const QImage& thumb, co
 {
     int cost = thumb.numBytes();
 
-    if (d->thumbnailImageCache.insert(cacheKey, new QImage(thumb), cost))
+    if (d->thumbnailImageCache.insert(cacheKey, thumb, cost))
     {
         d->mapThumbnailFilePath(filePath, cacheKey);
-        d->fileWatch()->addedThumbnail(filePath);
+        d->notifyAddedThumbnail(filePath);
     }
-
 }
 
 void LoadingCache::putThumbnail(const QString& cacheKey, const QPixmap& thumb, const QString& filePath)
 {
     int cost = thumb.width() * thumb.height() * thumb.depth() / 8;
 
-    if (d->thumbnailPixmapCache.insert(cacheKey, new QPixmap(thumb), cost))
+    if (d->thumbnailPixmapCache.insert(cacheKey, thumb, cost))
     {
         d->mapThumbnailFilePath(filePath, cacheKey);
-        d->fileWatch()->addedThumbnail(filePath);
+        d->notifyAddedThumbnail(filePath);
     }
 }
 
@@ -234,33 +314,126 @@ void LoadingCache::removeThumbnails()
 
 void LoadingCache::setThumbnailCacheSize(int numberOfQImages, int numberOfQPixmaps)
 {
-    d->thumbnailImageCache.setMaxCost(numberOfQImages * 256 * 256 * 4);
-    d->thumbnailPixmapCache.setMaxCost(numberOfQPixmaps * 256 * 256 * QPixmap::defaultDepth() / 8);
+    d->setConfiguredSize(ThumbnailImageCache, (qint64)numberOfQImages * 256 * 256 * 4);
+    d->setConfiguredSize(ThumbnailPixmapCache, (qint64)numberOfQPixmaps * 256 * 256 * QPixmap::defaultDepth() / 8);
+}
+
+// --- Adaptive sizing ----
+
+LoadingCache::Statistics LoadingCache::statistics(CacheType type) const
+{
+    return d->statistics(type);
+}
+
+void LoadingCache::setAdaptiveSizing(bool enable)
+{
+    {
+        QMutexLocker lock(&d->sizeMutex);
+
+        if (enable == (bool)d->adaptive)
+        {
+            return;
+        }
+
+        d->adaptive = enable;
+
+        for (int i = 0; i < LoadingCachePriv::NumberOfCaches; ++i)
+        {
+            CacheType type = (CacheType)i;
+
+            if (enable)
+            {
+                d->previousStatistics[i] = d->statistics(type);
+            }
+            else
+            {
+                d->setMaxCost(type, d->configuredSize[i]);
+            }
+        }
+    }
+
+    // QTimer is not thread-safe, start and stop it in its own thread
+    QMetaObject::invokeMethod(d->adaptTimer, enable ? "start" : "stop", Qt::QueuedConnection);
+}
+
+bool LoadingCache::isAdaptiveSizing() const
+{
+    return d->adaptive;
+}
+
+void LoadingCache::adaptCacheSizes()
+{
+    KMemoryInfo memory = KMemoryInfo::currentInfo();
+
+    if (!memory.isValid())
+    {
+        return;
+    }
+
+    qint64 totalRam     = memory.bytes(KMemoryInfo::TotalRam);
+    qint64 availableRam = memory.bytes(KMemoryInfo::AvailableRam);
+
+    QMutexLocker lock(&d->sizeMutex);
+
+    if (!d->adaptive)
+    {
+        return;
+    }
+
+    for (int i = 0; i < LoadingCachePriv::NumberOfCaches; ++i)
+    {
+        CacheType type = (CacheType)i;
+        qint64 size    = d->adaptedSize(type, totalRam, availableRam);
+
+        if (size != d->statistics(type).maxSize)
+        {
+            kDebug() << "Adapting size of cache" << i << "to" << size / 1024 << "kB, available memory"
+                     << availableRam / 1024 / 1024 << "MB";
+            d->setMaxCost(type, size);
+        }
+
+        d->previousStatistics[i] = d->statistics(type);
+    }
 }
 
 void LoadingCache::setFileWatch(LoadingCacheFileWatch* watch)
 {
-    delete d->watch;
-    d->watch = watch;
-    d->watch->m_cache = this;
+    LoadingCacheFileWatch* oldWatch = 0;
+    {
+        QMutexLocker lock(&d->watchMutex);
+        oldWatch         = d->watch;
+        d->watch         = watch;
+        d->watch->m_cache = this;
+    }
+
+    // the destructor acquires watchMutex
+    delete oldWatch;
 }
 
 QStringList LoadingCache::imageFilePathsInCache() const
 {
     d->cleanUpImageFilePathHash();
+    QMutexLocker lock(&d->filePathMutex);
     return d->imageFilePathHash.uniqueKeys();
 }
 
 QStringList LoadingCache::thumbnailFilePathsInCache() const
 {
     d->cleanUpThumbnailFilePathHash();
+    QMutexLocker lock(&d->filePathMutex);
     return d->thumbnailFilePathHash.uniqueKeys();
 }
 
 void LoadingCache::notifyFileChanged(const QString& filePath)
 {
-    QList<QString> keys = d->imageFilePathHash.values(filePath);
-    foreach(const QString& cacheKey, keys)
+    QList<QString> imageKeys, thumbnailKeys;
+    {
+        QMutexLocker lock(&d->filePathMutex);
+        imageKeys     = d->imageFilePathHash.values(filePath);
+        thumbnailKeys = d->thumbnailFilePathHash.values(filePath);
+    }
+
+    foreach(const QString& cacheKey, imageKeys)
     {
         if (d->imageCache.remove(cacheKey))
         {
@@ -268,8 +441,7 @@ void LoadingCache::notifyFileChanged(const QString& filePath)
         }
     }
 
-    keys = d->thumbnailFilePathHash.values(filePath);
-    foreach(const QString& cacheKey, keys)
+    foreach(const QString& cacheKey, thumbnailKeys)
     {
         if (d->thumbnailImageCache.remove(cacheKey) ||
             d->thumbnailPixmapCache.remove(cacheKey))
@@ -278,37 +450,165 @@ void LoadingCache::notifyFileChanged(const QString& filePath)
         }
     }
 
+    // the second level cache
+    PreviewDiskCache::instance()->removeFile(filePath);
+
     emit fileChanged(filePath);
 }
 
-LoadingCacheFileWatch* LoadingCachePriv::fileWatch()
+template <class T>
+static LoadingCache::Statistics cacheStatistics(const ShardedLoadingCache<T>& cache)
 {
+    LoadingCache::Statistics stats;
+    stats.size      = cache.totalCost();
+    stats.maxSize   = cache.maxCost();
+    stats.count     = cache.count();
+    stats.hits      = cache.hits();
+    stats.misses    = cache.misses();
+    stats.evictions = cache.evictions();
+    return stats;
+}
+
+LoadingCache::Statistics LoadingCachePriv::statistics(LoadingCache::CacheType type) const
+{
+    switch (type)
+    {
+        case LoadingCache::ImageCache:
+            return cacheStatistics(imageCache);
+        case LoadingCache::ThumbnailImageCache:
+            return cacheStatistics(thumbnailImageCache);
+        case LoadingCache::ThumbnailPixmapCache:
+            return cacheStatistics(thumbnailPixmapCache);
+    }
+
+    return LoadingCache::Statistics();
+}
+
+void LoadingCachePriv::setMaxCost(LoadingCache::CacheType type, qint64 maxCost)
+{
+    switch (type)
+    {
+        case LoadingCache::ImageCache:
+            imageCache.setMaxCost(maxCost);
+            break;
+        case LoadingCache::ThumbnailImageCache:
+            thumbnailImageCache.setMaxCost(maxCost);
+            break;
+        case LoadingCache::ThumbnailPixmapCache:
+            thumbnailPixmapCache.setMaxCost(maxCost);
+            break;
+    }
+}
+
+void LoadingCachePriv::setConfiguredSize(LoadingCache::CacheType type, qint64 size)
+{
+    QMutexLocker lock(&sizeMutex);
+    configuredSize[type] = size;
+    // In adaptive mode, adaptation starts again from the configured size
+    setMaxCost(type, size);
+}
+
+qint64 LoadingCachePriv::adaptedSize(LoadingCache::CacheType type, qint64 totalRam, qint64 availableRam) const
+{
+    LoadingCache::Statistics current        = statistics(type);
+    const LoadingCache::Statistics& previous = previousStatistics[type];
+
+    // Below the low watermark of available memory the caches shrink, above the high watermark they may grow
+    qint64 lowWatermark  = totalRam / 10;
+    qint64 highWatermark = totalRam / 4;
+
+    // The image cache may take a quarter of the memory.
+    // Thumbnails are small, and pixmaps take graphics memory: allow eight times the configured size.
+    qint64 minimum = configuredSize[type] / 4;
+    qint64 maximum = (type == LoadingCache::ImageCache) ? totalRam / 4 : qMin(8 * configuredSize[type], totalRam / 20);
+    maximum        = qMax(maximum, configuredSize[type]);
+
+    qint64 size    = current.maxSize;
+
+    if (availableRam < lowWatermark)
+    {
+        // Give back at least a quarter per interval, or all that is missing to the watermark
+        size = qMin(current.size * 3 / 4, current.size - (lowWatermark - availableRam));
+    }
+    else if (availableRam > highWatermark)
+    {
+        int hits      = current.hits      - previous.hits;
+        int misses    = current.misses    - previous.misses;
+        int evictions = current.evictions - previous.evictions;
+
+        // The cache is too small if it had to evict entries and the hit rate is below 90%
+        if (evictions > 0 && misses * 10 > hits + misses)
+        {
+            size = current.maxSize + qMin(current.maxSize / 2, availableRam - highWatermark);
+        }
+    }
+
+    return qBound(minimum, size, maximum);
+}
+
+void LoadingCachePriv::notifyAddedImage(const QString& filePath)
+{
+    LoadingCacheFileWatch* w = 0;
+    {
+        QMutexLocker lock(&watchMutex);
+        w = watch;
+    }
+
     // install default watch if no watch is set yet
-    if (!watch)
+    if (!w)
     {
         q->setFileWatch(new ClassicLoadingCacheFileWatch);
     }
 
-    return watch;
+    QMutexLocker lock(&watchMutex);
+    watch->addedImage(filePath);
+}
+
+void LoadingCachePriv::notifyAddedThumbnail(const QString& filePath)
+{
+    QMutexLocker lock(&watchMutex);
+
+    if (watch)
+    {
+        watch->addedThumbnail(filePath);
+    }
 }
 
 void LoadingCachePriv::mapImageFilePath(const QString& filePath, const QString& cacheKey)
 {
-    if (imageFilePathHash.size() > 5*imageCache.size())
+    int cached = imageCache.count();
     {
-        cleanUpImageFilePathHash();
+        QMutexLocker lock(&filePathMutex);
+
+        if (imageFilePathHash.size() <= 5*cached)
+        {
+            imageFilePathHash.insert(filePath, cacheKey);
+            return;
+        }
     }
 
+    cleanUpImageFilePathHash();
+
+    QMutexLocker lock(&filePathMutex);
     imageFilePathHash.insert(filePath, cacheKey);
 }
 
 void LoadingCachePriv::mapThumbnailFilePath(const QString& filePath, const QString& cacheKey)
 {
-    if (thumbnailFilePathHash.size() > 5*(thumbnailImageCache.size() + thumbnailPixmapCache.size()))
+    int cached = thumbnailImageCache.count() + thumbnailPixmapCache.count();
     {
-        cleanUpThumbnailFilePathHash();
+        QMutexLocker lock(&filePathMutex);
+
+        if (thumbnailFilePathHash.size() <= 5*cached)
+        {
+            thumbnailFilePathHash.insert(filePath, cacheKey);
+            return;
+        }
     }
 
+    cleanUpThumbnailFilePathHash();
+
+    QMutexLocker lock(&filePathMutex);
     thumbnailFilePathHash.insert(filePath, cacheKey);
 }
 
@@ -316,6 +616,8 @@ void LoadingCachePriv::cleanUpImageFilePathHash()
 {
     // Remove all entries from hash whose value is no longer a key in the cache
     QSet<QString> keys = imageCache.keys().toSet();
+
+    QMutexLocker lock(&filePathMutex);
     QMultiHash<QString, QString>::iterator it;
 
     for (it = imageFilePathHash.begin(); it != imageFilePathHash.end(); )
@@ -336,6 +638,8 @@ void LoadingCachePriv::cleanUpThumbnailFilePathHash()
     QSet<QString> keys;
     keys += thumbnailImageCache.keys().toSet();
     keys += thumbnailPixmapCache.keys().toSet();
+
+    QMutexLocker lock(&filePathMutex);
     QMultiHash<QString, QString>::iterator it;
 
     for (it = thumbnailFilePathHash.begin(); it != thumbnailFilePathHash.end(); )
@@ -357,7 +661,6 @@ void LoadingCache::iccSettingsChanged(const ICCSettingsContainer& current, const
         current.useManagedPreviews != previous.useManagedPreviews ||
         current.monitorProfile != previous.monitorProfile)
     {
-        LoadingCache::CacheLock lock(this);
         removeImages();
         removeThumbnails();
     }
@@ -369,7 +672,7 @@ LoadingCacheFileWatch::~LoadingCacheFileWatch()
 {
     if (m_cache)
     {
-        LoadingCache::CacheLock lock(m_cache);
+        QMutexLocker lock(&m_cache->d->watchMutex);
 
         if (m_cache->d->watch == this)
         {
@@ -382,7 +685,6 @@ void LoadingCacheFileWatch::notifyFileChanged(const QString& filePath)
 {
     if (m_cache)
     {
-        LoadingCache::CacheLock lock(m_cache);
         m_cache->notifyFileChanged(filePath);
     }
 }
@@ -452,9 +754,7 @@ void ClassicLoadingCacheFileWatch::slotFileDirty(const QString& path)
 
 void ClassicLoadingCacheFileWatch::slotUpdateDirWatch()
 {
-    // Event comes from main thread, we need to lock ourselves.
-    LoadingCache::CacheLock lock(m_cache);
-
+    // Event comes from main thread. The cache is thread-safe.
     // get a list of files in cache that need m_watch
     QStringList toBeAdded;
     QStringList toBeRemoved = m_watchedFiles;
@@ -501,16 +801,16 @@ LoadingCache::CacheLock::~CacheLock()
     m_cache->d->mutex.unlock();
 }
 
-void LoadingCache::CacheLock::wakeAll()
+void LoadingCache::CacheLock::wakeAll(const QString& cacheKey)
 {
     // obviously the mutex is locked when this function is called
-    m_cache->d->condVar.wakeAll();
+    m_cache->d->waitCondition(cacheKey).wakeAll();
 }
 
-void LoadingCache::CacheLock::timedWait()
+void LoadingCache::CacheLock::timedWait(const QString& cacheKey)
 {
     // same as above, the mutex is certainly locked
-    m_cache->d->condVar.wait(&m_cache->d->mutex, 1000);
+    m_cache->d->waitCondition(cacheKey).wait(&m_cache->d->mutex, 1000);
 }
 
 }   // namespace Digikam
@@ -128,7 +128,13 @@ public:
     static void cleanUp();
     virtual ~LoadingCache();
 
-    /// !! All methods of LoadingCache shall only be called when a CacheLock is held !!
+    /**
+     * Retrieving, putting and removing images and thumbnails is thread-safe
+     * and does not need a CacheLock. The caches are partitioned in shards by cache key,
+     * each with its own lock and LRU list, so that threads loading different images do not contend.
+     *
+     * !! The loading process management methods shall only be called when a CacheLock is held !!
+     */
 
     class DIGIKAM_EXPORT CacheLock
     {
@@ -136,29 +142,43 @@ public:
 
         CacheLock(LoadingCache* cache);
         ~CacheLock();
-        void wakeAll();
-        void timedWait();
+
+        /// Wakes all threads waiting for the loading process of the given cache key
+        void wakeAll(const QString& cacheKey);
+        /// Waits, for at most one second, until woken for the loading process of the given cache key
+        void timedWait(const QString& cacheKey);
 
     private:
 
         LoadingCache* m_cache;
     };
 
+    enum LookupMode
+    {
+        /// The lookup decides the request: a hit or a miss is counted in the statistics
+        CountLookup,
+        /**
+         * Only a hit is counted. For a lookup which, on a miss, is followed by another
+         * lookup for the same request, e.g. again after taking the CacheLock, or for another key.
+         */
+        CountHitOnly
+    };
+
     /**
      * Retrieves an image for the given string from the cache,
-     * or 0 if no image is found.
+     * or a null image if no image is found.
+     * DImg is explicitly shared: do not modify the returned image, make a copy.
      */
-    DImg* retrieveImage(const QString& cacheKey);
+    DImg retrieveImage(const QString& cacheKey, LookupMode mode = CountLookup);
     /// Returns whether the given DImg fits in the cache.
     bool isCacheable(const DImg* img);
     /** Put image into for given string into the cache.
      *  Returns true if image has been put in the cache, false otherwise.
-     *  Ownership of the DImg instance is passed to the cache.
-     *  When it cannot be put in the cache it is deleted.
+     *  The image is shared with the cache, it must not be modified afterwards.
      *  The third parameter specifies a file path that will be watched.
      *  If this file changes, the object will be removed from the cache.
      */
-    bool putImage(const QString& cacheKey, DImg* img, const QString& filePath);
+    bool putImage(const QString& cacheKey, const DImg& img, const QString& filePath);
     /**
      *  Remove entries for the given cacheKey from the cache
      */
@@ -200,10 +220,10 @@ public:
     /// QPixmaps can only be accessed from the main thread, so the tasks cannot access this cache.
     /**
      * Retrieves a thumbnail for the given filePath from the thumbnail cache,
-     * or a 0 if the thumbnail is not found.
+     * or a null image if the thumbnail is not found.
      */
-    const QImage* retrieveThumbnail(const QString& cacheKey) const;
-    const QPixmap* retrieveThumbnailPixmap(const QString& cacheKey) const;
+    QImage retrieveThumbnail(const QString& cacheKey, LookupMode mode = CountLookup) const;
+    QPixmap retrieveThumbnailPixmap(const QString& cacheKey, LookupMode mode = CountLookup) const;
     bool hasThumbnailPixmap(const QString& cacheKey) const;
 
     /**
@@ -234,6 +254,52 @@ public:
      */
     void setThumbnailCacheSize(int numberOfQImages, int numberOfQPixmaps);
 
+    // ------- Adaptive sizing and statistics -----------------------------------
+
+    enum CacheType
+    {
+        ImageCache,
+        ThumbnailImageCache,
+        ThumbnailPixmapCache
+    };
+
+    class DIGIKAM_EXPORT Statistics
+    {
+    public:
+
+        Statistics()
+            : size(0), maxSize(0), count(0), hits(0), misses(0), evictions(0)
+        {
+        }
+
+        /// Current and maximum size in bytes
+        qint64 size;
+        qint64 maxSize;
+        /// Number of cached entries
+        int    count;
+        /// Counted since the creation of the cache
+        int    hits;
+        int    misses;
+        int    evictions;
+    };
+
+    /**
+     * Returns the current size and the hit, miss and eviction counts of the given cache.
+     */
+    Statistics statistics(CacheType type) const;
+
+    /**
+     * Enables or disables adaptive sizing. If enabled, the available system memory
+     * and the hit rate of the caches are checked periodically.
+     * A cache which evicts entries although they are requested again is grown,
+     * as long as enough memory is available. If memory runs short, all caches are shrunk.
+     * The sizes set with setCacheSize and setThumbnailCacheSize are used as starting point.
+     * When disabled, these sizes are restored.
+     * Default: disabled.
+     */
+    void setAdaptiveSizing(bool enable);
+    bool isAdaptiveSizing() const;
+
     // ------- File Watch Management -----------------------------------
 
     /**
@@ -250,7 +316,7 @@ public:
 
     /**
      * Remove all entries from cache that were loaded from filePath.
-     * Emits relevant signals.
+     * Emits relevant signals. Does not need a CacheLock.
      */
     void notifyFileChanged(const QString& filePath);
 
@@ -272,6 +338,7 @@ Q_SIGNALS:
 private Q_SLOTS:
 
     void iccSettingsChanged(const ICCSettingsContainer& current, const ICCSettingsContainer& previous);
+    void adaptCacheSizes();
 
 private:
 
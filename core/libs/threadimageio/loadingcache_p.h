@@ -0,0 +1,470 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-10
+ * Description : sharded storage of the loading cache
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef LOADING_CACHE_P_H
+#define LOADING_CACHE_P_H
+
+// Qt includes
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QString>
+#include <QStringList>
+
+namespace Digikam
+{
+
+/** A list of cache entries in the order of their last use.
+ *  Values are stored by value; DImg, QImage and QPixmap are shared, so copies are cheap.
+ *  Not thread-safe.
+ */
+template <class T>
+class LoadingCacheLru
+{
+public:
+
+    LoadingCacheLru()
+        : first(0), last(0), totalCost(0)
+    {
+    }
+
+    ~LoadingCacheLru()
+    {
+        QList<T> garbage;
+        clear(garbage);
+    }
+
+    int count() const
+    {
+        return hash.size();
+    }
+
+    qint64 cost() const
+    {
+        return totalCost;
+    }
+
+    bool contains(const QString& key) const
+    {
+        return hash.contains(key);
+    }
+
+    /// Returns the value for key, and marks it as most recently used
+    bool find(const QString& key, T* value)
+    {
+        Node* node = hash.value(key);
+
+        if (!node)
+        {
+            return false;
+        }
+
+        unlink(node);
+        prepend(node);
+        *value = node->value;
+        return true;
+    }
+
+    /// Adds a new entry as most recently used. key must not be contained.
+    void insert(const QString& key, const T& value, int cost)
+    {
+        Node* node  = new Node;
+        node->key   = key;
+        node->value = value;
+        node->cost  = cost;
+        prepend(node);
+        hash.insert(key, node);
+        totalCost  += cost;
+    }
+
+    /// Removes the entry for key. Returns its cost, or -1 if key is not contained.
+    int remove(const QString& key, QList<T>& garbage)
+    {
+        Node* node = hash.take(key);
+
+        if (!node)
+        {
+            return -1;
+        }
+
+        return destroy(node, garbage);
+    }
+
+    /// Removes the least recently used entry. Returns its cost, or -1 if empty.
+    int removeLast(QList<T>& garbage)
+    {
+        if (!last)
+        {
+            return -1;
+        }
+
+        hash.remove(last->key);
+        return destroy(last, garbage);
+    }
+
+    void clear(QList<T>& garbage)
+    {
+        while (last)
+        {
+            removeLast(garbage);
+        }
+    }
+
+    QStringList keys() const
+    {
+        return hash.keys();
+    }
+
+private:
+
+    class Node
+    {
+    public:
+
+        QString key;
+        T       value;
+        int     cost;
+        Node*   previous;
+        Node*   next;
+    };
+
+    void prepend(Node* node)
+    {
+        node->previous = 0;
+        node->next     = first;
+
+        if (first)
+        {
+            first->previous = node;
+        }
+
+        first = node;
+
+        if (!last)
+        {
+            last = node;
+        }
+    }
+
+    void unlink(Node* node)
+    {
+        if (node->previous)
+        {
+            node->previous->next = node->next;
+        }
+        else
+        {
+            first = node->next;
+        }
+
+        if (node->next)
+        {
+            node->next->previous = node->previous;
+        }
+        else
+        {
+            last = node->previous;
+        }
+    }
+
+    int destroy(Node* node, QList<T>& garbage)
+    {
+        unlink(node);
+        // The value is released by the caller, when no lock is held any more
+        garbage << node->value;
+        int cost   = node->cost;
+        totalCost -= cost;
+        delete node;
+        return cost;
+    }
+
+private:
+
+    Q_DISABLE_COPY(LoadingCacheLru)
+
+    QHash<QString, Node*> hash;
+    Node*                 first;
+    Node*                 last;
+    qint64                totalCost;
+};
+
+// ---------------------------------------------------------------------------------------------------
+
+/** A thread-safe cache with least-recently-used replacement and a memory budget.
+ *  The entries are partitioned in shards by the hash of their key.
+ *  Each shard has its own lock and its own LRU list, so threads working on different keys
+ *  do not contend. The budget is enforced across all shards: if it is exceeded,
+ *  the least recently used entries of the inserting shard are removed first, then those of the other shards.
+ *  No two shard locks are ever held at the same time.
+ *
+ *  Costs are in bytes. Hits, misses and evictions are counted for monitoring and adaptive sizing.
+ */
+template <class T>
+class ShardedLoadingCache
+{
+public:
+
+    enum { NumberOfShards = 16 };
+
+public:
+
+    ShardedLoadingCache()
+        : m_maxCost(0), m_totalCost(0), m_count(0)
+    {
+    }
+
+    bool find(const QString& key, T* value)
+    {
+        Shard& s = shard(key);
+        QMutexLocker locker(&s.mutex);
+
+        return s.lru.find(key, value);
+    }
+
+    /** Counts a hit or a miss. Callers count once per logical lookup,
+     *  not per call of find(), which may be repeated for the same request.
+     */
+    void countLookup(bool hit)
+    {
+        if (hit)
+        {
+            m_hits.fetchAndAddRelaxed(1);
+        }
+        else
+        {
+            m_misses.fetchAndAddRelaxed(1);
+        }
+    }
+
+    bool contains(const QString& key)
+    {
+        Shard& s = shard(key);
+        QMutexLocker locker(&s.mutex);
+        return s.lru.contains(key);
+    }
+
+    /** Inserts value for key, replacing any previous value.
+     *  Returns false, as QCache does, if the cost exceeds the total budget.
+     */
+    bool insert(const QString& key, const T& value, int cost)
+    {
+        // released after all locks
+        QList<T> garbage;
+
+        if (cost > maxCost())
+        {
+            return false;
+        }
+
+        {
+            Shard& s = shard(key);
+            QMutexLocker locker(&s.mutex);
+
+            int removedCost = s.lru.remove(key, garbage);
+
+            if (removedCost != -1)
+            {
+                account(-removedCost, -1);
+            }
+
+            s.lru.insert(key, value, cost);
+            account(cost, 1);
+
+            // keep the entry just inserted
+            while (overBudget() && s.lru.count() > 1)
+            {
+                account(-s.lru.removeLast(garbage), -1);
+                m_evictions.fetchAndAddRelaxed(1);
+            }
+        }
+
+        enforceBudget(garbage);
+        return true;
+    }
+
+    bool remove(const QString& key)
+    {
+        QList<T> garbage;
+        Shard&   s = shard(key);
+        QMutexLocker locker(&s.mutex);
+
+        int removedCost = s.lru.remove(key, garbage);
+
+        if (removedCost == -1)
+        {
+            return false;
+        }
+
+        account(-removedCost, -1);
+        return true;
+    }
+
+    void clear()
+    {
+        QList<T> garbage;
+
+        for (int i = 0; i < NumberOfShards; ++i)
+        {
+            QMutexLocker locker(&m_shards[i].mutex);
+            account(-m_shards[i].lru.cost(), -m_shards[i].lru.count());
+            m_shards[i].lru.clear(garbage);
+        }
+    }
+
+    void setMaxCost(qint64 maxCost)
+    {
+        {
+            QMutexLocker locker(&m_accountingMutex);
+            m_maxCost = maxCost;
+        }
+
+        QList<T> garbage;
+        enforceBudget(garbage);
+    }
+
+    qint64 maxCost() const
+    {
+        QMutexLocker locker(&m_accountingMutex);
+        return m_maxCost;
+    }
+
+    qint64 totalCost() const
+    {
+        QMutexLocker locker(&m_accountingMutex);
+        return m_totalCost;
+    }
+
+    int count() const
+    {
+        QMutexLocker locker(&m_accountingMutex);
+        return m_count;
+    }
+
+    int hits() const
+    {
+        return m_hits;
+    }
+
+    int misses() const
+    {
+        return m_misses;
+    }
+
+    int evictions() const
+    {
+        return m_evictions;
+    }
+
+    QStringList keys()
+    {
+        QStringList keys;
+
+        for (int i = 0; i < NumberOfShards; ++i)
+        {
+            QMutexLocker locker(&m_shards[i].mutex);
+            keys += m_shards[i].lru.keys();
+        }
+
+        return keys;
+    }
+
+private:
+
+    class Shard
+    {
+    public:
+
+        QMutex             mutex;
+        LoadingCacheLru<T> lru;
+    };
+
+    Shard& shard(const QString& key)
+    {
+        return m_shards[qHash(key) % NumberOfShards];
+    }
+
+    void account(qint64 cost, int count)
+    {
+        QMutexLocker locker(&m_accountingMutex);
+        m_totalCost += cost;
+        m_count     += count;
+    }
+
+    bool overBudget() const
+    {
+        QMutexLocker locker(&m_accountingMutex);
+        return m_totalCost > m_maxCost;
+    }
+
+    /** Removes the least recently used entries of all shards, round-robin, until the budget is met.
+     *  Must be called without a shard lock held.
+     */
+    void enforceBudget(QList<T>& garbage)
+    {
+        int emptyShards = 0;
+
+        while (emptyShards < NumberOfShards && overBudget())
+        {
+            Shard& s = m_shards[(int)((uint)m_nextVictim.fetchAndAddRelaxed(1) % NumberOfShards)];
+            QMutexLocker locker(&s.mutex);
+
+            int removedCost = s.lru.removeLast(garbage);
+
+            if (removedCost == -1)
+            {
+                ++emptyShards;
+            }
+            else
+            {
+                account(-removedCost, -1);
+                m_evictions.fetchAndAddRelaxed(1);
+                emptyShards = 0;
+            }
+        }
+    }
+
+private:
+
+    Q_DISABLE_COPY(ShardedLoadingCache)
+
+    Shard          m_shards[NumberOfShards];
+
+    /// Protects the three members below. Held only for a few instructions.
+    mutable QMutex m_accountingMutex;
+    qint64         m_maxCost;
+    qint64         m_totalCost;
+    int            m_count;
+
+    QAtomicInt     m_nextVictim;
+
+    QAtomicInt     m_hits;
+    QAtomicInt     m_misses;
+    QAtomicInt     m_evictions;
+};
+
+}   // namespace Digikam
+
+#endif // LOADING_CACHE_P_H
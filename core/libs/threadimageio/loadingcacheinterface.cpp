@@ -43,7 +43,6 @@ void LoadingCacheInterface::cleanUp()
 void LoadingCacheInterface::fileChanged(const QString& filePath)
 {
     LoadingCache* cache = LoadingCache::cache();
-    LoadingCache::CacheLock lock(cache);
     cache->notifyFileChanged(filePath);
 
     /* old implementation
@@ -61,32 +60,29 @@ void LoadingCacheInterface::connectToSignalFileChanged(QObject* object, const ch
     QObject::connect(cache, SIGNAL(fileChanged(const QString&)),
                      object, slot,
                      Qt::QueuedConnection);
-    // make it a queued connection because the signal is emitted when the CacheLock is held!
+    // make it a queued connection because the signal is emitted from loading threads
 }
 
 void LoadingCacheInterface::cleanCache()
 {
     LoadingCache* cache = LoadingCache::cache();
-    LoadingCache::CacheLock lock(cache);
     cache->removeImages();
 }
 
 void LoadingCacheInterface::cleanThumbnailCache()
 {
     LoadingCache* cache = LoadingCache::cache();
-    LoadingCache::CacheLock lock(cache);
     cache->removeThumbnails();
 }
 
 void LoadingCacheInterface::putImage(const QString& filePath, const DImg& img)
 {
     LoadingCache* cache = LoadingCache::cache();
-    LoadingCache::CacheLock lock(cache);
 
     if (cache->isCacheable(&img))
     {
-        DImg* copy = new DImg(img);
-        copy->detach();
+        DImg copy = img;
+        copy.detach();
         cache->putImage(filePath, copy, filePath);
     }
 }
@@ -94,8 +90,12 @@ void LoadingCacheInterface::putImage(const QString& filePath, const DImg& img)
 void LoadingCacheInterface::setCacheOptions(int cacheSize)
 {
     LoadingCache* cache = LoadingCache::cache();
-    LoadingCache::CacheLock lock(cache);
     cache->setCacheSize(cacheSize);
 }
 
+void LoadingCacheInterface::setAdaptiveCacheSizing(bool enable)
+{
+    LoadingCache::cache()->setAdaptiveSizing(enable);
+}
+
 }   // namespace Digikam
@@ -73,6 +73,11 @@ public:
      * Set to 0 to disable caching.
      */
     static void setCacheOptions(int cacheSize);
+    /**
+     * Enable or disable adaptive sizing of the caches, depending on
+     * available memory and hit rate. The cache size set above is the starting point.
+     */
+    static void setAdaptiveCacheSizing(bool enable);
 };
 
 }   // namespace Digikam
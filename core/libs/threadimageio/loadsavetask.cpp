@@ -102,100 +102,33 @@ void SharedLoadingTask::execute()
     // send StartedLoadingEvent from each single Task, not via LoadingProcess list
     m_thread->imageStartedLoading(m_loadingDescription);
 
-    LoadingCache* cache = LoadingCache::cache();
+    LoadingCache* cache    = LoadingCache::cache();
+    QStringList lookupKeys = m_loadingDescription.lookupCacheKeys();
+
+    // The cache itself is thread-safe. Only take the CacheLock if the image is not cached.
+    DImg cachedImg         = findCachedImage(cache, lookupKeys, LoadingCache::CountHitOnly);
+
+    if (cachedImg.isNull())
     {
         LoadingCache::CacheLock lock(cache);
 
-        // find possible cached images
-        DImg* cachedImg = 0;
-        QStringList lookupKeys = m_loadingDescription.lookupCacheKeys();
-        foreach (const QString& key, lookupKeys)
-        {
-            if ( (cachedImg = cache->retrieveImage(key)) )
-            {
-                if (m_loadingDescription.needCheckRawDecoding())
-                {
-                    if (cachedImg->rawDecodingSettings() == m_loadingDescription.rawDecodingSettings)
-                    {
-                        break;
-                    }
-                    else
-                    {
-                        cachedImg = 0;
-                    }
-                }
-                else
-                {
-                    break;
-                }
-            }
-        }
+        // The image may have been put into the cache meanwhile, before its loading process was removed
+        cachedImg = findCachedImage(cache, lookupKeys);
 
-        if (cachedImg)
+        if (cachedImg.isNull())
         {
-            // image is found in image cache, loading is successful
-            m_img = *cachedImg;
-
-            if (accessMode() == LoadSaveThread::AccessModeReadWrite)
-            {
-                m_img = m_img.copy();
-            }
-
-            // continues after else clause...
+            attachToLoadingProcess(lock, cache, lookupKeys);
         }
-        else
-        {
-            // find possible running loading process
-            m_usedProcess = 0;
+    }
 
-            for ( QStringList::Iterator it = lookupKeys.begin(); it != lookupKeys.end(); ++it )
-            {
-                if ( (m_usedProcess = cache->retrieveLoadingProcess(*it)) )
-                {
-                    break;
-                }
-            }
+    if (!cachedImg.isNull())
+    {
+        // image is found in image cache, loading is successful
+        m_img = cachedImg;
 
-            if (m_usedProcess)
-            {
-                // Other process is right now loading this image.
-                // Add this task to the list of listeners and
-                // attach this thread to the other thread, wait until loading
-                // has finished.
-                m_usedProcess->addListener(this);
-
-                // break loop when either the loading has completed, or this task is being stopped
-                while ( m_loadingTaskStatus != LoadingTaskStatusStopping && m_usedProcess && !m_usedProcess->completed() )
-                {
-                    lock.timedWait();
-                }
-
-                // remove listener from process
-                if (m_usedProcess)
-                {
-                    m_usedProcess->removeListener(this);
-                }
-
-                // wake up the process which is waiting until all listeners have removed themselves
-                lock.wakeAll();
-                // set to 0, as checked in setStatus
-                m_usedProcess = 0;
-                //kDebug() << "SharedLoadingTask " << this << ": waited";
-                // m_img is now set to the result
-            }
-            else
-            {
-                // Neither in cache, nor currently loading in different thread.
-                // Load it here and now, add this LoadingProcess to cache list.
-                cache->addLoadingProcess(this);
-                // Add this to the list of listeners
-                addListener(this);
-                // for use in setStatus
-                m_usedProcess = this;
-                // Notify other processes that we are now loading this image.
-                // They might be interested - see notifyNewLoadingProcess below
-                cache->notifyNewLoadingProcess(this, m_loadingDescription);
-            }
+        if (accessMode() == LoadSaveThread::AccessModeReadWrite)
+        {
+            m_img = m_img.copy();
         }
     }
 
@@ -211,22 +144,18 @@ void SharedLoadingTask::execute()
     // load image
     m_img = DImg(m_loadingDescription.filePath, this, m_loadingDescription.rawDecodingSettings);
 
-    bool isCached = false;
+    // put (valid) image into cache of loaded images.
+    // This is done before the loading process is removed, so that there is no moment
+    // in which the image is neither cached nor being loaded.
+    if (!m_img.isNull())
     {
-        LoadingCache::CacheLock lock(cache);
-
-        // put (valid) image into cache of loaded images
-        if (!m_img.isNull())
-        {
-            isCached = cache->putImage(m_loadingDescription.cacheKey(), new DImg(m_img), m_loadingDescription.filePath);
-        }
-
-        // remove this from the list of loading processes in cache
-        cache->removeLoadingProcess(this);
+        cache->putImage(m_loadingDescription.cacheKey(), m_img, m_loadingDescription.filePath);
     }
 
     {
         LoadingCache::CacheLock lock(cache);
+        // remove this from the list of loading processes in cache
+        cache->removeLoadingProcess(this);
         //kDebug() << "SharedLoadingTask " << this << ": image loaded, " << img.isNull();
         // indicate that loading has finished so that listeners can stop waiting
         m_completed = true;
@@ -251,13 +180,13 @@ void SharedLoadingTask::execute()
 
         // remove myself from list of listeners
         removeListener(this);
-        // wake all listeners waiting on cache condVar, so that they remove themselves
-        lock.wakeAll();
+        // wake all listeners waiting on this process, so that they remove themselves
+        lock.wakeAll(cacheKey());
 
         // wait until all listeners have removed themselves
         while (m_listeners.count() != 0)
         {
-            lock.timedWait();
+            lock.timedWait(cacheKey());
         }
 
         // set to 0, as checked in setStatus
@@ -270,6 +199,87 @@ void SharedLoadingTask::execute()
     m_thread->imageLoaded(m_loadingDescription, m_img);
 }
 
+DImg SharedLoadingTask::findCachedImage(LoadingCache* cache, const QStringList& lookupKeys,
+                                        LoadingCache::LookupMode mode) const
+{
+    for (int i = 0; i < lookupKeys.size(); ++i)
+    {
+        // a miss is counted only for the last key
+        const bool isLastKey = (i == lookupKeys.size() - 1);
+        DImg cachedImg       = cache->retrieveImage(lookupKeys.at(i), isLastKey ? mode : LoadingCache::CountHitOnly);
+
+        if (cachedImg.isNull())
+        {
+            continue;
+        }
+
+        if (!m_loadingDescription.needCheckRawDecoding() ||
+            cachedImg.rawDecodingSettings() == m_loadingDescription.rawDecodingSettings)
+        {
+            return cachedImg;
+        }
+    }
+
+    return DImg();
+}
+
+void SharedLoadingTask::attachToLoadingProcess(LoadingCache::CacheLock& lock, LoadingCache* cache,
+                                               const QStringList& lookupKeys)
+{
+    // find possible running loading process
+    m_usedProcess = 0;
+
+    for ( QStringList::const_iterator it = lookupKeys.constBegin(); it != lookupKeys.constEnd(); ++it )
+    {
+        if ( (m_usedProcess = cache->retrieveLoadingProcess(*it)) )
+        {
+            break;
+        }
+    }
+
+    if (m_usedProcess)
+    {
+        // Other process is right now loading this image.
+        // Add this task to the list of listeners and
+        // attach this thread to the other thread, wait until loading
+        // has finished. Waiting and waking is done per process, by its cache key.
+        const QString processKey = m_usedProcess->cacheKey();
+        m_usedProcess->addListener(this);
+
+        // break loop when either the loading has completed, or this task is being stopped
+        while ( m_loadingTaskStatus != LoadingTaskStatusStopping && m_usedProcess && !m_usedProcess->completed() )
+        {
+            lock.timedWait(processKey);
+        }
+
+        // remove listener from process
+        if (m_usedProcess)
+        {
+            m_usedProcess->removeListener(this);
+        }
+
+        // wake up the process which is waiting until all listeners have removed themselves
+        lock.wakeAll(processKey);
+        // set to 0, as checked in setStatus
+        m_usedProcess = 0;
+        //kDebug() << "SharedLoadingTask " << this << ": waited";
+        // m_img is now set to the result
+    }
+    else
+    {
+        // Neither in cache, nor currently loading in different thread.
+        // Load it here and now, add this LoadingProcess to cache list.
+        cache->addLoadingProcess(this);
+        // Add this to the list of listeners
+        addListener(this);
+        // for use in setStatus
+        m_usedProcess = this;
+        // Notify other processes that we are now loading this image.
+        // They might be interested - see notifyNewLoadingProcess below
+        cache->notifyNewLoadingProcess(this, m_loadingDescription);
+    }
+}
+
 void SharedLoadingTask::setResult(const LoadingDescription& loadingDescription, const DImg& img)
 {
     // this is called from another process's execute while this task is waiting on m_usedProcess.
@@ -371,11 +381,12 @@ void SharedLoadingTask::setStatus(LoadingTaskStatus status)
         if (m_usedProcess)
         {
             // remove this from list of listeners - check in continueQuery() of active thread
+            QString processKey = m_usedProcess->cacheKey();
             m_usedProcess->removeListener(this);
             // set m_usedProcess to 0, signalling that we have detached already
             m_usedProcess = 0;
-            // wake all listeners - particularly this - from waiting on cache condvar
-            lock.wakeAll();
+            // wake all listeners of the process - particularly this - from waiting
+            lock.wakeAll(processKey);
         }
     }
 }
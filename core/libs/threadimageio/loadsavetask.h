@@ -151,6 +151,20 @@ public:
     virtual LoadSaveNotifier* loadSaveNotifier();
     virtual LoadSaveThread::AccessMode accessMode();
 
+protected:
+
+    /** Returns the first image cached under one of the keys which is usable for this task,
+     *  or a null image. Does not need a CacheLock.
+     *  The keys are one lookup for the cache statistics, counted as given by mode.
+     */
+    DImg findCachedImage(LoadingCache* cache, const QStringList& lookupKeys,
+                         LoadingCache::LookupMode mode = LoadingCache::CountLookup) const;
+
+    /** Waits for a loading process running for one of the keys and receives its result,
+     *  or, if there is none, registers this task as loading process. Requires the CacheLock.
+     */
+    void attachToLoadingProcess(LoadingCache::CacheLock& lock, LoadingCache* cache, const QStringList& lookupKeys);
+
 protected:
 
     bool                           m_completed;
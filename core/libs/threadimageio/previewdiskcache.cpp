@@ -0,0 +1,541 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-12
+ * Description : persistent on-disk cache of previews
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "previewdiskcache.h"
+
+// Qt includes
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QPair>
+#include <QStringList>
+#include <QVariant>
+
+// KDE includes
+
+#include <kde_file.h>
+#include <kdebug.h>
+#include <kglobal.h>
+#include <kmd5.h>
+#include <ksavefile.h>
+#include <kstandarddirs.h>
+
+// Local includes
+
+#include "iccprofile.h"
+#include "pgfutils.h"
+#include "thumbnailcreator.h"
+
+namespace Digikam
+{
+
+class PreviewDiskCache::PreviewDiskCachePriv
+{
+public:
+
+    enum
+    {
+        FileMagic   = 0x64506343,
+        FileVersion = 1,
+        /// PGF compression level, see writePGFImageData. Thumbnails use 4.
+        PGFQuality  = 2
+    };
+
+    class Entry
+    {
+    public:
+
+        Entry()
+            : size(0), lastUse(0)
+        {
+        }
+
+        qint64 size;
+        uint   lastUse;
+    };
+
+public:
+
+    PreviewDiskCachePriv()
+    {
+        scanned      = false;
+        totalSize    = 0;
+        maximumBytes = (qint64)512 * 1024 * 1024;
+        provider     = 0;
+    }
+
+    QString entryKey(const LoadingDescription& description);
+    QString fileName(const QString& filePath, const QString& key) const;
+    QString filePrefix(const QString& filePath) const;
+
+    DImg    readFile(const QString& path, const QString& key) const;
+
+    /// The following methods require the mutex to be held
+    void    ensureScanned();
+    void    removeEntries(const QStringList& names);
+    void    evict(QStringList& removedNames);
+
+    /// Removes the files of entries removed from the index. Call without the mutex held.
+    void    removeFiles(const QStringList& names);
+
+    /// The attributes of a DImg stored with the preview
+    static QStringList storedAttributes()
+    {
+        return QStringList() << "detectedFileFormat" << "originalFilePath" << "originalSize"
+                             << "fromRawEmbeddedPreview" << "exifRotated";
+    }
+
+public:
+
+    /// Protects all members below
+    QMutex                 mutex;
+    bool                   scanned;
+    QString                dir;
+    QHash<QString, Entry>  entries;
+    qint64                 totalSize;
+    qint64                 maximumBytes;
+    ThumbnailInfoProvider* provider;
+    /// Replaced providers. Not deleted before the cache, entryKey() uses them without the mutex held.
+    QList<ThumbnailInfoProvider*> replacedProviders;
+};
+
+QString PreviewDiskCache::PreviewDiskCachePriv::entryKey(const LoadingDescription& description)
+{
+    QFileInfo fileInfo(description.filePath);
+
+    if (!fileInfo.exists())
+    {
+        return QString();
+    }
+
+    QString key = description.cacheKey() + '-' + QString::number((int)description.previewParameters.flags)
+                  + '-' + QString::number(fileInfo.lastModified().toTime_t())
+                  + '-' + QString::number(fileInfo.size());
+
+    ThumbnailInfoProvider* infoProvider = 0;
+    {
+        QMutexLocker lock(&mutex);
+        infoProvider = provider;
+    }
+
+    if (infoProvider)
+    {
+        ThumbnailInfo info = infoProvider->thumbnailInfo(description.filePath);
+
+        if (!info.uniqueHash.isEmpty())
+        {
+            key += '-' + info.uniqueHash;
+        }
+    }
+
+    return key;
+}
+
+QString PreviewDiskCache::PreviewDiskCachePriv::filePrefix(const QString& filePath) const
+{
+    KMD5 md5(QFile::encodeName(filePath));
+    return QString::fromLatin1(md5.hexDigest()) + '-';
+}
+
+QString PreviewDiskCache::PreviewDiskCachePriv::fileName(const QString& filePath, const QString& key) const
+{
+    // The file path is hashed separately, so that all entries of a file can be found by their prefix
+    KMD5 md5(key.toUtf8());
+    return filePrefix(filePath) + QString::fromLatin1(md5.hexDigest()) + QString(".preview");
+}
+
+DImg PreviewDiskCache::PreviewDiskCachePriv::readFile(const QString& path, const QString& key) const
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return DImg();
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_5);
+
+    quint32 magic;
+    qint32  version;
+    stream >> magic >> version;
+
+    if (magic != (quint32)FileMagic || version != FileVersion)
+    {
+        return DImg();
+    }
+
+    QString                 storedKey;
+    QByteArray              iccData;
+    QMap<QString, QVariant> attributes;
+    QByteArray              pgfData;
+    stream >> storedKey >> iccData >> attributes >> pgfData;
+
+    if (stream.status() != QDataStream::Ok || storedKey != key)
+    {
+        return DImg();
+    }
+
+    QImage qimage;
+
+    if (!readPGFImageData(pgfData, qimage))
+    {
+        return DImg();
+    }
+
+    DImg img(qimage);
+
+    if (!iccData.isEmpty())
+    {
+        img.setIccProfile(IccProfile(iccData));
+    }
+
+    for (QMap<QString, QVariant>::const_iterator it = attributes.constBegin(); it != attributes.constEnd(); ++it)
+    {
+        img.setAttribute(it.key(), it.value());
+    }
+
+    return img;
+}
+
+void PreviewDiskCache::PreviewDiskCachePriv::ensureScanned()
+{
+    if (scanned)
+    {
+        return;
+    }
+
+    scanned = true;
+    dir     = KStandardDirs::locateLocal("cache", "digikam/previews/");
+
+    // The modification date of a file is its last use, see PreviewDiskCache::load
+    QFileInfoList infos = QDir(dir).entryInfoList(QStringList() << "*.preview", QDir::Files);
+
+    foreach (const QFileInfo& info, infos)
+    {
+        Entry& entry  = entries[info.fileName()];
+        entry.size    = info.size();
+        entry.lastUse = info.lastModified().toTime_t();
+        totalSize    += entry.size;
+    }
+
+    kDebug() << "Preview disk cache contains" << entries.size() << "entries," << totalSize / 1024 / 1024 << "MB";
+
+    // The maximum size may have been reduced since the last session
+    QStringList removedNames;
+    evict(removedNames);
+    removeFiles(removedNames);
+}
+
+void PreviewDiskCache::PreviewDiskCachePriv::removeEntries(const QStringList& names)
+{
+    foreach (const QString& name, names)
+    {
+        totalSize -= entries.take(name).size;
+    }
+}
+
+void PreviewDiskCache::PreviewDiskCachePriv::evict(QStringList& removedNames)
+{
+    if (totalSize <= maximumBytes)
+    {
+        return;
+    }
+
+    // Remove the least recently used entries, leaving some headroom
+    QList<QPair<uint, QString> > byLastUse;
+
+    for (QHash<QString, Entry>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it)
+    {
+        byLastUse << qMakePair(it.value().lastUse, it.key());
+    }
+
+    qSort(byLastUse);
+
+    qint64 targetSize = maximumBytes / 10 * 9;
+
+    for (int i = 0; i < byLastUse.size() && totalSize > targetSize; ++i)
+    {
+        totalSize -= entries.take(byLastUse[i].second).size;
+        removedNames << byLastUse[i].second;
+    }
+}
+
+void PreviewDiskCache::PreviewDiskCachePriv::removeFiles(const QStringList& names)
+{
+    foreach (const QString& name, names)
+    {
+        QFile::remove(dir + name);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------
+
+class PreviewDiskCacheCreator
+{
+public:
+
+    PreviewDiskCache object;
+};
+
+K_GLOBAL_STATIC(PreviewDiskCacheCreator, creator)
+
+PreviewDiskCache* PreviewDiskCache::instance()
+{
+    return &creator->object;
+}
+
+PreviewDiskCache::PreviewDiskCache()
+    : d(new PreviewDiskCachePriv)
+{
+}
+
+PreviewDiskCache::~PreviewDiskCache()
+{
+    delete d->provider;
+    qDeleteAll(d->replacedProviders);
+    delete d;
+}
+
+bool PreviewDiskCache::isCacheable(const LoadingDescription& description) const
+{
+    if (description.previewParameters.type != LoadingDescription::PreviewParameters::PreviewImage ||
+        description.previewParameters.size == 0 || description.filePath.isEmpty())
+    {
+        return false;
+    }
+
+    QMutexLocker lock(&d->mutex);
+    return d->maximumBytes > 0;
+}
+
+DImg PreviewDiskCache::load(const LoadingDescription& description)
+{
+    if (!isCacheable(description))
+    {
+        return DImg();
+    }
+
+    QString key = d->entryKey(description);
+
+    if (key.isNull())
+    {
+        return DImg();
+    }
+
+    QString name = d->fileName(description.filePath, key);
+    QString path;
+    {
+        QMutexLocker lock(&d->mutex);
+        d->ensureScanned();
+
+        QHash<QString, PreviewDiskCachePriv::Entry>::iterator it = d->entries.find(name);
+
+        if (it == d->entries.end())
+        {
+            return DImg();
+        }
+
+        it->lastUse = QDateTime::currentDateTime().toTime_t();
+        path        = d->dir + name;
+    }
+
+    DImg img = d->readFile(path, key);
+
+    if (img.isNull())
+    {
+        kDebug() << "Removing invalid preview cache entry" << path;
+        {
+            QMutexLocker lock(&d->mutex);
+            d->removeEntries(QStringList() << name);
+        }
+        QFile::remove(path);
+        return DImg();
+    }
+
+    // Keep the last use for the next session
+    KDE::utime(path, 0);
+
+    return img;
+}
+
+void PreviewDiskCache::store(const LoadingDescription& description, const DImg& img)
+{
+    if (img.isNull() || !isCacheable(description))
+    {
+        return;
+    }
+
+    QString key = d->entryKey(description);
+
+    if (key.isNull())
+    {
+        return;
+    }
+
+    QByteArray pgfData;
+
+    if (!writePGFImageData(img.copyQImage(), pgfData, PreviewDiskCachePriv::PGFQuality))
+    {
+        kWarning() << "Cannot compress preview of" << description.filePath;
+        return;
+    }
+
+    QMap<QString, QVariant> attributes;
+
+    foreach (const QString& attribute, PreviewDiskCachePriv::storedAttributes())
+    {
+        if (img.hasAttribute(attribute))
+        {
+            attributes[attribute] = img.attribute(attribute);
+        }
+    }
+
+    IccProfile profile = img.getIccProfile();
+    QByteArray iccData = profile.isNull() ? QByteArray() : profile.data();
+
+    QString name = d->fileName(description.filePath, key);
+    QString path;
+    {
+        QMutexLocker lock(&d->mutex);
+        d->ensureScanned();
+        path = d->dir + name;
+    }
+
+    KSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_5);
+    stream << (quint32)PreviewDiskCachePriv::FileMagic << (qint32)PreviewDiskCachePriv::FileVersion;
+    stream << key << iccData << attributes << pgfData;
+
+    if (stream.status() != QDataStream::Ok || !file.finalize())
+    {
+        file.abort();
+        return;
+    }
+
+    qint64 size = QFileInfo(path).size();
+
+    QStringList removedNames;
+    {
+        QMutexLocker lock(&d->mutex);
+        PreviewDiskCachePriv::Entry& entry = d->entries[name];
+        d->totalSize  += size - entry.size;
+        entry.size     = size;
+        entry.lastUse  = QDateTime::currentDateTime().toTime_t();
+        d->evict(removedNames);
+    }
+
+    d->removeFiles(removedNames);
+}
+
+void PreviewDiskCache::removeFile(const QString& filePath)
+{
+    QString prefix = d->filePrefix(filePath);
+    QStringList names;
+    {
+        QMutexLocker lock(&d->mutex);
+
+        if (!d->scanned)
+        {
+            // Nothing was stored or loaded yet in this session. Outdated entries are never used.
+            return;
+        }
+
+        for (QHash<QString, PreviewDiskCachePriv::Entry>::const_iterator it = d->entries.constBegin();
+             it != d->entries.constEnd(); ++it)
+        {
+            if (it.key().startsWith(prefix))
+            {
+                names << it.key();
+            }
+        }
+
+        d->removeEntries(names);
+    }
+
+    d->removeFiles(names);
+}
+
+void PreviewDiskCache::clear()
+{
+    QStringList names;
+    {
+        QMutexLocker lock(&d->mutex);
+        d->ensureScanned();
+        names = d->entries.keys();
+        d->entries.clear();
+        d->totalSize = 0;
+    }
+
+    d->removeFiles(names);
+}
+
+void PreviewDiskCache::setMaximumSize(int megabytes)
+{
+    QStringList removedNames;
+    {
+        QMutexLocker lock(&d->mutex);
+        d->maximumBytes = (qint64)megabytes * 1024 * 1024;
+
+        if (d->scanned)
+        {
+            d->evict(removedNames);
+        }
+    }
+
+    d->removeFiles(removedNames);
+}
+
+int PreviewDiskCache::maximumSize() const
+{
+    QMutexLocker lock(&d->mutex);
+    return (int)(d->maximumBytes / 1024 / 1024);
+}
+
+void PreviewDiskCache::setInfoProvider(ThumbnailInfoProvider* provider)
+{
+    QMutexLocker lock(&d->mutex);
+
+    if (d->provider)
+    {
+        d->replacedProviders << d->provider;
+    }
+
+    d->provider = provider;
+}
+
+}  // namespace Digikam
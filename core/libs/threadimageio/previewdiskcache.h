@@ -0,0 +1,114 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-12
+ * Description : persistent on-disk cache of previews
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef PREVIEWDISKCACHE_H
+#define PREVIEWDISKCACHE_H
+
+// Qt includes
+
+#include <QString>
+
+// Local includes
+
+#include "digikam_export.h"
+#include "dimg.h"
+#include "loadingdescription.h"
+
+namespace Digikam
+{
+
+class ThumbnailInfoProvider;
+
+/** The second level of preview caching, beneath the in-memory LoadingCache.
+ *  Screen-sized previews are stored on disk, so that they need not be decoded again
+ *  after a restart. The previews are stored scaled and rotated, but before color management,
+ *  compressed with PGF, in the user's cache directory.
+ *
+ *  An entry is identified by the loading description, the file's modification date and size,
+ *  and, if a ThumbnailInfoProvider is set, by the unique hash of the file.
+ *  A changed file thus never gets an outdated preview. Entries of changed files are also
+ *  removed when the LoadingCache is notified of the change.
+ *  The total size is limited; the least recently used entries are removed first.
+ *
+ *  All methods are thread-safe.
+ */
+class DIGIKAM_EXPORT PreviewDiskCache
+{
+public:
+
+    static PreviewDiskCache* instance();
+
+    /**
+     * Returns if a preview loaded for the given description is stored in this cache.
+     * This is the case for size-limited previews if the cache is enabled.
+     */
+    bool isCacheable(const LoadingDescription& description) const;
+
+    /**
+     * Returns the cached preview for the given description, or a null image.
+     */
+    DImg load(const LoadingDescription& description);
+
+    /**
+     * Stores the preview for the given description. Color management shall not be applied yet.
+     */
+    void store(const LoadingDescription& description, const DImg& img);
+
+    /**
+     * Removes all entries for the given file.
+     */
+    void removeFile(const QString& filePath);
+
+    /**
+     * Removes all entries.
+     */
+    void clear();
+
+    /**
+     * Sets the maximum size of the cache on disk, in megabytes.
+     * Set to 0 to disable the cache. Default: 512 MB.
+     */
+    void setMaximumSize(int megabytes);
+    int  maximumSize() const;
+
+    /**
+     * Set a ThumbnailInfoProvider to provide the unique hash of files.
+     * Ownership is taken. A replaced provider may still be in use by another thread,
+     * it is deleted together with the cache.
+     */
+    void setInfoProvider(ThumbnailInfoProvider* provider);
+
+private:
+
+    PreviewDiskCache();
+    ~PreviewDiskCache();
+
+    friend class PreviewDiskCacheCreator;
+
+    class PreviewDiskCachePriv;
+    PreviewDiskCachePriv* const d;
+};
+
+}  // namespace Digikam
+
+#endif // PREVIEWDISKCACHE_H
@@ -52,6 +52,7 @@
 
 #include "dmetadata.h"
 #include "jpegutils.h"
+#include "previewdiskcache.h"
 #include "previewloadthread.h"
 
 namespace Digikam
@@ -64,112 +65,45 @@ void PreviewLoadingTask::execute()
         return;
     }
 
-    LoadingCache* cache = LoadingCache::cache();
+    LoadingCache* cache    = LoadingCache::cache();
+    QStringList lookupKeys = m_loadingDescription.lookupCacheKeys();
+    // lookupCacheKeys returns "best first". Prepend the cache key to make the list "fastest first":
+    // Scaling a full version takes longer!
+    lookupKeys.push_front(m_loadingDescription.cacheKey());
+
+    // The cache itself is thread-safe. Only take the CacheLock if the image is not cached.
+    DImg cachedImg         = findCachedImage(cache, lookupKeys, LoadingCache::CountHitOnly);
+
+    if (cachedImg.isNull())
     {
         LoadingCache::CacheLock lock(cache);
 
-        // find possible cached images
-        DImg* cachedImg = 0;
-        QStringList lookupKeys = m_loadingDescription.lookupCacheKeys();
-        // lookupCacheKeys returns "best first". Prepend the cache key to make the list "fastest first":
-        // Scaling a full version takes longer!
-        lookupKeys.push_front(m_loadingDescription.cacheKey());
-        foreach (const QString& key, lookupKeys)
-        {
-            if ( (cachedImg = cache->retrieveImage(key)) )
-            {
-                if (m_loadingDescription.needCheckRawDecoding())
-                {
-                    if (cachedImg->rawDecodingSettings() == m_loadingDescription.rawDecodingSettings)
-                    {
-                        break;
-                    }
-                    else
-                    {
-                        cachedImg = 0;
-                    }
-                }
-                else
-                {
-                    break;
-                }
-            }
-        }
+        // The image may have been put into the cache meanwhile, before its loading process was removed
+        cachedImg = findCachedImage(cache, lookupKeys);
 
-        if (cachedImg)
+        if (cachedImg.isNull())
         {
-            // image is found in image cache, loading is successful
-
-            m_img = *cachedImg;
-
-            if (accessMode() == LoadSaveThread::AccessModeReadWrite)
-            {
-                m_img = m_img.copy();
-            }
-
-            // rotate if needed - images are unrotated in the cache,
-            // except for RAW images, which are already rotated by dcraw.
-            if (m_loadingDescription.previewParameters.exifRotate())
-            {
-                m_img = m_img.copy();
-                LoadSaveThread::exifRotate(m_img, m_loadingDescription.filePath);
-            }
+            attachToLoadingProcess(lock, cache, lookupKeys);
         }
-        else
-        {
-            // find possible running loading process
-            m_usedProcess = 0;
-
-            for ( QStringList::Iterator it = lookupKeys.begin(); it != lookupKeys.end(); ++it )
-            {
-                if ( (m_usedProcess = cache->retrieveLoadingProcess(*it)) )
-                {
-                    break;
-                }
-            }
+    }
 
-            // do not wait on other loading processes?
-            //m_usedProcess = cache->retrieveLoadingProcess(m_loadingDescription.cacheKey());
+    if (!cachedImg.isNull())
+    {
+        // image is found in image cache, loading is successful
 
-            if (m_usedProcess)
-            {
-                // Other process is right now loading this image.
-                // Add this task to the list of listeners and
-                // attach this thread to the other thread, wait until loading
-                // has finished.
-                m_usedProcess->addListener(this);
-
-                // break loop when either the loading has completed, or this task is being stopped
-                while ( m_loadingTaskStatus != LoadingTaskStatusStopping && m_usedProcess && !m_usedProcess->completed())
-                {
-                    lock.timedWait();
-                }
+        m_img = cachedImg;
 
-                // remove listener from process
-                if (m_usedProcess)
-                {
-                    m_usedProcess->removeListener(this);
-                }
+        if (accessMode() == LoadSaveThread::AccessModeReadWrite)
+        {
+            m_img = m_img.copy();
+        }
 
-                // wake up the process which is waiting until all listeners have removed themselves
-                lock.wakeAll();
-                // set to 0, as checked in setStatus
-                m_usedProcess = 0;
-                // m_img is now set to the result
-            }
-            else
-            {
-                // Neither in cache, nor currently loading in different thread.
-                // Load it here and now, add this LoadingProcess to cache list.
-                cache->addLoadingProcess(this);
-                // Add this to the list of listeners
-                addListener(this);
-                // for use in setStatus
-                m_usedProcess = this;
-                // Notify other processes that we are now loading this image.
-                // They might be interested - see notifyNewLoadingProcess below
-                cache->notifyNewLoadingProcess(this, m_loadingDescription);
-            }
+        // rotate if needed - images are unrotated in the cache,
+        // except for RAW images, which are already rotated by dcraw.
+        if (m_loadingDescription.previewParameters.exifRotate())
+        {
+            m_img = m_img.copy();
+            LoadSaveThread::exifRotate(m_img, m_loadingDescription.filePath);
         }
     }
 
@@ -196,9 +130,27 @@ void PreviewLoadingTask::execute()
     QImage qimage;
     bool fromEmbeddedPreview = false;
 
+    // -- Check the persistent preview cache -------------------
+
+    PreviewDiskCache* diskCache = PreviewDiskCache::instance();
+    bool useDiskCache           = diskCache->isCacheable(m_loadingDescription);
+    bool fromDiskCache          = false;
+    DImg diskCacheImage;
+
+    if (useDiskCache)
+    {
+        // Previews are stored scaled and rotated, but without post processing
+        m_img         = diskCache->load(m_loadingDescription);
+        fromDiskCache = !m_img.isNull();
+    }
+
     // -- Get the image preview --------------------------------
 
-    if (size)
+    if (fromDiskCache)
+    {
+        // nothing to decode
+    }
+    else if (size)
     {
         DImg::FORMAT format = DImg::fileFormat(m_loadingDescription.filePath);
         // First the QImage-dependent loading methods
@@ -364,9 +316,8 @@ void PreviewLoadingTask::execute()
             // but not for RAWs, there are so many cases to consider
             if (!m_img.isNull() && m_img.detectedFormat() != DImg::RAW)
             {
-                LoadingCache::CacheLock lock(cache);
                 LoadingDescription fullDescription(m_loadingDescription.filePath);
-                cache->putImage(fullDescription.cacheKey(), new DImg(m_img.copy()), m_loadingDescription.filePath);
+                cache->putImage(fullDescription.cacheKey(), m_img.copy(), m_loadingDescription.filePath);
             }
         }
 
@@ -397,6 +348,12 @@ void PreviewLoadingTask::execute()
             LoadSaveThread::exifRotate(m_img, m_loadingDescription.filePath);
         }
 
+        // Keep the image for the disk cache before post processing, which works in place
+        if (useDiskCache && !fromDiskCache && !m_img.isNull())
+        {
+            diskCacheImage = needsPostProcessing() ? m_img.copy() : m_img;
+        }
+
         // For previews, we put the image post processed in the cache
         postProcess();
     }
@@ -405,21 +362,17 @@ void PreviewLoadingTask::execute()
         m_img = DImg();
     }
 
+    // put (valid) image into cache of loaded images,
+    // before the loading process is removed
+    if (!m_img.isNull())
     {
-        LoadingCache::CacheLock lock(cache);
-
-        // put (valid) image into cache of loaded images
-        if (!m_img.isNull())
-        {
-            cache->putImage(m_loadingDescription.cacheKey(), new DImg(m_img), m_loadingDescription.filePath);
-        }
-
-        // remove this from the list of loading processes in cache
-        cache->removeLoadingProcess(this);
+        cache->putImage(m_loadingDescription.cacheKey(), m_img, m_loadingDescription.filePath);
     }
 
     {
         LoadingCache::CacheLock lock(cache);
+        // remove this from the list of loading processes in cache
+        cache->removeLoadingProcess(this);
         // indicate that loading has finished so that listeners can stop waiting
         m_completed = true;
 
@@ -448,13 +401,13 @@ void PreviewLoadingTask::execute()
 
         // remove myself from list of listeners
         removeListener(this);
-        // wake all listeners waiting on cache condVar, so that they remove themselves
-        lock.wakeAll();
+        // wake all listeners waiting on this process, so that they remove themselves
+        lock.wakeAll(cacheKey());
 
         // wait until all listeners have removed themselves
         while (m_listeners.count() != 0)
         {
-            lock.timedWait();
+            lock.timedWait(cacheKey());
         }
 
         // set to 0, as checked in setStatus
@@ -464,6 +417,12 @@ void PreviewLoadingTask::execute()
     // again: following the golden rule to avoid deadlocks, do this when CacheLock is not held
     m_thread->taskHasFinished();
     m_thread->imageLoaded(m_loadingDescription, m_img);
+
+    // Compressing and writing is done when the preview is already delivered
+    if (!diskCacheImage.isNull())
+    {
+        diskCache->store(m_loadingDescription, diskCacheImage);
+    }
 }
 
 bool PreviewLoadingTask::needToScale(const QSize& imageSize, int previewSize)
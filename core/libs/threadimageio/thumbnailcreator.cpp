@@ -33,6 +33,12 @@
 #include <QPainter>
 #include <QBuffer>
 #include <QIODevice>
+#include <QMutex>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 // KDE includes
 
@@ -87,6 +93,242 @@ ThumbnailInfo::ThumbnailInfo()
     orientationHint = DMetadata::ORIENTATION_UNSPECIFIED;
 }
 
+/** Reads a thumbnail from the data blob of the thumbnail database.
+ *  Thread-safe, used for prefetched thumbnails by several threads at a time.
+ */
+static ThumbnailImage decodeDatabaseThumbnail(DatabaseThumbnailInfo& dbInfo)
+{
+    ThumbnailImage image;
+
+    if (dbInfo.type == DatabaseThumbnail::PGF)
+    {
+        if (!readPGFImageData(dbInfo.data, image.qimage))
+        {
+            kWarning() << "Cannot load PGF thumb from DB";
+            return ThumbnailImage();
+        }
+    }
+    else if (dbInfo.type == DatabaseThumbnail::JPEG)
+    {
+        QBuffer buffer(&dbInfo.data);
+        buffer.open(QIODevice::ReadOnly);
+        image.qimage.load(&buffer, "JPEG");
+
+        if (dbInfo.data.isNull())
+        {
+            kWarning() << "Cannot load JPEG thumb from DB";
+            return ThumbnailImage();
+        }
+    }
+    else if (dbInfo.type == DatabaseThumbnail::JPEG2000)
+    {
+        QBuffer buffer(&dbInfo.data);
+        buffer.open(QIODevice::ReadOnly);
+        image.qimage.load(&buffer, "JP2");
+
+        if (dbInfo.data.isNull())
+        {
+            kWarning() << "Cannot load JPEG2000 thumb from DB";
+            return ThumbnailImage();
+        }
+    }
+    else if (dbInfo.type == DatabaseThumbnail::PNG)
+    {
+        QBuffer buffer(&dbInfo.data);
+        buffer.open(QIODevice::ReadOnly);
+        image.qimage.load(&buffer, "PNG");
+
+        if (dbInfo.data.isNull())
+        {
+            kWarning() << "Cannot load PNG thumb from DB";
+            return ThumbnailImage();
+        }
+    }
+
+    image.exifOrientation = dbInfo.orientationHint;
+
+    return image;
+}
+
+// ---------------------------------------------------------------------------------------------------
+
+/** The thumbnails read by ThumbnailCreator::prefetch().
+ *  Entries are added and removed only by the thread owning the ThumbnailCreator.
+ *  Decoding is done by the threads of the pool, and by the owning thread itself
+ *  if it needs a thumbnail whose decoding has not yet started.
+ */
+class ThumbnailPrefetch
+{
+public:
+
+    class Entry
+    {
+    public:
+
+        enum State
+        {
+            Queued,
+            Decoding,
+            Ready
+        };
+
+        Entry()
+            : state(Ready)
+        {
+        }
+
+        ThumbnailInfo         info;
+        DatabaseThumbnailInfo dbInfo;
+        ThumbnailImage        image;
+        State                 state;
+    };
+
+public:
+
+    ThumbnailPrefetch()
+    {
+        pool.setMaxThreadCount(qMax(QThread::idealThreadCount() - 1, 1));
+    }
+
+    ~ThumbnailPrefetch()
+    {
+        {
+            QMutexLocker lock(&mutex);
+            queue.clear();
+        }
+
+        pool.waitForDone();
+    }
+
+    void startDecoding();
+    bool decodeNext();
+    bool take(const QString& path, Entry* entry);
+
+public:
+
+    QMutex                mutex;
+    QWaitCondition        condVar;
+    QHash<QString, Entry> entries;
+    /// The paths of the entries waiting to be decoded, in order of request
+    QList<QString>        queue;
+    QThreadPool           pool;
+};
+
+class ThumbnailPrefetchDecoder : public QRunnable
+{
+public:
+
+    ThumbnailPrefetchDecoder(ThumbnailPrefetch* prefetch)
+        : prefetch(prefetch)
+    {
+    }
+
+    virtual void run()
+    {
+        while (prefetch->decodeNext())
+        {
+        }
+    }
+
+private:
+
+    ThumbnailPrefetch* const prefetch;
+};
+
+void ThumbnailPrefetch::startDecoding()
+{
+    int decoders;
+
+    {
+        QMutexLocker lock(&mutex);
+        decoders = qMin(queue.size(), pool.maxThreadCount() - pool.activeThreadCount());
+    }
+
+    for (int i=0; i<decoders; ++i)
+    {
+        pool.start(new ThumbnailPrefetchDecoder(this));
+    }
+}
+
+bool ThumbnailPrefetch::decodeNext()
+{
+    QString               path;
+    DatabaseThumbnailInfo dbInfo;
+
+    {
+        QMutexLocker lock(&mutex);
+
+        if (queue.isEmpty())
+        {
+            return false;
+        }
+
+        path = queue.takeFirst();
+        QHash<QString, Entry>::iterator it = entries.find(path);
+
+        if (it == entries.end())
+        {
+            return true;
+        }
+
+        it->state = Entry::Decoding;
+        dbInfo    = it->dbInfo;
+    }
+
+    ThumbnailImage image = decodeDatabaseThumbnail(dbInfo);
+
+    QMutexLocker lock(&mutex);
+    QHash<QString, Entry>::iterator it = entries.find(path);
+
+    // the entry may have been discarded and requested again meanwhile
+    if (it != entries.end() && it->state == Entry::Decoding)
+    {
+        it->image       = image;
+        it->dbInfo.data = QByteArray();
+        it->state       = Entry::Ready;
+        condVar.wakeAll();
+    }
+
+    return true;
+}
+
+bool ThumbnailPrefetch::take(const QString& path, Entry* entry)
+{
+    QMutexLocker lock(&mutex);
+    QHash<QString, Entry>::iterator it = entries.find(path);
+
+    if (it == entries.end())
+    {
+        return false;
+    }
+
+    if (it->state == Entry::Queued)
+    {
+        // Decoding has not yet started: Do it here instead of waiting
+        queue.removeOne(path);
+        *entry = it.value();
+        entries.erase(it);
+        lock.unlock();
+
+        entry->image = decodeDatabaseThumbnail(entry->dbInfo);
+        entry->state = Entry::Ready;
+        return true;
+    }
+
+    while (it->state == Entry::Decoding)
+    {
+        condVar.wait(&mutex);
+        // entries are only removed by this thread
+        it = entries.find(path);
+    }
+
+    *entry = it.value();
+    entries.erase(it);
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------
+
 ThumbnailCreator::ThumbnailCreator(StorageMethod method)
     : d(new ThumbnailCreatorPriv)
 {
@@ -104,6 +346,7 @@ ThumbnailCreator::ThumbnailCreator(int thumbnailSize, StorageMethod method)
 
 ThumbnailCreator::~ThumbnailCreator()
 {
+    delete d->prefetch;
     delete d;
 }
 
@@ -170,6 +413,11 @@ int ThumbnailCreator::storedSize() const
     return d->storageSize();
 }
 
+ThumbnailCreator::StorageMethod ThumbnailCreator::thumbnailStorage() const
+{
+    return d->thumbnailStorage;
+}
+
 QString ThumbnailCreator::errorString() const
 {
     return d->error;
@@ -221,17 +469,31 @@ QImage ThumbnailCreator::load(const QString& path, const QRect& rect, bool prege
         d->dbIdForReplacement = -1;    // just to prevent bugs
     }
 
+    ThumbnailInfo  info;
+    ThumbnailImage image;
+    bool           prefetched = false;
+
+    if (d->thumbnailStorage == ThumbnailDatabase && !pregenerate && rect.isNull())
+    {
+        prefetched = loadPrefetched(path, info, image);
+    }
+
     // get info about path
-    ThumbnailInfo info = makeThumbnailInfo(path, rect);
+    if (!prefetched)
+    {
+        info = makeThumbnailInfo(path, rect);
+    }
 
     // load pregenerated thumbnail
-    ThumbnailImage image;
-
     switch (d->thumbnailStorage)
     {
         case ThumbnailDatabase:
 
-            if (pregenerate)
+            if (prefetched)
+            {
+                // already read from the database by prefetch()
+            }
+            else if (pregenerate)
             {
                 if (isInDatabase(info))
                 {
@@ -336,6 +598,18 @@ QString ThumbnailCreator::identifierForDetail(const QString& path, const QRect&
     return url.toString();
 }
 
+QList<ThumbnailInfo> ThumbnailInfoProvider::thumbnailInfos(const QStringList& paths)
+{
+    QList<ThumbnailInfo> infos;
+
+    foreach (const QString& path, paths)
+    {
+        infos << thumbnailInfo(path);
+    }
+
+    return infos;
+}
+
 ThumbnailInfo ThumbnailCreator::makeThumbnailInfo(const QString& path, const QRect& rect) const
 {
     ThumbnailInfo info;
@@ -867,8 +1141,6 @@ ThumbnailImage ThumbnailCreator::loadFromDatabase(const ThumbnailInfo& info) con
 {
     DatabaseThumbnailInfo dbInfo = loadDatabaseThumbnailInfo(info);
 
-    ThumbnailImage image;
-
     if (dbInfo.data.isNull())
     {
         return ThumbnailImage();
@@ -881,54 +1153,198 @@ ThumbnailImage ThumbnailCreator::loadFromDatabase(const ThumbnailInfo& info) con
     }
 
     // Read QImage from data blob
-    if (dbInfo.type == DatabaseThumbnail::PGF)
+    return decodeDatabaseThumbnail(dbInfo);
+}
+
+void ThumbnailCreator::prefetch(const QStringList& filePaths) const
+{
+    if (d->thumbnailStorage != ThumbnailDatabase)
     {
-        if (!readPGFImageData(dbInfo.data, image.qimage))
+        return;
+    }
+
+    if (!d->prefetch)
+    {
+        d->prefetch = new ThumbnailPrefetch;
+    }
+
+    ThumbnailPrefetch* const prefetch = d->prefetch;
+    QSet<QString>            requested;
+    QStringList              newPaths;
+
+    {
+        QMutexLocker lock(&prefetch->mutex);
+
+        // discard what is no longer requested
+        foreach (const QString& path, filePaths)
         {
-            kWarning() << "Cannot load PGF thumb from DB";
-            return ThumbnailImage();
+            requested << path;
+        }
+
+        QHash<QString, ThumbnailPrefetch::Entry>::iterator it = prefetch->entries.begin();
+
+        while (it != prefetch->entries.end())
+        {
+            if (requested.contains(it.key()))
+            {
+                ++it;
+            }
+            else
+            {
+                it = prefetch->entries.erase(it);
+            }
+        }
+
+        QList<QString>::iterator queueIt = prefetch->queue.begin();
+
+        while (queueIt != prefetch->queue.end())
+        {
+            if (requested.contains(*queueIt))
+            {
+                ++queueIt;
+            }
+            else
+            {
+                queueIt = prefetch->queue.erase(queueIt);
+            }
+        }
+
+        foreach (const QString& path, requested)
+        {
+            if (!prefetch->entries.contains(path))
+            {
+                newPaths << path;
+            }
         }
     }
-    else if (dbInfo.type == DatabaseThumbnail::JPEG)
+
+    // Resolve all files at once, then look up all thumbnails with a few queries, preferring the hash as load() does
+    QList<ThumbnailInfo>        infos;
+    QList<QPair<QString, int> > hashes;
+    QList<ThumbnailInfo>        newInfos;
+
+    if (d->infoProvider)
     {
-        QBuffer buffer(&dbInfo.data);
-        buffer.open(QIODevice::ReadOnly);
-        image.qimage.load(&buffer, "JPEG");
+        newInfos = d->infoProvider->thumbnailInfos(newPaths);
+    }
+    else
+    {
+        foreach (const QString& path, newPaths)
+        {
+            newInfos << fileThumbnailInfo(path);
+        }
+    }
 
-        if (dbInfo.data.isNull())
+    foreach (const ThumbnailInfo& info, newInfos)
+    {
+        // custom identifiers are looked up by load()
+        if (!info.customIdentifier.isNull())
         {
-            kWarning() << "Cannot load JPEG thumb from DB";
-            return ThumbnailImage();
+            continue;
+        }
+
+        if (!info.uniqueHash.isNull())
+        {
+            hashes << qMakePair(info.uniqueHash, info.fileSize);
         }
+
+        infos << info;
     }
-    else if (dbInfo.type == DatabaseThumbnail::JPEG2000)
+
+    QHash<QPair<QString, int>, DatabaseThumbnailInfo> byHash;
+    QHash<QString, DatabaseThumbnailInfo>             byPath;
+
+    if (!infos.isEmpty())
     {
-        QBuffer buffer(&dbInfo.data);
-        buffer.open(QIODevice::ReadOnly);
-        image.qimage.load(&buffer, "JP2");
+        ThumbnailDatabaseAccess access;
+        QStringList             paths, uniqueHashes;
 
-        if (dbInfo.data.isNull())
+        byHash = access.db()->findByHashes(hashes);
+
+        foreach (const ThumbnailInfo& info, infos)
         {
-            kWarning() << "Cannot load JPEG2000 thumb from DB";
-            return ThumbnailImage();
+            if (!info.filePath.isNull() && byHash.value(qMakePair(info.uniqueHash, info.fileSize)).data.isNull())
+            {
+                paths        << info.filePath;
+                uniqueHashes << info.uniqueHash;
+            }
         }
+
+        byPath = access.db()->findByFilePaths(paths, uniqueHashes);
     }
-    else if (dbInfo.type == DatabaseThumbnail::PNG)
+
+    QMutexLocker lock(&prefetch->mutex);
+
+    foreach (const ThumbnailInfo& info, infos)
     {
-        QBuffer buffer(&dbInfo.data);
-        buffer.open(QIODevice::ReadOnly);
-        image.qimage.load(&buffer, "PNG");
+        ThumbnailPrefetch::Entry entry;
+        entry.info   = info;
+        entry.dbInfo = byHash.value(qMakePair(info.uniqueHash, info.fileSize));
 
-        if (dbInfo.data.isNull())
+        if (entry.dbInfo.data.isNull())
         {
-            kWarning() << "Cannot load PNG thumb from DB";
-            return ThumbnailImage();
+            entry.dbInfo = byPath.value(info.filePath);
         }
+
+        // Entries without a valid thumbnail are kept as well, with the id for replacement
+        if (entry.dbInfo.data.isNull() || entry.dbInfo.modificationDate < info.modificationDate)
+        {
+            entry.dbInfo.data = QByteArray();
+            entry.state       = ThumbnailPrefetch::Entry::Ready;
+        }
+        else
+        {
+            entry.state       = ThumbnailPrefetch::Entry::Queued;
+        }
+
+        prefetch->entries.insert(info.filePath, entry);
     }
 
-    image.exifOrientation = dbInfo.orientationHint;
+    // decode in the order of the request
+    prefetch->queue.clear();
 
-    return image;
+    foreach (const QString& path, filePaths)
+    {
+        QHash<QString, ThumbnailPrefetch::Entry>::const_iterator it = prefetch->entries.constFind(path);
+
+        if (it != prefetch->entries.constEnd() && it->state == ThumbnailPrefetch::Entry::Queued &&
+            !prefetch->queue.contains(path))
+        {
+            prefetch->queue << path;
+        }
+    }
+
+    lock.unlock();
+    prefetch->startDecoding();
+}
+
+bool ThumbnailCreator::isPrefetched(const QString& filePath) const
+{
+    if (!d->prefetch)
+    {
+        return false;
+    }
+
+    QMutexLocker lock(&d->prefetch->mutex);
+    return d->prefetch->entries.contains(filePath);
+}
+
+bool ThumbnailCreator::loadPrefetched(const QString& path, ThumbnailInfo& info, ThumbnailImage& image) const
+{
+    ThumbnailPrefetch::Entry entry;
+
+    if (!d->prefetch || !d->prefetch->take(path, &entry))
+    {
+        return false;
+    }
+
+    info  = entry.info;
+    image = entry.image;
+
+    // store for use in storeInDatabase()
+    d->dbIdForReplacement = entry.dbInfo.id;
+
+    return true;
 }
 
 void ThumbnailCreator::deleteFromDatabase(const ThumbnailInfo& info) const
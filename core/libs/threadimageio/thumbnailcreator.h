@@ -29,6 +29,7 @@
 // Qt includes
 
 #include <QString>
+#include <QStringList>
 #include <QPixmap>
 #include <QImage>
 
@@ -86,6 +87,10 @@ public:
     ThumbnailInfoProvider() {};
     virtual ~ThumbnailInfoProvider() {};
     virtual ThumbnailInfo thumbnailInfo(const QString& path)=0;
+
+    /** Returns the info of each of the given paths, in the same order.
+     *  The default implementation calls thumbnailInfo() for each path. */
+    virtual QList<ThumbnailInfo> thumbnailInfos(const QStringList& paths);
 };
 
 class DatabaseThumbnailInfo;
@@ -127,6 +132,21 @@ public:
     void pregenerate(const QString& filePath) const;
     void pregenerateDetail(const QString& filePath, const QRect& detailRect) const;
 
+    /**
+     * Reads the stored thumbnails of the given files from the thumbnail database
+     * with a few batch queries, and starts decoding them in parallel, in the given order.
+     * A subsequent call to load() for one of the files takes the prefetched thumbnail,
+     * waiting only for its own decoding.
+     * Replaces the previous prefetch; prefetched thumbnails of files not given again are discarded.
+     * Only has an effect for the ThumbnailDatabase storage method.
+     */
+    void prefetch(const QStringList& filePaths) const;
+
+    /**
+     * Returns true if the thumbnail of the file is prefetched and not yet loaded.
+     */
+    bool isPrefetched(const QString& filePath) const;
+
     /**
      * Sets the thumbnail size. This is the maximum size of the QImage
      * returned by load.
@@ -181,6 +201,11 @@ public:
      */
     int storedSize() const;
 
+    /**
+     * Return the storage method given in the constructor.
+     */
+    StorageMethod thumbnailStorage() const;
+
     /**
      * Store the given image as thumbnail of the given path.
      * Image should at least have storedSize().
@@ -227,6 +252,7 @@ private:
     void storeInDatabase(const ThumbnailInfo& info, const ThumbnailImage& image) const;
     DatabaseThumbnailInfo loadDatabaseThumbnailInfo(const ThumbnailInfo& info) const;
     ThumbnailImage loadFromDatabase(const ThumbnailInfo& info) const;
+    bool loadPrefetched(const QString& path, ThumbnailInfo& info, ThumbnailImage& image) const;
     bool isInDatabase(const ThumbnailInfo& info) const;
     void deleteFromDatabase(const ThumbnailInfo& info) const;
 
@@ -51,6 +51,8 @@ public:
     int    exifOrientation;
 };
 
+class ThumbnailPrefetch;
+
 class ThumbnailCreator::ThumbnailCreatorPriv
 {
 public:
@@ -63,6 +65,7 @@ public:
         thumbnailStorage    = ThumbnailCreator::FreeDesktopStandard;
         infoProvider        = 0;
         dbIdForReplacement  = -1;
+        prefetch            = 0;
 
         exifRotate          = true;
         removeAlphaChannel  = true;
@@ -83,6 +86,7 @@ public:
     ThumbnailCreator::StorageMethod thumbnailStorage;
     ThumbnailInfoProvider*          infoProvider;
     int                             dbIdForReplacement;
+    ThumbnailPrefetch*              prefetch;
 
     int                             thumbnailSize;
 
@@ -291,6 +291,31 @@ ThumbnailCreator* ThumbnailLoadThread::thumbnailCreator() const
     return d->creator;
 }
 
+QStringList ThumbnailLoadThread::pendingThumbnailPaths(int maximum)
+{
+    QStringList  paths;
+    QMutexLocker lock(threadMutex());
+
+    for (int i=0; i<m_todo.size() && paths.size() < maximum; ++i)
+    {
+        ThumbnailLoadingTask* task = dynamic_cast<ThumbnailLoadingTask*>(m_todo.at(i));
+
+        if (!task || task->status() == LoadingTask::LoadingTaskStatusStopping)
+        {
+            continue;
+        }
+
+        const LoadingDescription::PreviewParameters& parameters = task->loadingDescription().previewParameters;
+
+        if (parameters.type == LoadingDescription::PreviewParameters::Thumbnail && !parameters.onlyPregenerate())
+        {
+            paths << task->loadingDescription().filePath;
+        }
+    }
+
+    return paths;
+}
+
 int ThumbnailLoadThread::thumbnailPixmapSize(int size) const
 {
     return d->pixmapSizeForThumbnailSize(size);
@@ -388,14 +413,9 @@ bool ThumbnailLoadThread::ThumbnailLoadThreadPriv::checkDescription(const Loadin
 {
     QString cacheKey = description.cacheKey();
 
+    if (LoadingCache::cache()->hasThumbnailPixmap(cacheKey))
     {
-        LoadingCache* cache = LoadingCache::cache();
-        LoadingCache::CacheLock lock(cache);
-
-        if (cache->hasThumbnailPixmap(cacheKey))
-        {
-            return false;
-        }
+        return false;
     }
 
     {
@@ -456,7 +476,6 @@ QList<LoadingDescription> ThumbnailLoadThread::ThumbnailLoadThreadPriv::makeDesc
 
 bool ThumbnailLoadThread::find(const QString& filePath, int size, QPixmap* retPixmap, bool emitSignal, const QRect& detailRect)
 {
-    const QPixmap* pix = 0;
     LoadingDescription description;
 
     if (detailRect.isNull())
@@ -470,22 +489,18 @@ bool ThumbnailLoadThread::find(const QString& filePath, int size, QPixmap* retPi
 
     QString cacheKey = description.cacheKey();
 
-    {
-        LoadingCache* cache = LoadingCache::cache();
-        LoadingCache::CacheLock lock(cache);
-        pix = cache->retrieveThumbnailPixmap(cacheKey);
-    }
+    QPixmap pix = LoadingCache::cache()->retrieveThumbnailPixmap(cacheKey);
 
-    if (pix)
+    if (!pix.isNull())
     {
         if (retPixmap)
         {
-            *retPixmap = *pix;
+            *retPixmap = pix;
         }
 
         if (emitSignal)
         {
-            emit signalThumbnailLoaded(description, QPixmap(*pix));
+            emit signalThumbnailLoaded(description, pix);
         }
 
         return true;
@@ -758,11 +773,7 @@ void ThumbnailLoadThread::slotThumbnailLoaded(const LoadingDescription& descript
     }
 
     // put into cache
-    {
-        LoadingCache* cache = LoadingCache::cache();
-        LoadingCache::CacheLock lock(cache);
-        cache->putThumbnail(description.cacheKey(), pix, description.filePath);
-    }
+    LoadingCache::cache()->putThumbnail(description.cacheKey(), pix, description.filePath);
 
     emit signalThumbnailLoaded(description, pix);
 }
@@ -820,11 +831,7 @@ void ThumbnailLoadThread::gotKDEPreview(const KFileItem& item, const QPixmap& kd
     }
 
     // put into cache
-    {
-        LoadingCache* cache = LoadingCache::cache();
-        LoadingCache::CacheLock lock(cache);
-        cache->putThumbnail(description.cacheKey(), pix, description.filePath);
-    }
+    LoadingCache::cache()->putThumbnail(description.cacheKey(), pix, description.filePath);
 
     emit signalThumbnailLoaded(description, pix);
 }
@@ -916,7 +923,6 @@ void ThumbnailLoadThread::deleteThumbnail(const QString& filePath)
 {
     {
         LoadingCache* cache = LoadingCache::cache();
-        LoadingCache::CacheLock lock(cache);
 
         QStringList possibleKeys = LoadingDescription::possibleThumbnailCacheKeys(filePath);
         foreach(const QString& cacheKey, possibleKeys)
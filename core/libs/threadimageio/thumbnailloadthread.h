@@ -249,6 +249,9 @@ public:
     // For internal use - may only be used from the thread
     ThumbnailCreator* thumbnailCreator() const;
 
+    // For internal use - returns the paths of the waiting thumbnail loading tasks, in order
+    QStringList pendingThumbnailPaths(int maximum);
+
 protected:
 
     virtual void thumbnailLoaded(const LoadingDescription& loadingDescription, const QImage& img);
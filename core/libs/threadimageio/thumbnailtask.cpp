@@ -92,16 +92,16 @@ void ThumbnailLoadingTask::execute()
     }
 
     LoadingCache* cache = LoadingCache::cache();
+
+    // find possible cached images. The cache itself is thread-safe.
+    m_qimage = cache->retrieveThumbnail(m_loadingDescription.cacheKey(), LoadingCache::CountHitOnly);
+
+    if (m_qimage.isNull())
     {
         LoadingCache::CacheLock lock(cache);
 
-        // find possible cached images
-        const QImage* cachedImage = cache->retrieveThumbnail(m_loadingDescription.cacheKey());
-
-        if (cachedImage)
-        {
-            m_qimage = QImage(*cachedImage);
-        }
+        // The image may have been put into the cache meanwhile, before its loading process was removed
+        m_qimage = cache->retrieveThumbnail(m_loadingDescription.cacheKey());
 
         if (m_qimage.isNull())
         {
@@ -115,13 +115,14 @@ void ThumbnailLoadingTask::execute()
                 // Other process is right now loading this image.
                 // Add this task to the list of listeners and
                 // attach this thread to the other thread, wait until loading
-                // has finished.
+                // has finished. Waiting and waking is done per process, by its cache key.
+                const QString processKey = m_usedProcess->cacheKey();
                 m_usedProcess->addListener(this);
 
                 // break loop when either the loading has completed, or this task is being stopped
-                while ( !m_usedProcess->completed() && m_loadingTaskStatus != LoadingTaskStatusStopping )
+                while ( m_loadingTaskStatus != LoadingTaskStatusStopping && m_usedProcess && !m_usedProcess->completed() )
                 {
-                    lock.timedWait();
+                    lock.timedWait(processKey);
                 }
 
                 // remove listener from process
@@ -131,7 +132,7 @@ void ThumbnailLoadingTask::execute()
                 }
 
                 // wake up the process which is waiting until all listeners have removed themselves
-                lock.wakeAll();
+                lock.wakeAll(processKey);
                 // set to 0, as checked in setStatus
                 m_usedProcess = 0;
             }
@@ -166,6 +167,7 @@ void ThumbnailLoadingTask::execute()
     switch (m_loadingDescription.previewParameters.type)
     {
         case LoadingDescription::PreviewParameters::Thumbnail:
+            prefetchPendingThumbnails();
             m_qimage = m_creator->load(m_loadingDescription.filePath);
             break;
         case LoadingDescription::PreviewParameters::DetailThumbnail:
@@ -176,21 +178,17 @@ void ThumbnailLoadingTask::execute()
             break;
     }
 
+    // put (valid) image into cache of loaded images,
+    // before the loading process is removed
+    if (!m_qimage.isNull())
     {
-        LoadingCache::CacheLock lock(cache);
-
-        // put (valid) image into cache of loaded images
-        if (!m_qimage.isNull())
-        {
-            cache->putThumbnail(m_loadingDescription.cacheKey(), m_qimage, m_loadingDescription.filePath);
-        }
-
-        // remove this from the list of loading processes in cache
-        cache->removeLoadingProcess(this);
+        cache->putThumbnail(m_loadingDescription.cacheKey(), m_qimage, m_loadingDescription.filePath);
     }
 
     {
         LoadingCache::CacheLock lock(cache);
+        // remove this from the list of loading processes in cache
+        cache->removeLoadingProcess(this);
         // indicate that loading has finished so that listeners can stop waiting
         m_completed = true;
 
@@ -207,13 +205,13 @@ void ThumbnailLoadingTask::execute()
 
         // remove myself from list of listeners
         removeListener(this);
-        // wake all listeners waiting on cache condVar, so that they remove themselves
-        lock.wakeAll();
+        // wake all listeners waiting on this process, so that they remove themselves
+        lock.wakeAll(cacheKey());
 
         // wait until all listeners have removed themselves
         while (m_listeners.count() != 0)
         {
-            lock.timedWait();
+            lock.timedWait(cacheKey());
         }
 
         // set to 0, as checked in setStatus
@@ -233,6 +231,34 @@ void ThumbnailLoadingTask::setupCreator()
     m_creator->setLoadingProperties(this, m_loadingDescription.rawDecodingSettings);
 }
 
+void ThumbnailLoadingTask::prefetchPendingThumbnails()
+{
+    // The number of thumbnails read ahead, about two screens full
+    const int prefetchCount = 100;
+
+    // Only thumbnails from the database are prefetched
+    if (m_creator->thumbnailStorage() != ThumbnailCreator::ThumbnailDatabase ||
+        m_creator->isPrefetched(m_loadingDescription.filePath))
+    {
+        return;
+    }
+
+    ThumbnailLoadThread* thumbThread = dynamic_cast<ThumbnailLoadThread*>(m_thread);
+
+    if (!thumbThread)
+    {
+        return;
+    }
+
+    // Read this and the following thumbnails from the database with one query,
+    // and decode them in parallel while they are delivered one after the other
+    QStringList paths;
+    paths << m_loadingDescription.filePath;
+    paths << thumbThread->pendingThumbnailPaths(prefetchCount - 1);
+
+    m_creator->prefetch(paths);
+}
+
 void ThumbnailLoadingTask::setResult(const LoadingDescription& loadingDescription, const QImage& qimage)
 {
     // this is called from another process's execute while this task is waiting on m_usedProcess.
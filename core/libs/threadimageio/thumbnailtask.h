@@ -52,6 +52,7 @@ private:
 
     virtual void setResult(const LoadingDescription&, const DImg&) {};
     void setupCreator();
+    void prefetchPendingThumbnails();
 
     QImage            m_qimage;
     ThumbnailCreator* m_creator;
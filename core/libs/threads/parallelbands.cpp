@@ -0,0 +1,224 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-30
+ * Description : Parallel computation in bands of rows
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "parallelbands.h"
+
+// Qt includes
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+// KDE includes
+
+#include <kglobal.h>
+
+namespace Digikam
+{
+
+K_GLOBAL_STATIC(QThreadPool, parallelBandsPool)
+
+/**
+ * The state of a computation. It is shared with the helper tasks, which may
+ * start only after process() returned, so it is reference counted.
+ * The ParallelBands object itself is only accessed while bands are left.
+ */
+class ParallelBands::ParallelBandsPriv
+{
+public:
+
+    ParallelBandsPriv(ParallelBands* q, int count, int bandSize)
+        : ref(1),
+          q(q),
+          count(qMax(count, 0)),
+          bandSize(qMax(bandSize, 1)),
+          bands((this->count + this->bandSize - 1) / this->bandSize),
+          finishedBands(0)
+    {
+    }
+
+    /// Takes the next band and processes it, unless cancelled. Returns false if no band was left.
+    bool processNextBand(int helper)
+    {
+        const int band = nextBand.fetchAndAddOrdered(1);
+
+        if (band >= bands)
+        {
+            return false;
+        }
+
+        if (!cancelled)
+        {
+            const int start = band * bandSize;
+            const int stop  = qMin(start + bandSize, count);
+
+            q->processBand(start, stop, helper);
+            doneItems.fetchAndAddOrdered(stop - start);
+        }
+
+        QMutexLocker lock(&mutex);
+
+        if (++finishedBands == bands)
+        {
+            condition.wakeAll();
+        }
+
+        return true;
+    }
+
+    void deref()
+    {
+        if (!ref.deref())
+        {
+            delete this;
+        }
+    }
+
+public:
+
+    QAtomicInt           ref;
+    ParallelBands* const q;
+    const int            count;
+    const int            bandSize;
+    const int            bands;
+
+    QAtomicInt           nextBand;
+    QAtomicInt           doneItems;
+    QAtomicInt           cancelled;
+
+    QMutex               mutex;
+    QWaitCondition       condition;
+    int                  finishedBands;
+};
+
+class ParallelBandsTask : public QRunnable
+{
+public:
+
+    ParallelBandsTask(ParallelBands::ParallelBandsPriv* const d, int helper)
+        : d(d), helper(helper)
+    {
+        d->ref.ref();
+    }
+
+    ~ParallelBandsTask()
+    {
+        d->deref();
+    }
+
+    virtual void run()
+    {
+        while (d->processNextBand(helper))
+        {
+        }
+    }
+
+private:
+
+    ParallelBands::ParallelBandsPriv* const d;
+    const int                               helper;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+ParallelBands::ParallelBands(int count, int bandSize)
+    : d(new ParallelBandsPriv(this, count, bandSize))
+{
+}
+
+ParallelBands::~ParallelBands()
+{
+    d->deref();
+}
+
+void ParallelBands::process(int maxHelpers)
+{
+    if (maxHelpers < 0)
+    {
+        maxHelpers = QThread::idealThreadCount() - 1;
+    }
+
+    const int helpers = qMin(maxHelpers, d->bands - 1);
+
+    for (int i = 1; i <= helpers; ++i)
+    {
+        parallelBandsPool->start(new ParallelBandsTask(d, i));
+    }
+
+    while (d->processNextBand(0))
+    {
+        if (!d->cancelled)
+        {
+            bandProcessed();
+        }
+    }
+
+    // All bands are taken now. Wait for those processed by the helpers.
+    QMutexLocker lock(&d->mutex);
+
+    while (d->finishedBands < d->bands)
+    {
+        d->condition.wait(&d->mutex);
+    }
+}
+
+void ParallelBands::cancel()
+{
+    d->cancelled = 1;
+}
+
+bool ParallelBands::isCancelled() const
+{
+    return d->cancelled;
+}
+
+int ParallelBands::count() const
+{
+    return d->count;
+}
+
+int ParallelBands::bandCount() const
+{
+    return d->bands;
+}
+
+int ParallelBands::doneItems() const
+{
+    return d->doneItems;
+}
+
+int ParallelBands::bandSize(int count, int bandsPerThread, int maxBandSize)
+{
+    const int threads = qMax(QThread::idealThreadCount(), 1);
+    return qBound(1, count / (threads * bandsPerThread), maxBandSize);
+}
+
+void ParallelBands::bandProcessed()
+{
+}
+
+} // namespace Digikam
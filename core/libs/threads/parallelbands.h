@@ -0,0 +1,104 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-30
+ * Description : Parallel computation in bands of rows
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef PARALLELBANDS_H
+#define PARALLELBANDS_H
+
+// Local includes
+
+#include "digikam_export.h"
+
+namespace Digikam
+{
+
+/**
+ * Divides a range of items, typically the rows of an image, in bands,
+ * which are processed in parallel. Reimplement processBand() and call process().
+ *
+ * The calling thread takes part in the computation. Helper threads come from one
+ * thread pool shared by all computations, so that concurrent computations do not
+ * start more threads than there are cores. Each thread takes the next band until
+ * all are taken, through an atomic counter, without locking per band.
+ */
+class DIGIKAM_EXPORT ParallelBands
+{
+public:
+
+    /// Divides count items in bands of bandSize items (the last band may be smaller)
+    ParallelBands(int count, int bandSize);
+    virtual ~ParallelBands();
+
+    /**
+     * Processes all bands, and returns when they are done.
+     * At most maxHelpers threads help the calling thread; with -1, one thread per additional core.
+     * process() does not wait for helpers which have not yet started, so a band
+     * may itself start a parallel computation. Call process() only once.
+     */
+    void process(int maxHelpers = -1);
+
+    /**
+     * No more bands are started. process() returns when the bands already started are done.
+     * Can be called from any thread, including from processBand().
+     */
+    void cancel();
+    bool isCancelled() const;
+
+    int count() const;
+    int bandCount() const;
+
+    /// The number of items of the bands processed so far
+    int doneItems() const;
+
+    /**
+     * Returns a band size giving each of the cores about bandsPerThread bands of count items,
+     * which is at least 1 and at most maxBandSize.
+     */
+    static int bandSize(int count, int bandsPerThread, int maxBandSize);
+
+protected:
+
+    /**
+     * Process the items from start to stop (exclusive).
+     * helper is 0 in the calling thread, and from 1 to the number of helpers in the other threads.
+     * All bands with the same helper number are processed in the same thread, one after the other.
+     * Note: This method is called from several threads at the same time.
+     */
+    virtual void processBand(int start, int stop, int helper) = 0;
+
+    /**
+     * Called in the calling thread after each band it processed, for example to post progress.
+     * The default implementation does nothing.
+     */
+    virtual void bandProcessed();
+
+private:
+
+    class ParallelBandsPriv;
+    friend class ParallelBandsPriv;
+    friend class ParallelBandsTask;
+    ParallelBandsPriv* const d;
+};
+
+} // namespace Digikam
+
+#endif // PARALLELBANDS_H
@@ -104,6 +104,7 @@ extern "C"
 #include "iofilesettingscontainer.h"
 #include "loadingcache.h"
 #include "loadingcacheinterface.h"
+#include "previewdiskcache.h"
 #include "savingcontextcontainer.h"
 #include "setup.h"
 #include "setupmisc.h"
@@ -197,6 +198,8 @@ ShowFoto::ShowFoto(const KUrl::List& urlList)
     // Setup loading cache and thumbnails interface.
 
     Digikam::LoadingCacheInterface::initialize();
+    Digikam::LoadingCacheInterface::setAdaptiveCacheSizing(group.readEntry("Adaptive Cache Size", true));
+    Digikam::PreviewDiskCache::instance()->setMaximumSize(group.readEntry("Preview Disk Cache Size", 512));
 
     d->thumbLoadThread = new Digikam::ThumbnailLoadThread();
     d->thumbLoadThread->setThumbnailSize(Digikam::ThumbnailSize::Huge);
@@ -0,0 +1,242 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-27
+ * Description : benchmark of the smooth scaling code paths of DImg
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "dimgscalebenchmark.h"
+#include "dimgscalebenchmark.moc"
+
+// C++ includes
+
+#include <cstring>
+
+// Qt includes
+
+#include <QRect>
+#include <QSize>
+
+// KDE includes
+
+#include <qtest_kde.h>
+
+// Local includes
+
+#include "dimgscale.h"
+
+using namespace Digikam;
+
+QTEST_KDEMAIN(DImgScaleBenchmark, GUI)
+
+/// Size of the source images: six megapixels, large enough to be scaled in parallel bands
+static const int sourceWidth  = 3000;
+static const int sourceHeight = 2000;
+
+enum Operation
+{
+    Scale,
+    ScaleClipped,
+    ScaleSection
+};
+
+static DImg scaled(const DImg& image, int operation, const QSize& size, const QRect& rect)
+{
+    switch (operation)
+    {
+        case ScaleClipped:
+            return image.smoothScaleClipped(size, rect);
+        case ScaleSection:
+            return image.smoothScaleSection(rect, size);
+        default:
+            return image.smoothScale(size);
+    }
+}
+
+void DImgScaleBenchmark::initTestCase()
+{
+    // reproducible noise, and different in each channel
+    qsrand(42);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        DImg image(sourceWidth, sourceHeight, i & 2, i & 1);
+        uchar* bits = image.bits();
+
+        for (uint j = 0; j < image.numBytes(); ++j)
+        {
+            bits[j] = qrand() & 0xFF;
+        }
+
+        m_images[i] = image;
+    }
+}
+
+void DImgScaleBenchmark::cleanupTestCase()
+{
+    DImgScale::setCodePath(DImgScale::AutomaticCodePath);
+    DImgScale::setParallelBands(true);
+}
+
+const DImg& DImgScaleBenchmark::sourceImage(bool sixteenBit, bool alpha) const
+{
+    return m_images[(sixteenBit ? 2 : 0) + (alpha ? 1 : 0)];
+}
+
+void DImgScaleBenchmark::addScaleRows()
+{
+    QTest::addColumn<bool>("sixteenBit");
+    QTest::addColumn<bool>("alpha");
+    QTest::addColumn<int>("operation");
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QRect>("rect");
+}
+
+void DImgScaleBenchmark::testCodePaths_data()
+{
+    addScaleRows();
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const bool sixteenBit = i & 2;
+        const bool alpha      = i & 1;
+        const QString format  = QString(sixteenBit ? "16 bit" : "8 bit") + QString(alpha ? " RGBA" : " RGB");
+
+        // one row for each of the four cases of the area sampling: scaling up or down in x and y
+        QTest::newRow(qPrintable(format + ", preview"))
+            << sixteenBit << alpha << (int)Scale        << QSize(750, 500)   << QRect();
+        QTest::newRow(qPrintable(format + ", up"))
+            << sixteenBit << alpha << (int)Scale        << QSize(4500, 3000) << QRect();
+        QTest::newRow(qPrintable(format + ", down in y"))
+            << sixteenBit << alpha << (int)Scale        << QSize(3000, 1500) << QRect();
+        QTest::newRow(qPrintable(format + ", down in x"))
+            << sixteenBit << alpha << (int)Scale        << QSize(1500, 2500) << QRect();
+        QTest::newRow(qPrintable(format + ", zoom"))
+            << sixteenBit << alpha << (int)ScaleClipped << QSize(6000, 4000) << QRect(1000, 1000, 1600, 1200);
+        QTest::newRow(qPrintable(format + ", section"))
+            << sixteenBit << alpha << (int)ScaleSection << QSize(600, 450)   << QRect(1000, 500, 1200, 900);
+    }
+}
+
+void DImgScaleBenchmark::testCodePaths()
+{
+    QFETCH(bool, sixteenBit);
+    QFETCH(bool, alpha);
+    QFETCH(int, operation);
+    QFETCH(QSize, size);
+    QFETCH(QRect, rect);
+
+    const DImg& image = sourceImage(sixteenBit, alpha);
+
+    // The scalar code, in the calling thread, is the reference
+    QVERIFY(DImgScale::setCodePath(DImgScale::ScalarCodePath));
+    DImgScale::setParallelBands(false);
+    DImg reference    = scaled(image, operation, size, rect);
+    QVERIFY(!reference.isNull());
+
+    const DImgScale::CodePath paths[] = { DImgScale::ScalarCodePath, DImgScale::SSE2CodePath, DImgScale::AVX2CodePath };
+    const char* const names[]         = { "scalar", "SSE2", "AVX2" };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        // code paths not supported by this CPU are not compared
+        if (!DImgScale::setCodePath(paths[i]))
+        {
+            continue;
+        }
+
+        for (int parallel = 0; parallel < 2; ++parallel)
+        {
+            DImgScale::setParallelBands(parallel);
+            DImg result = scaled(image, operation, size, rect);
+
+            QCOMPARE(result.size(), reference.size());
+            QVERIFY2(memcmp(result.bits(), reference.bits(), reference.numBytes()) == 0,
+                     qPrintable(QString("%1 code path, %2").arg(names[i]).arg(parallel ? "parallel" : "one thread")));
+        }
+    }
+
+    DImgScale::setCodePath(DImgScale::AutomaticCodePath);
+    DImgScale::setParallelBands(true);
+}
+
+void DImgScaleBenchmark::benchmarkScale_data()
+{
+    addScaleRows();
+    QTest::addColumn<int>("codePath");
+    QTest::addColumn<bool>("parallel");
+
+    const DImgScale::CodePath paths[] = { DImgScale::ScalarCodePath, DImgScale::SSE2CodePath,
+                                          DImgScale::AVX2CodePath,   DImgScale::AutomaticCodePath
+                                        };
+    const char* const names[]         = { "scalar", "SSE2", "AVX2", "automatic, parallel" };
+
+    for (int sixteenBit = 0; sixteenBit < 2; ++sixteenBit)
+    {
+        const QString format = sixteenBit ? "16 bit" : "8 bit";
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const QString path = QString(", ") + names[i];
+            const bool parallel = (paths[i] == DImgScale::AutomaticCodePath);
+
+            QTest::newRow(qPrintable(format + ", preview" + path))
+                << (bool)sixteenBit << false << (int)Scale        << QSize(750, 500)   << QRect()
+                << (int)paths[i] << parallel;
+            QTest::newRow(qPrintable(format + ", up" + path))
+                << (bool)sixteenBit << false << (int)Scale        << QSize(4500, 3000) << QRect()
+                << (int)paths[i] << parallel;
+            QTest::newRow(qPrintable(format + ", down in y" + path))
+                << (bool)sixteenBit << false << (int)Scale        << QSize(3000, 1500) << QRect()
+                << (int)paths[i] << parallel;
+            QTest::newRow(qPrintable(format + ", zoom" + path))
+                << (bool)sixteenBit << false << (int)ScaleClipped << QSize(6000, 4000) << QRect(1000, 1000, 1600, 1200)
+                << (int)paths[i] << parallel;
+        }
+    }
+}
+
+void DImgScaleBenchmark::benchmarkScale()
+{
+    QFETCH(bool, sixteenBit);
+    QFETCH(bool, alpha);
+    QFETCH(int, operation);
+    QFETCH(QSize, size);
+    QFETCH(QRect, rect);
+    QFETCH(int, codePath);
+    QFETCH(bool, parallel);
+
+    if (!DImgScale::setCodePath((DImgScale::CodePath)codePath))
+    {
+        QSKIP("Code path is not available", SkipSingle);
+    }
+
+    // The scalar code path in one thread is the code before vectorization
+    DImgScale::setParallelBands(parallel);
+    const DImg& image = sourceImage(sixteenBit, alpha);
+
+    QBENCHMARK
+    {
+        DImg result = scaled(image, operation, size, rect);
+        Q_UNUSED(result);
+    }
+
+    DImgScale::setCodePath(DImgScale::AutomaticCodePath);
+    DImgScale::setParallelBands(true);
+}
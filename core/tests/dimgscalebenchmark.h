@@ -0,0 +1,57 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-27
+ * Description : benchmark of the smooth scaling code paths of DImg
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef DIMGSCALEBENCHMARK_H
+#define DIMGSCALEBENCHMARK_H
+
+// Qt includes
+
+#include <QtCore/QObject>
+
+// Local includes
+
+#include "dimg.h"
+
+class DImgScaleBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testCodePaths();
+    void testCodePaths_data();
+    void benchmarkScale();
+    void benchmarkScale_data();
+
+private:
+
+    void addScaleRows();
+    const Digikam::DImg& sourceImage(bool sixteenBit, bool alpha) const;
+
+    Digikam::DImg m_images[4];
+};
+
+#endif /* DIMGSCALEBENCHMARK_H */
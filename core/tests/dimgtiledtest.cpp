@@ -0,0 +1,329 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-29
+ * Description : test of the tiled pixel store of DImg
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "dimgtiledtest.h"
+#include "dimgtiledtest.moc"
+
+// C++ includes
+
+#include <cstring>
+
+// Qt includes
+
+#include <QDir>
+#include <QThread>
+
+// KDE includes
+
+#include <qtest_kde.h>
+#include <ktempdir.h>
+
+// Local includes
+
+#include "dimgtilestore.h"
+
+using namespace Digikam;
+
+QTEST_KDEMAIN(DImgTiledTest, GUI)
+
+static bool isSameColor(const DColor& a, const DColor& b)
+{
+    return a.red()   == b.red()   && a.green() == b.green() &&
+           a.blue()  == b.blue()  && a.alpha() == b.alpha();
+}
+
+/// Reads the pixels of a shared image while another thread calls bits()
+class TiledReaderThread : public QThread
+{
+public:
+
+    TiledReaderThread(const DImg& image, const DImg& reference)
+        : image(image), reference(reference), ok(true)
+    {
+    }
+
+    virtual void run()
+    {
+        for (uint y = 0; y < image.height(); y += 37)
+        {
+            if (!isSameColor(image.getPixelColor(y, y / 2), reference.getPixelColor(y, y / 2)))
+            {
+                ok = false;
+            }
+        }
+
+        const QRect rect(100, 100, 500, 500);
+        DImg section = image.smoothScaleSection(rect, QSize(250, 250));
+        DImg copy    = image.copy(rect);
+
+        if (memcmp(section.bits(), reference.smoothScaleSection(rect, QSize(250, 250)).bits(), section.numBytes()) != 0 ||
+            memcmp(copy.bits(), reference.copy(rect).bits(), copy.numBytes()) != 0)
+        {
+            ok = false;
+        }
+    }
+
+public:
+
+    const DImg image;
+    const DImg reference;
+    bool       ok;
+};
+
+void DImgTiledTest::initTestCase()
+{
+    // Not a multiple of the tile size, and some tiles will be moved to the scratch file
+    m_image = DImg(1000, 700, true, true);
+    uchar* bits = m_image.bits();
+
+    qsrand(42);
+
+    for (uint i = 0; i < m_image.numBytes(); ++i)
+    {
+        bits[i] = qrand() & 0xFF;
+    }
+
+    m_residentLimit = DImgTileStore::residentLimit();
+    DImgTileStore::setResidentLimit(4 * DImgTileStore::TileSize * DImgTileStore::TileSize * 8);
+}
+
+void DImgTiledTest::cleanupTestCase()
+{
+    DImgTileStore::setResidentLimit(m_residentLimit);
+}
+
+DImg DImgTiledTest::tiledCopy(const DImg& image) const
+{
+    DImg tiled = image.copy();
+    tiled.setTiled(true);
+    return tiled;
+}
+
+bool DImgTiledTest::isEqual(const DImg& a, const DImg& b) const
+{
+    if (a.size() != b.size() || a.sixteenBit() != b.sixteenBit())
+    {
+        return false;
+    }
+
+    // compare copies, bits() would move the pixels of tiled images to one buffer
+    DImg ca = a.copy();
+    DImg cb = b.copy();
+    return memcmp(ca.bits(), cb.bits(), ca.numBytes()) == 0;
+}
+
+void DImgTiledTest::testTileStore()
+{
+    const int depth = m_image.bytesDepth();
+    const int w     = m_image.width();
+    const int h     = m_image.height();
+
+    DImgTileStore store(w, h, depth);
+
+    // Tiles not written to read as zero
+    QByteArray zero(10 * 10 * depth, 0);
+    QByteArray region(10 * 10 * depth, 1);
+    store.readRegion(QRect(500, 300, 10, 10), (uchar*)region.data(), 10 * depth);
+    QCOMPARE(region, zero);
+    QCOMPARE(store.residentTiles(), 0);
+
+    store.writeRegion(QRect(0, 0, w, h), m_image.bits(), w * depth);
+    QVERIFY(store.spilledTiles() > 0);
+    QCOMPARE(store.residentTiles(), 4);
+
+    // Regions across tile borders, from memory and from the scratch file
+    const QRect rects[] = { QRect(0, 0, 1, 1), QRect(250, 250, 20, 20), QRect(0, 0, w, h),
+                            QRect(w - 3, h - 300, 3, 300), QRect(100, 600, 900, 100)
+                          };
+
+    for (uint i = 0; i < sizeof(rects) / sizeof(QRect); ++i)
+    {
+        const QRect& r = rects[i];
+        QByteArray data(r.width() * r.height() * depth, 0);
+        store.readRegion(r, (uchar*)data.data(), r.width() * depth);
+
+        for (int y = 0; y < r.height(); ++y)
+        {
+            QVERIFY(memcmp(data.constData() + y * r.width() * depth,
+                           m_image.scanLine(r.y() + y) + r.x() * depth, r.width() * depth) == 0);
+        }
+    }
+
+    DImgTileStore* copy = store.copy();
+    QByteArray all(m_image.numBytes(), 0);
+    copy->moveAllTo((uchar*)all.data());
+    delete copy;
+    QVERIFY(memcmp(all.constData(), m_image.bits(), m_image.numBytes()) == 0);
+}
+
+void DImgTiledTest::testSetTiled()
+{
+    DImg image = m_image.copy();
+    DImg shared(image);
+
+    image.setTiled(true);
+    QVERIFY(image.isTiled());
+    QCOMPARE(image.size(), m_image.size());
+
+    // The image was detached, the other one keeps its buffer
+    QVERIFY(!(image == shared));
+    QVERIFY(!shared.isTiled());
+
+    // bits() moves the pixels back to one buffer
+    QVERIFY(memcmp(image.bits(), m_image.bits(), m_image.numBytes()) == 0);
+    QVERIFY(!image.isTiled());
+
+    image.setTiled(true);
+    image.setTiled(false);
+    QVERIFY(!image.isTiled());
+    QVERIFY(memcmp(image.bits(), m_image.bits(), m_image.numBytes()) == 0);
+}
+
+void DImgTiledTest::testPixelAccess()
+{
+    DImg image = tiledCopy(m_image);
+
+    QVERIFY(isSameColor(image.getPixelColor(0, 0), m_image.getPixelColor(0, 0)));
+    QVERIFY(isSameColor(image.getPixelColor(999, 699), m_image.getPixelColor(999, 699)));
+    QVERIFY(isSameColor(image.getPixelColor(256, 511), m_image.getPixelColor(256, 511)));
+
+    DColor color(1000, 2000, 3000, 4000, true);
+    image.setPixelColor(300, 300, color);
+    QVERIFY(image.isTiled());
+    QVERIFY(isSameColor(image.getPixelColor(300, 300), color));
+    QVERIFY(isSameColor(image.getPixelColor(301, 300), m_image.getPixelColor(301, 300)));
+}
+
+void DImgTiledTest::testCopy()
+{
+    DImg image = tiledCopy(m_image);
+
+    DImg copy  = image.copy();
+    QVERIFY(copy.isTiled());
+    QVERIFY(isEqual(copy, m_image));
+
+    QRect rect(200, 250, 400, 300);
+    DImg section = image.copy(rect);
+    QVERIFY(image.isTiled());
+    QVERIFY(isEqual(section, m_image.copy(rect)));
+
+    QVERIFY(isEqual(image.copyImageData(), m_image));
+    QVERIFY(image.isTiled());
+}
+
+void DImgTiledTest::testBitBlt()
+{
+    DImg patch = m_image.copy(QRect(10, 20, 300, 200));
+
+    // to tiles
+    DImg image = tiledCopy(m_image);
+    DImg reference = m_image.copy();
+    image.bitBltImage(&patch, 600, 400);
+    reference.bitBltImage(&patch, 600, 400);
+    QVERIFY(image.isTiled());
+    QVERIFY(isEqual(image, reference));
+
+    // from tiles to tiles
+    DImg tiledPatch = tiledCopy(patch);
+    image.bitBltImage(&tiledPatch, 0, 0, 300, 200, 900, 650);
+    reference.bitBltImage(&patch, 0, 0, 300, 200, 900, 650);
+    QVERIFY(isEqual(image, reference));
+
+    // from tiles to a buffer
+    DImg dest(300, 200, true, true);
+    dest.bitBltImage(&image, 600, 400, 300, 200, 0, 0);
+    QVERIFY(isEqual(dest, patch));
+}
+
+void DImgTiledTest::testCrop()
+{
+    DImg image = tiledCopy(m_image);
+    image.crop(QRect(100, 200, 700, 700));
+    QVERIFY(image.isTiled());
+    QCOMPARE(image.size(), QSize(700, 500));
+
+    DImg reference = m_image.copy();
+    reference.crop(QRect(100, 200, 700, 500));
+    QVERIFY(isEqual(image, reference));
+}
+
+void DImgTiledTest::testSmoothScale()
+{
+    DImg image = tiledCopy(m_image);
+
+    QVERIFY(isEqual(image.smoothScale(300, 200), m_image.smoothScale(300, 200)));
+    QVERIFY(isEqual(image.smoothScale(2500, 1800), m_image.smoothScale(2500, 1800)));
+    QVERIFY(isEqual(image.smoothScaleSection(QRect(300, 200, 128, 128), QSize(512, 512)),
+                    m_image.smoothScaleSection(QRect(300, 200, 128, 128), QSize(512, 512))));
+    QVERIFY(isEqual(image.smoothScaleSection(QRect(0, 0, 1000, 700), QSize(128, 90)),
+                    m_image.smoothScaleSection(QRect(0, 0, 1000, 700), QSize(128, 90))));
+    QVERIFY(isEqual(image.smoothScaleClipped(QSize(4000, 2800), QRect(1000, 1000, 640, 480)),
+                    m_image.smoothScaleClipped(QSize(4000, 2800), QRect(1000, 1000, 640, 480))));
+
+    // Only the tiles were read
+    QVERIFY(image.isTiled());
+}
+
+void DImgTiledTest::testConcurrentBits()
+{
+    for (int run = 0; run < 10; ++run)
+    {
+        const DImg image = tiledCopy(m_image);
+        TiledReaderThread reader1(image, m_image);
+        TiledReaderThread reader2(image, m_image);
+
+        reader1.start();
+        reader2.start();
+
+        QVERIFY(memcmp(image.bits(), m_image.bits(), m_image.numBytes()) == 0);
+
+        reader1.wait();
+        reader2.wait();
+        QVERIFY(reader1.ok);
+        QVERIFY(reader2.ok);
+        QVERIFY(!image.isTiled());
+    }
+}
+
+void DImgTiledTest::testScratchDirectory()
+{
+    const QString scratchDirectory = DImgTileStore::scratchDirectory();
+    QVERIFY(!scratchDirectory.isEmpty());
+
+    KTempDir dir;
+    DImgTileStore::setScratchDirectory(dir.name());
+    QCOMPARE(DImgTileStore::scratchDirectory(), dir.name());
+
+    {
+        DImgTileStore store(m_image.width(), m_image.height(), m_image.bytesDepth());
+        store.writeRegion(QRect(0, 0, m_image.width(), m_image.height()), m_image.bits(),
+                          m_image.width() * m_image.bytesDepth());
+        QVERIFY(store.spilledTiles() > 0);
+        QCOMPARE(QDir(dir.name()).entryList(QStringList() << "digikam-tiles-*", QDir::Files).size(), 1);
+    }
+
+    // removed with the store
+    QVERIFY(QDir(dir.name()).entryList(QDir::Files).isEmpty());
+
+    DImgTileStore::setScratchDirectory(scratchDirectory);
+}
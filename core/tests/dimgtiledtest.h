@@ -0,0 +1,63 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-29
+ * Description : test of the tiled pixel store of DImg
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef DIMGTILEDTEST_H
+#define DIMGTILEDTEST_H
+
+// Qt includes
+
+#include <QtCore/QObject>
+
+// Local includes
+
+#include "dimg.h"
+
+class DImgTiledTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testTileStore();
+    void testSetTiled();
+    void testPixelAccess();
+    void testCopy();
+    void testBitBlt();
+    void testCrop();
+    void testSmoothScale();
+    void testConcurrentBits();
+    void testScratchDirectory();
+
+private:
+
+    Digikam::DImg tiledCopy(const Digikam::DImg& image) const;
+    bool          isEqual(const Digikam::DImg& a, const Digikam::DImg& b) const;
+
+    Digikam::DImg m_image;
+    qint64        m_residentLimit;
+};
+
+#endif /* DIMGTILEDTEST_H */
@@ -0,0 +1,206 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-20
+ * Description : benchmark of map area queries
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "mapareabenchmark.h"
+#include "mapareabenchmark.moc"
+
+// Qt includes
+
+#include <QDate>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTime>
+
+// KDE includes
+
+#include <qtest_kde.h>
+#include <kdebug.h>
+
+// Local includes
+
+#include "albumdb.h"
+#include "databaseaccess.h"
+#include "databasebackend.h"
+#include "databaseparameters.h"
+#include "databasetransaction.h"
+#include "imagelister.h"
+#include "imagelisterreceiver.h"
+#include "sqlquery.h"
+
+using namespace Digikam;
+
+QTEST_KDEMAIN(MapAreaBenchmark, GUI)
+
+/// Number of geotagged images in the benchmark database
+static const int numberOfImages = 500000;
+
+void MapAreaBenchmark::initTestCase()
+{
+    m_dbPath = QDir::temp().absoluteFilePath("mapareabenchmark-" + QTime::currentTime().toString("hhmmsszzz") + ".db");
+
+    DatabaseAccess::setParameters(DatabaseParameters::parametersForSQLite(m_dbPath), DatabaseAccess::MainApplication);
+    QVERIFY2(DatabaseAccess::checkReadyForUse(0), "Could not create the benchmark database");
+
+    QTime time;
+    time.start();
+
+    DatabaseAccess access;
+    m_hasSpatialIndex = access.db()->getSpatialIndexVersion() >= 1;
+
+    int rootId  = access.db()->addAlbumRoot(AlbumRoot::VolumeHardWired, "volumeid:?path=/benchmark", "/", "Benchmark");
+    int albumId = access.db()->addAlbum(rootId, "/", QString(), QDate::currentDate(), QString());
+
+    DatabaseTransaction transaction(&access);
+
+    SqlQuery images      = access.backend()->prepareQuery(
+                               "INSERT INTO Images (id, album, name, status, category, modificationDate, fileSize) "
+                               " VALUES (?, ?, ?, 1, 1, ?, 0);");
+    SqlQuery information = access.backend()->prepareQuery(
+                               "INSERT INTO ImageInformation (imageid, rating, creationDate) VALUES (?, 0, ?);");
+    SqlQuery positions   = access.backend()->prepareQuery(
+                               "INSERT INTO ImagePositions (imageid, latitudeNumber, longitudeNumber) VALUES (?, ?, ?);");
+
+    const QString date = QDateTime::currentDateTime().toString(Qt::ISODate);
+
+    // reproducible positions, clustered the way photos usually are: around a few hundred places
+    qsrand(42);
+
+    for (int id = 1; id <= numberOfImages; ++id)
+    {
+        const int    place = qrand() % 500;
+        const double lat   = (place % 25) * 6.0 - 70.0 + (qrand() % 100000) / 50000.0;
+        const double lng   = (place / 25) * 16.0 - 160.0 + (qrand() % 100000) / 50000.0;
+
+        images.bindValue(0, id);
+        images.bindValue(1, albumId);
+        images.bindValue(2, QString("IMG_%1.JPG").arg(id));
+        images.bindValue(3, date);
+        QVERIFY(access.backend()->exec(images));
+
+        information.bindValue(0, id);
+        information.bindValue(1, date);
+        QVERIFY(access.backend()->exec(information));
+
+        positions.bindValue(0, id);
+        positions.bindValue(1, lat);
+        positions.bindValue(2, lng);
+        QVERIFY(access.backend()->exec(positions));
+    }
+
+    kDebug() << "Created" << numberOfImages << "geotagged images in" << time.elapsed() << "ms"
+             << "spatial index:" << m_hasSpatialIndex;
+}
+
+void MapAreaBenchmark::cleanupTestCase()
+{
+    DatabaseAccess::cleanUpDatabase();
+
+    QFile::remove(m_dbPath);
+    QFile::remove(m_dbPath + "-wal");
+    QFile::remove(m_dbPath + "-shm");
+}
+
+void MapAreaBenchmark::useSpatialIndex(bool use)
+{
+    DatabaseAccess access;
+    access.db()->setSpatialIndexVersion(use ? 1 : 0);
+}
+
+void MapAreaBenchmark::benchmarkPan_data()
+{
+    QTest::addColumn<double>("size");
+    QTest::addColumn<bool>("spatialIndex");
+
+    QTest::newRow("continent, no index")   << 40.0 << false;
+    QTest::newRow("continent, index")      << 40.0 << true;
+    QTest::newRow("country, no index")     << 8.0  << false;
+    QTest::newRow("country, index")        << 8.0  << true;
+    QTest::newRow("city, no index")        << 0.2  << false;
+    QTest::newRow("city, index")           << 0.2  << true;
+}
+
+void MapAreaBenchmark::benchmarkPan()
+{
+    QFETCH(double, size);
+    QFETCH(bool, spatialIndex);
+
+    if (spatialIndex && !m_hasSpatialIndex)
+    {
+        QSKIP("SQLite has no R*Tree support", SkipSingle);
+    }
+
+    useSpatialIndex(spatialIndex);
+
+    ImageLister lister;
+    lister.setListOnlyAvailable(false);
+
+    QBENCHMARK
+    {
+        // Pan eastwards by a quarter of the visible area,
+        // each step lists the newly visible part, like GPSMarkerTiler::prepareTiles
+        for (int step = 0; step < 10; ++step)
+        {
+            ImageListerValueListReceiver receiver;
+            const double lng = -100.0 + step * size / 4;
+            lister.listAreaRange(&receiver, 20.0, 20.0 + size, lng + size * 3 / 4, lng + size);
+            QVERIFY(!receiver.hasError);
+        }
+    }
+
+    useSpatialIndex(m_hasSpatialIndex);
+}
+
+void MapAreaBenchmark::benchmarkZoom_data()
+{
+    QTest::addColumn<bool>("spatialIndex");
+
+    QTest::newRow("no index") << false;
+    QTest::newRow("index")    << true;
+}
+
+void MapAreaBenchmark::benchmarkZoom()
+{
+    QFETCH(bool, spatialIndex);
+
+    if (spatialIndex && !m_hasSpatialIndex)
+    {
+        QSKIP("SQLite has no R*Tree support", SkipSingle);
+    }
+
+    useSpatialIndex(spatialIndex);
+
+    QBENCHMARK
+    {
+        // Zoom in from the whole world to a single place, as the map kioslave lists it
+        for (double size = 180.0; size > 0.1; size /= 2)
+        {
+            QList<QVariant> values = DatabaseAccess().db()->getImageIdsFromArea(10.0 - size / 2, 10.0 + size / 2,
+                                                                                 0.0 - size,      0.0 + size,
+                                                                                 0, QString("rating"));
+            Q_UNUSED(values);
+        }
+    }
+
+    useSpatialIndex(m_hasSpatialIndex);
+}
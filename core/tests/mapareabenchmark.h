@@ -0,0 +1,54 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-20
+ * Description : benchmark of map area queries
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef MAPAREABENCHMARK_H
+#define MAPAREABENCHMARK_H
+
+// Qt includes
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+class MapAreaBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkPan();
+    void benchmarkPan_data();
+    void benchmarkZoom();
+    void benchmarkZoom_data();
+
+private:
+
+    void useSpatialIndex(bool use);
+
+    QString m_dbPath;
+    bool    m_hasSpatialIndex;
+};
+
+#endif /* MAPAREABENCHMARK_H */
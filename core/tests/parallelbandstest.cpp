@@ -0,0 +1,153 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-30
+ * Description : test of the parallel computation in bands
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "parallelbandstest.h"
+#include "parallelbandstest.moc"
+
+// Qt includes
+
+#include <QAtomicInt>
+
+// KDE includes
+
+#include <qtest_kde.h>
+
+// Local includes
+
+#include "parallelbands.h"
+
+using namespace Digikam;
+
+QTEST_KDEMAIN(ParallelBandsTest, NoGUI)
+
+class CountingBands : public ParallelBands
+{
+public:
+
+    CountingBands(int count, int bandSize, int cancelAfter = -1)
+        : ParallelBands(count, bandSize),
+          counts(new QAtomicInt[qMax(count, 1)]),
+          maxHelper(0),
+          cancelAfter(cancelAfter),
+          nested(0)
+    {
+    }
+
+    ~CountingBands()
+    {
+        delete [] counts;
+    }
+
+    QAtomicInt* const counts;
+    QAtomicInt        maxHelper;
+    QAtomicInt        processedBands;
+    QAtomicInt        nestedFailures;
+    const int         cancelAfter;
+    int               nested;
+
+protected:
+
+    virtual void processBand(int start, int stop, int helper)
+    {
+        for (int i = start; i < stop; ++i)
+        {
+            counts[i].ref();
+        }
+
+        for (int m = maxHelper; helper > m; m = maxHelper)
+        {
+            maxHelper.testAndSetOrdered(m, helper);
+        }
+
+        if (processedBands.fetchAndAddOrdered(1) + 1 == cancelAfter)
+        {
+            cancel();
+        }
+
+        // a computation started from a band must not wait for helpers busy with the outer one
+        if (nested)
+        {
+            CountingBands inner(nested, 1);
+            inner.process();
+
+            if (inner.doneItems() != nested)
+            {
+                nestedFailures.ref();
+            }
+        }
+    }
+};
+
+void ParallelBandsTest::testAllItems()
+{
+    const int sizes[] = { 0, 1, 7, 1000, 1001 };
+
+    for (uint s = 0; s < sizeof(sizes) / sizeof(int); ++s)
+    {
+        CountingBands bands(sizes[s], 8);
+        bands.process();
+
+        for (int i = 0; i < sizes[s]; ++i)
+        {
+            QCOMPARE((int)bands.counts[i], 1);
+        }
+
+        QCOMPARE(bands.doneItems(), sizes[s]);
+        QCOMPARE((int)bands.processedBands, bands.bandCount());
+    }
+
+    CountingBands limited(1000, 1);
+    limited.process(2);
+    QCOMPARE(limited.doneItems(), 1000);
+    QVERIFY(limited.maxHelper <= 2);
+
+    CountingBands single(1000, 1);
+    single.process(0);
+    QCOMPARE(single.doneItems(), 1000);
+    QCOMPARE((int)single.maxHelper, 0);
+}
+
+void ParallelBandsTest::testCancel()
+{
+    CountingBands bands(100000, 1, 10);
+    bands.process();
+
+    QVERIFY(bands.isCancelled());
+    QVERIFY(bands.doneItems() < 100000);
+    QCOMPARE(bands.doneItems(), (int)bands.processedBands);
+
+    for (int i = 0; i < 100000; ++i)
+    {
+        QVERIFY(bands.counts[i] <= 1);
+    }
+}
+
+void ParallelBandsTest::testNested()
+{
+    CountingBands bands(256, 1);
+    bands.nested = 64;
+    bands.process();
+
+    QCOMPARE(bands.doneItems(), 256);
+    QCOMPARE((int)bands.nestedFailures, 0);
+}
@@ -0,0 +1,80 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-09
+ * Description : test of the unique hash of files
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#include "uniquehashtest.h"
+#include "uniquehashtest.moc"
+
+// Qt includes
+
+#include <QByteArray>
+
+// KDE includes
+
+#include <qtest_kde.h>
+#include <ktemporaryfile.h>
+
+// Local includes
+
+#include "dimg.h"
+
+using namespace Digikam;
+
+QTEST_KDEMAIN(UniqueHashTest, GUI)
+
+static QByteArray pattern(int size)
+{
+    QByteArray data(size, 0);
+
+    for (int i = 0; i < size; ++i)
+    {
+        data[i] = (char)((i * 7 + 3) & 0xFF);
+    }
+
+    return data;
+}
+
+void UniqueHashTest::testUniqueHashV3_data()
+{
+    QTest::addColumn<QByteArray>("content");
+    QTest::addColumn<QByteArray>("hash");
+
+    // The hash is the 64-bit xxHash, seed 0, of the first and the last 100 kB of the file,
+    // which are the whole file twice for smaller files. Expected values from the reference implementation.
+    QTest::newRow("empty")      << QByteArray()             << QByteArray("ef46db3751d8e999");
+    QTest::newRow("abc")        << QByteArray("abc")        << QByteArray("29e28a96b15f41e6");
+    QTest::newRow("1000 bytes") << pattern(1000)            << QByteArray("1cfa79572f5391b8");
+    QTest::newRow("300 kB")     << pattern(300 * 1024 + 17) << QByteArray("de0a296816a8574c");
+}
+
+void UniqueHashTest::testUniqueHashV3()
+{
+    QFETCH(QByteArray, content);
+    QFETCH(QByteArray, hash);
+
+    KTemporaryFile file;
+    QVERIFY(file.open());
+    QCOMPARE(file.write(content), (qint64)content.size());
+    file.flush();
+
+    QCOMPARE(DImg::getUniqueHashV3(file.fileName()), hash);
+}
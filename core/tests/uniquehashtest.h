@@ -0,0 +1,41 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-09
+ * Description : test of the unique hash of files
+ *
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef UNIQUEHASHTEST_H
+#define UNIQUEHASHTEST_H
+
+// Qt includes
+
+#include <QtCore/QObject>
+
+class UniqueHashTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void testUniqueHashV3_data();
+    void testUniqueHashV3();
+};
+
+#endif /* UNIQUEHASHTEST_H */
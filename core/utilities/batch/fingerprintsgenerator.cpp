@@ -22,6 +22,7 @@
  * ============================================================ */
 
 #include "fingerprintsgenerator.moc"
+#include "fingerprintsgenerator_p.moc"
 
 // Qt includes
 
@@ -31,10 +32,14 @@
 #include <QFileInfo>
 #include <QDateTime>
 #include <QCloseEvent>
+#include <QMutexLocker>
+#include <QPixmap>
+#include <QThread>
 
 // KDE includes
 
 #include <kapplication.h>
+#include <kurl.h>
 #include <kcodecs.h>
 #include <klocale.h>
 #include <kstandardguiitem.h>
@@ -48,13 +53,151 @@
 #include "databaseaccess.h"
 #include "haar.h"
 #include "haariface.h"
+#include "imageinfo.h"
 #include "previewloadthread.h"
 #include "knotificationwrapper.h"
 #include "metadatasettings.h"
+#include "fingerprintsgenerator_p.h"
 
 namespace Digikam
 {
 
+FingerPrintsWriter::FingerPrintsWriter()
+    : flushing(false)
+{
+}
+
+FingerPrintsWriter::~FingerPrintsWriter()
+{
+    // protect haarIface
+    shutDown();
+}
+
+void FingerPrintsWriter::add(qlonglong imageid, const Haar::SignatureData& sig)
+{
+    QMutexLocker lock(threadMutex());
+    pending.insert(imageid, sig);
+
+    if (pending.size() >= BatchSize)
+    {
+        start(lock);
+    }
+}
+
+void FingerPrintsWriter::flush()
+{
+    QMutexLocker lock(threadMutex());
+    flushing = true;
+    start(lock);
+}
+
+void FingerPrintsWriter::run()
+{
+    while (runningFlag())
+    {
+        QMap<qlonglong, Haar::SignatureData> batch;
+        bool                                 flushed = false;
+        {
+            QMutexLocker lock(threadMutex());
+
+            if (pending.size() >= BatchSize || (flushing && !pending.isEmpty()))
+            {
+                batch = pending;
+                pending.clear();
+            }
+            else
+            {
+                flushed  = flushing;
+                flushing = false;
+                stop(lock);
+            }
+        }
+
+        if (batch.isEmpty())
+        {
+            if (flushed)
+            {
+                emit signalFlushed();
+            }
+
+            continue;
+        }
+
+        // one transaction per batch
+        haarIface.storeSignatures(batch);
+    }
+}
+
+// ----------------------------------------------------------------------------------------
+
+FingerPrintsHasher::FingerPrintsHasher(FingerPrintsWriter* writer)
+    : writer(writer)
+{
+}
+
+FingerPrintsHasher::~FingerPrintsHasher()
+{
+    // protect haarIface
+    shutDown();
+}
+
+void FingerPrintsHasher::process(const QString& filePath, const DImg& image)
+{
+    QMutexLocker lock(threadMutex());
+    todo << qMakePair(filePath, image);
+    start(lock);
+}
+
+void FingerPrintsHasher::cancel()
+{
+    QMutexLocker lock(threadMutex());
+    todo.clear();
+    stop(lock);
+}
+
+void FingerPrintsHasher::run()
+{
+    while (runningFlag())
+    {
+        QPair<QString, DImg> item;
+        {
+            QMutexLocker lock(threadMutex());
+
+            if (todo.isEmpty())
+            {
+                stop(lock);
+                continue;
+            }
+
+            item = todo.takeFirst();
+        }
+
+        // compute Haar fingerprint
+        Haar::SignatureData sig;
+
+        if (haarIface.calculateSignature(item.second, &sig))
+        {
+            ImageInfo info(KUrl::fromPath(item.first));
+
+            if (!info.isNull())
+            {
+                writer->add(info.id(), sig);
+            }
+        }
+
+        QImage thumbnail;
+
+        if (!item.second.isNull())
+        {
+            thumbnail = item.second.smoothScale(128, 128, Qt::KeepAspectRatio).copyQImage();
+        }
+
+        emit signalProcessed(item.first, thumbnail);
+    }
+}
+
+// ----------------------------------------------------------------------------------------
+
 class FingerPrintsGenerator::FingerPrintsGeneratorPriv
 {
 public:
@@ -62,31 +205,70 @@ public:
     FingerPrintsGeneratorPriv() :
         cancel(false),
         rebuildAll(true),
-        previewLoadThread(0)
+        remaining(0),
+        inFlight(0),
+        maxInFlight(0),
+        nextLoader(0),
+        nextHasher(0),
+        writer(0)
     {
         duration.start();
     }
 
-    bool               cancel;
-    bool               rebuildAll;
+    bool                       cancel;
+    bool                       rebuildAll;
 
-    QTime              duration;
+    QTime                      duration;
 
-    QStringList        allPicturesPath;
+    /// Images not yet sent to the loaders
+    QStringList                allPicturesPath;
+    /// Images not yet processed
+    int                        remaining;
+    /// Images loading or waiting for a hasher. Limited for the memory cost.
+    int                        inFlight;
+    int                        maxInFlight;
 
-    PreviewLoadThread* previewLoadThread;
+    int                        nextLoader;
+    int                        nextHasher;
 
-    HaarIface          haarIface;
+    /// The pipeline: decoding, Haar transform and database writing run in separate threads
+    QList<PreviewLoadThread*>  previewLoadThreads;
+    QList<FingerPrintsHasher*> hashers;
+    FingerPrintsWriter*        writer;
 };
 
 FingerPrintsGenerator::FingerPrintsGenerator(QWidget* /*parent*/, bool rebuildAll)
     : DProgressDlg(0), d(new FingerPrintsGeneratorPriv)
 {
-    d->rebuildAll        = rebuildAll;
-    d->previewLoadThread = new PreviewLoadThread();
+    d->rebuildAll  = rebuildAll;
+    d->writer      = new FingerPrintsWriter;
+
+    connect(d->writer, SIGNAL(signalFlushed()),
+            this, SLOT(slotWriterFlushed()),
+            Qt::QueuedConnection);
+
+    const int threads = qMax(QThread::idealThreadCount(), 1);
+    d->maxInFlight    = 2 * threads;
+
+    for (int i = 0; i < threads; ++i)
+    {
+        PreviewLoadThread* thread = new PreviewLoadThread();
+        // Per default, only the last added image will be loaded
+        thread->setLoadingPolicy(PreviewLoadThread::LoadingPolicySimpleAppend);
+
+        connect(thread, SIGNAL(signalImageLoaded(const LoadingDescription&, const DImg&)),
+                this, SLOT(slotGotImagePreview(const LoadingDescription&, const DImg&)));
 
-    connect(d->previewLoadThread, SIGNAL(signalImageLoaded(const LoadingDescription&, const DImg&)),
-            this, SLOT(slotGotImagePreview(const LoadingDescription&, const DImg&)));
+        d->previewLoadThreads << thread;
+
+        FingerPrintsHasher* hasher = new FingerPrintsHasher(d->writer);
+
+        connect(hasher, SIGNAL(signalProcessed(const QString&, const QImage&)),
+                this, SLOT(slotImageProcessed(const QString&, const QImage&)),
+                Qt::QueuedConnection);
+
+        d->hashers << hasher;
+    }
 
     setModal(false);
     setValue(0);
@@ -99,6 +281,17 @@ FingerPrintsGenerator::FingerPrintsGenerator(QWidget* /*parent*/, bool rebuildAl
 
 FingerPrintsGenerator::~FingerPrintsGenerator()
 {
+    qDeleteAll(d->previewLoadThreads);
+    // the hashers pass their results to the writer
+    qDeleteAll(d->hashers);
+
+    // Do not wait for the database here: the writer deletes itself when the remaining signatures are written
+    d->writer->disconnect(this);
+    connect(d->writer, SIGNAL(signalFlushed()),
+            d->writer, SLOT(deleteLater()),
+            Qt::QueuedConnection);
+    d->writer->flush();
+
     delete d;
 }
 
@@ -123,6 +316,7 @@ void FingerPrintsGenerator::slotRebuildFingerPrints()
     }
 
     setMaximum(d->allPicturesPath.count());
+    d->remaining = d->allPicturesPath.count();
 
     if (d->allPicturesPath.isEmpty())
     {
@@ -130,22 +324,25 @@ void FingerPrintsGenerator::slotRebuildFingerPrints()
         return;
     }
 
-    processOne();
+    processMore();
 }
 
-void FingerPrintsGenerator::processOne()
+void FingerPrintsGenerator::processMore()
 {
-    if (d->cancel)
+    const bool exifRotate = MetadataSettings::instance()->settings().exifRotate;
+
+    while (!d->cancel && d->inFlight < d->maxInFlight && !d->allPicturesPath.isEmpty())
     {
-        return;
+        // Load at reduced size (scaled JPEG decoding, embedded RAW preview), on all loading threads
+        QString path = d->allPicturesPath.takeFirst();
+        LoadingDescription description(path, HaarIface::preferredSize(), exifRotate,
+                                       LoadingDescription::ConvertToSRGB);
+        description.rawDecodingSettings.rawPrm.sixteenBitsImage = false;
+
+        d->previewLoadThreads.at(d->nextLoader)->load(description);
+        d->nextLoader = (d->nextLoader + 1) % d->previewLoadThreads.size();
+        ++d->inFlight;
     }
-
-    QString path = d->allPicturesPath.first();
-    LoadingDescription description(path, HaarIface::preferredSize(),
-                                   MetadataSettings::instance()->settings().exifRotate,
-                                   LoadingDescription::ConvertToSRGB);
-    description.rawDecodingSettings.rawPrm.sixteenBitsImage = false;
-    d->previewLoadThread->load(description);
 }
 
 void FingerPrintsGenerator::complete()
@@ -164,39 +361,48 @@ void FingerPrintsGenerator::complete()
 
 void FingerPrintsGenerator::slotGotImagePreview(const LoadingDescription& desc, const DImg& img)
 {
-    if (d->allPicturesPath.isEmpty())
+    if (d->cancel)
     {
         return;
     }
 
-    if (d->allPicturesPath.first() != desc.filePath)
-    {
-        return;
-    }
+    // The Haar transform runs on the hashers, round-robin
+    d->hashers.at(d->nextHasher)->process(desc.filePath, img);
+    d->nextHasher = (d->nextHasher + 1) % d->hashers.size();
+}
 
-    if (!img.isNull())
+void FingerPrintsGenerator::slotImageProcessed(const QString& filePath, const QImage& thumbnail)
+{
+    if (d->cancel)
     {
-        // compute Haar fingerprint
-        d->haarIface.indexImage(desc.filePath, img);
+        return;
     }
 
-    QPixmap pix = DImg(img).smoothScale(128, 128, Qt::KeepAspectRatio).convertToPixmap();
-    addedAction(pix, desc.filePath);
+    addedAction(QPixmap::fromImage(thumbnail), filePath);
     advance(1);
 
-    if (!d->allPicturesPath.isEmpty())
-    {
-        d->allPicturesPath.removeFirst();
-    }
+    --d->inFlight;
+    --d->remaining;
 
-    if (d->allPicturesPath.isEmpty())
+    if (d->remaining <= 0)
     {
-        complete();
+        // write the last incomplete batch, complete() when done
+        d->writer->flush();
     }
     else
     {
-        processOne();
+        processMore();
+    }
+}
+
+void FingerPrintsGenerator::slotWriterFlushed()
+{
+    if (d->cancel)
+    {
+        return;
     }
+
+    complete();
 }
 
 void FingerPrintsGenerator::slotCancel()
@@ -214,6 +420,21 @@ void FingerPrintsGenerator::closeEvent(QCloseEvent* e)
 void FingerPrintsGenerator::abort()
 {
     d->cancel = true;
+
+    foreach (PreviewLoadThread* thread, d->previewLoadThreads)
+    {
+        thread->stopAllTasks();
+    }
+
+    foreach (FingerPrintsHasher* hasher, d->hashers)
+    {
+        hasher->cancel();
+        hasher->wait();
+    }
+
+    // keep what has been calculated so far, without waiting for the database
+    d->writer->flush();
+
     emit signalRebuildAllFingerPrintsDone();
 }
 
@@ -32,6 +32,7 @@
 
 #include "dprogressdlg.h"
 
+class QImage;
 class QWidget;
 
 class KUrl;
@@ -59,7 +60,7 @@ private:
 
     void abort();
     void complete();
-    void processOne();
+    void processMore();
 
 protected:
 
@@ -73,6 +74,8 @@ private Q_SLOTS:
 
     void slotRebuildFingerPrints();
     void slotGotImagePreview(const LoadingDescription&, const DImg&);
+    void slotImageProcessed(const QString&, const QImage&);
+    void slotWriterFlushed();
 
 private:
 
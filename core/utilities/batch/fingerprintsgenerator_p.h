@@ -0,0 +1,120 @@
+/* ============================================================
+ *
+ * This file is a part of digiKam project
+ * http://www.digikam.org
+ *
+ * Date        : 2011-03-08
+ * Description : finger-prints generator pipeline stages
+ *
+ * Copyright (C) 2008-2011 by Gilles Caulier <caulier dot gilles at gmail dot com>
+ * Copyright (C) 2011 by Marcel Wiesweg <marcel dot wiesweg at gmx dot de>
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation;
+ * either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * ============================================================ */
+
+#ifndef FINGERPRINTSGENERATOR_P_H
+#define FINGERPRINTSGENERATOR_P_H
+
+// Qt includes
+
+#include <QImage>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+
+// Local includes
+
+#include "dimg.h"
+#include "dynamicthread.h"
+#include "haar.h"
+#include "haariface.h"
+
+namespace Digikam
+{
+
+/** Collects calculated signatures and writes them to the database
+ *  in transactions of BatchSize rows, from a single thread.
+ */
+class FingerPrintsWriter : public DynamicThread
+{
+    Q_OBJECT
+
+public:
+
+    enum { BatchSize = 250 };
+
+public:
+
+    FingerPrintsWriter();
+    ~FingerPrintsWriter();
+
+    /// Thread-safe. Starts writing when a batch is complete.
+    void add(qlonglong imageid, const Haar::SignatureData& sig);
+
+    /// Writes all pending signatures. signalFlushed() is emitted when they are written.
+    void flush();
+
+Q_SIGNALS:
+
+    void signalFlushed();
+
+protected:
+
+    virtual void run();
+
+private:
+
+    QMap<qlonglong, Haar::SignatureData> pending;
+    bool                                 flushing;
+    HaarIface                            haarIface;
+};
+
+// ----------------------------------------------------------------------------------------
+
+/** Calculates the Haar signature of decoded images, passes it on to the writer,
+ *  and reports each processed image with a small thumbnail.
+ */
+class FingerPrintsHasher : public DynamicThread
+{
+    Q_OBJECT
+
+public:
+
+    FingerPrintsHasher(FingerPrintsWriter* writer);
+    ~FingerPrintsHasher();
+
+    /// Thread-safe. Queues the image for processing.
+    void process(const QString& filePath, const DImg& image);
+
+    /// Removes all queued images and stops processing.
+    void cancel();
+
+Q_SIGNALS:
+
+    void signalProcessed(const QString& filePath, const QImage& thumbnail);
+
+protected:
+
+    virtual void run();
+
+private:
+
+    QList<QPair<QString, DImg> > todo;
+    HaarIface                    haarIface;
+    FingerPrintsWriter* const    writer;
+};
+
+}  // namespace Digikam
+
+#endif /* FINGERPRINTSGENERATOR_P_H */
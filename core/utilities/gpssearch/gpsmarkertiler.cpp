@@ -52,7 +52,10 @@ class GPSMarkerTiler::MyTile : public Tile
 {
 public:
     MyTile()
-        : Tile()
+        : Tile(),
+          stateGeneration(-1),
+          selectedCount(0),
+          groupState(KMap::KMapSelectedNone)
     {
     }
 
@@ -60,7 +63,24 @@ public:
     {
     }
 
-    QList<qlonglong> imagesId;
+    /**
+     * @brief Marks the aggregated values as outdated, to be called whenever imagesId changes.
+     */
+    void invalidateAggregates()
+    {
+        stateGeneration = -1;
+        representatives.clear();
+    }
+
+    QList<qlonglong>       imagesId;
+
+    /// The following values aggregate the images of this tile. They are computed from the
+    /// child tiles if there are any, and are valid while stateGeneration equals the tiler's one.
+    int                    stateGeneration;
+    int                    selectedCount;
+    KMap::KMapGroupState   groupState;
+    /// best image of this tile per sort key
+    QHash<int, qlonglong>  representatives;
 };
 
 class GPSMarkerTiler::GPSMarkerTilerPrivate
@@ -88,14 +108,14 @@ public:
           thumbnailLoadThread(0),
           thumbnailMap(),
           rectList(),
-          rectLevel(),
           activeState(true),
           imagesHash(),
           imageFilterModel(),
           imageAlbumModel(),
           selectionModel(),
           currentRegionSelection(),
-          mapGlobalGroupState()
+          mapGlobalGroupState(),
+          stateGeneration(0)
     {
     }
 
@@ -103,7 +123,6 @@ public:
     ThumbnailLoadThread*                   thumbnailLoadThread;
     QHash<QString, QVariant>               thumbnailMap;
     QList<QRectF>                          rectList;
-    QList<int>                             rectLevel;
     bool                                   activeState;
     QHash<qlonglong, GPSImageInfo>         imagesHash;
     ImageFilterModel*                      imageFilterModel;
@@ -111,6 +130,8 @@ public:
     QItemSelectionModel*                   selectionModel;
     KMap::GeoCoordinates::Pair             currentRegionSelection;
     KMap::KMapGroupState                   mapGlobalGroupState;
+    /// incremented when the selection or filter state of the images may have changed
+    int                                    stateGeneration;
 };
 
 /**
@@ -136,6 +157,15 @@ GPSMarkerTiler::GPSMarkerTiler(QObject* const parent, ImageFilterModel* const im
     connect(d->imageAlbumModel, SIGNAL(imageInfosAdded(const QList<ImageInfo>&)),
             this, SLOT(slotNewModelData(const QList<ImageInfo>&)));
 
+    connect(d->imageAlbumModel, SIGNAL(imageInfosRemoved(const QList<ImageInfo>&)),
+            this, SLOT(slotNewModelData(const QList<ImageInfo>&)));
+
+    connect(d->imageFilterModel, SIGNAL(layoutChanged()),
+            this, SLOT(slotFilterModelChanged()));
+
+    connect(d->imageFilterModel, SIGNAL(modelReset()),
+            this, SLOT(slotFilterModelChanged()));
+
     connect(d->selectionModel, SIGNAL(selectionChanged(const QItemSelection&, const QItemSelection&)),
                 this, SLOT(slotSelectionChanged(const QItemSelection&, const QItemSelection&)));
 }
@@ -161,7 +191,8 @@ void GPSMarkerTiler::regenerateTiles()
  *
  * This function calls the database for the images found inside a rectangle
  * defined by upperLeft and lowerRight points. The images are returned from
- * the database in batches.
+ * the database in batches. The tiles are kept for all levels, so an area
+ * is only listed once, regardless of the level it is requested for.
  *
  * @param upperLeft The North-West point.
  * @param lowerRight The South-East point.
@@ -177,11 +208,6 @@ void GPSMarkerTiler::prepareTiles(const KMap::GeoCoordinates& upperLeft, const K
 
     for (int i=0; i<d->rectList.count(); ++i)
     {
-        if (level != d->rectLevel.at(i))
-        {
-            continue;
-        }
-
         qreal rectLat1, rectLng1, rectLat2, rectLng2;
         const QRectF currentRect = d->rectList.at(i);
         currentRect.getCoords(&rectLat1, &rectLng1, &rectLat2, &rectLng2);
@@ -228,7 +254,6 @@ void GPSMarkerTiler::prepareTiles(const KMap::GeoCoordinates& upperLeft, const K
 
     const QRectF newRect(lat1, lng1, lat2-lat1, lng2-lng1);
     d->rectList.append(newRect);
-    d->rectLevel.append(level);
 
     kDebug() << "Listing" << lat1 << lat2 << lng1 << lng2;
     DatabaseUrl u = DatabaseUrl::fromAreaRange(lat1, lat2, lng1, lng2);
@@ -273,7 +298,7 @@ KMap::AbstractMarkerTiler::Tile* GPSMarkerTiler::getTile(const KMap::TileIndex&
 
             for (int i=0; i<tile->imagesId.count(); ++i)
             {
-                const int currentImageId = tile->imagesId.at(i);
+                const qlonglong currentImageId = tile->imagesId.at(i);
                 const GPSImageInfo currentImageInfo = d->imagesHash[currentImageId];
                 const KMap::TileIndex markerTileIndex = KMap::TileIndex::fromCoordinates(currentImageInfo.coordinates, level);
                 const int newTileIndex = markerTileIndex.lastIndex();
@@ -291,6 +316,7 @@ KMap::AbstractMarkerTiler::Tile* GPSMarkerTiler::getTile(const KMap::TileIndex&
                     if (!newTile->imagesId.contains(currentImageId))
                     {
                         newTile->imagesId.append(currentImageId);
+                        newTile->invalidateAggregates();
                     }
                 }
             }
@@ -330,9 +356,16 @@ int GPSMarkerTiler::getTileMarkerCount(const KMap::TileIndex& tileIndex)
 
 int GPSMarkerTiler::getTileSelectedCount(const KMap::TileIndex& tileIndex)
 {
-    Q_UNUSED(tileIndex)
+    MyTile* const tile = static_cast<MyTile*>(getTile(tileIndex, true));
 
-    return 0;
+    if (!tile)
+    {
+        return 0;
+    }
+
+    updateTileAggregates(tile);
+
+    return tile->selectedCount;
 }
 
 /**
@@ -349,27 +382,14 @@ QVariant GPSMarkerTiler::getTileRepresentativeMarker(const KMap::TileIndex& tile
         return QVariant();
     }
 
-    if (tile->imagesId.isEmpty())
-    {
-        return QVariant();
-    }
+    const qlonglong bestMarkerId = tileRepresentative(tile, sortKey);
 
-    GPSImageInfo bestMarkerInfo = d->imagesHash.value(tile->imagesId.first());
-    KMap::KMapGroupState bestMarkerGroupState = getImageState(bestMarkerInfo.id);
-
-    for (int i=1; i<tile->imagesId.count(); ++i)
+    if (bestMarkerId == -1)
     {
-        const GPSImageInfo currentMarkerInfo = d->imagesHash.value(tile->imagesId.at(i));
-        const KMap::KMapGroupState currentMarkerGroupState = getImageState(currentMarkerInfo.id);
-
-        if (GPSImageInfoSorter::fitsBetter(bestMarkerInfo, bestMarkerGroupState, currentMarkerInfo, currentMarkerGroupState, getGlobalGroupState(), GPSImageInfoSorter::SortOptions(sortKey)))
-        {
-            bestMarkerInfo = currentMarkerInfo;
-            bestMarkerGroupState = currentMarkerGroupState;
-        }
+        return QVariant();
     }
 
-    const QPair<KMap::TileIndex, int> returnedMarker(tileIndex, bestMarkerInfo.id);
+    const QPair<KMap::TileIndex, int> returnedMarker(tileIndex, bestMarkerId);
 
     return QVariant::fromValue(returnedMarker);
 }
@@ -465,17 +485,15 @@ KMap::KMapGroupState GPSMarkerTiler::getTileGroupState(const KMap::TileIndex& ti
         return KMap::KMapSelectedNone;
     }
 
-    /// @todo Store this state in the tiles!
-    MyTile* tile = static_cast<MyTile*>(getTile(tileIndex, true));
-    KMap::KMapGroupStateComputer tileStateComputer;
-    for (int i=0; i<tile->imagesId.count(); ++i)
+    MyTile* const tile = static_cast<MyTile*>(getTile(tileIndex, true));
+    if (!tile)
     {
-        const KMap::KMapGroupState imageState = getImageState(tile->imagesId.at(i));
-
-        tileStateComputer.addState(imageState);
+        return KMap::KMapSelectedNone;
     }
 
-    return tileStateComputer.getState();
+    updateTileAggregates(tile);
+
+    return tile->groupState;
 }
 
 /**
@@ -587,6 +605,13 @@ void GPSMarkerTiler::slotMapImagesJobResult(KJob* job)
             continue;
         }
 
+        // Images listed before are already sorted into the tiles,
+        // changes to them arrive through slotImageChange
+        if (d->imagesHash.contains(currentImageInfo.id))
+        {
+            continue;
+        }
+
         d->imagesHash.insert(currentImageInfo.id, currentImageInfo);
 
         const KMap::TileIndex markerTileIndex = KMap::TileIndex::fromCoordinates(currentImageInfo.coordinates, KMap::TileIndex::MaxLevel);
@@ -756,15 +781,26 @@ void GPSMarkerTiler::slotNewModelData(const QList<ImageInfo>& infoList)
 {
     // We do not actually store the data from the model, we just want
     // to know that something was changed.
-    /// @todo Also monitor removed, reset, etc. signals
+    /// @todo Also monitor reset, etc. signals
     Q_UNUSED(infoList);
 
+    invalidateTileStates();
+
     emit(signalTilesOrSelectionChanged());
 }
 
+/**
+ * @brief The filtered images changed, therefore the states of the tiles are outdated
+ */
+void GPSMarkerTiler::slotFilterModelChanged()
+{
+    invalidateTileStates();
+}
+
 void GPSMarkerTiler::setRegionSelection(const KMap::GeoCoordinates::Pair& sel)
 {
     d->currentRegionSelection = sel;
+    invalidateTileStates();
 
     if (sel.first.hasCoordinates())
     {
@@ -783,6 +819,7 @@ void GPSMarkerTiler::removeCurrentRegionSelection()
     d->currentRegionSelection.first.clear();
 
     d->mapGlobalGroupState&= ~KMap::KMapRegionSelectedMask;
+    invalidateTileStates();
 
     emit(signalTilesOrSelectionChanged());
 }
@@ -933,6 +970,8 @@ void GPSMarkerTiler::setPositiveFilterIsActive(const bool state)
         d->mapGlobalGroupState&= ~KMap::KMapFilteredPositiveMask;
     }
 
+    invalidateTileStates();
+
     /// @todo Somehow, a delay is necessary before emitting this signal - probably the order in which the filtering is propagated to other parts of digikam is wrong or just takes too long
     QTimer::singleShot(100, this, SIGNAL(signalTilesOrSelectionChanged()));
 //     emit(signalTilesOrSelectionChanged());
@@ -940,9 +979,8 @@ void GPSMarkerTiler::setPositiveFilterIsActive(const bool state)
 
 void GPSMarkerTiler::slotSelectionChanged(const QItemSelection& selected, const QItemSelection& deselected)
 {
-    /// @todo Buffer this information, update the tiles, etc.
-    Q_UNUSED(selected);
-    Q_UNUSED(deselected);
+    invalidateTileStatesOfImages(selected.indexes());
+    invalidateTileStatesOfImages(deselected.indexes());
 
     emit(signalTilesOrSelectionChanged());
 }
@@ -960,6 +998,7 @@ void GPSMarkerTiler::removeMarkerFromTileAndChildren(const qlonglong imageId, co
         }
 
         currentTile->imagesId.removeOne(imageId);
+        currentTile->invalidateAggregates();
 
         if (currentTile->imagesId.isEmpty())
         {
@@ -994,6 +1033,9 @@ void GPSMarkerTiler::addMarkerToTileAndChildren(const qlonglong imageId, const K
             currentTile->imagesId.append(imageId);
         }
 
+        // the image may also have moved inside of this tile
+        currentTile->invalidateAggregates();
+
         if (currentTile->childrenEmpty())
         {
             break;
@@ -1010,4 +1052,168 @@ void GPSMarkerTiler::addMarkerToTileAndChildren(const qlonglong imageId, const K
     }
 }
 
+/**
+ * @brief Marks the selection and filter states of all tiles as outdated.
+ * They are recomputed when a tile is asked for them the next time.
+ */
+void GPSMarkerTiler::invalidateTileStates()
+{
+    ++d->stateGeneration;
+}
+
+/**
+ * @brief Marks the states of the tiles containing the given images as outdated.
+ *
+ * Only the tiles on the paths from the root tile to the images are touched, all other tiles
+ * keep their states.
+ */
+void GPSMarkerTiler::invalidateTileStatesOfImages(const QModelIndexList& imageIndexes)
+{
+    foreach (const QModelIndex& index, imageIndexes)
+    {
+        const qlonglong imageId = d->imageFilterModel->imageId(index);
+
+        if (!d->imagesHash.contains(imageId))
+        {
+            continue;
+        }
+
+        const KMap::TileIndex markerTileIndex = KMap::TileIndex::fromCoordinates(d->imagesHash.value(imageId).coordinates, KMap::TileIndex::MaxLevel);
+        MyTile* currentTile                   = static_cast<MyTile*>(rootTile());
+
+        for (int level = 0; level <= markerTileIndex.level(); ++level)
+        {
+            currentTile->invalidateAggregates();
+
+            if (currentTile->childrenEmpty())
+            {
+                break;
+            }
+
+            currentTile = static_cast<MyTile*>(currentTile->getChild(markerTileIndex.at(level)));
+            if (!currentTile)
+            {
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Computes the group state and the number of selected images of a tile, if they are outdated.
+ *
+ * Tiles with children combine the values of their children, which are kept for the next time.
+ * Only tiles without children look at the state of each image.
+ */
+void GPSMarkerTiler::updateTileAggregates(MyTile* const tile)
+{
+    if (tile->stateGeneration == d->stateGeneration)
+    {
+        return;
+    }
+
+    KMap::KMapGroupStateComputer tileStateComputer;
+    int selectedCount = 0;
+
+    if (tile->childrenEmpty())
+    {
+        for (int i=0; i<tile->imagesId.count(); ++i)
+        {
+            const KMap::KMapGroupState imageState = getImageState(tile->imagesId.at(i));
+
+            tileStateComputer.addState(imageState);
+
+            if ((imageState & KMap::KMapSelectedMask) == KMap::KMapSelectedAll)
+            {
+                ++selectedCount;
+            }
+        }
+    }
+    else
+    {
+        for (int i=0; i<Tile::maxChildCount(); ++i)
+        {
+            MyTile* const childTile = static_cast<MyTile*>(tile->getChild(i));
+
+            if (!childTile || childTile->imagesId.isEmpty())
+            {
+                continue;
+            }
+
+            updateTileAggregates(childTile);
+
+            tileStateComputer.addState(childTile->groupState);
+            selectedCount += childTile->selectedCount;
+        }
+    }
+
+    tile->groupState      = tileStateComputer.getState();
+    tile->selectedCount   = selectedCount;
+    tile->representatives.clear();
+    tile->stateGeneration = d->stateGeneration;
+}
+
+/**
+ * @brief Returns the best image of a tile for the given sort key, or -1 if the tile is empty.
+ *
+ * The result is kept in the tile. Tiles with children only compare the best images of their children.
+ */
+qlonglong GPSMarkerTiler::tileRepresentative(MyTile* const tile, const int sortKey)
+{
+    updateTileAggregates(tile);
+
+    QHash<int, qlonglong>::const_iterator it = tile->representatives.constFind(sortKey);
+    if (it != tile->representatives.constEnd())
+    {
+        return it.value();
+    }
+
+    QList<qlonglong> candidates;
+
+    if (tile->childrenEmpty())
+    {
+        candidates = tile->imagesId;
+    }
+    else
+    {
+        for (int i=0; i<Tile::maxChildCount(); ++i)
+        {
+            MyTile* const childTile = static_cast<MyTile*>(tile->getChild(i));
+
+            if (!childTile || childTile->imagesId.isEmpty())
+            {
+                continue;
+            }
+
+            candidates << tileRepresentative(childTile, sortKey);
+        }
+    }
+
+    qlonglong bestMarkerId = -1;
+
+    if (!candidates.isEmpty())
+    {
+        GPSImageInfo bestMarkerInfo = d->imagesHash.value(candidates.first());
+        KMap::KMapGroupState bestMarkerGroupState = getImageState(bestMarkerInfo.id);
+
+        for (int i=1; i<candidates.count(); ++i)
+        {
+            const GPSImageInfo currentMarkerInfo = d->imagesHash.value(candidates.at(i));
+            const KMap::KMapGroupState currentMarkerGroupState = getImageState(currentMarkerInfo.id);
+
+            if (GPSImageInfoSorter::fitsBetter(bestMarkerInfo, bestMarkerGroupState, currentMarkerInfo, currentMarkerGroupState, getGlobalGroupState(), GPSImageInfoSorter::SortOptions(sortKey)))
+            {
+                bestMarkerInfo = currentMarkerInfo;
+                bestMarkerGroupState = currentMarkerGroupState;
+            }
+        }
+
+        bestMarkerId = bestMarkerInfo.id;
+    }
+
+    tile->representatives.insert(sortKey, bestMarkerId);
+
+    return bestMarkerId;
+}
+
 } // namespace Digikam
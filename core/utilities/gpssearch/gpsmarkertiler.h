@@ -115,6 +115,7 @@ private Q_SLOTS:
     void slotThumbnailLoaded(const LoadingDescription&, const QPixmap&);
     void slotImageChange(const ImageChangeset& changeset);
     void slotSelectionChanged(const QItemSelection& selected, const QItemSelection& deselected);
+    void slotFilterModelChanged();
 
 private:
 
@@ -122,6 +123,10 @@ private:
     KMap::KMapGroupState getImageState(const qlonglong imageId);
     void removeMarkerFromTileAndChildren(const qlonglong imageId, const KMap::TileIndex& markerTileIndex, MyTile* const startTile, const int startTileLevel, MyTile* const parentTile);
     void addMarkerToTileAndChildren(const qlonglong imageId, const KMap::TileIndex& markerTileIndex, MyTile* const startTile, const int startTileLevel);
+    void invalidateTileStates();
+    void invalidateTileStatesOfImages(const QModelIndexList& imageIndexes);
+    void updateTileAggregates(MyTile* const tile);
+    qlonglong tileRepresentative(MyTile* const tile, const int sortKey);
 
     class GPSMarkerTilerPrivate;
     GPSMarkerTilerPrivate* const d;
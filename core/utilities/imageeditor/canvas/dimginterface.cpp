@@ -70,6 +70,7 @@
 #include "rawimport.h"
 #include "editortooliface.h"
 #include "dimg.h"
+#include "dimgtilestore.h"
 #include "dimgfiltergenerator.h"
 #include "bcgfilter.h"
 #include "equalizefilter.h"
@@ -438,6 +439,15 @@ void DImgInterface::slotImageLoaded(const LoadingDescription& loadingDescription
         d->height     = d->origHeight;
 
         updateColorManagement();
+
+        // Keep very large images in tiles, which can be moved to a scratch file.
+        // The canvas reads only the tiles it paints; the first filter moves them back to one buffer.
+        const qint64 residentLimit = DImgTileStore::residentLimit();
+
+        if (residentLimit > 0 && (qint64)d->image.numBytes() > residentLimit)
+        {
+            d->image.setTiled(true);
+        }
     }
     else
     {
@@ -162,7 +162,10 @@ void SetupDatabase::applySettings()
 
         if (oldDir != newDir || d->databaseWidget->currentDatabaseType() != d->databaseWidget->originalDbType)
         {
-            settings->setDatabaseParameters(DatabaseParameters::parametersForSQLiteDefaultFile(newPath));
+            DatabaseParameters params = DatabaseParameters::parametersForSQLiteDefaultFile(newPath);
+            // not offered in the dialog, keep the configured value
+            params.writeAheadLog = settings->getDatabaseParameters().writeAheadLog;
+            settings->setDatabaseParameters(params);
 
             // clear other fields
             d->databaseWidget->internalServer->setChecked(false);